@@ -0,0 +1,187 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file chargen_server.hpp
+ * @brief This file declares the TCP and UDP character generator servers
+ * (RFC 864).
+ */
+#pragma once
+#ifndef ECHO_CHARGEN_SERVER_HPP
+#define ECHO_CHARGEN_SERVER_HPP
+#include "echo/tcp_server.hpp"
+#include "echo/udp_server.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <span>
+#include <vector>
+/** @namespace For echo services. */
+namespace echo {
+/**
+ * @brief The character generator pattern.
+ * @details Each line holds 72 printable ASCII characters followed by CRLF,
+ * and each line starts one character further along than the line before.
+ * The stream repeats after 95 lines.
+ */
+struct chargen_pattern {
+  /** @brief The number of characters on a line. */
+  static constexpr std::size_t LINE = 72;
+  /** @brief The number of printable ASCII characters. */
+  static constexpr std::size_t CHARS = 95;
+  /** @brief The length of a line, including CRLF. */
+  static constexpr std::size_t STRIDE = LINE + 2;
+  /** @brief The length of the stream before it repeats. */
+  static constexpr std::size_t PERIOD = CHARS * STRIDE;
+
+  /**
+   * @brief The precomputed pattern.
+   * @details The stream is stored twice over, so that the PERIOD bytes
+   * starting at any offset below PERIOD are contiguous.
+   * @returns The pattern, 2 * PERIOD bytes long.
+   */
+  static auto bytes() noexcept -> std::span<const std::byte>;
+};
+
+/**
+ * @brief A TCP character generator server.
+ * @details Each connection sends straight from the precomputed pattern, so
+ * nothing is copied in user-space. Bytes received from the client are
+ * read into one shared buffer and thrown away.
+ */
+class tcp_chargen_server : public tcp_base<tcp_chargen_server> {
+public:
+  /** @brief The base class. */
+  using Base = tcp_base<tcp_chargen_server>;
+  /** @brief The socket message type. */
+  using socket_message = io::socket::socket_message<sockaddr_in6>;
+  /** @brief The state of a single connection. */
+  struct connection {
+    /** @brief The offset of the next byte into the pattern. */
+    std::size_t offset = 0;
+  };
+  /** @brief A connections type. */
+  using connections = std::vector<std::optional<connection>>;
+
+  /**
+   * @brief Constructs the chargen server on the socket address.
+   * @tparam T The type of the socket_address.
+   * @param address The local IP address to bind to.
+   */
+  template <typename T>
+  explicit tcp_chargen_server(socket_address<T> address) noexcept
+      : Base(address)
+  {}
+
+  /**
+   * @brief Initializes socket options.
+   * @param sock The socket to initialize.
+   * @returns A portable error_code.
+   */
+  [[nodiscard]] static auto
+  initialize(const socket_handle &sock) noexcept -> std::error_code;
+
+  /** @brief Runs when the server receives a terminate signal. */
+  auto stop() noexcept -> void;
+
+  /**
+   * @brief Sends the pattern until the connection is closed.
+   * @param ctx The asynchronous context of the connection.
+   * @param socket The socket to send on.
+   */
+  auto generate(async_context &ctx, const socket_dialog &socket) -> void;
+
+  /**
+   * @brief Receives the bytes emitted by the service_base reader.
+   * @param ctx The asynchronous context of the message.
+   * @param socket The socket that the message was read from.
+   * @param rctx The read context that manages the read buffer lifetime.
+   * @param buf The bytes that were read from the socket.
+   */
+  auto service(async_context &ctx, const socket_dialog &socket,
+               const std::shared_ptr<read_context> &rctx,
+               std::span<const std::byte> buf) -> void;
+
+private:
+  /** @brief The receive buffer shared by every connection. */
+  std::vector<std::byte> buffer_ = std::vector<std::byte>(TCP_BUFSIZE);
+  /** @brief Active connections. */
+  connections active_;
+  /** @brief The number of bytes sent. */
+  std::uint64_t sent_ = 0;
+  /** @brief Set once stop() has run. */
+  bool stopped_ = false;
+};
+
+/**
+ * @brief A UDP character generator server.
+ * @details Every datagram received is answered with a datagram of between
+ * 0 and 512 characters, starting one line further into the pattern each
+ * time.
+ */
+class udp_chargen_server : public udp_base<udp_chargen_server> {
+public:
+  /** @brief The base class. */
+  using Base = udp_base<udp_chargen_server>;
+  /** @brief The socket message type. */
+  using socket_message = io::socket::socket_message<sockaddr_in6>;
+  /** @brief The longest reply. */
+  static constexpr std::size_t MAX_REPLY = 512;
+
+  /**
+   * @brief Constructs the chargen server on the socket address.
+   * @tparam T The type of the socket_address.
+   * @param address The local IP address to bind to.
+   */
+  template <typename T>
+  explicit udp_chargen_server(socket_address<T> address) noexcept
+      : Base(address)
+  {}
+
+  /**
+   * @brief Initializes socket options.
+   * @param sock The socket to initialize.
+   * @returns A portable error_code.
+   */
+  [[nodiscard]] static auto
+  initialize(const socket_handle &sock) noexcept -> std::error_code;
+
+  /** @brief Runs when the server receives a terminate signal. */
+  auto stop() noexcept -> void;
+
+  /**
+   * @brief Receives the bytes emitted by the service_base reader.
+   * @param ctx The asynchronous context of the message.
+   * @param socket The socket that the message was read from.
+   * @param rctx The read context that manages the read buffer lifetime.
+   * @param buf The bytes that were read from the socket.
+   */
+  auto service(async_context &ctx, const socket_dialog &socket,
+               const std::shared_ptr<read_context> &rctx,
+               std::span<const std::byte> buf) -> void;
+
+private:
+  /** @brief The offset of the next reply into the pattern. */
+  std::size_t offset_ = 0;
+  /** @brief Chooses the length of each reply. */
+  std::minstd_rand random_;
+  /** @brief The number of datagrams sent. */
+  std::uint64_t sent_ = 0;
+  /** @brief Set once stop() has run. */
+  bool stopped_ = false;
+};
+} // namespace echo
+#endif // ECHO_CHARGEN_SERVER_HPP
@@ -0,0 +1,107 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file activation.hpp
+ * @brief This file declares helpers for socket activation and readiness
+ * notification by a service manager.
+ * @details Inherited listeners follow the `LISTEN_FDS` convention: the
+ * service manager passes `LISTEN_FDS` sockets starting at file descriptor
+ * 3, and sets `LISTEN_PID` to the pid they are meant for. Readiness is
+ * reported with `sd_notify` style datagrams sent to `NOTIFY_SOCKET`.
+ */
+#pragma once
+#ifndef ECHO_ACTIVATION_HPP
+#define ECHO_ACTIVATION_HPP
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include <sys/types.h>
+/** @namespace For internal echo server implementation details. */
+namespace echo::detail {
+/** @brief The first file descriptor passed by the service manager. */
+static constexpr int LISTEN_FDS_START = 3;
+
+/**
+ * @brief Takes the listening sockets passed by the service manager.
+ * @details The sockets are marked close-on-exec, and `LISTEN_PID`,
+ * `LISTEN_FDS` and `LISTEN_FDNAMES` are removed from the environment so
+ * that they are not passed on to child processes.
+ * @returns The inherited sockets, empty if there are none.
+ */
+auto listen_fds() noexcept -> std::vector<int>;
+
+/**
+ * @brief Lists the sockets that this process has open.
+ * @returns The socket descriptors.
+ */
+auto sockets() noexcept -> std::vector<int>;
+
+/**
+ * @brief Finds the socket for a server.
+ * @details A stream socket must be listening to match.
+ * @param fds The sockets to search.
+ * @param type The socket type, SOCK_STREAM or SOCK_DGRAM.
+ * @param port The local port in host byte order.
+ * @returns The matching socket, or -1 if there is none.
+ */
+auto find_listener(const std::vector<int> &fds, int type,
+                   unsigned short port) noexcept -> int;
+
+/**
+ * @brief Checks that a server's socket is serving its address.
+ * @details A stream socket must be listening and a datagram socket must
+ * be bound to a port.
+ * @param fd The socket to check.
+ * @returns true if the socket is serving.
+ */
+auto serving(int fd) noexcept -> bool;
+
+/**
+ * @brief Replaces a socket with an inherited socket.
+ * @details The inherited socket is duplicated onto the file descriptor
+ * number of the replaced socket, so that anything watching that number
+ * now watches the inherited socket. The inherited descriptor is closed.
+ * @param inherited The inherited socket.
+ * @param sockfd The socket to replace.
+ * @returns A portable error_code.
+ */
+auto adopt_socket(int inherited, int sockfd) noexcept -> std::error_code;
+
+/**
+ * @brief Executes a program that inherits sockets.
+ * @details The sockets are passed following the `LISTEN_FDS` convention.
+ * No other descriptor is passed on, apart from the standard streams.
+ * @param path The program to execute.
+ * @param argv The null-terminated program arguments.
+ * @param fds The sockets to pass.
+ * @param env Extra `NAME=VALUE` environment variables.
+ * @returns The pid of the new process, or -1 if it could not be forked.
+ */
+auto spawn(const char *path, char *const argv[], const std::vector<int> &fds,
+           const std::vector<std::string> &env) noexcept -> pid_t;
+
+/**
+ * @brief Sends a state change to the service manager.
+ * @details Does nothing if `NOTIFY_SOCKET` is not set. An address that
+ * starts with `@` is in the abstract namespace.
+ * @param state Newline separated assignments, such as `READY=1`.
+ * @returns A portable error_code.
+ */
+auto notify(std::string_view state) noexcept -> std::error_code;
+} // namespace echo::detail
+#endif // ECHO_ACTIVATION_HPP
@@ -0,0 +1,37 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file address.hpp
+ * @brief This file declares socket address formatting for the echo tools.
+ */
+#pragma once
+#ifndef ECHO_ADDRESS_HPP
+#define ECHO_ADDRESS_HPP
+#include <string>
+
+#include <netinet/in.h>
+/** @namespace For internal echo server implementation details. */
+namespace echo::detail {
+/**
+ * @brief Formats a recorded socket address.
+ * @param address The address. An IPv4 address is stored as a sockaddr_in.
+ * @param with_port Append the port number.
+ * @returns `host:port` for IPv4 and `[host]:port` for IPv6.
+ */
+auto format_address(const sockaddr_in6 &address,
+                    bool with_port = true) -> std::string;
+} // namespace echo::detail
+#endif // ECHO_ADDRESS_HPP
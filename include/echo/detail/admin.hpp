@@ -0,0 +1,272 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file admin.hpp
+ * @brief This file declares the admin socket and the live accounting that
+ * it reports.
+ */
+#pragma once
+#ifndef ECHO_ADMIN_HPP
+#define ECHO_ADMIN_HPP
+#include "echo/detail/timestamps.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <netinet/in.h>
+#include <sys/types.h>
+/** @namespace For internal echo server implementation details. */
+namespace echo::detail {
+/**
+ * @brief Adds to a counter that only one thread writes.
+ * @details A relaxed load and store is a plain move, where an atomic
+ * read-modify-write would lock the bus.
+ * @param counter The counter.
+ * @param value The value to add.
+ */
+inline auto add(std::atomic<std::uint64_t> &counter,
+                std::uint64_t value) noexcept -> void
+{
+  counter.store(counter.load(std::memory_order_relaxed) + value,
+                std::memory_order_relaxed);
+}
+
+/** @brief The accounting of a server's event loop thread. */
+struct loop_stats {
+  /** @brief The name of the server. */
+  std::string name;
+  /** @brief The thread id, once the server has started. */
+  std::atomic<pid_t> tid = 0;
+  /** @brief The number of receive events serviced. */
+  std::atomic<std::uint64_t> events = 0;
+  /** @brief The number of bytes received. */
+  std::atomic<std::uint64_t> bytes_in = 0;
+  /** @brief The number of bytes sent. */
+  std::atomic<std::uint64_t> bytes_out = 0;
+
+  /**
+   * @brief Constructs the stats of a server.
+   * @param server The name of the server.
+   */
+  explicit loop_stats(std::string server) noexcept
+      : name{std::move(server)}
+  {}
+};
+
+/**
+ * @brief Reads the CPU time a thread has used.
+ * @param tid The thread id.
+ * @returns The user and system time, or zero if the thread is gone.
+ */
+auto cpu_time(pid_t tid) noexcept -> std::chrono::milliseconds;
+
+/**
+ * @brief The accounting of one connection.
+ * @details The counters are written by the server thread and read by the
+ * admin thread.
+ */
+struct connection_entry {
+  /** @brief The time the connection was opened. */
+  wall_clock::time_point opened;
+  /** @brief The size of the receive buffer. */
+  std::size_t buffer_size = 0;
+  /** @brief The number of bytes received. */
+  std::atomic<std::uint64_t> bytes_in = 0;
+  /** @brief The number of bytes sent. */
+  std::atomic<std::uint64_t> bytes_out = 0;
+  /** @brief The number of bytes received but not yet sent. */
+  std::atomic<std::uint64_t> pending = 0;
+  /** @brief Set while the descriptor belongs to the connection. */
+  bool open = false;
+
+  /**
+   * @brief Accounts for received bytes.
+   * @param len The number of bytes.
+   */
+  auto received(std::uint64_t len) noexcept -> void
+  {
+    add(bytes_in, len);
+    add(pending, len);
+  }
+
+  /**
+   * @brief Accounts for sent bytes.
+   * @param len The number of bytes.
+   */
+  auto sent(std::uint64_t len) noexcept -> void
+  {
+    add(bytes_out, len);
+    pending.store(pending.load(std::memory_order_relaxed) - len,
+                  std::memory_order_relaxed);
+  }
+};
+
+/** @brief A snapshot of one connection. */
+struct connection_info {
+  /** @brief The socket descriptor. */
+  int fd;
+  /** @brief The peer address. */
+  sockaddr_in6 peer;
+  /** @brief How long the connection has been open. */
+  std::chrono::milliseconds age;
+  /** @brief The number of bytes received. */
+  std::uint64_t bytes_in;
+  /** @brief The number of bytes sent. */
+  std::uint64_t bytes_out;
+  /** @brief The number of bytes received but not yet sent. */
+  std::uint64_t pending;
+  /** @brief The size of the receive buffer. */
+  std::size_t buffer_size;
+};
+
+/**
+ * @brief The live connections of a server, indexed by socket descriptor.
+ * @details Entries never move, so the server thread updates the counters
+ * of an entry it holds without a lock. Opening and closing an entry, and
+ * reading the table, take the lock. The server closes an entry before it
+ * closes the socket, so a descriptor with an open entry is still the
+ * connection's while the lock is held.
+ */
+class connection_table {
+public:
+  /**
+   * @brief Opens the entry of a new connection.
+   * @param fd The socket descriptor.
+   * @param opened The time the connection was opened.
+   * @param buffer_size The size of its receive buffer.
+   * @returns The entry, valid until the table is destroyed.
+   */
+  auto open(int fd, wall_clock::time_point opened, std::size_t buffer_size)
+      -> connection_entry &;
+
+  /**
+   * @brief Closes the entry of a connection.
+   * @param fd The socket descriptor.
+   */
+  auto close(int fd) noexcept -> void;
+
+  /**
+   * @brief Reads the open connections.
+   * @details Peer addresses are read from the sockets, so the server
+   * doesn't look them up for connections that are never listed.
+   * @returns A snapshot of each open connection.
+   */
+  [[nodiscard]] auto snapshot() const -> std::vector<connection_info>;
+
+  /**
+   * @brief Shuts a connection down, which the server sees as end of file.
+   * @param fd The socket descriptor.
+   * @returns false if the descriptor isn't an open connection.
+   */
+  auto shutdown(int fd) noexcept -> bool;
+
+  /** @returns The number of open connections. */
+  [[nodiscard]] auto size() const noexcept -> std::size_t;
+
+private:
+  /** @brief Guards opening, closing and reading entries. */
+  mutable std::mutex mtx_;
+  /** @brief The entries, indexed by socket descriptor. */
+  std::vector<std::unique_ptr<connection_entry>> entries_;
+  /** @brief The number of open connections. */
+  std::size_t size_ = 0;
+};
+
+/**
+ * @brief A Unix socket that answers admin commands.
+ * @details Clients send one command per line and get the handler's
+ * response back, followed by an empty line. Clients are served one at a
+ * time, and a client that stalls for a second is disconnected.
+ */
+class admin_socket {
+public:
+  /** @brief Answers a command with lines that each end in a newline. */
+  using handler_type = std::function<std::string(std::string_view)>;
+
+  /** @brief Default constructor. */
+  admin_socket() noexcept = default;
+  /** @brief Deleted copy constructor. */
+  admin_socket(const admin_socket &) = delete;
+  /**
+   * @brief Move constructor.
+   * @param other The admin socket to move from.
+   */
+  admin_socket(admin_socket &&other) noexcept;
+  /** @brief Deleted copy assignment. */
+  auto operator=(const admin_socket &) -> admin_socket & = delete;
+  /**
+   * @brief Move assignment.
+   * @param other The admin socket to move from.
+   * @returns A reference to this admin socket.
+   */
+  auto operator=(admin_socket &&other) noexcept -> admin_socket &;
+  /** @brief Closes and unlinks the socket. */
+  ~admin_socket();
+
+  /**
+   * @brief Listens on a socket path that only the owner can connect to.
+   * @details A stale socket left at the path is replaced.
+   * @param path The socket path.
+   * @param error Set if the socket could not be created.
+   * @returns The admin socket.
+   */
+  static auto create(const std::string &path,
+                     std::error_code &error) noexcept -> admin_socket;
+
+  /**
+   * @brief Serves clients until stop() is called.
+   * @param handler Answers each command.
+   */
+  auto run(const handler_type &handler) -> void;
+
+  /**
+   * @brief Stops run().
+   * @details Safe to call from any thread.
+   */
+  auto stop() noexcept -> void;
+
+  /** @brief Checks that the socket is open. */
+  [[nodiscard]] explicit operator bool() const noexcept;
+
+private:
+  /**
+   * @brief Answers the commands of one client until it disconnects.
+   * @param client The client socket.
+   * @param handler Answers each command.
+   */
+  auto serve(int client, const handler_type &handler) -> void;
+
+  /** @brief Closes and unlinks the socket. */
+  auto close() noexcept -> void;
+
+  /** @brief The socket path. */
+  std::string path_;
+  /** @brief The listening socket. */
+  int listener_ = -1;
+  /** @brief An eventfd that stops run(). */
+  int stop_ = -1;
+};
+} // namespace echo::detail
+#endif // ECHO_ADMIN_HPP
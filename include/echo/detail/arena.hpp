@@ -0,0 +1,207 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file arena.hpp
+ * @brief This file declares a hugepage-backed arena for echo buffers.
+ */
+#pragma once
+#ifndef ECHO_ARENA_HPP
+#define ECHO_ARENA_HPP
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <system_error>
+/** @namespace For internal echo server implementation details. */
+namespace echo::detail {
+/**
+ * @brief A region of prefaulted memory that echo buffers are carved from.
+ * @details The region is mapped with `MAP_HUGETLB` when hugepages are
+ * reserved, and otherwise with transparent hugepages requested through
+ * `madvise`. It is bound to the NUMA node of the calling thread and
+ * faulted in up front, so buffers never take a page fault on first touch.
+ * Blocks are handed out in power-of-two size classes of at least a cache
+ * line, and freed blocks are kept on a free list per class. Allocation
+ * takes a lock, so an arena can be shared by the server threads.
+ */
+class arena {
+public:
+  /** @brief The size of a hugepage. */
+  static constexpr std::size_t HUGEPAGE = 2UL * 1024 * 1024;
+  /** @brief The smallest block, and the alignment of every block. */
+  static constexpr std::size_t MIN_BLOCK = 64;
+
+  /** @brief Constructs an arena that holds nothing. */
+  arena() noexcept = default;
+  /** @brief Deleted copy constructor. */
+  arena(const arena &) = delete;
+  /**
+   * @brief Move constructor.
+   * @param other The arena to move from.
+   */
+  arena(arena &&other) noexcept;
+  /** @brief Deleted copy assignment. */
+  auto operator=(const arena &) -> arena & = delete;
+  /**
+   * @brief Move assignment.
+   * @param other The arena to move from.
+   * @returns A reference to this arena.
+   */
+  auto operator=(arena &&other) noexcept -> arena &;
+  /** @brief Unmaps the region. */
+  ~arena();
+
+  /**
+   * @brief Maps and prefaults an arena.
+   * @param size The size of the region, rounded up to a hugepage.
+   * @param error Set if the region could not be mapped.
+   * @returns The arena.
+   */
+  static auto create(std::size_t size, std::error_code &error) noexcept
+      -> arena;
+
+  /**
+   * @brief Allocates a block.
+   * @param size The size of the block in bytes.
+   * @returns The block, or nullptr if the arena is exhausted.
+   */
+  [[nodiscard]] auto allocate(std::size_t size) noexcept -> void *;
+
+  /**
+   * @brief Returns a block to its free list.
+   * @param ptr A block returned by allocate().
+   * @param size The size that the block was allocated with.
+   */
+  auto deallocate(void *ptr, std::size_t size) noexcept -> void;
+
+  /**
+   * @brief Checks whether a block was allocated from this arena.
+   * @param ptr The block.
+   * @returns true if the block lies inside the region.
+   */
+  [[nodiscard]] auto contains(const void *ptr) const noexcept -> bool;
+
+  /** @returns The size of the region in bytes. */
+  [[nodiscard]] auto size() const noexcept -> std::size_t;
+
+  /** @returns The bytes handed out, including freed blocks. */
+  [[nodiscard]] auto used() const noexcept -> std::size_t;
+
+  /** @returns true if the region is backed by reserved hugepages. */
+  [[nodiscard]] auto hugetlb() const noexcept -> bool;
+
+  /** @returns The NUMA node that the region is bound to. */
+  [[nodiscard]] auto node() const noexcept -> int;
+
+  /** @returns true if the arena holds a region. */
+  explicit operator bool() const noexcept;
+
+  /**
+   * @brief Sets the arena that arena_allocator allocates from.
+   * @details Every buffer allocated from the arena must be freed before it
+   * is replaced.
+   * @param arena The arena, or nullptr to allocate from the heap.
+   */
+  static auto install(arena *arena) noexcept -> void;
+
+  /** @returns The installed arena, or nullptr if there is none. */
+  static auto installed() noexcept -> arena *;
+
+private:
+  /** @brief The number of size classes. */
+  static constexpr std::size_t CLASSES = 48;
+
+  /** @brief A freed block. */
+  struct free_block {
+    /** @brief The next freed block of the same class. */
+    free_block *next;
+  };
+
+  /** @brief Unmaps the region. */
+  auto close() noexcept -> void;
+
+  /** @brief The base of the region. */
+  std::byte *base_ = nullptr;
+  /** @brief The size of the region. */
+  std::size_t size_ = 0;
+  /** @brief The offset of the first byte that hasn't been handed out. */
+  std::size_t offset_ = 0;
+  /** @brief Set if the region is backed by reserved hugepages. */
+  bool hugetlb_ = false;
+  /** @brief The NUMA node that the region is bound to. */
+  int node_ = -1;
+  /** @brief The free list of each size class. */
+  std::array<free_block *, CLASSES> free_ = {};
+  /** @brief Guards the bump pointer and the free lists. */
+  std::mutex mtx_;
+};
+
+/**
+ * @brief Allocates from the installed arena.
+ * @details Falls back to the heap when no arena is installed or the arena
+ * is exhausted, so containers work the same with or without one.
+ * @tparam T The value type.
+ */
+template <typename T> struct arena_allocator {
+  /** @brief The value type. */
+  using value_type = T;
+
+  /** @brief Default constructor. */
+  arena_allocator() noexcept = default;
+  /** @brief Rebinding constructor. */
+  template <typename U>
+  explicit(false) arena_allocator(const arena_allocator<U> & /*other*/) noexcept
+  {}
+
+  /**
+   * @brief Allocates storage.
+   * @param count The number of values.
+   * @returns The storage.
+   */
+  [[nodiscard]] auto allocate(std::size_t count) -> T *
+  {
+    if (auto *arena = arena::installed())
+    {
+      if (auto *ptr = arena->allocate(count * sizeof(T)))
+        return static_cast<T *>(ptr);
+    }
+    return std::allocator<T>().allocate(count);
+  }
+
+  /**
+   * @brief Frees storage.
+   * @param ptr The storage.
+   * @param count The number of values.
+   */
+  auto deallocate(T *ptr, std::size_t count) noexcept -> void
+  {
+    if (auto *arena = arena::installed(); arena && arena->contains(ptr))
+      return arena->deallocate(ptr, count * sizeof(T));
+
+    std::allocator<T>().deallocate(ptr, count);
+  }
+
+  /** @returns true, every arena_allocator allocates from the same arena. */
+  template <typename U>
+  friend constexpr auto operator==(const arena_allocator & /*lhs*/,
+                                   const arena_allocator<U> & /*rhs*/) noexcept
+      -> bool
+  {
+    return true;
+  }
+};
+} // namespace echo::detail
+#endif // ECHO_ARENA_HPP
@@ -0,0 +1,260 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file bpf.hpp
+ * @brief This file declares a minimal eBPF assembler and loader.
+ */
+#pragma once
+#ifndef ECHO_BPF_HPP
+#define ECHO_BPF_HPP
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <system_error>
+#include <vector>
+
+#include <linux/bpf.h>
+/** @namespace For eBPF programs and maps, loaded without libbpf. */
+namespace echo::detail::bpf {
+/** @brief The eBPF registers. */
+enum reg : std::uint8_t { R0, R1, R2, R3, R4, R5, R6, R7, R8, R9, R10 };
+
+/**
+ * @brief Assembles eBPF instructions.
+ * @details Jumps go to labels, which are resolved by finish(). Loads and
+ * stores take the access size as BPF_B, BPF_H, BPF_W or BPF_DW, and
+ * conditional jumps take the comparison as BPF_JEQ, BPF_JGT and so on.
+ * Packet fields are loaded in network byte order, so the immediates they
+ * are compared with must be too.
+ */
+class assembler {
+public:
+  /** @brief A jump target. */
+  using label = std::size_t;
+
+  /** @returns A new label, to be bound to an instruction. */
+  auto make_label() -> label;
+
+  /**
+   * @brief Binds a label to the next instruction.
+   * @param target The label.
+   */
+  auto bind(label target) -> void;
+
+  /**
+   * @brief Sets dst to an immediate.
+   * @param dst The destination register.
+   * @param imm The immediate.
+   */
+  auto mov(reg dst, std::int32_t imm) -> void;
+
+  /**
+   * @brief Converts dst from network to host byte order.
+   * @param dst The register to convert.
+   * @param bits The width of the value, 16, 32 or 64.
+   */
+  auto to_host(reg dst, std::int32_t bits) -> void;
+
+  /**
+   * @brief Copies src into dst.
+   * @param dst The destination register.
+   * @param src The source register.
+   */
+  auto mov(reg dst, reg src) -> void;
+
+  /**
+   * @brief Applies a 64-bit ALU operation with an immediate.
+   * @param op The operation, e.g. BPF_ADD.
+   * @param dst The destination register.
+   * @param imm The immediate.
+   */
+  auto alu(std::uint8_t op, reg dst, std::int32_t imm) -> void;
+
+  /**
+   * @brief Applies a 64-bit ALU operation with a register.
+   * @param op The operation, e.g. BPF_ADD.
+   * @param dst The destination register.
+   * @param src The source register.
+   */
+  auto alu(std::uint8_t op, reg dst, reg src) -> void;
+
+  /**
+   * @brief Loads dst from memory.
+   * @param size The access size.
+   * @param dst The destination register.
+   * @param src The register that holds the address.
+   * @param off The offset from the address.
+   */
+  auto load(std::uint8_t size, reg dst, reg src, std::int16_t off) -> void;
+
+  /**
+   * @brief Stores src to memory.
+   * @param size The access size.
+   * @param dst The register that holds the address.
+   * @param off The offset from the address.
+   * @param src The register to store.
+   */
+  auto store(std::uint8_t size, reg dst, std::int16_t off, reg src) -> void;
+
+  /**
+   * @brief Stores an immediate to memory.
+   * @param size The access size.
+   * @param dst The register that holds the address.
+   * @param off The offset from the address.
+   * @param imm The immediate to store.
+   */
+  auto store(std::uint8_t size, reg dst, std::int16_t off, std::int32_t imm)
+      -> void;
+
+  /**
+   * @brief Loads a map into dst.
+   * @param dst The destination register.
+   * @param map The map descriptor.
+   */
+  auto load_map(reg dst, int map) -> void;
+
+  /**
+   * @brief Jumps to target.
+   * @param target The label to jump to.
+   */
+  auto jump(label target) -> void;
+
+  /**
+   * @brief Jumps to target if comparing dst with an immediate holds.
+   * @param op The comparison.
+   * @param dst The register to compare.
+   * @param imm The immediate.
+   * @param target The label to jump to.
+   */
+  auto jump(std::uint8_t op, reg dst, std::int32_t imm, label target) -> void;
+
+  /**
+   * @brief Jumps to target if comparing dst with src holds.
+   * @param op The comparison.
+   * @param dst The register to compare.
+   * @param src The register to compare with.
+   * @param target The label to jump to.
+   */
+  auto jump(std::uint8_t op, reg dst, reg src, label target) -> void;
+
+  /**
+   * @brief Calls a helper function.
+   * @param helper The helper, e.g. BPF_FUNC_map_lookup_elem.
+   */
+  auto call(std::int32_t helper) -> void;
+
+  /** @brief Returns R0 from the program. */
+  auto exit() -> void;
+
+  /**
+   * @brief Resolves the jumps.
+   * @returns The program.
+   */
+  [[nodiscard]] auto finish() const -> std::vector<bpf_insn>;
+
+private:
+  /**
+   * @brief Appends an instruction.
+   * @param insn The instruction.
+   */
+  auto emit(const bpf_insn &insn) -> void;
+
+  /** @brief A jump to be resolved. */
+  struct fixup {
+    /** @brief The index of the jump instruction. */
+    std::size_t insn;
+    /** @brief The label it jumps to. */
+    label target;
+  };
+
+  /** @brief The instructions. */
+  std::vector<bpf_insn> insns_;
+  /** @brief The instruction index of each label. */
+  std::vector<std::size_t> labels_;
+  /** @brief The jumps to resolve. */
+  std::vector<fixup> fixups_;
+};
+
+/**
+ * @brief Creates a map.
+ * @param type The map type.
+ * @param key_size The size of a key in bytes.
+ * @param value_size The size of a value in bytes.
+ * @param max_entries The number of entries.
+ * @param error Set if the map could not be created.
+ * @returns The map descriptor, or -1.
+ */
+auto create_map(bpf_map_type type, std::uint32_t key_size,
+                std::uint32_t value_size, std::uint32_t max_entries,
+                std::error_code &error) noexcept -> int;
+
+/**
+ * @brief Sets a map entry.
+ * @param map The map descriptor.
+ * @param key The key.
+ * @param value The value.
+ * @returns A portable error_code.
+ */
+auto update(int map, const void *key, const void *value) noexcept
+    -> std::error_code;
+
+/**
+ * @brief Reads a map entry.
+ * @details Per-CPU maps fill one value for each possible CPU.
+ * @param map The map descriptor.
+ * @param key The key.
+ * @param value The value to fill.
+ * @returns A portable error_code.
+ */
+auto lookup(int map, const void *key, void *value) noexcept
+    -> std::error_code;
+
+/**
+ * @brief Loads an XDP program.
+ * @param program The program.
+ * @param error Set if the program was rejected.
+ * @param log Filled with the verifier log if the program was rejected.
+ * @returns The program descriptor, or -1.
+ */
+auto load_xdp(std::span<const bpf_insn> program, std::error_code &error,
+              std::vector<char> *log = nullptr) noexcept -> int;
+
+/**
+ * @brief Attaches an XDP program to an interface.
+ * @details The program is detached when the returned link is closed.
+ * @param program The program descriptor.
+ * @param ifindex The interface index.
+ * @param generic Attach in generic (SKB) mode, which works with any driver.
+ * @param error Set if the program could not be attached.
+ * @returns The link descriptor, or -1.
+ */
+auto attach_xdp(int program, unsigned ifindex, bool generic,
+                std::error_code &error) noexcept -> int;
+
+/**
+ * @brief Runs an XDP program on a packet, without a network device.
+ * @param program The program descriptor.
+ * @param packet The packet, which is replaced by the program's output.
+ * @param error Set if the program could not be run.
+ * @returns The XDP action the program returned.
+ */
+auto test_run(int program, std::vector<std::byte> &packet,
+              std::error_code &error) noexcept -> std::uint32_t;
+
+/** @returns The number of possible CPUs, the length of a per-CPU value. */
+auto possible_cpus() noexcept -> std::size_t;
+} // namespace echo::detail::bpf
+#endif // ECHO_BPF_HPP
@@ -0,0 +1,107 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file budget.hpp
+ * @brief This file declares a process-wide memory budget for echo buffers.
+ */
+#pragma once
+#ifndef ECHO_BUDGET_HPP
+#define ECHO_BUDGET_HPP
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+/** @namespace For internal echo server implementation details. */
+namespace echo::detail {
+/**
+ * @brief A byte budget shared by all of the servers in a process.
+ * @details New consumers are only admitted below the shedding watermark,
+ * which leaves headroom for the buffers that existing sessions still need
+ * to grow into. Nothing is ever allocated over the limit, so crossing it
+ * degrades service instead of waking up the OOM killer. The budget is
+ * lock-free and may be shared between event loops.
+ */
+class memory_budget {
+public:
+  /** @brief The share of the limit that new consumers are admitted below. */
+  static constexpr double WATERMARK = 0.9;
+
+  /**
+   * @brief Constructs a budget.
+   * @param limit The budget in bytes.
+   */
+  explicit memory_budget(std::size_t limit) noexcept;
+
+  /**
+   * @brief Charges a new consumer, such as a new connection, to the budget.
+   * @param bytes The number of bytes to charge.
+   * @returns false if usage would cross the shedding watermark.
+   */
+  [[nodiscard]] auto try_admit(std::size_t bytes) noexcept -> bool;
+
+  /**
+   * @brief Charges an existing consumer to the budget.
+   * @param bytes The number of bytes to charge.
+   * @returns false if usage would cross the limit.
+   */
+  [[nodiscard]] auto try_acquire(std::size_t bytes) noexcept -> bool;
+
+  /**
+   * @brief Returns bytes to the budget.
+   * @param bytes The number of bytes to return.
+   */
+  auto release(std::size_t bytes) noexcept -> void;
+
+  /** @returns The number of bytes in use. */
+  [[nodiscard]] auto used() const noexcept -> std::size_t;
+
+  /** @returns The budget in bytes. */
+  [[nodiscard]] auto limit() const noexcept -> std::size_t;
+
+  /** @returns The highest number of bytes in use. */
+  [[nodiscard]] auto peak() const noexcept -> std::size_t;
+
+  /** @returns The number of charges that were refused. */
+  [[nodiscard]] auto shed() const noexcept -> std::uint64_t;
+
+  /**
+   * @brief Formats a one line summary of the budget.
+   * @returns The summary.
+   */
+  [[nodiscard]] auto summary() const -> std::string;
+
+private:
+  /**
+   * @brief Charges bytes if usage stays at or below a ceiling.
+   * @param bytes The number of bytes to charge.
+   * @param ceiling The ceiling.
+   * @returns true if the bytes were charged.
+   */
+  auto charge(std::size_t bytes, std::size_t ceiling) noexcept -> bool;
+
+  /** @brief The budget in bytes. */
+  std::size_t limit_;
+  /** @brief The shedding watermark in bytes. */
+  std::size_t watermark_;
+  /** @brief The number of bytes in use. */
+  std::atomic<std::size_t> used_{0};
+  /** @brief The highest number of bytes in use. */
+  std::atomic<std::size_t> peak_{0};
+  /** @brief The number of charges that were refused. */
+  std::atomic<std::uint64_t> shed_{0};
+};
+} // namespace echo::detail
+#endif // ECHO_BUDGET_HPP
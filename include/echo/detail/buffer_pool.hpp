@@ -0,0 +1,78 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file buffer_pool.hpp
+ * @brief This file declares a pool of fixed-size buffers.
+ */
+#pragma once
+#ifndef ECHO_BUFFER_POOL_HPP
+#define ECHO_BUFFER_POOL_HPP
+#include "echo/detail/arena.hpp"
+
+#include <cstddef>
+#include <span>
+#include <vector>
+/** @namespace For internal echo server implementation details. */
+namespace echo::detail {
+/**
+ * @brief A pool of fixed-size buffers carved out of one allocation.
+ * @details Buffers are handed out and returned in LIFO order so that the
+ * most recently used, cache-warm buffer is reused first. A pool is owned
+ * by a single event loop and is not thread-safe.
+ */
+class buffer_pool {
+public:
+  /** @brief Constructs an empty pool. */
+  buffer_pool() = default;
+
+  /**
+   * @brief Constructs a pool.
+   * @param count The number of buffers.
+   * @param size The size of each buffer in bytes.
+   */
+  buffer_pool(std::size_t count, std::size_t size);
+
+  /**
+   * @brief Takes a buffer from the pool.
+   * @returns A buffer, or an empty span if the pool is exhausted.
+   */
+  [[nodiscard]] auto acquire() noexcept -> std::span<std::byte>;
+
+  /**
+   * @brief Returns a buffer to the pool.
+   * @param buffer A buffer returned by acquire().
+   */
+  auto release(std::span<std::byte> buffer) noexcept -> void;
+
+  /** @returns The number of buffers that can be acquired. */
+  [[nodiscard]] auto available() const noexcept -> std::size_t;
+
+  /** @returns The total number of buffers. */
+  [[nodiscard]] auto capacity() const noexcept -> std::size_t;
+
+  /** @returns The size of each buffer in bytes. */
+  [[nodiscard]] auto buffer_size() const noexcept -> std::size_t;
+
+private:
+  /** @brief The backing storage for all buffers. */
+  std::vector<std::byte, arena_allocator<std::byte>> storage_;
+  /** @brief The indices of the free buffers. */
+  std::vector<std::size_t> free_;
+  /** @brief The size of each buffer in bytes. */
+  std::size_t size_ = 0;
+};
+} // namespace echo::detail
+#endif // ECHO_BUFFER_POOL_HPP
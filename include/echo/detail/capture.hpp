@@ -0,0 +1,160 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file capture.hpp
+ * @brief This file declares a memory-mapped datagram capture ring.
+ */
+#pragma once
+#ifndef ECHO_CAPTURE_HPP
+#define ECHO_CAPTURE_HPP
+#include "generator.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <system_error>
+
+#include <netinet/in.h>
+/** @namespace For internal echo server implementation details. */
+namespace echo::detail {
+/** @brief The header at the start of a capture file. */
+struct capture_header {
+  /** @brief The capture file magic. */
+  static constexpr std::uint64_t MAGIC = 0x3150414330484345; // "ECH0CAP1"
+  /** @brief The file magic. */
+  std::uint64_t magic;
+  /** @brief Non-zero while recording is enabled. */
+  std::uint32_t enabled;
+  /** @brief Reserved. */
+  std::uint32_t reserved;
+  /** @brief The size of the record area in bytes. */
+  std::uint64_t capacity;
+  /** @brief The offset of the next record to write. */
+  std::uint64_t head;
+  /** @brief The offset of the oldest record. */
+  std::uint64_t tail;
+  /** @brief The number of records in the ring. */
+  std::uint64_t count;
+  /** @brief The number of records overwritten by newer records. */
+  std::uint64_t overwritten;
+  /** @brief Padding to a cache line. */
+  std::uint64_t padding;
+};
+
+/** @brief A captured datagram. */
+struct capture_record {
+  /** @brief The arrival time. */
+  std::chrono::system_clock::time_point timestamp;
+  /** @brief The source address. An IPv4 source is stored as a sockaddr_in. */
+  sockaddr_in6 address;
+  /** @brief The datagram payload. */
+  std::span<const std::byte> payload;
+};
+
+/**
+ * @brief A memory-mapped file that datagrams are recorded into.
+ * @details The file is a fixed size ring. When it is full the oldest
+ * records are overwritten. Recording copies into the mapping, so the hot
+ * path makes no system calls. Recording is enabled and disabled through a
+ * flag in the mapped header, so any process that maps the file can switch
+ * it at runtime.
+ */
+class capture_file {
+public:
+  /** @brief The minimum size of a capture file. */
+  static constexpr std::size_t MIN_SIZE = 64UL * 1024;
+
+  /** @brief Default constructor. */
+  capture_file() noexcept = default;
+  /** @brief Deleted copy constructor. */
+  capture_file(const capture_file &) = delete;
+  /**
+   * @brief Move constructor.
+   * @param other The capture file to move from.
+   */
+  capture_file(capture_file &&other) noexcept;
+  /** @brief Deleted copy assignment. */
+  auto operator=(const capture_file &) -> capture_file & = delete;
+  /**
+   * @brief Move assignment.
+   * @param other The capture file to move from.
+   * @returns A reference to this capture file.
+   */
+  auto operator=(capture_file &&other) noexcept -> capture_file &;
+  /** @brief Unmaps the file. */
+  ~capture_file();
+
+  /**
+   * @brief Creates, or truncates, a capture file for recording.
+   * @param path The path of the capture file.
+   * @param size The size of the file in bytes.
+   * @param error Set if the file could not be created.
+   * @returns The capture file.
+   */
+  static auto create(const char *path, std::size_t size,
+                     std::error_code &error) noexcept -> capture_file;
+
+  /**
+   * @brief Opens an existing capture file.
+   * @param path The path of the capture file.
+   * @param writable Map the file writable, to switch recording.
+   * @param error Set if the file could not be opened.
+   * @returns The capture file.
+   */
+  static auto open(const char *path, bool writable,
+                   std::error_code &error) noexcept -> capture_file;
+
+  /**
+   * @brief Records a datagram if recording is enabled.
+   * @param address The source address of the datagram.
+   * @param payload The datagram payload.
+   */
+  auto record(std::span<const std::byte> address,
+              std::span<const std::byte> payload) noexcept -> void;
+
+  /**
+   * @brief Enables or disables recording.
+   * @param enabled Whether to record.
+   */
+  auto enable(bool enabled) noexcept -> void;
+
+  /**
+   * @brief Reads the records from oldest to newest.
+   * @returns A generator of records.
+   */
+  [[nodiscard]] auto records() const -> generator<capture_record>;
+
+  /**
+   * @brief Gets the file header.
+   * @returns The file header.
+   */
+  [[nodiscard]] auto header() const noexcept -> const capture_header &;
+
+  /** @brief Checks that a file is mapped. */
+  [[nodiscard]] explicit operator bool() const noexcept;
+
+private:
+  /**
+   * @brief Discards the oldest record.
+   */
+  auto evict() noexcept -> void;
+
+  /** @brief The mapping. */
+  std::span<std::byte> map_;
+};
+} // namespace echo::detail
+#endif // ECHO_CAPTURE_HPP
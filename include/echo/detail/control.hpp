@@ -0,0 +1,117 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file control.hpp
+ * @brief This file declares the control plane that delivers signals and
+ * control commands to the echo servers.
+ */
+#pragma once
+#ifndef ECHO_CONTROL_HPP
+#define ECHO_CONTROL_HPP
+#include <atomic>
+#include <cstdint>
+#include <system_error>
+
+#include <signal.h>
+/** @namespace For internal echo server implementation details. */
+namespace echo::detail {
+/**
+ * @brief Delivers signals and control commands through file descriptors.
+ * @details Signals are blocked and read from a signalfd, and commands
+ * posted from other threads wake the reader through an eventfd. The reader
+ * sleeps in poll() until one of them is ready, so an idle control plane
+ * never wakes up.
+ */
+class control_plane {
+public:
+  /** @brief A control command. */
+  enum command : std::uint8_t {
+    /** @brief No command is pending. */
+    NONE,
+    /** @brief Stop the servers. */
+    TERMINATE,
+    /** @brief Log the server stats. */
+    STATS,
+    /** @brief Hand the servers over to a new process. */
+    UPGRADE,
+    /** @brief Stop the control loop. */
+    STOP,
+    /** @brief The number of commands. */
+    COMMANDS
+  };
+
+  /** @brief Default constructor. */
+  control_plane() noexcept = default;
+  /** @brief Deleted copy constructor. */
+  control_plane(const control_plane &) = delete;
+  /**
+   * @brief Move constructor.
+   * @param other The control plane to move from.
+   */
+  control_plane(control_plane &&other) noexcept;
+  /** @brief Deleted copy assignment. */
+  auto operator=(const control_plane &) -> control_plane & = delete;
+  /**
+   * @brief Move assignment.
+   * @param other The control plane to move from.
+   * @returns A reference to this control plane.
+   */
+  auto operator=(control_plane &&other) noexcept -> control_plane &;
+  /** @brief Closes the file descriptors. */
+  ~control_plane();
+
+  /**
+   * @brief Creates a control plane.
+   * @details SIGTERM, SIGINT, SIGHUP, SIGUSR1 and SIGUSR2 are blocked in the
+   * calling thread. Threads started afterwards inherit the mask, so call
+   * this before any other thread is started.
+   * @param error Set if the file descriptors could not be created.
+   * @returns The control plane.
+   */
+  static auto create(std::error_code &error) noexcept -> control_plane;
+
+  /**
+   * @brief Posts a command to the thread that is waiting.
+   * @details Safe to call from any thread.
+   * @param cmd The command to post.
+   */
+  auto post(command cmd) noexcept -> void;
+
+  /**
+   * @brief Waits for the next command.
+   * @details SIGTERM, SIGINT and SIGHUP map to TERMINATE, SIGUSR1 maps to
+   * STATS and SIGUSR2 maps to UPGRADE. Posted commands are returned before
+   * signals.
+   * @returns The next command, or STOP if the control plane is closed.
+   */
+  [[nodiscard]] auto wait() noexcept -> command;
+
+  /** @returns true if the control plane is open. */
+  explicit operator bool() const noexcept;
+
+private:
+  /** @brief Closes the file descriptors. */
+  auto close() noexcept -> void;
+
+  /** @brief The signalfd. */
+  int signals_ = -1;
+  /** @brief The eventfd that posted commands are signalled on. */
+  int events_ = -1;
+  /** @brief The set of posted commands, one bit per command. */
+  std::atomic<std::uint32_t> pending_;
+};
+} // namespace echo::detail
+#endif // ECHO_CONTROL_HPP
@@ -0,0 +1,119 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file fair_queue.hpp
+ * @brief This file declares a deficit round robin scheduler for TCP
+ * connections.
+ */
+#pragma once
+#ifndef ECHO_FAIR_QUEUE_HPP
+#define ECHO_FAIR_QUEUE_HPP
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+/** @namespace For internal echo server implementation details. */
+namespace echo::detail {
+/**
+ * @brief Schedules connections with deficit round robin.
+ * @details Every connection may echo a quantum of bytes before it has to
+ * yield. A connection that has used up its deficit is parked at the back
+ * of the queue instead of re-arming its receive, and each time it reaches
+ * the front it is topped up by one quantum, once per round. A connection
+ * keeps what is left of its deficit for as long as it has input queued,
+ * and only starts afresh with a full quantum once it has gone idle, so a
+ * bulk transfer that echoes a little at a time is still parked every
+ * quantum, while request/response flows that drain their input are not
+ * queued behind it. Connections are identified by their socket
+ * descriptor. A queue is owned by a single event loop and is not
+ * thread-safe.
+ */
+class fair_queue {
+public:
+  /** @brief Constructs a queue that never parks a connection. */
+  fair_queue() = default;
+
+  /**
+   * @brief Constructs a queue.
+   * @param quantum The number of bytes a connection may echo per turn.
+   */
+  explicit fair_queue(std::size_t quantum) noexcept;
+
+  /**
+   * @brief Starts scheduling a connection with a full quantum.
+   * @param flow The connection's socket descriptor.
+   */
+  auto open(int flow) -> void;
+
+  /**
+   * @brief Stops scheduling a running connection.
+   * @param flow The connection's socket descriptor.
+   */
+  auto close(int flow) noexcept -> void;
+
+  /**
+   * @brief Charges echoed bytes to a connection's deficit.
+   * @param flow The connection's socket descriptor.
+   * @param bytes The number of bytes echoed.
+   * @returns true if the connection may keep running.
+   */
+  auto charge(int flow, std::size_t bytes) noexcept -> bool;
+
+  /**
+   * @brief Resets the deficit of a connection that has gone idle.
+   * @details Call only once the connection has no input left queued.
+   * @param flow The connection's socket descriptor.
+   */
+  auto idle(int flow) noexcept -> void;
+
+  /**
+   * @brief Parks a connection that has used up its deficit.
+   * @param flow The connection's socket descriptor.
+   */
+  auto park(int flow) -> void;
+
+  /**
+   * @brief Releases the next parked connection.
+   * @details Connections are topped up by a quantum each time they reach
+   * the front, and go round again until their deficit is positive.
+   * @returns The connection's socket descriptor, or -1 if none are parked.
+   */
+  [[nodiscard]] auto next() noexcept -> int;
+
+  /** @returns The number of bytes a connection may echo per turn. */
+  [[nodiscard]] auto quantum() const noexcept -> std::size_t;
+
+  /** @returns The number of running connections. */
+  [[nodiscard]] auto running() const noexcept -> std::size_t;
+
+  /** @returns The number of parked connections. */
+  [[nodiscard]] auto parked() const noexcept -> std::size_t;
+
+  /** @returns true if connections are scheduled. */
+  explicit operator bool() const noexcept;
+
+private:
+  /** @brief The byte deficit of each connection, indexed by descriptor. */
+  std::vector<std::int64_t> deficits_;
+  /** @brief Parked connections in the order they are released. */
+  std::deque<int> parked_;
+  /** @brief The number of bytes a connection may echo per turn. */
+  std::int64_t quantum_ = 0;
+  /** @brief The number of running connections. */
+  std::size_t running_ = 0;
+};
+} // namespace echo::detail
+#endif // ECHO_FAIR_QUEUE_HPP
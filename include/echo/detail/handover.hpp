@@ -0,0 +1,129 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file handover.hpp
+ * @brief This file declares the channel that TCP connections are handed
+ * over on during an upgrade.
+ */
+#pragma once
+#ifndef ECHO_HANDOVER_HPP
+#define ECHO_HANDOVER_HPP
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <system_error>
+
+#include <netinet/in.h>
+/** @namespace For internal echo server implementation details. */
+namespace echo::detail {
+/**
+ * @brief Hands TCP connections over from one process to another.
+ * @details The channel is a SOCK_SEQPACKET Unix socket. The new process
+ * sends one byte once it is ready to take connections over. The old
+ * process then sends one message per connection, carrying the socket as
+ * SCM_RIGHTS ancillary data, and closes the channel when it is done.
+ */
+class handover {
+public:
+  /** @brief The environment variable that holds the channel descriptor. */
+  static constexpr auto ENV = "ECHO_UPGRADE_FD";
+  /** @brief How long either side waits for the other. */
+  static constexpr auto TIMEOUT = std::chrono::seconds(5);
+
+  /** @brief The state of a connection that is handed over. */
+  struct record {
+    /** @brief The peer address. */
+    sockaddr_in6 peer;
+    /** @brief The number of bytes echoed so far. */
+    std::uint64_t bytes;
+    /** @brief When the connection was opened, in ns since the epoch. */
+    std::int64_t opened;
+  };
+
+  /** @brief Constructs a handover that is not connected to a process. */
+  handover() noexcept = default;
+  /** @brief Deleted copy constructor. */
+  handover(const handover &) = delete;
+  /** @brief Deleted move constructor. */
+  handover(handover &&) = delete;
+  /** @brief Deleted copy assignment. */
+  auto operator=(const handover &) -> handover & = delete;
+  /** @brief Deleted move assignment. */
+  auto operator=(handover &&) -> handover & = delete;
+  /** @brief Closes the channel. */
+  ~handover();
+
+  /**
+   * @brief Waits for the new process, then starts sending to it.
+   * @details Safe to call while a server thread calls sending().
+   * @param channel The channel, which the handover takes ownership of.
+   * @returns A portable error_code, set if the new process did not
+   * become ready.
+   */
+  auto send_to(int channel) noexcept -> std::error_code;
+
+  /** @returns true if connections should be sent. */
+  [[nodiscard]] auto sending() const noexcept -> bool;
+
+  /**
+   * @brief Sends a connection to the new process.
+   * @param sockfd The connected socket.
+   * @param state The state of the connection.
+   * @returns A portable error_code.
+   */
+  auto send(int sockfd, const record &state) noexcept -> std::error_code;
+
+  /**
+   * @brief Starts receiving from the old process.
+   * @param channel The channel, which the handover takes ownership of.
+   */
+  auto receive_from(int channel) noexcept -> void;
+
+  /** @returns true if connections should be received. */
+  [[nodiscard]] auto receiving() const noexcept -> bool;
+
+  /**
+   * @brief Receives the next connection from the old process.
+   * @details Tells the old process that this one is ready the first time
+   * it is called.
+   * @param state Set to the state of the connection.
+   * @returns The connected socket, or -1 once the old process is done.
+   */
+  auto receive(record &state) noexcept -> int;
+
+  /** @brief Closes the channel. */
+  auto close() noexcept -> void;
+
+  /**
+   * @brief Stops this process from serving a socket.
+   * @details The socket is replaced by one that reads end-of-file, so the
+   * event loop watching the descriptor closes it. The original socket is
+   * left open in the process it was handed over to.
+   * @param sockfd The socket to replace.
+   * @returns A portable error_code.
+   */
+  static auto detach(int sockfd) noexcept -> std::error_code;
+
+private:
+  /** @brief The channel to the new process. */
+  std::atomic<int> outgoing_{-1};
+  /** @brief The channel from the old process. */
+  int incoming_ = -1;
+  /** @brief Set once the old process has been told this one is ready. */
+  bool ready_ = false;
+};
+} // namespace echo::detail
+#endif // ECHO_HANDOVER_HPP
@@ -0,0 +1,83 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file histogram.hpp
+ * @brief This file declares a log-scale latency histogram.
+ */
+#pragma once
+#ifndef ECHO_HISTOGRAM_HPP
+#define ECHO_HISTOGRAM_HPP
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <span>
+#include <string>
+/** @namespace For internal echo server implementation details. */
+namespace echo::detail {
+/**
+ * @brief A latency histogram with power-of-two nanosecond buckets.
+ * @details Bucket `i` counts samples in the range [2^(i-1), 2^i) ns. Recording
+ * a sample is a bit scan and an increment, so it is cheap enough for the
+ * echo hot path. Histograms are owned by a single event loop and are not
+ * thread-safe.
+ */
+class histogram {
+public:
+  /** @brief The number of buckets. */
+  static constexpr std::size_t BUCKETS = 64;
+  /** @brief The duration type. */
+  using duration = std::chrono::nanoseconds;
+
+  /**
+   * @brief Records a sample.
+   * @param value The sample to record. Negative samples are counted as 0.
+   */
+  auto record(duration value) noexcept -> void;
+
+  /**
+   * @brief Gets the number of recorded samples.
+   * @returns The number of recorded samples.
+   */
+  [[nodiscard]] auto count() const noexcept -> std::uint64_t;
+
+  /**
+   * @brief Gets an upper bound on a percentile.
+   * @param pct The percentile in the range [0, 100].
+   * @returns The upper bound of the bucket holding the percentile.
+   */
+  [[nodiscard]] auto percentile(double pct) const noexcept -> duration;
+
+  /**
+   * @brief Gets the bucket counts.
+   * @returns The bucket counts.
+   */
+  [[nodiscard]] auto
+  buckets() const noexcept -> std::span<const std::uint64_t, BUCKETS>;
+
+  /**
+   * @brief Formats a one line summary of the histogram.
+   * @returns The summary.
+   */
+  [[nodiscard]] auto summary() const -> std::string;
+
+private:
+  /** @brief The bucket counts. */
+  std::array<std::uint64_t, BUCKETS> buckets_{};
+  /** @brief The total number of samples. */
+  std::uint64_t count_ = 0;
+};
+} // namespace echo::detail
+#endif // ECHO_HISTOGRAM_HPP
@@ -0,0 +1,204 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file journal.hpp
+ * @brief This file declares a binary connection-event journal.
+ */
+#pragma once
+#ifndef ECHO_JOURNAL_HPP
+#define ECHO_JOURNAL_HPP
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <span>
+#include <string>
+#include <system_error>
+
+#include <netinet/in.h>
+/** @namespace For internal echo server implementation details. */
+namespace echo::detail {
+/** @brief A fixed-size connection event. */
+struct journal_event {
+  /** @brief Event types. */
+  enum type : std::uint8_t { OPEN = 1, CLOSE = 2 };
+  /** @brief The event time in nanoseconds since the epoch. */
+  std::uint64_t timestamp;
+  /** @brief Bytes echoed over the connection (CLOSE only). */
+  std::uint64_t bytes;
+  /** @brief The connection lifetime in nanoseconds (CLOSE only). */
+  std::uint64_t duration;
+  /** @brief The connection socket. */
+  std::uint32_t connection;
+  /** @brief The event type. */
+  std::uint8_t type;
+  /** @brief Reserved. */
+  std::uint8_t reserved[3];
+  /** @brief The peer address. An IPv4 peer is stored as a sockaddr_in. */
+  sockaddr_in6 peer;
+  /** @brief Padding to 64 bytes. */
+  std::uint32_t padding;
+};
+static_assert(sizeof(journal_event) == 64);
+
+/** @brief The header at the start of each journal segment. */
+struct journal_header {
+  /** @brief The journal segment magic. */
+  static constexpr std::uint64_t MAGIC = 0x314e524a30484345; // "ECH0JRN1"
+  /** @brief The segment magic. */
+  std::uint64_t magic;
+  /** @brief The size of each event. */
+  std::uint64_t event_size;
+  /** @brief The number of events in the segment. */
+  std::uint64_t count;
+  /** @brief Padding to the size of an event. */
+  std::uint64_t padding[5];
+};
+static_assert(sizeof(journal_header) == sizeof(journal_event));
+
+/**
+ * @brief An append-only journal of memory-mapped segment files.
+ * @details Events are copied into the current segment, so appending makes
+ * no system calls. Once the segment is half full, a thread of the
+ * journal's own creates and maps the next segment, so the thread that
+ * appends never waits on the file system. Once the current segment is full
+ * the journal rotates to the next one and deletes the oldest segments that
+ * it created beyond the retention limit. Rotation only waits if the next
+ * segment is still being created. If the next segment can't be created,
+ * the journal counts the failure and starts over at the beginning of the
+ * current segment rather than stop. Events are appended by a single
+ * thread.
+ */
+class journal {
+public:
+  /** @brief Default constructor. */
+  journal() noexcept;
+  /** @brief Deleted copy constructor. */
+  journal(const journal &) = delete;
+  /**
+   * @brief Move constructor.
+   * @param other The journal to move from.
+   */
+  journal(journal &&other) noexcept;
+  /** @brief Deleted copy assignment. */
+  auto operator=(const journal &) -> journal & = delete;
+  /**
+   * @brief Move assignment.
+   * @param other The journal to move from.
+   * @returns A reference to this journal.
+   */
+  auto operator=(journal &&other) noexcept -> journal &;
+  /** @brief Unmaps the segments and removes the unused next segment. */
+  ~journal();
+
+  /**
+   * @brief Opens a journal in a directory.
+   * @details The first segment is created by the calling thread, the
+   * others by the journal's own.
+   * @param directory The directory to write segments into.
+   * @param segment_size The size of each segment in bytes.
+   * @param segments The number of segments to retain.
+   * @param error Set if the first segment could not be created.
+   * @returns The journal.
+   */
+  static auto open(std::string directory, std::size_t segment_size,
+                   std::size_t segments,
+                   std::error_code &error) noexcept -> journal;
+
+  /**
+   * @brief Appends an event.
+   * @param event The event to append.
+   */
+  auto append(const journal_event &event) noexcept -> void;
+
+  /**
+   * @brief Gets the number of segments that could not be created.
+   * @returns The number of failures.
+   */
+  [[nodiscard]] auto failures() const noexcept -> std::size_t;
+
+  /** @brief Checks that the journal is open. */
+  [[nodiscard]] explicit operator bool() const noexcept;
+
+private:
+  /** @brief Creates the next segment on a thread of its own. */
+  struct preparer;
+
+  /**
+   * @brief Rotates to the next segment.
+   * @details The current segment is kept if the next one couldn't be
+   * created.
+   * @returns false if the current segment was kept.
+   */
+  auto rotate() noexcept -> bool;
+
+  /** @brief Unmaps the segments and removes the unused next segment. */
+  auto close() noexcept -> void;
+
+  /** @brief The journal directory. */
+  std::string directory_;
+  /** @brief The segment size. */
+  std::size_t segment_size_ = 0;
+  /** @brief The number of segments to retain. */
+  std::size_t segments_ = 0;
+  /** @brief Segments created by this journal, oldest first. */
+  std::deque<std::string> files_;
+  /** @brief The current segment mapping. */
+  std::span<std::byte> map_;
+  /** @brief Creates the next segment. */
+  std::unique_ptr<preparer> preparer_;
+};
+
+/** @brief A read-only journal segment. */
+class journal_segment {
+public:
+  /** @brief Default constructor. */
+  journal_segment() noexcept = default;
+  /** @brief Deleted copy constructor. */
+  journal_segment(const journal_segment &) = delete;
+  /**
+   * @brief Move constructor.
+   * @param other The segment to move from.
+   */
+  journal_segment(journal_segment &&other) noexcept;
+  /** @brief Deleted copy assignment. */
+  auto operator=(const journal_segment &) -> journal_segment & = delete;
+  /** @brief Deleted move assignment. */
+  auto operator=(journal_segment &&) -> journal_segment & = delete;
+  /** @brief Unmaps the segment. */
+  ~journal_segment();
+
+  /**
+   * @brief Opens a journal segment.
+   * @param path The segment path.
+   * @param error Set if the segment could not be opened.
+   * @returns The segment.
+   */
+  static auto open(const char *path,
+                   std::error_code &error) noexcept -> journal_segment;
+
+  /**
+   * @brief Gets the events in the segment.
+   * @returns The events in the order they were appended.
+   */
+  [[nodiscard]] auto events() const noexcept -> std::span<const journal_event>;
+
+private:
+  /** @brief The segment mapping. */
+  std::span<std::byte> map_;
+};
+} // namespace echo::detail
+#endif // ECHO_JOURNAL_HPP
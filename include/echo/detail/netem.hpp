@@ -0,0 +1,208 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file netem.hpp
+ * @brief This file declares the network emulator that holds echoes for a
+ * random delay.
+ */
+#pragma once
+#ifndef ECHO_NETEM_HPP
+#define ECHO_NETEM_HPP
+#include "echo/detail/timer_wheel.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+/** @namespace For internal echo server implementation details. */
+namespace echo::detail {
+/** @brief Network emulation options. */
+struct netem_options {
+  /** @brief The distribution of the delays around the mean. */
+  enum distribution : std::uint8_t {
+    /** @brief Every echo is held for the mean delay. */
+    FIXED,
+    /** @brief Delays are uniform within the jitter of the mean. */
+    UNIFORM,
+    /** @brief Delays are normal with the jitter as standard deviation. */
+    NORMAL
+  };
+
+  /** @brief The mean delay. */
+  std::chrono::microseconds delay{0};
+  /** @brief The spread of the delays around the mean. */
+  std::chrono::microseconds jitter{0};
+  /** @brief The distribution of the delays. */
+  distribution shape = FIXED;
+  /** @brief The percentage of UDP replies to drop. */
+  double loss = 0;
+  /** @brief The number of UDP replies that are reordered among each other. */
+  std::size_t reorder = 0;
+  /** @brief The maximum number of held echoes. */
+  std::size_t limit = 1024UL * 1024;
+
+  /** @returns true if echoes are delayed. */
+  [[nodiscard]] auto delayed() const noexcept -> bool;
+
+  /** @returns true if any emulation is enabled. */
+  [[nodiscard]] explicit operator bool() const noexcept;
+};
+
+/**
+ * @brief Holds echoes for a random delay, drops and reorders them.
+ * @details Echoes are identified by an id that the server chooses, and are
+ * held on a timer_wheel with a tick of TICK. A timerfd ticks while echoes
+ * are held, and a thread forwards each tick to a socket that the server's
+ * event loop reads, so the server sends the echoes that are due from its
+ * own thread. With a reorder window of N, each echo takes the place of
+ * one of the N - 1 echoes held before it, so the delays keep their
+ * distribution but the echoes come out of order. The emulator is owned by
+ * a single event loop; only the forwarding thread runs elsewhere.
+ */
+class netem {
+public:
+  /** @brief The resolution of the delays. */
+  static constexpr auto TICK = std::chrono::milliseconds(1);
+
+  /** @brief Constructs an emulator that holds nothing. */
+  netem() = default;
+  /** @brief Deleted copy constructor. */
+  netem(const netem &) = delete;
+  /**
+   * @brief Move constructor.
+   * @param other The emulator to move from.
+   */
+  netem(netem &&other) noexcept;
+  /** @brief Deleted copy assignment. */
+  auto operator=(const netem &) -> netem & = delete;
+  /**
+   * @brief Move assignment.
+   * @param other The emulator to move from.
+   * @returns A reference to this emulator.
+   */
+  auto operator=(netem &&other) noexcept -> netem &;
+  /** @brief Stops the forwarding thread and closes the descriptors. */
+  ~netem();
+
+  /**
+   * @brief Creates an emulator and starts its forwarding thread.
+   * @param options The emulation options.
+   * @param error Set if the descriptors could not be created.
+   * @returns The emulator.
+   */
+  static auto create(const netem_options &options,
+                     std::error_code &error) noexcept -> netem;
+
+  /**
+   * @brief Draws whether a UDP reply is lost.
+   * @returns true if the reply should be dropped.
+   */
+  [[nodiscard]] auto lost() -> bool;
+
+  /**
+   * @brief Holds an echo for a random delay.
+   * @param id The echo's id, unique among the held echoes.
+   * @param reorder Reorder the echo within the reorder window.
+   * @returns false if the limit of held echoes has been reached.
+   */
+  [[nodiscard]] auto hold(std::uint32_t id, bool reorder) -> bool;
+
+  /**
+   * @brief Expires the echoes that are due.
+   * @details Call each time the socket is readable. The timerfd is stopped
+   * once nothing is held.
+   * @param ids The ids of the due echoes are appended here.
+   */
+  auto expire(std::vector<std::uint32_t> &ids) -> void;
+
+  /**
+   * @brief Expires every held echo.
+   * @param ids The ids of the held echoes are appended here.
+   */
+  auto clear(std::vector<std::uint32_t> &ids) -> void;
+
+  /** @returns The socket that is readable on each tick. */
+  [[nodiscard]] auto fd() const noexcept -> int;
+
+  /** @returns The number of held echoes. */
+  [[nodiscard]] auto size() const noexcept -> std::size_t;
+
+  /**
+   * @brief Formats a one line summary of the counters.
+   * @returns The summary.
+   */
+  [[nodiscard]] auto summary() const -> std::string;
+
+  /** @returns true if the emulator is running. */
+  explicit operator bool() const noexcept;
+
+private:
+  /** @brief The clock type. */
+  using clock = std::chrono::steady_clock;
+
+  /** @returns A random delay. */
+  auto sample() -> std::chrono::microseconds;
+
+  /** @returns The current tick. */
+  [[nodiscard]] auto now() const noexcept -> timer_wheel::tick_type;
+
+  /**
+   * @brief Starts or stops the timerfd.
+   * @param ticking true to tick every TICK.
+   */
+  auto tick(bool ticking) noexcept -> void;
+
+  /** @brief Stops the forwarding thread and closes the descriptors. */
+  auto close() noexcept -> void;
+
+  /** @brief The emulation options. */
+  netem_options options_;
+  /** @brief The random number generator. */
+  std::mt19937_64 random_;
+  /** @brief The held echoes. */
+  timer_wheel wheel_;
+  /** @brief The timers of the echoes in the reorder window. */
+  std::vector<std::uint32_t> window_;
+  /** @brief The next position in the reorder window. */
+  std::size_t position_ = 0;
+  /** @brief The time of tick 0. */
+  clock::time_point epoch_;
+  /** @brief The timerfd. */
+  int timer_ = -1;
+  /** @brief The socket the event loop reads, and the one ticks are sent on. */
+  std::array<int, 2> sockets_ = {-1, -1};
+  /** @brief An eventfd that stops the forwarding thread. */
+  int stop_ = -1;
+  /** @brief Set while the timerfd is ticking. */
+  bool ticking_ = false;
+  /** @brief Forwards ticks from the timerfd to the socket. */
+  std::jthread thread_;
+  /** @brief The number of echoes held. */
+  std::uint64_t held_ = 0;
+  /** @brief The number of UDP replies dropped. */
+  std::uint64_t lost_ = 0;
+  /** @brief The number of UDP replies that were reordered. */
+  std::uint64_t reordered_ = 0;
+  /** @brief The number of echoes that found the limit reached. */
+  std::uint64_t overflows_ = 0;
+};
+} // namespace echo::detail
+#endif // ECHO_NETEM_HPP
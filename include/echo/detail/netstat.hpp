@@ -0,0 +1,54 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file netstat.hpp
+ * @brief This file declares readers for kernel listen queue counters.
+ */
+#pragma once
+#ifndef ECHO_NETSTAT_HPP
+#define ECHO_NETSTAT_HPP
+#include <cstdint>
+#include <istream>
+#include <optional>
+/** @namespace For internal echo server implementation details. */
+namespace echo::detail {
+/** @brief Listen queue statistics. */
+struct listen_stats {
+  /** @brief Connections waiting in the accept queue of the listener. */
+  std::uint32_t queued = 0;
+  /** @brief The effective backlog of the listener. */
+  std::uint32_t backlog = 0;
+  /** @brief Host-wide count of accept queue overflows (TcpExt). */
+  std::uint64_t overflows = 0;
+  /** @brief Host-wide count of dropped SYNs (TcpExt). */
+  std::uint64_t drops = 0;
+};
+
+/**
+ * @brief Parses the TcpExt ListenOverflows and ListenDrops counters.
+ * @param netstat A stream formatted like `/proc/net/netstat`.
+ * @returns The counters, or std::nullopt if they are not present.
+ */
+auto parse_netstat(std::istream &netstat) -> std::optional<listen_stats>;
+
+/**
+ * @brief Reads the listen queue statistics for a listening socket.
+ * @param sockfd The listening socket.
+ * @returns The listen queue statistics.
+ */
+auto read_listen_stats(int sockfd) -> listen_stats;
+} // namespace echo::detail
+#endif // ECHO_NETSTAT_HPP
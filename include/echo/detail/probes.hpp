@@ -0,0 +1,36 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file probes.hpp
+ * @brief This file defines USDT static tracepoints for the echo servers.
+ */
+#pragma once
+#ifndef ECHO_PROBES_HPP
+#define ECHO_PROBES_HPP
+/**
+ * @def ECHO_PROBE(name, ...)
+ * @brief Fires the `echo:name` USDT probe with up to 12 integer arguments.
+ * @details When built with `sys/sdt.h` each probe is a single `nop` and a
+ * note in the ELF `.note.stapsdt` section that bpftrace and perf can attach
+ * to at runtime. Otherwise probes compile to nothing.
+ */
+#ifdef ECHO_ENABLE_USDT
+#include <sys/sdt.h>
+#define ECHO_PROBE(name, ...) STAP_PROBEV(echo, name __VA_OPT__(, ) __VA_ARGS__)
+#else
+#define ECHO_PROBE(name, ...) static_cast<void>(0)
+#endif // ECHO_ENABLE_USDT
+#endif // ECHO_PROBES_HPP
@@ -0,0 +1,177 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file retry_queue.hpp
+ * @brief This file declares a bounded queue of UDP replies waiting to be
+ * retried, and per-errno drop counters.
+ */
+#pragma once
+#ifndef ECHO_RETRY_QUEUE_HPP
+#define ECHO_RETRY_QUEUE_HPP
+#include "echo/detail/arena.hpp"
+
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+/** @namespace For internal echo server implementation details. */
+namespace echo::detail {
+/**
+ * @brief Gets the errno value carried by a sender error.
+ * @tparam Error The error type.
+ * @param error The error.
+ * @returns The errno value, or EIO if the error doesn't carry one.
+ */
+template <typename Error>
+constexpr auto error_number(const Error &error) noexcept -> int
+{
+  if constexpr (std::is_convertible_v<Error, std::error_code>)
+    return std::error_code(error).value();
+  else if constexpr (std::is_integral_v<Error>)
+    return static_cast<int>(error);
+  else
+    return EIO;
+}
+
+/**
+ * @brief Checks whether a failed send is worth retrying.
+ * @param error The errno value of the failed send.
+ * @returns true for transient backpressure errors.
+ */
+constexpr auto is_retryable(int error) noexcept -> bool
+{
+  return error == EAGAIN || error == EWOULDBLOCK || error == ENOBUFS;
+}
+
+/** @brief Counters for UDP replies that were retried or dropped. */
+struct send_drops {
+  /** @brief The number of errno values that are counted separately. */
+  static constexpr std::size_t ERRNOS = 256;
+
+  /** @brief Dropped replies, indexed by the errno that caused the drop. */
+  std::array<std::uint64_t, ERRNOS> by_errno{};
+  /** @brief Replies that were put on the retry queue. */
+  std::uint64_t queued = 0;
+  /** @brief Queued replies that were sent. */
+  std::uint64_t retried = 0;
+
+  /**
+   * @brief Counts a dropped reply.
+   * @param error The errno value that caused the drop.
+   */
+  auto drop(int error) noexcept -> void;
+
+  /** @returns The total number of dropped replies. */
+  [[nodiscard]] auto total() const noexcept -> std::uint64_t;
+
+  /**
+   * @brief Formats a one line summary of the counters.
+   * @returns The summary.
+   */
+  [[nodiscard]] auto summary() const -> std::string;
+};
+
+/**
+ * @brief A bounded FIFO of UDP replies that could not be sent.
+ * @details Each slot holds a copy of the reply and its destination, so the
+ * receive buffer can be reused as soon as a reply is queued. Queued replies
+ * are flushed with `sendmmsg` in batches. A queue is owned by a single event
+ * loop and is not thread-safe.
+ */
+class retry_queue {
+public:
+  /** @brief The maximum number of replies sent by one sendmmsg call. */
+  static constexpr std::size_t BATCH = 64;
+
+  /** @brief A queued reply. */
+  struct entry {
+    /** @brief The destination address. */
+    sockaddr_in6 address = {};
+    /** @brief The length of the destination address. */
+    socklen_t addrlen = 0;
+    /** @brief The reply payload. */
+    std::span<const std::byte> payload;
+  };
+
+  /** @brief Constructs a queue that holds nothing. */
+  retry_queue() = default;
+
+  /**
+   * @brief Constructs a queue.
+   * @param capacity The maximum number of queued replies.
+   * @param size The maximum size of a reply in bytes.
+   */
+  retry_queue(std::size_t capacity, std::size_t size);
+
+  /**
+   * @brief Copies a reply onto the back of the queue.
+   * @param address The destination address.
+   * @param payload The reply payload.
+   * @returns false if the queue is full.
+   */
+  [[nodiscard]] auto push(std::span<const std::byte> address,
+                          std::span<const std::byte> payload) noexcept -> bool;
+
+  /**
+   * @brief Gets the reply at the front of the queue.
+   * @returns The front entry. The queue must not be empty.
+   */
+  [[nodiscard]] auto front() const noexcept -> const entry &;
+
+  /** @brief Removes the reply at the front of the queue. */
+  auto pop() noexcept -> void;
+
+  /**
+   * @brief Sends as many queued replies as the socket accepts.
+   * @details Stops at the first retryable error. Replies that fail with any
+   * other error are dropped and counted.
+   * @param sockfd The UDP socket.
+   * @param drops The drop counters to update.
+   * @returns The number of replies that were sent.
+   */
+  auto flush(int sockfd, send_drops &drops) noexcept -> std::size_t;
+
+  /** @returns The number of queued replies. */
+  [[nodiscard]] auto size() const noexcept -> std::size_t;
+
+  /** @returns true if no replies are queued. */
+  [[nodiscard]] auto empty() const noexcept -> bool;
+
+  /** @returns The maximum number of queued replies. */
+  [[nodiscard]] auto capacity() const noexcept -> std::size_t;
+
+private:
+  /** @brief The queued replies, as a ring. */
+  std::vector<entry> entries_;
+  /** @brief The backing storage for reply payloads. */
+  std::vector<std::byte, arena_allocator<std::byte>> storage_;
+  /** @brief The maximum size of a reply. */
+  std::size_t size_ = 0;
+  /** @brief The index of the front entry. */
+  std::size_t head_ = 0;
+  /** @brief The number of queued replies. */
+  std::size_t count_ = 0;
+};
+} // namespace echo::detail
+#endif // ECHO_RETRY_QUEUE_HPP
@@ -0,0 +1,164 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file supervisor.hpp
+ * @brief This file declares the supervisor that runs the echo servers in
+ * pre-forked worker processes.
+ */
+#pragma once
+#ifndef ECHO_SUPERVISOR_HPP
+#define ECHO_SUPERVISOR_HPP
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <system_error>
+#include <vector>
+
+#include <signal.h>
+#include <sys/types.h>
+/** @namespace For internal echo server implementation details. */
+namespace echo::detail {
+/**
+ * @brief Forks worker processes and keeps them running.
+ * @details Each worker runs its own servers, bound to the same ports with
+ * `SO_REUSEPORT`, so a crash only takes down one worker. The supervisor
+ * blocks its signals and reads them from a signalfd:
+ * - SIGTERM, SIGINT and SIGHUP are forwarded to the workers as SIGTERM,
+ *   and the supervisor returns once every worker has exited.
+ * - SIGUSR1 is forwarded as is. SIGUSR2 is ignored, since a worker can't
+ *   upgrade on its own.
+ * - SIGCHLD collects the exit status of a worker, and restarts the worker
+ *   unless the supervisor is stopping.
+ *
+ * Workers report that they are ready by writing to a pipe, and the
+ * supervisor notifies the service manager once every worker is ready.
+ */
+class supervisor {
+public:
+  /** @brief The time a worker must run before it is restarted at once. */
+  static constexpr auto RESTART_DELAY = std::chrono::seconds(1);
+
+  /** @brief The exit of a worker. */
+  struct worker_exit {
+    /** @brief The index of the worker. */
+    std::size_t index = 0;
+    /** @brief The process id of the worker. */
+    pid_t pid = -1;
+    /** @brief The wait status of the worker. */
+    int status = 0;
+    /** @brief Set if the worker will be restarted. */
+    bool restarting = false;
+  };
+
+  /**
+   * @brief Runs a worker in the forked process.
+   * @details The worker is passed its index and a descriptor to report
+   * readiness with, and returns the exit code of the process.
+   */
+  using worker_type = std::function<int(std::size_t, int)>;
+  /** @brief Observes the exit of each worker. */
+  using observer_type = std::function<void(const worker_exit &)>;
+
+  /**
+   * @brief Constructs a supervisor.
+   * @param workers The number of workers to run.
+   * @param worker Runs a worker.
+   * @param observer Observes the exit of each worker.
+   */
+  supervisor(std::size_t workers, worker_type worker,
+             observer_type observer = {});
+  /** @brief Deleted copy constructor. */
+  supervisor(const supervisor &) = delete;
+  /** @brief Deleted move constructor. */
+  supervisor(supervisor &&) = delete;
+  /** @brief Deleted copy assignment. */
+  auto operator=(const supervisor &) -> supervisor & = delete;
+  /** @brief Deleted move assignment. */
+  auto operator=(supervisor &&) -> supervisor & = delete;
+  /** @brief Closes the file descriptors. */
+  ~supervisor();
+
+  /**
+   * @brief Runs the workers until they have been stopped.
+   * @details Call this before any other thread is started, so that the
+   * workers are forked from a single-threaded process.
+   * @param error Set if the supervisor could not be set up.
+   * @returns 0 if every worker exited cleanly when it was stopped.
+   */
+  auto run(std::error_code &error) -> int;
+
+  /**
+   * @brief Reports that a worker is ready.
+   * @param ready The descriptor passed to the worker. It is closed.
+   */
+  static auto ready(int ready) noexcept -> void;
+
+private:
+  /** @brief The clock type. */
+  using clock = std::chrono::steady_clock;
+
+  /** @brief The state of a worker slot. */
+  struct slot {
+    /** @brief The process id of the worker, -1 if it isn't running. */
+    pid_t pid = -1;
+    /** @brief The time the worker was started. */
+    clock::time_point started;
+    /** @brief The time the worker is due to be restarted. */
+    clock::time_point restart;
+  };
+
+  /**
+   * @brief Forks a worker.
+   * @param index The index of the worker.
+   * @returns A portable error_code.
+   */
+  auto spawn(std::size_t index) -> std::error_code;
+
+  /** @brief Collects the exit status of the workers that have exited. */
+  auto reap() -> void;
+
+  /**
+   * @brief Sends a signal to every running worker.
+   * @param signo The signal to send.
+   */
+  auto forward(int signo) noexcept -> void;
+
+  /** @returns The poll timeout until the next restart, -1 for none. */
+  [[nodiscard]] auto timeout() const noexcept -> int;
+
+  /** @brief Closes the file descriptors. */
+  auto close() noexcept -> void;
+
+  /** @brief Runs a worker. */
+  worker_type worker_;
+  /** @brief Observes the exit of each worker. */
+  observer_type observer_;
+  /** @brief The worker slots. */
+  std::vector<slot> slots_;
+  /** @brief The signalfd. */
+  int signals_ = -1;
+  /** @brief The pipe that workers report readiness on. */
+  std::array<int, 2> ready_ = {-1, -1};
+  /** @brief The signal mask to restore in the workers. */
+  sigset_t mask_ = {};
+  /** @brief Set once the workers have been told to stop. */
+  bool stopping_ = false;
+  /** @brief Set if a worker failed while it was being stopped. */
+  bool failed_ = false;
+};
+} // namespace echo::detail
+#endif // ECHO_SUPERVISOR_HPP
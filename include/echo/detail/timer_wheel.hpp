@@ -0,0 +1,136 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file timer_wheel.hpp
+ * @brief This file declares a hashed timing wheel.
+ */
+#pragma once
+#ifndef ECHO_TIMER_WHEEL_HPP
+#define ECHO_TIMER_WHEEL_HPP
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+/** @namespace For internal echo server implementation details. */
+namespace echo::detail {
+/**
+ * @brief A hashed timing wheel.
+ * @details Timers are kept in a ring of slots, one per tick, and a timer
+ * that is due more than a rotation ahead waits in its slot until the wheel
+ * comes round to it again. Scheduling a timer is O(1), and advancing the
+ * wheel only visits the slots of the ticks that have passed, so the cost
+ * doesn't grow with the number of pending timers. Timers in a slot expire
+ * in the order they were scheduled. Nodes are recycled through a free
+ * list, so a wheel that has reached its peak size no longer allocates. A
+ * wheel is owned by a single event loop and is not thread-safe.
+ */
+class timer_wheel {
+public:
+  /** @brief The tick type. */
+  using tick_type = std::uint64_t;
+  /** @brief The number of slots, a power of two. */
+  static constexpr std::size_t SLOTS = 4096;
+  /** @brief An invalid timer or id. */
+  static constexpr std::uint32_t NONE = UINT32_MAX;
+
+  /** @brief Constructs a wheel at tick 0. */
+  timer_wheel();
+
+  /**
+   * @brief Schedules a timer.
+   * @details A timer that is already due expires on the next tick.
+   * @param id The id to expire, which must not be NONE.
+   * @param due The tick the timer is due on.
+   * @returns The timer, valid until it expires.
+   */
+  auto schedule(std::uint32_t id, tick_type due) -> std::uint32_t;
+
+  /**
+   * @brief Advances the wheel and expires the timers that are due.
+   * @param now The current tick.
+   * @param expired The ids of the expired timers are appended here.
+   */
+  auto advance(tick_type now, std::vector<std::uint32_t> &expired) -> void;
+
+  /**
+   * @brief Expires every pending timer, in the order they are due.
+   * @param expired The ids of the expired timers are appended here.
+   */
+  auto clear(std::vector<std::uint32_t> &expired) -> void;
+
+  /**
+   * @brief Gets the id of a pending timer.
+   * @param timer The timer.
+   * @returns The id, or NONE if the timer has expired.
+   */
+  [[nodiscard]] auto id(std::uint32_t timer) const noexcept -> std::uint32_t;
+
+  /**
+   * @brief Swaps the ids of two pending timers.
+   * @param first The first timer.
+   * @param second The second timer.
+   */
+  auto swap(std::uint32_t first, std::uint32_t second) noexcept -> void;
+
+  /** @returns The current tick. */
+  [[nodiscard]] auto now() const noexcept -> tick_type;
+
+  /** @returns The number of pending timers. */
+  [[nodiscard]] auto size() const noexcept -> std::size_t;
+
+  /** @returns true if no timers are pending. */
+  [[nodiscard]] auto empty() const noexcept -> bool;
+
+private:
+  /** @brief A timer. */
+  struct node {
+    /** @brief The tick the timer is due on. */
+    tick_type due = 0;
+    /** @brief The id to expire, NONE once the node is free. */
+    std::uint32_t id = NONE;
+    /** @brief The next node in the slot or the free list. */
+    std::uint32_t next = NONE;
+  };
+
+  /** @brief The timers of a tick, oldest first. */
+  struct slot {
+    /** @brief The first node. */
+    std::uint32_t head = NONE;
+    /** @brief The last node. */
+    std::uint32_t tail = NONE;
+  };
+
+  /**
+   * @brief Expires the timers of a slot that are due by a tick.
+   * @param index The slot.
+   * @param now The tick.
+   * @param expired The ids of the expired timers are appended here.
+   */
+  auto expire(std::size_t index, tick_type now,
+              std::vector<std::uint32_t> &expired) -> void;
+
+  /** @brief The nodes, indexed by timer. */
+  std::vector<node> nodes_;
+  /** @brief The slots, indexed by tick. */
+  std::vector<slot> slots_;
+  /** @brief The first free node. */
+  std::uint32_t free_ = NONE;
+  /** @brief The current tick. */
+  tick_type now_ = 0;
+  /** @brief The number of pending timers. */
+  std::size_t size_ = 0;
+};
+} // namespace echo::detail
+#endif // ECHO_TIMER_WHEEL_HPP
@@ -0,0 +1,63 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file timestamps.hpp
+ * @brief This file declares helpers for kernel packet timestamps.
+ */
+#pragma once
+#ifndef ECHO_TIMESTAMPS_HPP
+#define ECHO_TIMESTAMPS_HPP
+#include "histogram.hpp"
+
+#include <chrono>
+#include <optional>
+#include <string_view>
+/** @namespace For internal echo server implementation details. */
+namespace echo::detail {
+/** @brief Kernel software timestamps are taken against the realtime clock. */
+using wall_clock = std::chrono::system_clock;
+
+/**
+ * @brief Enables kernel software receive timestamps on a socket.
+ * @details Timestamps are read back with `SIOCGSTAMPNS` so that no control
+ * buffer is needed on the receive path.
+ * @param sockfd The socket to enable timestamps on.
+ * @returns true if timestamps were enabled.
+ */
+auto enable_rx_timestamps(int sockfd) noexcept -> bool;
+
+/**
+ * @brief Gets the kernel arrival time of the last datagram read.
+ * @param sockfd The socket the datagram was read from.
+ * @returns The arrival time, or std::nullopt if it is not available.
+ */
+auto rx_timestamp(int sockfd) noexcept -> std::optional<wall_clock::time_point>;
+
+/** @brief Latency histograms for a server. */
+struct latency_stats {
+  /** @brief Kernel arrival to user-space dispatch. */
+  histogram queueing;
+  /** @brief User-space dispatch to send completion. */
+  histogram processing;
+
+  /**
+   * @brief Logs a summary of the histograms.
+   * @param name The name of the server.
+   */
+  auto log(std::string_view name) const -> void;
+};
+} // namespace echo::detail
+#endif // ECHO_TIMESTAMPS_HPP
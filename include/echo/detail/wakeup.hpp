@@ -0,0 +1,86 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file wakeup.hpp
+ * @brief This file declares a socket that an event loop posts wakeups to
+ * itself on.
+ */
+#pragma once
+#ifndef ECHO_WAKEUP_HPP
+#define ECHO_WAKEUP_HPP
+#include <array>
+#include <system_error>
+/** @namespace For internal echo server implementation details. */
+namespace echo::detail {
+/**
+ * @brief A datagram socket pair that an event loop wakes itself up with.
+ * @details The loop reads one end like any other socket, and notify()
+ * sends a datagram to it, so the loop comes back to the reader once it
+ * has handled the events that are already ready. Wakeups that are posted
+ * while one is pending are merged.
+ */
+class wakeup {
+public:
+  /** @brief Constructs a closed wakeup. */
+  wakeup() noexcept = default;
+  /** @brief Deleted copy constructor. */
+  wakeup(const wakeup &) = delete;
+  /**
+   * @brief Move constructor.
+   * @param other The wakeup to move from.
+   */
+  wakeup(wakeup &&other) noexcept;
+  /** @brief Deleted copy assignment. */
+  auto operator=(const wakeup &) -> wakeup & = delete;
+  /**
+   * @brief Move assignment.
+   * @param other The wakeup to move from.
+   * @returns A reference to this wakeup.
+   */
+  auto operator=(wakeup &&other) noexcept -> wakeup &;
+  /** @brief Closes the sockets. */
+  ~wakeup();
+
+  /**
+   * @brief Creates the socket pair.
+   * @param error Set if the sockets could not be created.
+   * @returns The wakeup.
+   */
+  static auto create(std::error_code &error) noexcept -> wakeup;
+
+  /** @brief Wakes the reader up, unless a wakeup is already pending. */
+  auto notify() noexcept -> void;
+
+  /** @brief Marks the pending wakeup as read. */
+  auto clear() noexcept -> void;
+
+  /** @returns The socket that the loop reads. */
+  [[nodiscard]] auto fd() const noexcept -> int;
+
+  /** @returns true if the sockets are open. */
+  explicit operator bool() const noexcept;
+
+private:
+  /** @brief Closes the sockets. */
+  auto close() noexcept -> void;
+
+  /** @brief The socket that is read, and the one wakeups are sent on. */
+  std::array<int, 2> sockets_ = {-1, -1};
+  /** @brief Set while a wakeup is waiting to be read. */
+  bool pending_ = false;
+};
+} // namespace echo::detail
+#endif // ECHO_WAKEUP_HPP
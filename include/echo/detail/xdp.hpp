@@ -0,0 +1,86 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file xdp.hpp
+ * @brief This file declares the XDP programs that steer UDP echo traffic.
+ */
+#pragma once
+#ifndef ECHO_XDP_HPP
+#define ECHO_XDP_HPP
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <system_error>
+#include <vector>
+
+#include <linux/bpf.h>
+/** @namespace For internal echo server implementation details. */
+namespace echo::detail {
+/** @brief The counters an XDP program keeps for each CPU. */
+struct xdp_counters {
+  /** @brief The number of datagrams echoed. */
+  std::uint64_t packets = 0;
+  /** @brief The number of IP bytes echoed. */
+  std::uint64_t bytes = 0;
+};
+
+/**
+ * @brief Builds the program that redirects UDP echo traffic to AF_XDP
+ * sockets.
+ * @details Unicast IPv4 and IPv6 datagrams to the port, up to max_len
+ * bytes long, are redirected to the socket bound to the receive queue.
+ * Everything else, including fragments, IPv4 options and queues without a
+ * socket, passes to the kernel stack.
+ * @param port The UDP port.
+ * @param xsks The XSKMAP descriptor, indexed by receive queue.
+ * @param max_len The longest frame an AF_XDP socket can receive.
+ * @returns The program.
+ */
+auto xsk_redirect_program(std::uint16_t port, int xsks, std::size_t max_len)
+    -> std::vector<bpf_insn>;
+
+/**
+ * @brief Builds the program that echoes UDP datagrams from the driver.
+ * @details The program matches the same datagrams as the redirect
+ * program, swaps their MAC addresses, IP addresses and ports in place and
+ * transmits them back out of the interface with XDP_TX. The echo never
+ * reaches the kernel stack. Everything else passes to the kernel stack.
+ * @param port The UDP port.
+ * @param counters A single-entry per-CPU array of xdp_counters.
+ * @returns The program.
+ */
+auto xdp_reflect_program(std::uint16_t port, int counters)
+    -> std::vector<bpf_insn>;
+
+/**
+ * @brief Sums the counters of an XDP program over every CPU.
+ * @param counters The per-CPU array of xdp_counters.
+ * @param error Set if the counters could not be read.
+ * @returns The totals.
+ */
+auto read_counters(int counters, std::error_code &error) -> xdp_counters;
+
+/**
+ * @brief Turns a UDP datagram frame into its echo, in place.
+ * @details The MAC addresses, IP addresses and UDP ports are swapped. The
+ * IPv4 and UDP checksums are sums over the swapped fields, so they stay
+ * valid.
+ * @param frame An Ethernet frame.
+ * @returns false, leaving the frame untouched, if it isn't a UDP datagram.
+ */
+auto reflect(std::span<std::byte> frame) noexcept -> bool;
+} // namespace echo::detail
+#endif // ECHO_XDP_HPP
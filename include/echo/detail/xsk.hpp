@@ -0,0 +1,146 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file xsk.hpp
+ * @brief This file declares an AF_XDP socket that echoes UDP datagrams.
+ */
+#pragma once
+#ifndef ECHO_XSK_HPP
+#define ECHO_XSK_HPP
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <system_error>
+/** @namespace For internal echo server implementation details. */
+namespace echo::detail {
+/** @brief AF_XDP socket options. */
+struct xsk_options {
+  /** @brief The interface index. */
+  unsigned ifindex = 0;
+  /** @brief The receive queue to bind to. */
+  std::uint32_t queue = 0;
+  /** @brief The number of UMEM frames, a power of two. */
+  std::uint32_t frames = 4096;
+  /** @brief Copy frames instead of sharing the UMEM with the driver. */
+  bool copy = false;
+};
+
+/**
+ * @brief An AF_XDP socket that echoes UDP datagrams.
+ * @details The socket owns a UMEM and its fill, completion, receive and
+ * transmit rings. Every ring holds as many entries as there are frames,
+ * so a frame can always be put back. Received frames are turned into
+ * their echo in place and transmitted from the same frame, which returns
+ * to the fill ring once the transmit completes.
+ */
+class xsk_socket {
+public:
+  /** @brief The size of a UMEM frame. */
+  static constexpr std::uint32_t FRAME_SIZE = 4096;
+  /** @brief The longest frame that can be received into a UMEM frame. */
+  static constexpr std::size_t MAX_FRAME = FRAME_SIZE - 256;
+
+  /** @brief Default constructor. */
+  xsk_socket() noexcept = default;
+  /** @brief Deleted copy constructor. */
+  xsk_socket(const xsk_socket &) = delete;
+  /**
+   * @brief Move constructor.
+   * @param other The socket to move from.
+   */
+  xsk_socket(xsk_socket &&other) noexcept;
+  /** @brief Deleted copy assignment. */
+  auto operator=(const xsk_socket &) -> xsk_socket & = delete;
+  /**
+   * @brief Move assignment.
+   * @param other The socket to move from.
+   * @returns A reference to this socket.
+   */
+  auto operator=(xsk_socket &&other) noexcept -> xsk_socket &;
+  /** @brief Unmaps the rings and the UMEM, and closes the socket. */
+  ~xsk_socket();
+
+  /**
+   * @brief Creates a socket bound to an interface queue.
+   * @param options The socket options.
+   * @param error Set if the socket could not be created.
+   * @returns The socket.
+   */
+  static auto create(const xsk_options &options,
+                     std::error_code &error) noexcept -> xsk_socket;
+
+  /**
+   * @brief Echoes the datagrams that have been received.
+   * @returns The number of datagrams echoed.
+   */
+  auto echo() noexcept -> std::size_t;
+
+  /** @returns The socket descriptor, to poll and to add to an XSKMAP. */
+  [[nodiscard]] auto fd() const noexcept -> int;
+
+  /** @returns The number of datagrams echoed. */
+  [[nodiscard]] auto packets() const noexcept -> std::uint64_t;
+
+  /** @returns The number of bytes echoed, including frame headers. */
+  [[nodiscard]] auto bytes() const noexcept -> std::uint64_t;
+
+  /** @brief Checks that the socket is open. */
+  [[nodiscard]] explicit operator bool() const noexcept;
+
+private:
+  /** @brief A ring shared with the kernel. */
+  struct ring {
+    /** @brief The mapping. */
+    std::span<std::byte> map;
+    /** @brief The producer index. */
+    std::uint32_t *producer = nullptr;
+    /** @brief The consumer index. */
+    std::uint32_t *consumer = nullptr;
+    /** @brief The ring flags. */
+    std::uint32_t *flags = nullptr;
+    /** @brief The entries. */
+    void *entries = nullptr;
+    /** @brief The index mask. */
+    std::uint32_t mask = 0;
+  };
+
+  /**
+   * @brief Returns completed transmits to the fill ring.
+   */
+  auto reclaim() noexcept -> void;
+
+  /** @brief Closes the socket and unmaps everything. */
+  auto close() noexcept -> void;
+
+  /** @brief The socket descriptor. */
+  int fd_ = -1;
+  /** @brief The UMEM. */
+  std::span<std::byte> umem_;
+  /** @brief The fill ring. */
+  ring fill_;
+  /** @brief The completion ring. */
+  ring completion_;
+  /** @brief The receive ring. */
+  ring rx_;
+  /** @brief The transmit ring. */
+  ring tx_;
+  /** @brief The number of datagrams echoed. */
+  std::uint64_t packets_ = 0;
+  /** @brief The number of bytes echoed. */
+  std::uint64_t bytes_ = 0;
+};
+} // namespace echo::detail
+#endif // ECHO_XSK_HPP
@@ -0,0 +1,143 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file discard_server.hpp
+ * @brief This file declares the TCP and UDP discard servers (RFC 863).
+ */
+#pragma once
+#ifndef ECHO_DISCARD_SERVER_HPP
+#define ECHO_DISCARD_SERVER_HPP
+#include "echo/tcp_server.hpp"
+#include "echo/udp_server.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+/** @namespace For echo services. */
+namespace echo {
+/** @brief The size of the discard receive buffers. */
+static constexpr auto DISCARD_BUFSIZE = 64UL;
+
+/**
+ * @brief A TCP discard server.
+ * @details Every connection reads into one shared buffer, because the
+ * bytes are never looked at. Whatever else is queued on the socket is
+ * dropped with `MSG_TRUNC`, which frees it without copying it out of the
+ * kernel.
+ */
+class tcp_discard_server : public tcp_base<tcp_discard_server> {
+public:
+  /** @brief The base class. */
+  using Base = tcp_base<tcp_discard_server>;
+
+  /**
+   * @brief Constructs the discard server on the socket address.
+   * @tparam T The type of the socket_address.
+   * @param address The local IP address to bind to.
+   */
+  template <typename T>
+  explicit tcp_discard_server(socket_address<T> address) noexcept
+      : Base(address)
+  {}
+
+  /**
+   * @brief Initializes socket options.
+   * @param sock The socket to initialize.
+   * @returns A portable error_code.
+   */
+  [[nodiscard]] static auto
+  initialize(const socket_handle &sock) noexcept -> std::error_code;
+
+  /** @brief Runs when the server receives a terminate signal. */
+  auto stop() noexcept -> void;
+
+  /**
+   * @brief Receives the bytes emitted by the service_base reader.
+   * @param ctx The asynchronous context of the message.
+   * @param socket The socket that the message was read from.
+   * @param rctx The read context that manages the read buffer lifetime.
+   * @param buf The bytes that were read from the socket.
+   */
+  auto service(async_context &ctx, const socket_dialog &socket,
+               const std::shared_ptr<read_context> &rctx,
+               std::span<const std::byte> buf) -> void;
+
+private:
+  /** @brief The receive buffer shared by every connection. */
+  std::vector<std::byte> buffer_ = std::vector<std::byte>(DISCARD_BUFSIZE);
+  /** @brief Active connections. */
+  std::vector<bool> active_;
+  /** @brief The number of bytes discarded. */
+  std::uint64_t discarded_ = 0;
+  /** @brief Set once stop() has run. */
+  bool stopped_ = false;
+};
+
+/**
+ * @brief A UDP discard server.
+ * @details The service reads the first bytes of a datagram. The datagrams
+ * queued behind it are dropped with `MSG_TRUNC` without being copied.
+ */
+class udp_discard_server
+    : public udp_base<udp_discard_server, DISCARD_BUFSIZE> {
+public:
+  /** @brief The base class. */
+  using Base = udp_base<udp_discard_server, DISCARD_BUFSIZE>;
+  /** @brief The most datagrams dropped per wakeup. */
+  static constexpr int BATCH = 64;
+
+  /**
+   * @brief Constructs the discard server on the socket address.
+   * @tparam T The type of the socket_address.
+   * @param address The local IP address to bind to.
+   */
+  template <typename T>
+  explicit udp_discard_server(socket_address<T> address) noexcept
+      : Base(address)
+  {}
+
+  /**
+   * @brief Initializes socket options.
+   * @param sock The socket to initialize.
+   * @returns A portable error_code.
+   */
+  [[nodiscard]] auto
+  initialize(const socket_handle &sock) noexcept -> std::error_code;
+
+  /** @brief Runs when the server receives a terminate signal. */
+  auto stop() noexcept -> void;
+
+  /**
+   * @brief Receives the bytes emitted by the service_base reader.
+   * @param ctx The asynchronous context of the message.
+   * @param socket The socket that the message was read from.
+   * @param rctx The read context that manages the read buffer lifetime.
+   * @param buf The bytes that were read from the socket.
+   */
+  auto service(async_context &ctx, const socket_dialog &socket,
+               const std::shared_ptr<read_context> &rctx,
+               std::span<const std::byte> buf) -> void;
+
+private:
+  /** @brief The UDP socket. */
+  io::socket::native_socket_type sockfd_ = -1;
+  /** @brief The number of datagrams discarded. */
+  std::uint64_t discarded_ = 0;
+  /** @brief Set once stop() has run. */
+  bool stopped_ = false;
+};
+} // namespace echo
+#endif // ECHO_DISCARD_SERVER_HPP
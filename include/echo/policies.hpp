@@ -0,0 +1,1020 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file policies.hpp
+ * @brief This file declares the policy types that configure the echo servers.
+ * @details Each server is a template over a buffer policy, a stats policy,
+ * a logging policy, an address-family policy, an accounting policy, a
+ * memory-budget policy and a network-emulation policy. The TCP server also
+ * takes a scheduling policy and a journal policy, and the UDP server a
+ * capture policy. Policies that disable a feature expose `enabled = false`
+ * and no-op members so that the feature compiles out of the echo path
+ * entirely.
+ */
+#pragma once
+#ifndef ECHO_POLICIES_HPP
+#define ECHO_POLICIES_HPP
+#include "echo/detail/admin.hpp"
+#include "echo/detail/arena.hpp"
+#include "echo/detail/budget.hpp"
+#include "echo/detail/capture.hpp"
+#include "echo/detail/fair_queue.hpp"
+#include "echo/detail/journal.hpp"
+#include "echo/detail/netem.hpp"
+#include "echo/detail/timestamps.hpp"
+#include "echo/detail/wakeup.hpp"
+
+#include <net/cppnet.hpp>
+#include <spdlog/spdlog.h>
+
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+/** @namespace For echo services. */
+namespace echo {
+/**
+ * @brief Buffer policy for heap-allocated receive buffers.
+ * @tparam Size The size of each receive buffer in bytes.
+ * @tparam Allocator The allocator for TCP connection buffers. The default
+ * allocates from the installed arena, and from the heap without one.
+ */
+template <std::size_t Size,
+          typename Allocator = detail::arena_allocator<std::byte>>
+struct heap_buffers {
+  /** @brief The size of each receive buffer. */
+  static constexpr std::size_t size = Size;
+  /** @brief The allocator type. */
+  using allocator_type = Allocator;
+  /** @brief The buffer type. */
+  using buffer_type = std::vector<std::byte, Allocator>;
+
+  /**
+   * @brief Allocates a receive buffer.
+   * @returns A buffer of `size` bytes.
+   */
+  [[nodiscard]] static auto make() -> buffer_type { return buffer_type(Size); }
+};
+
+/** @brief Stats policy that records latency histograms. */
+struct latency_histograms {
+  /** @brief Stats are compiled in. */
+  static constexpr bool enabled = true;
+  /** @brief The timestamp type. */
+  using time_point = detail::wall_clock::time_point;
+
+  /**
+   * @brief Reads the current time.
+   * @returns The current time.
+   */
+  [[nodiscard]] static auto now() noexcept -> time_point
+  {
+    return detail::wall_clock::now();
+  }
+
+  /**
+   * @brief Records the time between kernel arrival and dispatch.
+   * @param arrived The kernel arrival time.
+   * @param dispatched The user-space dispatch time.
+   */
+  auto queueing(detail::wall_clock::time_point arrived,
+                time_point dispatched) noexcept -> void
+  {
+    latency.queueing.record(dispatched - arrived);
+  }
+
+  /**
+   * @brief Records the time between dispatch and send completion.
+   * @param dispatched The user-space dispatch time.
+   */
+  auto processing(time_point dispatched) noexcept -> void
+  {
+    latency.processing.record(now() - dispatched);
+  }
+
+  /**
+   * @brief Logs a summary of the histograms.
+   * @param name The name of the server.
+   */
+  auto log(std::string_view name) const -> void { latency.log(name); }
+
+  /** @brief Latency histograms. */
+  detail::latency_stats latency;
+};
+
+/** @brief Stats policy that records nothing. */
+struct null_stats {
+  /** @brief Stats are compiled out. */
+  static constexpr bool enabled = false;
+  /** @brief An empty timestamp type. */
+  struct time_point {};
+
+  /** @returns An empty timestamp. */
+  [[nodiscard]] static constexpr auto now() noexcept -> time_point
+  {
+    return {};
+  }
+  /** @brief Does nothing. */
+  static constexpr auto queueing(detail::wall_clock::time_point,
+                                 time_point) noexcept -> void
+  {}
+  /** @brief Does nothing. */
+  static constexpr auto processing(time_point) noexcept -> void {}
+  /** @brief Does nothing. */
+  static constexpr auto log(std::string_view) noexcept -> void {}
+};
+
+/** @brief Logging policy that writes to spdlog. */
+struct spdlog_logging {
+  /** @brief Logging is compiled in. */
+  static constexpr bool enabled = true;
+
+  /**
+   * @brief Logs an informational message.
+   * @param fmt The format string.
+   * @param args The format arguments.
+   */
+  template <typename... Args>
+  static auto info(spdlog::format_string_t<Args...> fmt,
+                   Args &&...args) -> void
+  {
+    spdlog::info(fmt, std::forward<Args>(args)...);
+  }
+
+  /**
+   * @brief Logs a warning.
+   * @param fmt The format string.
+   * @param args The format arguments.
+   */
+  template <typename... Args>
+  static auto warn(spdlog::format_string_t<Args...> fmt,
+                   Args &&...args) -> void
+  {
+    spdlog::warn(fmt, std::forward<Args>(args)...);
+  }
+};
+
+/** @brief Logging policy that writes nothing. */
+struct null_logging {
+  /** @brief Logging is compiled out. */
+  static constexpr bool enabled = false;
+
+  /** @brief Does nothing. */
+  template <typename... Args>
+  static constexpr auto info(Args &&.../*args*/) noexcept -> void
+  {}
+
+  /** @brief Does nothing. */
+  template <typename... Args>
+  static constexpr auto warn(Args &&.../*args*/) noexcept -> void
+  {}
+};
+
+/**
+ * @brief Accounting policy that keeps live counters for the admin socket.
+ * @details Each counter has a single writer, the server thread, so it is
+ * a relaxed load and store, which is cheap enough to keep on at all times.
+ * A server that isn't given a table or loop stats accounts into its own.
+ */
+struct live_accounting {
+  /** @brief Accounting is compiled in. */
+  static constexpr bool enabled = true;
+  /** @brief A connection's entry in the connection table. */
+  using entry_type = detail::connection_entry *;
+
+  /**
+   * @brief Constructs the accounting of a server.
+   * @param connections The table to account connections in.
+   * @param stats The stats of the server's event loop.
+   * @param name The name of the server.
+   */
+  live_accounting(std::shared_ptr<detail::connection_table> connections,
+                  std::shared_ptr<detail::loop_stats> stats,
+                  std::string_view name)
+      : table{connections ? std::move(connections)
+                          : std::make_shared<detail::connection_table>()},
+        loop{stats ? std::move(stats)
+                   : std::make_shared<detail::loop_stats>(std::string(name))}
+  {}
+
+  /** @brief Records the thread that runs the event loop. */
+  auto start() noexcept -> void { loop->tid = gettid(); }
+
+  /**
+   * @brief Opens the entry of a new connection.
+   * @param fd The connection's socket.
+   * @param opened The time the connection was opened.
+   * @param buffer_size The size of its receive buffer.
+   * @returns The entry.
+   */
+  auto open(int fd, detail::wall_clock::time_point opened,
+            std::size_t buffer_size) -> entry_type
+  {
+    return &table->open(fd, opened, buffer_size);
+  }
+
+  /**
+   * @brief Closes the entry of a connection.
+   * @param fd The connection's socket.
+   */
+  auto close(int fd) noexcept -> void { table->close(fd); }
+
+  /** @brief Accounts for a receive event. */
+  auto event() noexcept -> void { detail::add(loop->events, 1); }
+
+  /**
+   * @brief Accounts for received bytes.
+   * @param len The number of bytes.
+   */
+  auto received(std::uint64_t len) noexcept -> void
+  {
+    detail::add(loop->bytes_in, len);
+  }
+
+  /**
+   * @brief Accounts for sent bytes.
+   * @param len The number of bytes.
+   */
+  auto sent(std::uint64_t len) noexcept -> void
+  {
+    detail::add(loop->bytes_out, len);
+  }
+
+  /**
+   * @brief Accounts for bytes received on a connection.
+   * @param entry The connection's entry.
+   * @param len The number of bytes.
+   */
+  auto received(entry_type entry, std::uint64_t len) noexcept -> void
+  {
+    entry->received(len);
+    received(len);
+  }
+
+  /**
+   * @brief Accounts for bytes sent on a connection.
+   * @param entry The connection's entry.
+   * @param len The number of bytes.
+   */
+  auto sent(entry_type entry, std::uint64_t len) noexcept -> void
+  {
+    entry->sent(len);
+    sent(len);
+  }
+
+  /** @brief The live connections. */
+  std::shared_ptr<detail::connection_table> table;
+  /** @brief The stats of the event loop. */
+  std::shared_ptr<detail::loop_stats> loop;
+};
+
+/** @brief Accounting policy that counts nothing. */
+struct null_accounting {
+  /** @brief Accounting is compiled out. */
+  static constexpr bool enabled = false;
+  /** @brief An empty entry type. */
+  struct entry_type {};
+
+  /** @brief Ignores the table and loop stats. */
+  null_accounting(const std::shared_ptr<detail::connection_table> &,
+                  const std::shared_ptr<detail::loop_stats> &,
+                  std::string_view) noexcept
+  {}
+  /** @brief Does nothing. */
+  static constexpr auto start() noexcept -> void {}
+  /** @returns An empty entry. */
+  static constexpr auto open(int, detail::wall_clock::time_point,
+                             std::size_t) noexcept -> entry_type
+  {
+    return {};
+  }
+  /** @brief Does nothing. */
+  static constexpr auto close(int) noexcept -> void {}
+  /** @brief Does nothing. */
+  static constexpr auto event() noexcept -> void {}
+  /** @brief Does nothing. */
+  static constexpr auto received(std::uint64_t) noexcept -> void {}
+  /** @brief Does nothing. */
+  static constexpr auto sent(std::uint64_t) noexcept -> void {}
+  /** @brief Does nothing. */
+  static constexpr auto received(entry_type, std::uint64_t) noexcept -> void
+  {}
+  /** @brief Does nothing. */
+  static constexpr auto sent(entry_type, std::uint64_t) noexcept -> void {}
+};
+
+/**
+ * @brief Budget policy that charges buffers to a memory budget.
+ * @details A server that isn't given a budget charges an unlimited budget
+ * of its own, so charging never needs to check for one.
+ */
+struct shared_budget {
+  /** @brief The budget is compiled in. */
+  static constexpr bool enabled = true;
+
+  /**
+   * @brief Constructs the budget policy of a server.
+   * @param shared The budget shared with the other servers, if any.
+   */
+  explicit shared_budget(std::shared_ptr<detail::memory_budget> shared)
+      : budget{shared ? std::move(shared)
+                      : std::make_shared<detail::memory_budget>(
+                            std::numeric_limits<std::size_t>::max())}
+  {}
+
+  /**
+   * @brief Charges a new consumer to the budget.
+   * @param bytes The number of bytes to charge.
+   * @returns false if usage would cross the shedding watermark.
+   */
+  [[nodiscard]] auto try_admit(std::size_t bytes) noexcept -> bool
+  {
+    return budget->try_admit(bytes);
+  }
+
+  /**
+   * @brief Charges an existing consumer to the budget.
+   * @param bytes The number of bytes to charge.
+   * @returns false if usage would cross the limit.
+   */
+  [[nodiscard]] auto try_acquire(std::size_t bytes) noexcept -> bool
+  {
+    return budget->try_acquire(bytes);
+  }
+
+  /**
+   * @brief Returns bytes to the budget.
+   * @param bytes The number of bytes to return.
+   */
+  auto release(std::size_t bytes) noexcept -> void { budget->release(bytes); }
+
+  /** @returns A one line summary of the budget. */
+  [[nodiscard]] auto summary() const -> std::string
+  {
+    return budget->summary();
+  }
+
+  /** @brief The memory budget. */
+  std::shared_ptr<detail::memory_budget> budget;
+};
+
+/** @brief Budget policy that charges nothing. */
+struct null_budget {
+  /** @brief The budget is compiled out. */
+  static constexpr bool enabled = false;
+
+  /** @brief Ignores the budget. */
+  explicit null_budget(const std::shared_ptr<detail::memory_budget> &) noexcept
+  {}
+  /** @returns true. */
+  static constexpr auto try_admit(std::size_t) noexcept -> bool { return true; }
+  /** @returns true. */
+  static constexpr auto try_acquire(std::size_t) noexcept -> bool
+  {
+    return true;
+  }
+  /** @brief Does nothing. */
+  static constexpr auto release(std::size_t) noexcept -> void {}
+  /** @returns An empty summary. */
+  static constexpr auto summary() noexcept -> std::string_view { return {}; }
+};
+
+/**
+ * @brief Emulation policy that holds echoes in a network emulator.
+ * @details Only the servers built with this policy own an emulator and
+ * check for held echoes.
+ */
+struct network_emulation {
+  /** @brief Network emulation is compiled in. */
+  static constexpr bool enabled = true;
+
+  /**
+   * @brief The network emulator of a server and the echoes it holds.
+   * @tparam Held The type of a held echo.
+   */
+  template <typename Held> class state {
+  public:
+    /**
+     * @brief Creates the emulator.
+     * @param options The emulation options.
+     * @returns A portable error_code.
+     */
+    [[nodiscard]] auto
+    create(const detail::netem_options &options) -> std::error_code
+    {
+      auto error = std::error_code();
+      netem_ = detail::netem::create(options, error);
+      return error;
+    }
+
+    /**
+     * @brief Duplicates the emulator's socket for the poller to watch.
+     * @details The poller closes its own copy.
+     * @returns The socket the emulator ticks on, or -1.
+     */
+    auto start() noexcept -> io::socket::native_socket_type
+    {
+      if (netem_)
+        ticks_ = fcntl(netem_.fd(), F_DUPFD_CLOEXEC, 0);
+      return ticks_;
+    }
+
+    /** @brief Stops the emulator ticking. */
+    auto stop() noexcept -> void
+    {
+      if (ticks_ >= 0)
+        shutdown(ticks_, SHUT_RD);
+    }
+
+    /** @returns The socket the emulator ticks on, -1 before start(). */
+    [[nodiscard]] auto ticks() const noexcept -> io::socket::native_socket_type
+    {
+      return ticks_;
+    }
+
+    /** @returns The receive buffer of the tick socket. */
+    auto buffer() noexcept -> std::span<std::byte> { return tick_buffer_; }
+
+    /** @returns true if a UDP reply should be dropped. */
+    [[nodiscard]] auto lost() -> bool { return netem_.lost(); }
+
+    /** @returns The id of a free slot for an echo. */
+    auto acquire() -> std::uint32_t
+    {
+      if (vacant_.empty())
+      {
+        held_.emplace_back();
+        return static_cast<std::uint32_t>(held_.size() - 1);
+      }
+
+      auto id = vacant_.back();
+      vacant_.pop_back();
+      return id;
+    }
+
+    /**
+     * @brief Frees the slot of an echo.
+     * @param id The echo's id.
+     */
+    auto release(std::uint32_t id) -> void { vacant_.push_back(id); }
+
+    /**
+     * @param id The echo's id.
+     * @returns The echo in the slot, which is created if need be.
+     */
+    auto held(std::uint32_t id) -> Held &
+    {
+      if (held_.size() <= id)
+        held_.resize(id + 1);
+      return held_[id];
+    }
+
+    /**
+     * @brief Holds an echo for a random delay.
+     * @param id The echo's id.
+     * @param reorder Reorder the echo within the reorder window.
+     * @returns false if the limit of held echoes has been reached.
+     */
+    [[nodiscard]] auto hold(std::uint32_t id, bool reorder) -> bool
+    {
+      return netem_.hold(id, reorder);
+    }
+
+    /**
+     * @brief Expires the echoes that are due.
+     * @param all Expire every held echo.
+     * @returns The ids of the expired echoes.
+     */
+    auto expire(bool all) -> std::span<const std::uint32_t>
+    {
+      due_.clear();
+      if (all)
+        netem_.clear(due_);
+      else
+        netem_.expire(due_);
+      return due_;
+    }
+
+    /** @returns The number of held echoes. */
+    [[nodiscard]] auto size() const noexcept -> std::size_t
+    {
+      return netem_.size();
+    }
+
+    /** @returns A one line summary of the emulator. */
+    [[nodiscard]] auto summary() const -> std::string
+    {
+      return netem_.summary();
+    }
+
+    /** @returns true if the emulator was created. */
+    explicit operator bool() const noexcept
+    {
+      return static_cast<bool>(netem_);
+    }
+
+  private:
+    /** @brief The network emulator. */
+    detail::netem netem_;
+    /** @brief The held echoes, indexed by id. */
+    std::vector<Held> held_;
+    /** @brief The ids of the free slots. */
+    std::vector<std::uint32_t> vacant_;
+    /** @brief The ids of the echoes that are due. */
+    std::vector<std::uint32_t> due_;
+    /** @brief The socket the emulator ticks on. */
+    io::socket::native_socket_type ticks_ = -1;
+    /** @brief The receive buffer of the tick socket. */
+    std::array<std::byte, 64> tick_buffer_{};
+  };
+};
+
+/** @brief Emulation policy that echoes straight away. */
+struct null_emulation {
+  /** @brief Network emulation is compiled out. */
+  static constexpr bool enabled = false;
+
+  /**
+   * @brief An emulator that holds nothing.
+   * @tparam Held The type of a held echo.
+   */
+  template <typename Held> struct state {
+    /** @returns An empty error_code. */
+    static auto create(const detail::netem_options &) noexcept
+        -> std::error_code
+    {
+      return {};
+    }
+    /** @returns -1. */
+    static constexpr auto start() noexcept -> io::socket::native_socket_type
+    {
+      return -1;
+    }
+    /** @brief Does nothing. */
+    static constexpr auto stop() noexcept -> void {}
+    /** @returns -1. */
+    static constexpr auto ticks() noexcept -> io::socket::native_socket_type
+    {
+      return -1;
+    }
+    /** @returns An empty buffer. */
+    static constexpr auto buffer() noexcept -> std::span<std::byte>
+    {
+      return {};
+    }
+    /** @returns false. */
+    static constexpr auto lost() noexcept -> bool { return false; }
+    /** @returns 0. */
+    static constexpr auto acquire() noexcept -> std::uint32_t { return 0; }
+    /** @brief Does nothing. */
+    static constexpr auto release(std::uint32_t) noexcept -> void {}
+    /** @returns An empty echo. */
+    static auto held(std::uint32_t) -> Held { return {}; }
+    /** @returns false. */
+    static constexpr auto hold(std::uint32_t, bool) noexcept -> bool
+    {
+      return false;
+    }
+    /** @returns No ids. */
+    static constexpr auto expire(bool) noexcept
+        -> std::span<const std::uint32_t>
+    {
+      return {};
+    }
+    /** @returns 0. */
+    static constexpr auto size() noexcept -> std::size_t { return 0; }
+    /** @returns An empty summary. */
+    static constexpr auto summary() noexcept -> std::string_view { return {}; }
+    /** @returns false. */
+    explicit constexpr operator bool() const noexcept { return false; }
+  };
+};
+
+/**
+ * @brief Scheduling policy that schedules TCP connections with deficit
+ * round robin when a quantum is set.
+ * @details A parked connection is released by a wakeup that the event loop
+ * reads once the connections that are already ready have had their turn.
+ */
+struct fair_scheduling {
+  /** @brief Fair scheduling is compiled in. */
+  static constexpr bool enabled = true;
+
+  /**
+   * @brief Constructs the scheduler of a server.
+   * @param quantum The bytes a connection may echo per turn, 0 for no
+   * limit.
+   */
+  explicit fair_scheduling(std::size_t quantum) noexcept : queue_{quantum} {}
+
+  /**
+   * @brief Creates the wakeup if a quantum is set.
+   * @returns A portable error_code.
+   */
+  [[nodiscard]] auto create() noexcept -> std::error_code
+  {
+    auto error = std::error_code();
+    if (queue_)
+      waker_ = detail::wakeup::create(error);
+    return error;
+  }
+
+  /**
+   * @brief Duplicates the wakeup socket for the poller to watch.
+   * @details The poller closes its own copy.
+   * @returns The socket the loop reads wakeups on, or -1.
+   */
+  auto start() noexcept -> io::socket::native_socket_type
+  {
+    if (waker_)
+      wakeups_ = fcntl(waker_.fd(), F_DUPFD_CLOEXEC, 0);
+    return wakeups_;
+  }
+
+  /** @brief Releases every parked connection through the wakeup socket. */
+  auto stop() noexcept -> void
+  {
+    if (wakeups_ >= 0)
+      shutdown(wakeups_, SHUT_RD);
+  }
+
+  /** @returns The socket the loop reads wakeups on, -1 before start(). */
+  [[nodiscard]] auto wakeups() const noexcept
+      -> io::socket::native_socket_type
+  {
+    return wakeups_;
+  }
+
+  /** @returns The receive buffer of the wakeup socket. */
+  auto buffer() noexcept -> std::span<std::byte> { return wakeup_buffer_; }
+
+  /** @brief Wakes the loop up, unless a wakeup is already pending. */
+  auto notify() noexcept -> void { waker_.notify(); }
+
+  /** @brief Marks the pending wakeup as read. */
+  auto clear() noexcept -> void { waker_.clear(); }
+
+  /**
+   * @param limit The most bytes a connection may echo otherwise.
+   * @returns The most bytes a connection may echo in one go.
+   */
+  [[nodiscard]] auto limit(std::size_t limit) const noexcept -> std::size_t
+  {
+    return queue_ ? queue_.quantum() : limit;
+  }
+
+  /**
+   * @brief Starts scheduling a connection.
+   * @param flow The connection's socket descriptor.
+   */
+  auto open(int flow) -> void
+  {
+    if (queue_)
+      queue_.open(flow);
+  }
+
+  /**
+   * @brief Stops scheduling a connection.
+   * @param flow The connection's socket descriptor.
+   */
+  auto close(int flow) noexcept -> void
+  {
+    if (queue_)
+      queue_.close(flow);
+  }
+
+  /**
+   * @brief Charges echoed bytes to a connection.
+   * @param flow The connection's socket descriptor.
+   * @param bytes The number of bytes echoed.
+   * @returns false once the connection has used up its deficit.
+   */
+  auto charge(int flow, std::size_t bytes) noexcept -> bool
+  {
+    return queue_.charge(flow, bytes);
+  }
+
+  /**
+   * @brief Resets the deficit of a connection if it has gone idle.
+   * @details A connection has gone idle when a read that doesn't wait
+   * finds nothing queued on its socket. A connection with input queued
+   * keeps what is left of its deficit.
+   * @param flow The connection's socket descriptor.
+   */
+  auto idle(int flow) noexcept -> void
+  {
+    auto byte = std::byte{};
+    if (queue_ && recv(flow, &byte, 1, MSG_DONTWAIT | MSG_PEEK) < 0 &&
+        (errno == EAGAIN || errno == EWOULDBLOCK))
+    {
+      queue_.idle(flow);
+    }
+  }
+
+  /**
+   * @brief Parks a connection that has used up its deficit.
+   * @param flow The connection's socket descriptor.
+   */
+  auto park(int flow) -> void { queue_.park(flow); }
+
+  /** @returns The next parked connection, or -1 if none are parked. */
+  [[nodiscard]] auto next() noexcept -> int { return queue_.next(); }
+
+  /** @returns The number of parked connections. */
+  [[nodiscard]] auto parked() const noexcept -> std::size_t
+  {
+    return queue_.parked();
+  }
+
+  /** @returns true if a quantum is set. */
+  explicit operator bool() const noexcept
+  {
+    return static_cast<bool>(queue_);
+  }
+
+private:
+  /** @brief The deficit round robin queue. */
+  detail::fair_queue queue_;
+  /** @brief Wakes the loop up to release parked connections. */
+  detail::wakeup waker_;
+  /** @brief The socket the loop reads wakeups on. */
+  io::socket::native_socket_type wakeups_ = -1;
+  /** @brief The receive buffer of the wakeup socket. */
+  std::array<std::byte, 8> wakeup_buffer_{};
+};
+
+/** @brief Scheduling policy that re-arms every receive straight away. */
+struct null_scheduling {
+  /** @brief Fair scheduling is compiled out. */
+  static constexpr bool enabled = false;
+
+  /** @brief Ignores the quantum. */
+  explicit null_scheduling(std::size_t) noexcept {}
+  /** @returns An empty error_code. */
+  static auto create() noexcept -> std::error_code { return {}; }
+  /** @returns -1. */
+  static constexpr auto start() noexcept -> io::socket::native_socket_type
+  {
+    return -1;
+  }
+  /** @brief Does nothing. */
+  static constexpr auto stop() noexcept -> void {}
+  /** @returns -1. */
+  static constexpr auto wakeups() noexcept -> io::socket::native_socket_type
+  {
+    return -1;
+  }
+  /** @returns An empty buffer. */
+  static constexpr auto buffer() noexcept -> std::span<std::byte>
+  {
+    return {};
+  }
+  /** @brief Does nothing. */
+  static constexpr auto notify() noexcept -> void {}
+  /** @brief Does nothing. */
+  static constexpr auto clear() noexcept -> void {}
+  /** @returns `limit`. */
+  static constexpr auto limit(std::size_t limit) noexcept -> std::size_t
+  {
+    return limit;
+  }
+  /** @brief Does nothing. */
+  static constexpr auto open(int) noexcept -> void {}
+  /** @brief Does nothing. */
+  static constexpr auto close(int) noexcept -> void {}
+  /** @returns true. */
+  static constexpr auto charge(int, std::size_t) noexcept -> bool
+  {
+    return true;
+  }
+  /** @brief Does nothing. */
+  static constexpr auto idle(int) noexcept -> void {}
+  /** @brief Does nothing. */
+  static constexpr auto park(int) noexcept -> void {}
+  /** @returns -1. */
+  static constexpr auto next() noexcept -> int { return -1; }
+  /** @returns 0. */
+  static constexpr auto parked() noexcept -> std::size_t { return 0; }
+  /** @returns false. */
+  explicit constexpr operator bool() const noexcept { return false; }
+};
+
+/** @brief Journal policy that writes connection events to a journal. */
+struct binary_journal {
+  /** @brief The journal is compiled in. */
+  static constexpr bool enabled = true;
+
+  /**
+   * @brief Opens the journal.
+   * @param directory The directory to write segments into.
+   * @param segment_size The size of each segment in bytes.
+   * @param segments The number of segments to retain.
+   * @returns A portable error_code.
+   */
+  [[nodiscard]] auto open(std::string directory, std::size_t segment_size,
+                          std::size_t segments) noexcept -> std::error_code
+  {
+    auto error = std::error_code();
+    journal_ = detail::journal::open(std::move(directory), segment_size,
+                                     segments, error);
+    return error;
+  }
+
+  /**
+   * @brief Appends an event.
+   * @param event The event to append.
+   */
+  auto append(const detail::journal_event &event) noexcept -> void
+  {
+    journal_.append(event);
+  }
+
+  /** @returns The number of segments that could not be created. */
+  [[nodiscard]] auto failures() const noexcept -> std::size_t
+  {
+    return journal_.failures();
+  }
+
+  /** @returns true if the journal is open. */
+  explicit operator bool() const noexcept
+  {
+    return static_cast<bool>(journal_);
+  }
+
+private:
+  /** @brief The connection-event journal. */
+  detail::journal journal_;
+};
+
+/** @brief Journal policy that writes nothing. */
+struct null_journal {
+  /** @brief The journal is compiled out. */
+  static constexpr bool enabled = false;
+
+  /** @returns An empty error_code. */
+  static auto open(const std::string &, std::size_t, std::size_t) noexcept
+      -> std::error_code
+  {
+    return {};
+  }
+  /** @brief Does nothing. */
+  static constexpr auto append(const detail::journal_event &) noexcept
+      -> void
+  {}
+  /** @returns 0. */
+  static constexpr auto failures() noexcept -> std::size_t { return 0; }
+  /** @returns false. */
+  explicit constexpr operator bool() const noexcept { return false; }
+};
+
+/** @brief Capture policy that records inbound UDP datagrams. */
+struct datagram_capture {
+  /** @brief The capture is compiled in. */
+  static constexpr bool enabled = true;
+
+  /**
+   * @brief Creates, or truncates, the capture file.
+   * @param path The path of the capture file.
+   * @param size The size of the file in bytes.
+   * @returns A portable error_code.
+   */
+  [[nodiscard]] auto create(const std::string &path,
+                            std::size_t size) noexcept -> std::error_code
+  {
+    auto error = std::error_code();
+    capture_ = detail::capture_file::create(path.c_str(), size, error);
+    return error;
+  }
+
+  /**
+   * @brief Records a datagram if recording is enabled.
+   * @param address The source address of the datagram.
+   * @param payload The datagram payload.
+   */
+  auto record(std::span<const std::byte> address,
+              std::span<const std::byte> payload) noexcept -> void
+  {
+    capture_.record(address, payload);
+  }
+
+  /** @returns true if the capture file is open. */
+  explicit operator bool() const noexcept
+  {
+    return static_cast<bool>(capture_);
+  }
+
+private:
+  /** @brief The datagram capture file. */
+  detail::capture_file capture_;
+};
+
+/** @brief Capture policy that records nothing. */
+struct null_capture {
+  /** @brief The capture is compiled out. */
+  static constexpr bool enabled = false;
+
+  /** @returns An empty error_code. */
+  static auto create(const std::string &, std::size_t) noexcept
+      -> std::error_code
+  {
+    return {};
+  }
+  /** @brief Does nothing. */
+  static constexpr auto record(std::span<const std::byte>,
+                               std::span<const std::byte>) noexcept -> void
+  {}
+  /** @returns false. */
+  explicit constexpr operator bool() const noexcept { return false; }
+};
+
+/** @brief Address-family policy that serves IPv4 and IPv6 peers. */
+struct dual_stack {
+  /**
+   * @brief Initializes the listening socket.
+   * @returns A portable error_code.
+   */
+  static auto initialize(io::socket::native_socket_type /*sockfd*/) noexcept
+      -> std::error_code
+  {
+    return {};
+  }
+
+  /**
+   * @brief Converts a received peer address into a reply address.
+   * @details Peers received on AF_INET sockets are replied to with a
+   * sockaddr_in.
+   * @param address The address a datagram was received from.
+   * @returns The address to reply to.
+   */
+  static auto reply_address(io::socket::socket_address<sockaddr_in6> address)
+      noexcept -> io::socket::socket_address<sockaddr_in6>
+  {
+    using namespace io::socket;
+    if (address->sin6_family == AF_INET)
+    {
+      const auto *ptr =
+          // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+          reinterpret_cast<struct sockaddr *>(std::ranges::data(address));
+      address = socket_address<sockaddr_in>(ptr);
+    }
+    return address;
+  }
+};
+
+/** @brief Address-family policy that only serves IPv6 peers. */
+struct ipv6_only {
+  /**
+   * @brief Sets IPV6_V6ONLY on the listening socket.
+   * @param sockfd The socket to initialize.
+   * @returns A portable error_code.
+   */
+  static auto
+  initialize(io::socket::native_socket_type sockfd) noexcept -> std::error_code
+  {
+    int enable = 1;
+    if (setsockopt(sockfd, IPPROTO_IPV6, IPV6_V6ONLY, &enable, sizeof(enable)))
+      return {errno, std::system_category()};
+
+    return {};
+  }
+
+  /**
+   * @brief Returns the peer address unchanged.
+   * @param address The address a datagram was received from.
+   * @returns The address to reply to.
+   */
+  static constexpr auto
+  reply_address(const io::socket::socket_address<sockaddr_in6> &address)
+      noexcept -> const io::socket::socket_address<sockaddr_in6> &
+  {
+    return address;
+  }
+};
+} // namespace echo
+#endif // ECHO_POLICIES_HPP
@@ -20,49 +20,195 @@
 #pragma once
 #ifndef ECHO_TCP_SERVER_HPP
 #define ECHO_TCP_SERVER_HPP
+#include "echo/detail/admin.hpp"
+#include "echo/detail/budget.hpp"
+#include "echo/detail/handover.hpp"
+#include "echo/detail/netem.hpp"
+#include "echo/detail/timestamps.hpp"
+#include "echo/policies.hpp"
+
 #include <net/cppnet.hpp>
 
+#include <array>
 #include <chrono>
+#include <memory>
 #include <optional>
+#include <string>
+#include <utility>
+#include <vector>
 /** @namespace For echo services. */
 namespace echo {
+/** @brief The default TCP buffer size. */
+static constexpr auto TCP_BUFSIZE = 4 * 1024UL;
 /** @brief The service type to use. */
 template <typename TCPStreamHandler>
 using tcp_base = net::service::async_tcp_service<TCPStreamHandler, 0UL>;
 
-/** @brief A TCP echo server. */
-class tcp_server : public tcp_base<tcp_server> {
+/** @brief Listening socket options. */
+struct tcp_options {
+  /** @brief The TCP_FASTOPEN queue length, 0 disables fast open. */
+  int fastopen = 0;
+  /** @brief The TCP_DEFER_ACCEPT timeout in seconds, 0 disables it. */
+  int defer_accept = 0;
+  /** @brief The listen backlog, 0 keeps the default. */
+  int backlog = 0;
+  /** @brief Set SO_REUSEPORT so that several processes share the port. */
+  bool reuseport = false;
+  /** @brief Record echo processing times into latency histograms. */
+  bool timestamps = false;
+  /**
+   * @brief Write connection events to a binary journal in this directory.
+   * @details Only servers with the binary_journal policy write one.
+   */
+  std::string journal;
+  /** @brief The size of each journal segment in bytes. */
+  std::size_t journal_size = 64UL * 1024 * 1024;
+  /** @brief The number of journal segments to retain. */
+  std::size_t journal_segments = 8;
+  /**
+   * @brief The memory budget for connection buffers.
+   * @details Without one, the server charges an unlimited budget.
+   */
+  std::shared_ptr<detail::memory_budget> budget;
+  /** @brief An inherited listening socket to serve, -1 for none. */
+  int inherited = -1;
+  /** @brief Hands connections over during an upgrade, nullptr for none. */
+  std::shared_ptr<detail::handover> handover;
+  /**
+   * @brief The bytes a connection may echo per turn, 0 for no limit.
+   * @details Only servers with the fair_scheduling policy schedule.
+   */
+  std::size_t quantum = 0;
+  /** @brief The SO_MAX_PACING_RATE of each connection, 0 for none. */
+  std::uint64_t pacing_rate = 0;
+  /** @brief Gather queued input into fewer, larger echoes. */
+  bool coalesce = false;
+  /** @brief The table to account connections in, nullptr for its own. */
+  std::shared_ptr<detail::connection_table> connections;
+  /** @brief The stats of the server's event loop, nullptr for its own. */
+  std::shared_ptr<detail::loop_stats> loop;
+  /**
+   * @brief Set to the result of starting the server, nullptr for none.
+   * @details It is set before the server's context leaves the pending
+   * state, and is an error if the server isn't serving its address.
+   */
+  std::shared_ptr<std::error_code> started;
+  /**
+   * @brief Delay echoes like a slow network.
+   * @details Loss and reordering only apply to UDP replies. Only servers
+   * with the network_emulation policy emulate.
+   */
+  detail::netem_options netem;
+};
+
+/**
+ * @brief A TCP echo server.
+ * @tparam Buffers The buffer policy.
+ * @tparam Stats The stats policy.
+ * @tparam Logging The logging policy.
+ * @tparam Family The address-family policy.
+ * @tparam Accounting The accounting policy.
+ * @tparam Budget The memory-budget policy.
+ * @tparam Emulation The network-emulation policy.
+ * @tparam Scheduling The scheduling policy.
+ * @tparam Journal The journal policy.
+ */
+template <typename Buffers = heap_buffers<TCP_BUFSIZE>,
+          typename Stats = latency_histograms,
+          typename Logging = spdlog_logging, typename Family = dual_stack,
+          typename Accounting = live_accounting,
+          typename Budget = shared_budget,
+          typename Emulation = null_emulation,
+          typename Scheduling = null_scheduling,
+          typename Journal = null_journal>
+class basic_tcp_server
+    : public tcp_base<basic_tcp_server<Buffers, Stats, Logging, Family,
+                                       Accounting, Budget, Emulation,
+                                       Scheduling, Journal>> {
 public:
   /** @brief The base class. */
-  using Base = tcp_base<tcp_server>;
+  using Base = tcp_base<basic_tcp_server>;
+  /** @brief The socket handle type. */
+  using typename Base::socket_handle;
+  /** @brief The socket dialog type. */
+  using typename Base::socket_dialog;
+  /** @brief The read context type. */
+  using typename Base::read_context;
+  /** @brief The asynchronous context type. */
+  using async_context = net::service::async_context;
+  /** @brief The socket address type. */
+  template <typename T>
+  using socket_address = io::socket::socket_address<T>;
   /** @brief TCP buffer type. */
-  using buffer_type = std::vector<std::byte>;
+  using buffer_type = typename Buffers::buffer_type;
+  /** @brief The state of a single connection. */
+  struct connection {
+    /** @brief The receive buffer. */
+    buffer_type buffer;
+    /** @brief The dispatch time of the bytes being echoed. */
+    [[no_unique_address]] typename Stats::time_point dispatched;
+    /** @brief The time the connection was opened. */
+    detail::wall_clock::time_point opened;
+    /** @brief The number of bytes echoed. */
+    std::uint64_t bytes = 0;
+    /** @brief The peer address. */
+    sockaddr_in6 peer = {};
+    /** @brief Set while an echo is being sent. */
+    bool sending = false;
+    /** @brief Set once the connection is handed over to another process. */
+    bool handed_over = false;
+    /** @brief The connection's socket, which its receive is re-armed on. */
+    std::optional<socket_dialog> socket;
+    /** @brief The read context that manages the read buffer lifetime. */
+    std::shared_ptr<read_context> rctx;
+    /** @brief The connection's entry in the connection table. */
+    [[no_unique_address]] typename Accounting::entry_type entry{};
+  };
   /** @brief A connections type. */
-  using connections = std::vector<std::optional<buffer_type>>;
+  using connections = std::vector<std::optional<connection>>;
   /** @brief The socket message type. */
   using socket_message = io::socket::socket_message<sockaddr_in6>;
+  /** @brief Listening socket options. */
+  using options = tcp_options;
 
   /**
    * @brief Constructs segment_service on the socket address.
    * @tparam T The type of the socket_address.
    * @param address The local IP address to bind to.
+   * @param opts The listening socket options.
    */
   template <typename T>
-  explicit tcp_server(socket_address<T> address) noexcept : Base(address)
+  explicit basic_tcp_server(socket_address<T> address,
+                            options opts = {}) noexcept
+      : Base(address), options_{std::move(opts)},
+        scheduling_{options_.quantum},
+        accounting_{options_.connections, options_.loop, "tcp"},
+        budget_{options_.budget}
   {}
   /**
    * @brief Initializes socket options.
    * @param sock The socket to initialize.
    * @returns A portable error_code.
    */
-  [[nodiscard]] static auto
+  [[nodiscard]] auto
   initialize(const socket_handle &sock) noexcept -> std::error_code;
 
+  /**
+   * @brief Starts the service and applies the configured listen backlog.
+   * @details An inherited listener replaces the socket bound by the
+   * service, so the service should be bound to an ephemeral port. During
+   * an upgrade, connections handed over by the old process are adopted.
+   * @param ctx The asynchronous context to start the service in.
+   */
+  auto start(async_context &ctx) noexcept -> void;
+
   /** @brief Runs when the server receives a terminate signal. */
   auto stop() noexcept -> void;
 
   /**
    * @brief Services the incoming socket_message.
+   * @details Sends through the event loop, for echoes that the socket
+   * didn't take when they were sent inline.
    * @param ctx The asynchronous context of the message.
    * @param socket The socket that the message was read from.
    * @param rctx The read context that manages the read buffer lifetime.
@@ -83,6 +229,170 @@ public:
                std::span<const std::byte> buf) -> void;
 
 private:
+  /** @brief Completes the receive operation of a connection. */
+  struct receiver {
+    /** @brief The receiver concept. */
+    using receiver_concept = stdexec::receiver_t;
+
+    /**
+     * @brief Services the bytes that were received.
+     * @param len The number of bytes received, 0 at end of file.
+     */
+    template <typename Length>
+    auto set_value(Length len) && noexcept -> void
+    {
+      server->received(*ctx, sockfd, static_cast<std::size_t>(len));
+    }
+    /** @brief Closes the connection. */
+    template <typename Error>
+    auto set_error(Error && /*error*/) && noexcept -> void
+    {
+      server->received(*ctx, sockfd, 0);
+    }
+    /** @brief Closes the connection. */
+    auto set_stopped() && noexcept -> void
+    {
+      server->received(*ctx, sockfd, 0);
+    }
+
+    /** @brief The server. */
+    basic_tcp_server *server;
+    /** @brief The asynchronous context of the connection. */
+    async_context *ctx;
+    /** @brief The connection's socket. */
+    io::socket::native_socket_type sockfd;
+  };
+  /** @brief The sender of a receive operation. */
+  using receive_sender = decltype(std::declval<async_context &>().scope.nest(
+      io::recvmsg(std::declval<const socket_dialog &>(),
+                  std::declval<socket_message &>(), 0)));
+  /** @brief A receive operation. */
+  using receive_operation = stdexec::connect_result_t<receive_sender, receiver>;
+  /**
+   * @brief The receive operations of a socket descriptor.
+   * @details A receive is re-armed by constructing the operation in place,
+   * so it doesn't allocate. The operation that completed last may still be
+   * on the stack, so the receive is re-armed in the other one.
+   */
+  struct receive_state {
+    /** @brief The two operations. */
+    std::array<std::optional<receive_operation>, 2> operations;
+    /** @brief The operation that was started last. */
+    std::size_t current = 0;
+    /** @brief Set while an operation is being started. */
+    bool starting = false;
+    /** @brief Set when the receive is re-armed while it is being started. */
+    bool again = false;
+  };
+
+  /**
+   * @brief Re-arms the receive of a connection without allocating.
+   * @param ctx The asynchronous context of the connection.
+   * @param sockfd The connection's socket.
+   */
+  auto rearm(async_context &ctx, io::socket::native_socket_type sockfd)
+      -> void;
+
+  /**
+   * @brief Services the bytes received on a connection.
+   * @param ctx The asynchronous context of the connection.
+   * @param sockfd The connection's socket.
+   * @param len The number of bytes received, 0 to close the connection.
+   */
+  auto received(async_context &ctx, io::socket::native_socket_type sockfd,
+                std::size_t len) -> void;
+
+  /**
+   * @brief Initializes the listening socket.
+   * @returns A portable error_code.
+   */
+  auto prepare() noexcept -> std::error_code;
+
+  /**
+   * @brief Applies the listening socket options.
+   * @param sockfd The listening socket.
+   * @returns A portable error_code.
+   */
+  auto configure(io::socket::native_socket_type sockfd) noexcept
+      -> std::error_code;
+
+  /**
+   * @brief Sets the per-connection socket options.
+   * @param sockfd The connection's socket.
+   */
+  auto configure_connection(io::socket::native_socket_type sockfd) noexcept
+      -> void;
+
+  /**
+   * @brief Opens a new connection's entry in the connection table.
+   * @param sockfd The connection's socket.
+   * @param conn The connection.
+   */
+  auto account(io::socket::native_socket_type sockfd,
+               connection &conn) -> void;
+
+  /**
+   * @brief Accounts for echoed bytes.
+   * @param sockfd The connection's socket.
+   * @param len The number of bytes sent.
+   * @returns false once the connection has used up its quantum.
+   */
+  auto sent(io::socket::native_socket_type sockfd, std::size_t len) noexcept
+      -> bool;
+
+  /**
+   * @brief Re-arms the receive once a whole echo has been sent.
+   * @param ctx The asynchronous context of the connection.
+   * @param sockfd The connection's socket.
+   * @param turn false if the connection has used up its quantum.
+   */
+  auto finish(async_context &ctx, io::socket::native_socket_type sockfd,
+              bool turn) -> void;
+
+  /**
+   * @brief Parks a connection that has used up its quantum.
+   * @details The receive is re-armed once the connections ahead of it have
+   * had their turn.
+   * @param ctx The asynchronous context of the connection.
+   * @param sockfd The connection's socket.
+   */
+  auto park(async_context &ctx, io::socket::native_socket_type sockfd)
+      -> void;
+
+  /**
+   * @brief Re-arms the receive of the next parked connection.
+   * @param ctx The asynchronous context of the connections.
+   */
+  auto release(async_context &ctx) -> void;
+
+  /**
+   * @brief Holds an echo in the network emulator.
+   * @details The receive isn't re-armed until the echo has been sent, so
+   * the echo stays in the connection's buffer, and the emulator holds the
+   * bytes of the buffer that are to be echoed.
+   * @param sockfd The connection's socket.
+   * @param buf The bytes to echo.
+   * @returns false if the emulator is full.
+   */
+  auto hold(io::socket::native_socket_type sockfd,
+            std::span<const std::byte> buf) -> bool;
+
+  /**
+   * @brief Sends the held echoes that are due.
+   * @param ctx The asynchronous context of the connections.
+   * @param all Send every held echo.
+   */
+  auto expire(async_context &ctx, bool all) -> void;
+
+  /** @brief Hands the listener and idle connections over. */
+  auto hand_over() noexcept -> void;
+
+  /**
+   * @brief Adopts the connections handed over by the old process.
+   * @param ctx The asynchronous context to serve the connections in.
+   */
+  auto take_over(async_context &ctx) -> void;
+
   /** @brief The clock type. */
   using clock = std::chrono::steady_clock;
   /** @brief The timepoint type. */
@@ -91,11 +401,77 @@ private:
   using duration = std::chrono::milliseconds;
   /** @brief The drain timeout interval. */
   static constexpr auto DRAIN_TIMER = duration(5000);
+  /** @brief The most bytes echoed inline before the receive is re-armed. */
+  static constexpr auto INLINE_BYTES = 64 * 1024UL;
 
+  /** @brief Listening socket options. */
+  options options_;
+  /** @brief The listening socket. */
+  io::socket::native_socket_type listener_ = -1;
+  /** @brief The result of initializing the listening socket. */
+  std::error_code error_;
   /** @brief Active connections. */
   connections active_;
+  /** @brief The receive operations, indexed by socket descriptor. */
+  std::vector<std::unique_ptr<receive_state>> receives_;
   /** @brief Drain timeout. */
   std::optional<time_point> drain_timeout_;
+  /** @brief Schedules connections when a quantum is set. */
+  [[no_unique_address]] Scheduling scheduling_;
+  /** @brief Set while new connections are shed by the memory budget. */
+  bool shedding_ = false;
+  /** @brief Latency stats. */
+  [[no_unique_address]] Stats stats_;
+  /** @brief Connection and event loop accounting. */
+  [[no_unique_address]] Accounting accounting_;
+  /** @brief The memory budget. */
+  [[no_unique_address]] Budget budget_;
+  /** @brief The connection-event journal. */
+  [[no_unique_address]] Journal journal_;
+  /** @brief The network emulator, indexed by socket descriptor. */
+  [[no_unique_address]] typename Emulation::template state<
+      std::span<const std::byte>>
+      emulation_;
 };
+
+/** @brief The default TCP echo server. */
+using tcp_server = basic_tcp_server<>;
+/**
+ * @brief A TCP echo server without stats, logging, accounting or a memory
+ * budget.
+ */
+using minimal_tcp_server =
+    basic_tcp_server<heap_buffers<TCP_BUFSIZE>, null_stats, null_logging,
+                     dual_stack, null_accounting, null_budget>;
+/** @brief A TCP echo server with large buffers for bulk transfers. */
+using bulk_tcp_server =
+    basic_tcp_server<heap_buffers<64 * 1024UL>, null_stats>;
+/** @brief A TCP echo server that only accepts IPv6 peers. */
+using ipv6_tcp_server =
+    basic_tcp_server<heap_buffers<TCP_BUFSIZE>, latency_histograms,
+                     spdlog_logging, ipv6_only>;
+/**
+ * @brief The default TCP echo server with network emulation, fair
+ * scheduling and a journal.
+ */
+using full_tcp_server =
+    basic_tcp_server<heap_buffers<TCP_BUFSIZE>, latency_histograms,
+                     spdlog_logging, dual_stack, live_accounting,
+                     shared_budget, network_emulation, fair_scheduling,
+                     binary_journal>;
+
+// The presets are instantiated in tcp_server.cpp.
+extern template class basic_tcp_server<>;
+extern template class basic_tcp_server<heap_buffers<TCP_BUFSIZE>, null_stats,
+                                       null_logging, dual_stack,
+                                       null_accounting, null_budget>;
+extern template class basic_tcp_server<heap_buffers<64 * 1024UL>, null_stats>;
+extern template class basic_tcp_server<heap_buffers<TCP_BUFSIZE>,
+                                       latency_histograms, spdlog_logging,
+                                       ipv6_only>;
+extern template class basic_tcp_server<
+    heap_buffers<TCP_BUFSIZE>, latency_histograms, spdlog_logging, dual_stack,
+    live_accounting, shared_budget, network_emulation, fair_scheduling,
+    binary_journal>;
 } // namespace echo
 #endif // ECHO_TCP_SERVER_HPP
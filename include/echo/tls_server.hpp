@@ -0,0 +1,155 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file tls_server.hpp
+ * @brief This file declares the TLS echo server.
+ */
+#pragma once
+#ifndef ECHO_TLS_SERVER_HPP
+#define ECHO_TLS_SERVER_HPP
+#include "echo/tcp_server.hpp"
+
+#include <openssl/types.h>
+
+#include <memory>
+/** @namespace For echo services. */
+namespace echo {
+/**
+ * @brief A TLS echo server.
+ * @details The TLS handshake is performed in user-space over memory BIOs.
+ * Once a TLS 1.3 session is established, the record layer is handed to
+ * kernel TLS (`TCP_ULP` "tls") so that the steady-state echo loop is plain
+ * `recvmsg`/`sendmsg`. Sessions that can't be offloaded fall back to
+ * user-space record processing. The traffic secrets are cleansed once the
+ * handshake is over, so a KeyUpdate from the peer isn't supported after
+ * offload: the kernel can't decrypt the records that follow it with the
+ * old keys, which fails the receive and ends the session.
+ */
+class tls_server : public tcp_base<tls_server> {
+public:
+  /** @brief The base class. */
+  using Base = tcp_base<tls_server>;
+  /** @brief TLS buffer type. */
+  using buffer_type = std::vector<std::byte>;
+  /** @brief The shared TLS context type. */
+  using context_ptr = std::shared_ptr<SSL_CTX>;
+  /** @brief The socket message type. */
+  using socket_message = io::socket::socket_message<sockaddr_in6>;
+
+  /** @brief TLS 1.3 application traffic secrets captured from the handshake. */
+  struct traffic_secrets {
+    /** @brief Cleanses the secrets. */
+    ~traffic_secrets();
+
+    /** @brief The client application traffic secret. */
+    std::vector<unsigned char> client;
+    /** @brief The server application traffic secret. */
+    std::vector<unsigned char> server;
+  };
+
+  /** @brief The state of a single TLS session. */
+  struct session {
+    /** @brief Frees the SSL object. */
+    struct ssl_deleter {
+      /** @brief Frees the SSL object. */
+      auto operator()(SSL *ssl) const noexcept -> void;
+    };
+    /** @brief The SSL object. */
+    std::unique_ptr<SSL, ssl_deleter> ssl;
+    /** @brief Secrets used to configure kernel TLS. */
+    std::unique_ptr<traffic_secrets> secrets;
+    /** @brief The receive buffer. */
+    buffer_type buffer;
+    /** @brief Ciphertext waiting to be sent by user-space. */
+    buffer_type pending;
+    /** @brief Set when the record layer has been handed to the kernel. */
+    bool offloaded = false;
+  };
+  /** @brief A connections type. */
+  using connections = std::vector<std::optional<session>>;
+
+  /**
+   * @brief Constructs the TLS server on the socket address.
+   * @tparam T The type of the socket_address.
+   * @param address The local IP address to bind to.
+   * @param context The TLS context shared by all sessions.
+   */
+  template <typename T>
+  tls_server(socket_address<T> address, context_ptr context) noexcept
+      : Base(address), context_(std::move(context))
+  {}
+
+  /**
+   * @brief Creates a server TLS context.
+   * @param certificate Path to a PEM certificate chain.
+   * @param private_key Path to the PEM private key.
+   * @returns The TLS context or a nullptr if it could not be created.
+   */
+  [[nodiscard]] static auto
+  make_context(const char *certificate,
+               const char *private_key) noexcept -> context_ptr;
+
+  /**
+   * @brief Initializes socket options.
+   * @param sock The socket to initialize.
+   * @returns A portable error_code.
+   */
+  [[nodiscard]] static auto
+  initialize(const socket_handle &sock) noexcept -> std::error_code;
+
+  /** @brief Runs when the server receives a terminate signal. */
+  auto stop() noexcept -> void;
+
+  /**
+   * @brief Sends the socket_message.
+   * @param ctx The asynchronous context of the message.
+   * @param socket The socket to send the message on.
+   * @param rctx The read context that manages the read buffer lifetime.
+   * @param msg The message to send.
+   */
+  auto echo(async_context &ctx, const socket_dialog &socket,
+            const std::shared_ptr<read_context> &rctx,
+            const socket_message &msg) -> void;
+  /**
+   * @brief Receives the bytes emitted by the service_base reader.
+   * @param ctx The asynchronous context of the message.
+   * @param socket The socket that the message was read from.
+   * @param rctx The read context that manages the read buffer lifetime.
+   * @param buf The bytes that were read from the socket.
+   */
+  auto service(async_context &ctx, const socket_dialog &socket,
+               const std::shared_ptr<read_context> &rctx,
+               std::span<const std::byte> buf) -> void;
+
+private:
+  /** @brief The clock type. */
+  using clock = std::chrono::steady_clock;
+  /** @brief The timepoint type. */
+  using time_point = clock::time_point;
+  /** @brief The duration type. */
+  using duration = std::chrono::milliseconds;
+  /** @brief The drain timeout interval. */
+  static constexpr auto DRAIN_TIMER = duration(5000);
+
+  /** @brief The TLS context. */
+  context_ptr context_;
+  /** @brief Active sessions. */
+  connections active_;
+  /** @brief Drain timeout. */
+  std::optional<time_point> drain_timeout_;
+};
+} // namespace echo
+#endif // ECHO_TLS_SERVER_HPP
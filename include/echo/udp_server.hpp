@@ -20,49 +20,168 @@
 #pragma once
 #ifndef ECHO_UDP_SERVER_HPP
 #define ECHO_UDP_SERVER_HPP
+#include "echo/detail/admin.hpp"
+#include "echo/detail/budget.hpp"
+#include "echo/detail/buffer_pool.hpp"
+#include "echo/detail/netem.hpp"
+#include "echo/detail/retry_queue.hpp"
+#include "echo/detail/timestamps.hpp"
+#include "echo/policies.hpp"
+
 #include <net/cppnet.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
 /** @namespace For echo services. */
 namespace echo {
 /** @brief UDP BufferSize. */
 static constexpr auto UDP_BUFSIZE = 4 * 1024UL;
+/** @brief The size of the receive buffer, enough for any UDP payload. */
+static constexpr auto UDP_RECVSIZE = 64 * 1024UL;
 /** @brief The service type to use. */
-template <typename UDPStreamHandler>
-using udp_base = net::service::async_udp_service<UDPStreamHandler, UDP_BUFSIZE>;
+template <typename UDPStreamHandler, std::size_t Size = UDP_BUFSIZE>
+using udp_base = net::service::async_udp_service<UDPStreamHandler, Size>;
 
-/** @brief A UDP echo server. */
-class udp_server : public udp_base<udp_server> {
+/** @brief UDP socket options. */
+struct udp_options {
+  /** @brief Record kernel receive timestamps into latency histograms. */
+  bool timestamps = false;
+  /** @brief Set SO_REUSEPORT so that several processes share the port. */
+  bool reuseport = false;
+  /**
+   * @brief Record inbound datagrams into this capture file.
+   * @details Only servers with the datagram_capture policy record.
+   */
+  std::string capture;
+  /** @brief The size of the capture file in bytes. */
+  std::size_t capture_size = 64UL * 1024 * 1024;
+  /**
+   * @brief The memory budget for datagram buffers.
+   * @details Without one, the server charges an unlimited budget.
+   */
+  std::shared_ptr<detail::memory_budget> budget;
+  /** @brief The number of replies that can be in flight at once. */
+  std::size_t depth = 1;
+  /** @brief The maximum number of replies waiting to be retried. */
+  std::size_t retries = 256;
+  /** @brief The number of large replies that can be in flight at once. */
+  std::size_t large = 4;
+  /** @brief An inherited socket to serve, -1 for none. */
+  int inherited = -1;
+  /** @brief The stats of the server's event loop, nullptr for its own. */
+  std::shared_ptr<detail::loop_stats> loop;
+  /**
+   * @brief Set to the result of starting the server, nullptr for none.
+   * @details It is set before the server's context leaves the pending
+   * state, and is an error if the server isn't serving its address.
+   */
+  std::shared_ptr<std::error_code> started;
+  /**
+   * @brief Delay, drop and reorder replies like a lossy network.
+   * @details Only servers with the network_emulation policy emulate.
+   */
+  detail::netem_options netem;
+};
+
+/**
+ * @brief A UDP echo server.
+ * @details The service owns a single receive buffer that is large enough
+ * for any datagram. The size of the buffer policy sets the size of the
+ * buffers that hold replies in flight and replies waiting to be retried.
+ * Larger datagrams are copied into a small pool of receive-sized buffers
+ * instead.
+ * @tparam Buffers The buffer policy.
+ * @tparam Stats The stats policy.
+ * @tparam Logging The logging policy.
+ * @tparam Family The address-family policy.
+ * @tparam Accounting The accounting policy.
+ * @tparam Budget The memory-budget policy.
+ * @tparam Emulation The network-emulation policy.
+ * @tparam Capture The capture policy.
+ */
+template <typename Buffers = heap_buffers<UDP_BUFSIZE>,
+          typename Stats = latency_histograms,
+          typename Logging = spdlog_logging, typename Family = dual_stack,
+          typename Accounting = live_accounting,
+          typename Budget = shared_budget,
+          typename Emulation = null_emulation,
+          typename Capture = null_capture>
+class basic_udp_server
+    : public udp_base<basic_udp_server<Buffers, Stats, Logging, Family,
+                                       Accounting, Budget, Emulation,
+                                       Capture>,
+                      std::max(Buffers::size, UDP_RECVSIZE)> {
 public:
   /** @brief The base class. */
-  using Base = udp_base<udp_server>;
+  using Base =
+      udp_base<basic_udp_server, std::max(Buffers::size, UDP_RECVSIZE)>;
+  /** @brief The socket handle type. */
+  using typename Base::socket_handle;
+  /** @brief The socket dialog type. */
+  using typename Base::socket_dialog;
+  /** @brief The read context type. */
+  using typename Base::read_context;
+  /** @brief The asynchronous context type. */
+  using async_context = net::service::async_context;
+  /** @brief The socket address type. */
+  template <typename T>
+  using socket_address = io::socket::socket_address<T>;
   /** @brief The socket message type. */
   using socket_message = io::socket::socket_message<sockaddr_in6>;
+  /** @brief UDP socket options. */
+  using options = udp_options;
+  /** @brief The size of the receive buffer. */
+  static constexpr std::size_t RECVSIZE =
+      std::max(Buffers::size, UDP_RECVSIZE);
 
   /**
    * @brief Constructs segment_service on the socket address.
    * @tparam T The type of the socket_address.
    * @param address The local IP address to bind to.
+   * @param opts The UDP socket options.
    */
   template <typename T>
-  explicit udp_server(socket_address<T> address) noexcept : Base(address)
+  explicit basic_udp_server(socket_address<T> address,
+                            options opts = {}) noexcept
+      : Base(address), options_{std::move(opts)},
+        accounting_{nullptr, options_.loop, "udp"}, budget_{options_.budget}
   {}
   /**
    * @brief Initializes socket options.
    * @param sock The socket to initialize.
    * @returns A portable error_code.
    */
-  [[nodiscard]] static auto
+  [[nodiscard]] auto
   initialize(const socket_handle &sock) noexcept -> std::error_code;
 
   /**
-   * @brief Services the incoming socket_message.
+   * @brief Starts the service.
+   * @details An inherited socket replaces the socket bound by the service,
+   * so the service should be bound to an ephemeral port.
+   * @param ctx The asynchronous context to start the service in.
+   */
+  auto start(async_context &ctx) noexcept -> void;
+
+  /** @brief Runs when the server receives a terminate signal. */
+  auto stop() noexcept -> void;
+
+  /**
+   * @brief Echoes a datagram from the receive buffer.
+   * @details The receive is re-armed once the reply has been sent, or
+   * queued for a retry.
    * @param ctx The asynchronous context of the message.
    * @param socket The socket that the message was read from.
    * @param rctx The read context that manages the read buffer lifetime.
-   * @param msg The message that was read from the socket.
+   * @param address The address to reply to.
+   * @param buf The bytes to echo.
    */
   auto echo(async_context &ctx, const socket_dialog &socket,
             const std::shared_ptr<read_context> &rctx,
-            const socket_message &msg) -> void;
+            const socket_address<sockaddr_in6> &address,
+            std::span<const std::byte> buf) -> void;
   /**
    * @brief Receives the bytes emitted by the service_base reader.
    * @param ctx The asynchronous context of the message.
@@ -73,6 +192,150 @@ public:
   auto service(async_context &ctx, const socket_dialog &socket,
                const std::shared_ptr<read_context> &rctx,
                std::span<const std::byte> buf) -> void;
+
+private:
+  /**
+   * @brief Initializes the UDP socket.
+   * @returns A portable error_code.
+   */
+  auto prepare() noexcept -> std::error_code;
+
+  /**
+   * @brief Sends a reply from a pooled buffer.
+   * @param ctx The asynchronous context of the message.
+   * @param socket The socket to send the reply on.
+   * @param address The address to reply to.
+   * @param block The pooled buffer, released once the reply is sent.
+   */
+  auto reply(async_context &ctx, const socket_dialog &socket,
+             const socket_address<sockaddr_in6> &address,
+             std::span<std::byte> block) -> void;
+
+  /**
+   * @brief Returns a reply buffer to the pool it was acquired from.
+   * @param block The reply buffer.
+   */
+  auto recycle(std::span<std::byte> block) noexcept -> void;
+
+  /**
+   * @brief Queues a reply that could not be sent, or counts it as dropped.
+   * @param address The address to reply to.
+   * @param buf The bytes to echo.
+   * @param error The errno value of the failed send.
+   */
+  auto defer(socket_address<sockaddr_in6> address,
+             std::span<const std::byte> buf, int error) -> void;
+
+  /**
+   * @brief Sends queued replies.
+   * @details Replies the socket accepts straight away are sent in one batch.
+   * The front of what is left is handed to the event loop, which waits for
+   * the socket to become writable.
+   * @param ctx The asynchronous context of the socket.
+   * @param socket The UDP socket.
+   */
+  auto flush(async_context &ctx, const socket_dialog &socket) -> void;
+
+  /**
+   * @brief Copies a reply into the network emulator, or drops it.
+   * @param address The address to reply to.
+   * @param buf The bytes to echo.
+   */
+  auto hold(const socket_address<sockaddr_in6> &address,
+            std::span<const std::byte> buf) -> void;
+
+  /**
+   * @brief Sends the held replies that are due.
+   * @details Replies the socket doesn't take are queued for a retry.
+   * @param all Send every held reply.
+   */
+  auto expire(bool all) -> void;
+
+  /** @brief A reply held by the network emulator. */
+  struct held_reply {
+    /** @brief The address to reply to. */
+    socket_address<sockaddr_in6> address;
+    /** @brief The reply payload. */
+    std::vector<std::byte, detail::arena_allocator<std::byte>> payload;
+  };
+
+  /** @brief UDP socket options. */
+  options options_;
+  /** @brief The dispatch time of the datagram being echoed. */
+  [[no_unique_address]] typename Stats::time_point dispatched_;
+  /** @brief Latency stats. */
+  [[no_unique_address]] Stats stats_;
+  /** @brief Event loop accounting. */
+  [[no_unique_address]] Accounting accounting_;
+  /** @brief The memory budget. */
+  [[no_unique_address]] Budget budget_;
+  /** @brief The datagram capture. */
+  [[no_unique_address]] Capture capture_;
+  /** @brief Buffers for replies that are in flight. */
+  detail::buffer_pool pool_;
+  /** @brief Buffers for large replies that are in flight. */
+  detail::buffer_pool large_pool_;
+  /** @brief The number of datagrams larger than the reply buffers. */
+  std::uint64_t large_ = 0;
+  /** @brief The number of datagrams larger than the receive buffer. */
+  std::uint64_t truncated_ = 0;
+  /** @brief Replies waiting for the socket to accept them. */
+  detail::retry_queue retry_;
+  /** @brief Retry and drop counters. */
+  detail::send_drops drops_;
+  /** @brief The errno value of the last deferred reply. */
+  int backpressure_ = EAGAIN;
+  /** @brief Set while the front of the retry queue is in flight. */
+  bool flushing_ = false;
+  /** @brief The bytes charged to the memory budget. */
+  std::size_t charged_ = 0;
+  /** @brief The UDP socket. */
+  io::socket::native_socket_type sockfd_ = -1;
+  /** @brief The result of initializing the UDP socket. */
+  std::error_code error_;
+  /** @brief Set once stop() has run. */
+  bool stopped_ = false;
+  /** @brief The network emulator and the replies it holds. */
+  [[no_unique_address]] typename Emulation::template state<held_reply>
+      emulation_;
 };
+
+/** @brief The default UDP echo server. */
+using udp_server = basic_udp_server<>;
+/**
+ * @brief A UDP echo server without stats, logging, accounting or a memory
+ * budget.
+ */
+using minimal_udp_server =
+    basic_udp_server<heap_buffers<UDP_BUFSIZE>, null_stats, null_logging,
+                     dual_stack, null_accounting, null_budget>;
+/** @brief A UDP echo server with large buffers for bulk transfers. */
+using bulk_udp_server =
+    basic_udp_server<heap_buffers<64 * 1024UL>, null_stats>;
+/** @brief A UDP echo server that only accepts IPv6 peers. */
+using ipv6_udp_server =
+    basic_udp_server<heap_buffers<UDP_BUFSIZE>, latency_histograms,
+                     spdlog_logging, ipv6_only>;
+/**
+ * @brief The default UDP echo server with network emulation and a
+ * datagram capture.
+ */
+using full_udp_server =
+    basic_udp_server<heap_buffers<UDP_BUFSIZE>, latency_histograms,
+                     spdlog_logging, dual_stack, live_accounting,
+                     shared_budget, network_emulation, datagram_capture>;
+
+// The presets are instantiated in udp_server.cpp.
+extern template class basic_udp_server<>;
+extern template class basic_udp_server<heap_buffers<UDP_BUFSIZE>, null_stats,
+                                       null_logging, dual_stack,
+                                       null_accounting, null_budget>;
+extern template class basic_udp_server<heap_buffers<64 * 1024UL>, null_stats>;
+extern template class basic_udp_server<heap_buffers<UDP_BUFSIZE>,
+                                       latency_histograms, spdlog_logging,
+                                       ipv6_only>;
+extern template class basic_udp_server<
+    heap_buffers<UDP_BUFSIZE>, latency_histograms, spdlog_logging, dual_stack,
+    live_accounting, shared_budget, network_emulation, datagram_capture>;
 } // namespace echo
 #endif // ECHO_UDP_SERVER_HPP
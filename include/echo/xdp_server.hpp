@@ -0,0 +1,127 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file xdp_server.hpp
+ * @brief This file declares the AF_XDP UDP echo server.
+ */
+#pragma once
+#ifndef ECHO_XDP_SERVER_HPP
+#define ECHO_XDP_SERVER_HPP
+#include "echo/detail/xdp.hpp"
+#include "echo/detail/xsk.hpp"
+
+#include <cstdint>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+/** @namespace For echo services. */
+namespace echo {
+/** @brief AF_XDP options. */
+struct xdp_options {
+  /** @brief The interface to echo on, empty to disable AF_XDP. */
+  std::string interface;
+  /** @brief Attach in generic (SKB) mode, which works with any driver. */
+  bool generic = false;
+  /** @brief Echo from the XDP program instead of AF_XDP sockets. */
+  bool reflect = false;
+  /** @brief The number of UMEM frames for each queue, a power of two. */
+  std::uint32_t frames = 4096;
+};
+
+/**
+ * @brief A UDP echo server that bypasses the kernel stack with XDP.
+ * @details An XDP program on the interface redirects UDP datagrams for
+ * the port to an AF_XDP socket on the queue they arrived on. Each queue
+ * has its own socket, UMEM and thread, which echoes the datagrams in
+ * place. With `reflect` set, the program echoes the datagrams itself and
+ * counts them in a per-CPU map, so no socket or thread is needed.
+ * Everything else passes to the kernel stack, where the UDP server on the
+ * same port handles what the program doesn't echo.
+ */
+class xdp_server {
+public:
+  /** @brief AF_XDP options. */
+  using options = xdp_options;
+
+  /**
+   * @brief Constructs the server for a UDP port.
+   * @param port The UDP port.
+   * @param opts The AF_XDP options.
+   */
+  xdp_server(unsigned short port, options opts) noexcept;
+  /** @brief Deleted copy constructor. */
+  xdp_server(const xdp_server &) = delete;
+  /** @brief Deleted move constructor. */
+  xdp_server(xdp_server &&) = delete;
+  /** @brief Deleted copy assignment. */
+  auto operator=(const xdp_server &) -> xdp_server & = delete;
+  /** @brief Deleted move assignment. */
+  auto operator=(xdp_server &&) -> xdp_server & = delete;
+  /** @brief Stops the server. */
+  ~xdp_server();
+
+  /**
+   * @brief Binds a socket to every queue and attaches the XDP program.
+   * @returns A portable error_code, set if nothing was attached.
+   */
+  auto start() noexcept -> std::error_code;
+
+  /** @brief Detaches the XDP program and stops the queue threads. */
+  auto stop() noexcept -> void;
+
+  /** @returns The number of queues served by AF_XDP sockets. */
+  [[nodiscard]] auto queues() const noexcept -> std::size_t;
+
+  /**
+   * @brief Reads the counters of the reflecting program.
+   * @param error Set if the counters could not be read.
+   * @returns The datagrams and bytes echoed by the program.
+   */
+  [[nodiscard]] auto counters(std::error_code &error) const
+      -> detail::xdp_counters;
+
+private:
+  /**
+   * @brief Echoes on one queue until the server stops.
+   * @param sock The queue's socket.
+   */
+  auto serve(detail::xsk_socket &sock) const noexcept -> void;
+
+  /** @brief Closes the program, the map and the sockets. */
+  auto close() noexcept -> void;
+
+  /** @brief The UDP port. */
+  unsigned short port_;
+  /** @brief AF_XDP options. */
+  options options_;
+  /** @brief The XSKMAP of sockets by queue. */
+  int xsks_ = -1;
+  /** @brief The per-CPU counters of the reflecting program. */
+  int counters_ = -1;
+  /** @brief The XDP program. */
+  int program_ = -1;
+  /** @brief The link that attaches the program. */
+  int link_ = -1;
+  /** @brief An eventfd that wakes the queue threads to stop. */
+  int stop_ = -1;
+  /** @brief The socket for each queue. */
+  std::vector<detail::xsk_socket> sockets_;
+  /** @brief The thread for each queue. */
+  std::vector<std::jthread> threads_;
+};
+} // namespace echo
+#endif // ECHO_XDP_SERVER_HPP
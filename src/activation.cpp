@@ -0,0 +1,260 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file activation.cpp
+ * @brief This file defines helpers for socket activation and readiness
+ * notification by a service manager.
+ */
+#include "echo/detail/activation.hpp"
+
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+extern char **environ;
+namespace echo::detail {
+// Parses a non-negative integer from an environment variable.
+static auto getenv_int(const char *name) noexcept -> int
+{
+  const auto *value = std::getenv(name);
+  if (!value)
+    return -1;
+
+  auto result = 0;
+  const auto *end = value + std::strlen(value);
+  auto [ptr, err] = std::from_chars(value, end, result);
+  if (err != std::errc{} || ptr != end)
+    return -1;
+
+  return result;
+}
+
+auto listen_fds() noexcept -> std::vector<int>
+{
+  auto fds = std::vector<int>();
+  auto pid = getenv_int("LISTEN_PID");
+  auto count = getenv_int("LISTEN_FDS");
+
+  unsetenv("LISTEN_PID");
+  unsetenv("LISTEN_FDS");
+  unsetenv("LISTEN_FDNAMES");
+
+  if (pid != getpid() || count <= 0)
+    return fds;
+
+  fds.reserve(count);
+  for (int fd = LISTEN_FDS_START; fd < LISTEN_FDS_START + count; ++fd)
+  {
+    if (auto flags = fcntl(fd, F_GETFD); flags >= 0)
+    {
+      fcntl(fd, F_SETFD, flags | FD_CLOEXEC);
+      fds.push_back(fd);
+    }
+  }
+  return fds;
+}
+
+auto sockets() noexcept -> std::vector<int>
+{
+  namespace fs = std::filesystem;
+  auto fds = std::vector<int>();
+  auto error = std::error_code();
+
+  for (auto it = fs::directory_iterator("/proc/self/fd", error);
+       !error && it != fs::directory_iterator(); it.increment(error))
+  {
+    auto name = it->path().filename().string();
+    auto fd = -1;
+    auto [ptr, err] =
+        std::from_chars(name.data(), name.data() + name.size(), fd);
+
+    struct stat info = {};
+    if (err == std::errc{} && fstat(fd, &info) == 0 && S_ISSOCK(info.st_mode))
+      fds.push_back(fd);
+  }
+  return fds;
+}
+
+auto find_listener(const std::vector<int> &fds, int type,
+                   unsigned short port) noexcept -> int
+{
+  for (auto fd : fds)
+  {
+    auto socktype = 0;
+    auto len = static_cast<socklen_t>(sizeof(socktype));
+    if (getsockopt(fd, SOL_SOCKET, SO_TYPE, &socktype, &len) ||
+        socktype != type)
+    {
+      continue;
+    }
+
+    auto listening = 0;
+    len = sizeof(listening);
+    if (type == SOCK_STREAM &&
+        (getsockopt(fd, SOL_SOCKET, SO_ACCEPTCONN, &listening, &len) ||
+         !listening))
+    {
+      continue;
+    }
+
+    auto addr = sockaddr_storage{};
+    len = sizeof(addr);
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    if (getsockname(fd, reinterpret_cast<sockaddr *>(&addr), &len))
+      continue;
+
+    auto local = in_port_t{};
+    if (addr.ss_family == AF_INET6)
+      // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+      local = reinterpret_cast<const sockaddr_in6 *>(&addr)->sin6_port;
+    else if (addr.ss_family == AF_INET)
+      // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+      local = reinterpret_cast<const sockaddr_in *>(&addr)->sin_port;
+    else
+      continue;
+
+    if (ntohs(local) == port)
+      return fd;
+  }
+  return -1;
+}
+
+auto serving(int fd) noexcept -> bool
+{
+  auto socktype = 0;
+  auto len = static_cast<socklen_t>(sizeof(socktype));
+  if (fd < 0 || getsockopt(fd, SOL_SOCKET, SO_TYPE, &socktype, &len))
+    return false;
+
+  if (socktype == SOCK_STREAM)
+  {
+    auto listening = 0;
+    len = sizeof(listening);
+    return !getsockopt(fd, SOL_SOCKET, SO_ACCEPTCONN, &listening, &len) &&
+           listening;
+  }
+
+  auto addr = sockaddr_storage{};
+  len = sizeof(addr);
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+  if (getsockname(fd, reinterpret_cast<sockaddr *>(&addr), &len))
+    return false;
+
+  if (addr.ss_family == AF_INET6)
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    return reinterpret_cast<const sockaddr_in6 *>(&addr)->sin6_port != 0;
+  if (addr.ss_family == AF_INET)
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    return reinterpret_cast<const sockaddr_in *>(&addr)->sin_port != 0;
+  return false;
+}
+
+auto adopt_socket(int inherited, int sockfd) noexcept -> std::error_code
+{
+  if (dup3(inherited, sockfd, O_CLOEXEC) < 0)
+    return {errno, std::system_category()};
+
+  close(inherited);
+  return {};
+}
+
+auto spawn(const char *path, char *const argv[], const std::vector<int> &fds,
+           const std::vector<std::string> &env) noexcept -> pid_t
+{
+  // Only async-signal-safe calls can be made in the child of a
+  // multi-threaded process, so everything it needs is prepared here.
+  static constexpr auto PIDLEN = 16UL;
+  auto strings = std::vector<std::string>();
+  for (auto **var = environ; var && *var; ++var)
+  {
+    if (!std::string_view(*var).starts_with("LISTEN_"))
+      strings.emplace_back(*var);
+  }
+  strings.push_back("LISTEN_FDS=" + std::to_string(fds.size()));
+  strings.insert(strings.end(), env.begin(), env.end());
+  strings.push_back("LISTEN_PID=" + std::string(PIDLEN, '\0'));
+  auto *pidstr = strings.back().data() + std::strlen("LISTEN_PID=");
+
+  auto envp = std::vector<char *>();
+  envp.reserve(strings.size() + 1);
+  for (auto &var : strings)
+    envp.push_back(var.data());
+  envp.push_back(nullptr);
+
+  auto moved = std::vector<int>(fds.size());
+  auto top = LISTEN_FDS_START + static_cast<int>(fds.size());
+
+  auto pid = fork();
+  if (pid != 0)
+    return pid;
+
+  // Move the sockets out of the way before putting them in place, in case
+  // one of them is already in the target range.
+  for (std::size_t i = 0; i < fds.size(); ++i)
+    moved[i] = fcntl(fds[i], F_DUPFD_CLOEXEC, top);
+
+  for (std::size_t i = 0; i < fds.size(); ++i)
+    dup2(moved[i], LISTEN_FDS_START + static_cast<int>(i));
+
+  close_range(top, ~0U, 0);
+  std::to_chars(pidstr, pidstr + PIDLEN - 1, getpid());
+
+  execve(path, argv, envp.data());
+  _exit(127); // NOLINT(concurrency-mt-unsafe)
+}
+
+auto notify(std::string_view state) noexcept -> std::error_code
+{
+  const auto *path = std::getenv("NOTIFY_SOCKET");
+  if (!path || !*path)
+    return {};
+
+  auto addr = sockaddr_un{.sun_family = AF_UNIX, .sun_path = {}};
+  auto len = std::strlen(path);
+  if ((path[0] != '/' && path[0] != '@') || len >= sizeof(addr.sun_path))
+    return std::make_error_code(std::errc::invalid_argument);
+
+  std::memcpy(addr.sun_path, path, len);
+  if (addr.sun_path[0] == '@')
+    addr.sun_path[0] = '\0';
+
+  auto sockfd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  if (sockfd < 0)
+    return {errno, std::system_category()};
+
+  auto error = std::error_code();
+  auto addrlen =
+      static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + len);
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+  if (sendto(sockfd, state.data(), state.size(), MSG_NOSIGNAL,
+             reinterpret_cast<const sockaddr *>(&addr), addrlen) < 0)
+  {
+    error = {errno, std::system_category()};
+  }
+
+  close(sockfd);
+  return error;
+}
+} // namespace echo::detail
@@ -0,0 +1,49 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file address.cpp
+ * @brief This file defines socket address formatting for the echo tools.
+ */
+#include "echo/detail/address.hpp"
+
+#include <array>
+#include <cstring>
+#include <format>
+
+#include <arpa/inet.h>
+namespace echo::detail {
+
+auto format_address(const sockaddr_in6 &address, bool with_port) -> std::string
+{
+  auto buf = std::array<char, INET6_ADDRSTRLEN>();
+  if (address.sin6_family == AF_INET)
+  {
+    auto addr = sockaddr_in{};
+    std::memcpy(&addr, &address, sizeof(addr));
+    inet_ntop(AF_INET, &addr.sin_addr, buf.data(), buf.size());
+    if (!with_port)
+      return {buf.data()};
+
+    return std::format("{}:{}", buf.data(), ntohs(addr.sin_port));
+  }
+
+  inet_ntop(AF_INET6, &address.sin6_addr, buf.data(), buf.size());
+  if (!with_port)
+    return std::format("[{}]", buf.data());
+
+  return std::format("[{}]:{}", buf.data(), ntohs(address.sin6_port));
+}
+} // namespace echo::detail
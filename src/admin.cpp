@@ -0,0 +1,287 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file admin.cpp
+ * @brief This file defines the admin socket and the live accounting that
+ * it reports.
+ */
+#include "echo/detail/admin.hpp"
+
+#include <array>
+#include <cerrno>
+#include <cstdio>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace echo::detail {
+// How long a client may take to send a command or read a response.
+static constexpr auto CLIENT_TIMEOUT = timeval{.tv_sec = 1, .tv_usec = 0};
+// The longest command line.
+static constexpr auto MAX_LINE = 1024UL;
+
+auto cpu_time(pid_t tid) noexcept -> std::chrono::milliseconds
+{
+  auto path = std::array<char, 64>{};
+  std::snprintf(path.data(), path.size(), "/proc/self/task/%d/stat", tid);
+  auto *file = std::fopen(path.data(), "re");
+  if (!file)
+    return {};
+
+  // utime and stime are the 14th and 15th fields. The command name in the
+  // second field is in parentheses and may hold spaces.
+  auto ticks = 0UL;
+  auto user = 0UL;
+  auto system = 0UL;
+  auto matched =
+      std::fscanf(file, "%*d (%*[^)]) %*c %*d %*d %*d %*d %*d %*u %*u %*u "
+                        "%*u %*u %lu %lu",
+                  &user, &system);
+  std::fclose(file);
+  if (matched == 2)
+    ticks = user + system;
+
+  static const auto hz = sysconf(_SC_CLK_TCK);
+  return std::chrono::milliseconds(ticks * 1000 / hz);
+}
+
+auto connection_table::open(int fd, wall_clock::time_point opened,
+                            std::size_t buffer_size) -> connection_entry &
+{
+  auto lock = std::lock_guard(mtx_);
+  auto index = static_cast<std::size_t>(fd);
+  if (entries_.size() <= index)
+    entries_.resize(index + 1);
+
+  auto &entry = entries_[index];
+  if (!entry)
+    entry = std::make_unique<connection_entry>();
+
+  entry->opened = opened;
+  entry->buffer_size = buffer_size;
+  entry->bytes_in.store(0, std::memory_order_relaxed);
+  entry->bytes_out.store(0, std::memory_order_relaxed);
+  entry->pending.store(0, std::memory_order_relaxed);
+  if (!std::exchange(entry->open, true))
+    ++size_;
+  return *entry;
+}
+
+auto connection_table::close(int fd) noexcept -> void
+{
+  auto lock = std::lock_guard(mtx_);
+  auto index = static_cast<std::size_t>(fd);
+  if (index < entries_.size() && entries_[index] &&
+      std::exchange(entries_[index]->open, false))
+  {
+    --size_;
+  }
+}
+
+auto connection_table::snapshot() const -> std::vector<connection_info>
+{
+  auto now = wall_clock::now();
+  auto connections = std::vector<connection_info>();
+  auto lock = std::lock_guard(mtx_);
+  connections.reserve(size_);
+
+  for (std::size_t fd = 0; fd < entries_.size(); ++fd)
+  {
+    const auto &entry = entries_[fd];
+    if (!entry || !entry->open)
+      continue;
+
+    auto info = connection_info{
+        .fd = static_cast<int>(fd),
+        .peer = {},
+        .age = std::chrono::duration_cast<std::chrono::milliseconds>(
+            now - entry->opened),
+        .bytes_in = entry->bytes_in.load(std::memory_order_relaxed),
+        .bytes_out = entry->bytes_out.load(std::memory_order_relaxed),
+        .pending = entry->pending.load(std::memory_order_relaxed),
+        .buffer_size = entry->buffer_size};
+    auto len = static_cast<socklen_t>(sizeof(info.peer));
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    getpeername(info.fd, reinterpret_cast<sockaddr *>(&info.peer), &len);
+    connections.push_back(info);
+  }
+  return connections;
+}
+
+auto connection_table::shutdown(int fd) noexcept -> bool
+{
+  auto lock = std::lock_guard(mtx_);
+  auto index = static_cast<std::size_t>(fd);
+  if (fd < 0 || index >= entries_.size() || !entries_[index] ||
+      !entries_[index]->open)
+  {
+    return false;
+  }
+
+  return ::shutdown(fd, SHUT_RDWR) == 0;
+}
+
+auto connection_table::size() const noexcept -> std::size_t
+{
+  auto lock = std::lock_guard(mtx_);
+  return size_;
+}
+
+admin_socket::admin_socket(admin_socket &&other) noexcept
+    : path_{std::move(other.path_)},
+      listener_{std::exchange(other.listener_, -1)},
+      stop_{std::exchange(other.stop_, -1)}
+{
+  other.path_.clear();
+}
+
+auto admin_socket::operator=(admin_socket &&other) noexcept -> admin_socket &
+{
+  if (this != &other)
+  {
+    close();
+    path_ = std::exchange(other.path_, {});
+    listener_ = std::exchange(other.listener_, -1);
+    stop_ = std::exchange(other.stop_, -1);
+  }
+  return *this;
+}
+
+admin_socket::~admin_socket() { close(); }
+
+auto admin_socket::create(const std::string &path,
+                          std::error_code &error) noexcept -> admin_socket
+{
+  auto fail = [&] {
+    error = {errno, std::system_category()};
+    return admin_socket();
+  };
+
+  auto sock = admin_socket();
+  auto addr = sockaddr_un{.sun_family = AF_UNIX, .sun_path = {}};
+  if (path.empty() || path.size() >= sizeof(addr.sun_path))
+  {
+    error = std::make_error_code(std::errc::filename_too_long);
+    return sock;
+  }
+  path.copy(addr.sun_path, sizeof(addr.sun_path) - 1);
+
+  sock.listener_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  sock.stop_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (sock.listener_ < 0 || sock.stop_ < 0)
+    return fail();
+
+  // Only the owner may connect, whatever the umask.
+  unlink(path.c_str());
+  auto mask = umask(0077);
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+  auto bound = bind(sock.listener_, reinterpret_cast<sockaddr *>(&addr),
+                    sizeof(addr));
+  umask(mask);
+  if (bound || listen(sock.listener_, SOMAXCONN))
+    return fail();
+
+  sock.path_ = path;
+  return sock;
+}
+
+auto admin_socket::run(const handler_type &handler) -> void
+{
+  auto fds = std::array<pollfd, 2>{};
+  fds[0] = {.fd = listener_, .events = POLLIN, .revents = 0};
+  fds[1] = {.fd = stop_, .events = POLLIN, .revents = 0};
+  while (true)
+  {
+    if (poll(fds.data(), fds.size(), -1) < 0 && errno != EINTR)
+      return;
+
+    if (fds[1].revents)
+      return;
+
+    if (fds[0].revents & POLLIN)
+    {
+      auto client = accept4(listener_, nullptr, nullptr, SOCK_CLOEXEC);
+      if (client < 0)
+        continue;
+
+      setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &CLIENT_TIMEOUT,
+                 sizeof(CLIENT_TIMEOUT));
+      setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &CLIENT_TIMEOUT,
+                 sizeof(CLIENT_TIMEOUT));
+      serve(client, handler);
+      ::close(client);
+    }
+  }
+}
+
+auto admin_socket::serve(int client, const handler_type &handler) -> void
+{
+  auto line = std::string();
+  auto buf = std::array<char, 512>{};
+  while (true)
+  {
+    auto len = recv(client, buf.data(), buf.size(), 0);
+    if (len <= 0)
+      return;
+
+    for (auto c : std::string_view(buf.data(), len))
+    {
+      if (c != '\n')
+      {
+        if (line.size() >= MAX_LINE)
+          return;
+        line.push_back(c);
+        continue;
+      }
+
+      if (!line.empty() && line.back() == '\r')
+        line.pop_back();
+
+      auto response = handler(line) + "\n";
+      line.clear();
+      for (std::string_view out = response; !out.empty();)
+      {
+        auto sent = send(client, out.data(), out.size(), MSG_NOSIGNAL);
+        if (sent <= 0)
+          return;
+        out.remove_prefix(sent);
+      }
+    }
+  }
+}
+
+auto admin_socket::stop() noexcept -> void
+{
+  auto value = std::uint64_t{1};
+  [[maybe_unused]] auto len = write(stop_, &value, sizeof(value));
+}
+
+admin_socket::operator bool() const noexcept { return listener_ >= 0; }
+
+auto admin_socket::close() noexcept -> void
+{
+  if (listener_ >= 0)
+    ::close(std::exchange(listener_, -1));
+  if (stop_ >= 0)
+    ::close(std::exchange(stop_, -1));
+  if (!path_.empty())
+    unlink(std::exchange(path_, {}).c_str());
+}
+} // namespace echo::detail
@@ -0,0 +1,191 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file arena.cpp
+ * @brief This file defines a hugepage-backed arena for echo buffers.
+ */
+#include "echo/detail/arena.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <new>
+#include <utility>
+
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+namespace echo::detail {
+// The arena that arena_allocator allocates from.
+static std::atomic<arena *> installed_arena = nullptr;
+
+// The size class of a block.
+static constexpr auto size_class(std::size_t size) noexcept -> std::size_t
+{
+  return std::bit_width(std::max(size, arena::MIN_BLOCK) - 1);
+}
+
+// Prefers the NUMA node of the calling thread for a region that hasn't
+// been faulted in yet.
+static auto bind_local(void *addr, std::size_t size) noexcept -> int
+{
+  auto cpu = 0U;
+  auto node = 0U;
+  if (syscall(SYS_getcpu, &cpu, &node, nullptr) ||
+      node >= sizeof(unsigned long) * 8)
+  {
+    return -1;
+  }
+
+  auto mask = 1UL << node;
+  if (syscall(SYS_mbind, addr, size, MPOL_PREFERRED, &mask,
+              sizeof(mask) * 8, 0))
+  {
+    return -1;
+  }
+  return static_cast<int>(node);
+}
+
+// Faults a region in, so that no page faults are taken when it is used.
+static auto prefault(std::byte *addr, std::size_t size) noexcept -> void
+{
+#ifdef MADV_POPULATE_WRITE
+  if (!madvise(addr, size, MADV_POPULATE_WRITE))
+    return;
+#endif
+  static const auto page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+  volatile auto *bytes = addr;
+  for (std::size_t offset = 0; offset < size; offset += page)
+    bytes[offset] = std::byte{};
+}
+
+arena::arena(arena &&other) noexcept
+    : base_{std::exchange(other.base_, nullptr)},
+      size_{std::exchange(other.size_, 0)},
+      offset_{std::exchange(other.offset_, 0)},
+      hugetlb_{std::exchange(other.hugetlb_, false)},
+      node_{std::exchange(other.node_, -1)},
+      free_{std::exchange(other.free_, {})}
+{}
+
+auto arena::operator=(arena &&other) noexcept -> arena &
+{
+  if (this != &other)
+  {
+    close();
+    base_ = std::exchange(other.base_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+    offset_ = std::exchange(other.offset_, 0);
+    hugetlb_ = std::exchange(other.hugetlb_, false);
+    node_ = std::exchange(other.node_, -1);
+    free_ = std::exchange(other.free_, {});
+  }
+  return *this;
+}
+
+arena::~arena() { close(); }
+
+auto arena::close() noexcept -> void
+{
+  if (base_)
+    munmap(std::exchange(base_, nullptr), std::exchange(size_, 0));
+}
+
+auto arena::create(std::size_t size, std::error_code &error) noexcept -> arena
+{
+  auto region = arena();
+  size = (std::max(size, HUGEPAGE) + HUGEPAGE - 1) & ~(HUGEPAGE - 1);
+
+  // Reserved hugepages are used if there are enough of them, otherwise
+  // transparent hugepages are asked for.
+  auto flags = MAP_PRIVATE | MAP_ANONYMOUS;
+  auto *addr = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                    flags | MAP_HUGETLB, -1, 0);
+  region.hugetlb_ = addr != MAP_FAILED;
+  if (!region.hugetlb_)
+  {
+    addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (addr == MAP_FAILED)
+    {
+      error = {errno, std::system_category()};
+      return region;
+    }
+    madvise(addr, size, MADV_HUGEPAGE);
+  }
+
+  region.base_ = static_cast<std::byte *>(addr);
+  region.size_ = size;
+  region.node_ = bind_local(addr, size);
+  prefault(region.base_, size);
+  return region;
+}
+
+auto arena::allocate(std::size_t size) noexcept -> void *
+{
+  auto cls = size_class(size);
+  if (cls >= CLASSES)
+    return nullptr;
+
+  auto lock = std::lock_guard(mtx_);
+  if (auto *block = free_[cls])
+  {
+    free_[cls] = block->next;
+    return block;
+  }
+
+  auto block = 1UL << cls;
+  if (size_ - offset_ < block)
+    return nullptr;
+
+  return base_ + std::exchange(offset_, offset_ + block);
+}
+
+auto arena::deallocate(void *ptr, std::size_t size) noexcept -> void
+{
+  auto cls = size_class(size);
+  auto lock = std::lock_guard(mtx_);
+  free_[cls] = new (ptr) free_block{.next = free_[cls]};
+}
+
+auto arena::contains(const void *ptr) const noexcept -> bool
+{
+  const auto *byte = static_cast<const std::byte *>(ptr);
+  return base_ && byte >= base_ && byte < base_ + size_;
+}
+
+auto arena::size() const noexcept -> std::size_t { return size_; }
+
+auto arena::used() const noexcept -> std::size_t { return offset_; }
+
+auto arena::hugetlb() const noexcept -> bool { return hugetlb_; }
+
+auto arena::node() const noexcept -> int { return node_; }
+
+arena::operator bool() const noexcept { return base_ != nullptr; }
+
+auto arena::install(arena *arena) noexcept -> void
+{
+  installed_arena.store(arena, std::memory_order_release);
+}
+
+auto arena::installed() noexcept -> arena *
+{
+  return installed_arena.load(std::memory_order_acquire);
+}
+} // namespace echo::detail
@@ -0,0 +1,299 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file bpf.cpp
+ * @brief This file defines a minimal eBPF assembler and loader.
+ */
+#include "echo/detail/bpf.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <utility>
+
+#include <linux/if_link.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace echo::detail::bpf {
+// The bpf() system call, which glibc doesn't wrap.
+static auto sys_bpf(bpf_cmd cmd, bpf_attr &attr) noexcept -> int
+{
+  return static_cast<int>(syscall(SYS_bpf, cmd, &attr, sizeof(attr)));
+}
+
+// Converts a pointer into a bpf_attr field.
+static auto to_u64(const void *ptr) noexcept -> std::uint64_t
+{
+  return reinterpret_cast<std::uintptr_t>(ptr);
+}
+
+// Builds an instruction.
+static constexpr auto insn(std::uint8_t code, reg dst, reg src,
+                           std::int16_t off, std::int32_t imm) noexcept
+    -> bpf_insn
+{
+  auto ins = bpf_insn{};
+  ins.code = code;
+  ins.dst_reg = dst & 0xf;
+  ins.src_reg = src & 0xf;
+  ins.off = off;
+  ins.imm = imm;
+  return ins;
+}
+
+auto assembler::make_label() -> label
+{
+  labels_.push_back(SIZE_MAX);
+  return labels_.size() - 1;
+}
+
+auto assembler::bind(label target) -> void
+{
+  assert(target < labels_.size() && labels_[target] == SIZE_MAX);
+  labels_[target] = insns_.size();
+}
+
+auto assembler::mov(reg dst, std::int32_t imm) -> void
+{
+  emit(insn(BPF_ALU64 | BPF_MOV | BPF_K, dst, R0, 0, imm));
+}
+
+auto assembler::to_host(reg dst, std::int32_t bits) -> void
+{
+  emit(insn(BPF_ALU | BPF_END | BPF_TO_BE, dst, R0, 0, bits));
+}
+
+auto assembler::mov(reg dst, reg src) -> void
+{
+  emit(insn(BPF_ALU64 | BPF_MOV | BPF_X, dst, src, 0, 0));
+}
+
+auto assembler::alu(std::uint8_t op, reg dst, std::int32_t imm) -> void
+{
+  emit(insn(BPF_ALU64 | op | BPF_K, dst, R0, 0, imm));
+}
+
+auto assembler::alu(std::uint8_t op, reg dst, reg src) -> void
+{
+  emit(insn(BPF_ALU64 | op | BPF_X, dst, src, 0, 0));
+}
+
+auto assembler::load(std::uint8_t size, reg dst, reg src,
+                     std::int16_t off) -> void
+{
+  emit(insn(BPF_LDX | size | BPF_MEM, dst, src, off, 0));
+}
+
+auto assembler::store(std::uint8_t size, reg dst, std::int16_t off,
+                      reg src) -> void
+{
+  emit(insn(BPF_STX | size | BPF_MEM, dst, src, off, 0));
+}
+
+auto assembler::store(std::uint8_t size, reg dst, std::int16_t off,
+                      std::int32_t imm) -> void
+{
+  emit(insn(BPF_ST | size | BPF_MEM, dst, R0, off, imm));
+}
+
+auto assembler::load_map(reg dst, int map) -> void
+{
+  // A 64-bit immediate load takes two instructions.
+  emit(insn(BPF_LD | BPF_DW | BPF_IMM, dst, static_cast<reg>(BPF_PSEUDO_MAP_FD),
+            0, map));
+  emit(insn(0, R0, R0, 0, 0));
+}
+
+auto assembler::jump(label target) -> void
+{
+  fixups_.push_back({insns_.size(), target});
+  emit(insn(BPF_JMP | BPF_JA, R0, R0, 0, 0));
+}
+
+auto assembler::jump(std::uint8_t op, reg dst, std::int32_t imm,
+                     label target) -> void
+{
+  fixups_.push_back({insns_.size(), target});
+  emit(insn(BPF_JMP | op | BPF_K, dst, R0, 0, imm));
+}
+
+auto assembler::jump(std::uint8_t op, reg dst, reg src, label target) -> void
+{
+  fixups_.push_back({insns_.size(), target});
+  emit(insn(BPF_JMP | op | BPF_X, dst, src, 0, 0));
+}
+
+auto assembler::call(std::int32_t helper) -> void
+{
+  emit(insn(BPF_JMP | BPF_CALL, R0, R0, 0, helper));
+}
+
+auto assembler::exit() -> void { emit(insn(BPF_JMP | BPF_EXIT, R0, R0, 0, 0)); }
+
+auto assembler::finish() const -> std::vector<bpf_insn>
+{
+  auto program = insns_;
+  for (const auto &[index, target] : fixups_)
+  {
+    assert(labels_.at(target) != SIZE_MAX);
+    // Jump offsets are relative to the instruction after the jump.
+    program[index].off = static_cast<std::int16_t>(
+        static_cast<std::ptrdiff_t>(labels_[target]) -
+        static_cast<std::ptrdiff_t>(index) - 1);
+  }
+  return program;
+}
+
+auto assembler::emit(const bpf_insn &insn) -> void { insns_.push_back(insn); }
+
+auto create_map(bpf_map_type type, std::uint32_t key_size,
+                std::uint32_t value_size, std::uint32_t max_entries,
+                std::error_code &error) noexcept -> int
+{
+  auto attr = bpf_attr{};
+  attr.map_type = type;
+  attr.key_size = key_size;
+  attr.value_size = value_size;
+  attr.max_entries = max_entries;
+
+  auto map = sys_bpf(BPF_MAP_CREATE, attr);
+  if (map < 0)
+    error = {errno, std::system_category()};
+  return map;
+}
+
+auto update(int map, const void *key, const void *value) noexcept
+    -> std::error_code
+{
+  auto attr = bpf_attr{};
+  attr.map_fd = static_cast<std::uint32_t>(map);
+  attr.key = to_u64(key);
+  attr.value = to_u64(value);
+  attr.flags = BPF_ANY;
+
+  if (sys_bpf(BPF_MAP_UPDATE_ELEM, attr))
+    return {errno, std::system_category()};
+  return {};
+}
+
+auto lookup(int map, const void *key, void *value) noexcept
+    -> std::error_code
+{
+  auto attr = bpf_attr{};
+  attr.map_fd = static_cast<std::uint32_t>(map);
+  attr.key = to_u64(key);
+  attr.value = to_u64(value);
+
+  if (sys_bpf(BPF_MAP_LOOKUP_ELEM, attr))
+    return {errno, std::system_category()};
+  return {};
+}
+
+auto load_xdp(std::span<const bpf_insn> program, std::error_code &error,
+              std::vector<char> *log) noexcept -> int
+{
+  static constexpr char license[] = "GPL";
+  auto attr = bpf_attr{};
+  attr.prog_type = BPF_PROG_TYPE_XDP;
+  attr.insns = to_u64(program.data());
+  attr.insn_cnt = static_cast<std::uint32_t>(program.size());
+  attr.license = to_u64(license);
+
+  auto prog = sys_bpf(BPF_PROG_LOAD, attr);
+  if (prog >= 0)
+    return prog;
+
+  error = {errno, std::system_category()};
+  if (log && error != std::errc::operation_not_permitted)
+  {
+    // The verifier only explains itself when it is given a buffer.
+    log->assign(64UL * 1024, '\0');
+    attr.log_buf = to_u64(log->data());
+    attr.log_size = static_cast<std::uint32_t>(log->size());
+    attr.log_level = 1;
+    if ((prog = sys_bpf(BPF_PROG_LOAD, attr)) >= 0)
+      return prog;
+  }
+  return -1;
+}
+
+auto attach_xdp(int program, unsigned ifindex, bool generic,
+                std::error_code &error) noexcept -> int
+{
+  auto attr = bpf_attr{};
+  attr.link_create.prog_fd = static_cast<std::uint32_t>(program);
+  attr.link_create.target_ifindex = ifindex;
+  attr.link_create.attach_type = BPF_XDP;
+  attr.link_create.flags = generic ? XDP_FLAGS_SKB_MODE : XDP_FLAGS_DRV_MODE;
+
+  auto link = sys_bpf(BPF_LINK_CREATE, attr);
+  if (link < 0)
+    error = {errno, std::system_category()};
+  return link;
+}
+
+auto test_run(int program, std::vector<std::byte> &packet,
+              std::error_code &error) noexcept -> std::uint32_t
+{
+  auto out = std::vector<std::byte>(packet.size() + 256);
+  auto attr = bpf_attr{};
+  attr.test.prog_fd = static_cast<std::uint32_t>(program);
+  attr.test.data_in = to_u64(packet.data());
+  attr.test.data_size_in = static_cast<std::uint32_t>(packet.size());
+  attr.test.data_out = to_u64(out.data());
+  attr.test.data_size_out = static_cast<std::uint32_t>(out.size());
+  attr.test.repeat = 1;
+
+  if (sys_bpf(BPF_PROG_TEST_RUN, attr))
+  {
+    error = {errno, std::system_category()};
+    return XDP_ABORTED;
+  }
+
+  out.resize(std::min<std::size_t>(attr.test.data_size_out, out.size()));
+  packet = std::move(out);
+  return attr.test.retval;
+}
+
+auto possible_cpus() noexcept -> std::size_t
+{
+  // The list is ranges like "0-3,8-11". Per-CPU values are indexed up to
+  // the highest possible CPU.
+  static const auto cpus = [] {
+    auto count = std::size_t{1};
+    auto *file = std::fopen("/sys/devices/system/cpu/possible", "re");
+    if (!file)
+      return count;
+
+    unsigned first = 0;
+    unsigned last = 0;
+    while (std::fscanf(file, "%u", &first) == 1)
+    {
+      last = first;
+      if (std::fscanf(file, "-%u", &last) != 1)
+        last = first;
+      count = std::max<std::size_t>(count, last + 1);
+      if (std::fgetc(file) != ',')
+        break;
+    }
+    std::fclose(file);
+    return count;
+  }();
+  return cpus;
+}
+} // namespace echo::detail::bpf
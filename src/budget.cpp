@@ -0,0 +1,91 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file budget.cpp
+ * @brief This file defines a process-wide memory budget for echo buffers.
+ */
+#include "echo/detail/budget.hpp"
+
+#include <format>
+namespace echo::detail {
+
+memory_budget::memory_budget(std::size_t limit) noexcept
+    : limit_{limit},
+      watermark_{static_cast<std::size_t>(static_cast<double>(limit) *
+                                          WATERMARK)}
+{}
+
+auto memory_budget::charge(std::size_t bytes,
+                           std::size_t ceiling) noexcept -> bool
+{
+  auto used = used_.load(std::memory_order_relaxed);
+  do
+  {
+    if (bytes > ceiling || used > ceiling - bytes)
+    {
+      shed_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+  } while (!used_.compare_exchange_weak(used, used + bytes,
+                                        std::memory_order_relaxed));
+
+  auto peak = peak_.load(std::memory_order_relaxed);
+  while (used + bytes > peak &&
+         !peak_.compare_exchange_weak(peak, used + bytes,
+                                      std::memory_order_relaxed))
+  {
+  }
+  return true;
+}
+
+auto memory_budget::try_admit(std::size_t bytes) noexcept -> bool
+{
+  return charge(bytes, watermark_);
+}
+
+auto memory_budget::try_acquire(std::size_t bytes) noexcept -> bool
+{
+  return charge(bytes, limit_);
+}
+
+auto memory_budget::release(std::size_t bytes) noexcept -> void
+{
+  used_.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+auto memory_budget::used() const noexcept -> std::size_t
+{
+  return used_.load(std::memory_order_relaxed);
+}
+
+auto memory_budget::limit() const noexcept -> std::size_t { return limit_; }
+
+auto memory_budget::peak() const noexcept -> std::size_t
+{
+  return peak_.load(std::memory_order_relaxed);
+}
+
+auto memory_budget::shed() const noexcept -> std::uint64_t
+{
+  return shed_.load(std::memory_order_relaxed);
+}
+
+auto memory_budget::summary() const -> std::string
+{
+  return std::format("{}/{} bytes used, peak {}, {} shed", used(), limit_,
+                     peak(), shed());
+}
+} // namespace echo::detail
@@ -0,0 +1,67 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file buffer_pool.cpp
+ * @brief This file defines a pool of fixed-size buffers.
+ */
+#include "echo/detail/buffer_pool.hpp"
+
+#include <cassert>
+namespace echo::detail {
+
+buffer_pool::buffer_pool(std::size_t count, std::size_t size)
+    : storage_(count * size), size_{size}
+{
+  free_.reserve(count);
+  for (auto i = count; i > 0; --i)
+    free_.push_back(i - 1);
+}
+
+auto buffer_pool::acquire() noexcept -> std::span<std::byte>
+{
+  if (free_.empty())
+    return {};
+
+  auto index = free_.back();
+  free_.pop_back();
+  return std::span(storage_).subspan(index * size_, size_);
+}
+
+auto buffer_pool::release(std::span<std::byte> buffer) noexcept -> void
+{
+  assert(buffer.data() >= storage_.data() &&
+         buffer.data() < storage_.data() + storage_.size() &&
+         "Buffer must belong to this pool.");
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  auto offset = static_cast<std::size_t>(buffer.data() - storage_.data());
+  free_.push_back(offset / size_);
+}
+
+auto buffer_pool::available() const noexcept -> std::size_t
+{
+  return free_.size();
+}
+
+auto buffer_pool::capacity() const noexcept -> std::size_t
+{
+  return size_ ? storage_.size() / size_ : 0;
+}
+
+auto buffer_pool::buffer_size() const noexcept -> std::size_t
+{
+  return size_;
+}
+} // namespace echo::detail
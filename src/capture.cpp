@@ -0,0 +1,279 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file capture.cpp
+ * @brief This file defines a memory-mapped datagram capture ring.
+ */
+#include "echo/detail/capture.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+namespace echo::detail {
+namespace {
+// Records are 8-byte aligned, and start with this header.
+struct record_header {
+  std::uint32_t length;
+  std::uint32_t reserved;
+  std::int64_t timestamp;
+  sockaddr_in6 address;
+  std::uint32_t padding;
+};
+
+// Marks the end of the records before the ring wraps around.
+constexpr auto WRAP = 0xffffffffU;
+constexpr auto ALIGN = 8UL;
+
+constexpr auto record_size(std::size_t length) noexcept -> std::size_t
+{
+  return sizeof(record_header) + ((length + ALIGN - 1) & ~(ALIGN - 1));
+}
+
+auto header_of(std::span<std::byte> map) noexcept -> capture_header &
+{
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+  return *reinterpret_cast<capture_header *>(map.data());
+}
+
+auto record_at(std::span<std::byte> map,
+               std::size_t offset) noexcept -> record_header *
+{
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+  return reinterpret_cast<record_header *>(map.data() +
+                                           sizeof(capture_header) + offset);
+}
+
+// The reader and the writer both treat a record that can't fit before
+// the end of the ring as a wrap marker.
+auto wraps_at(std::span<std::byte> map, std::size_t offset) noexcept -> bool
+{
+  const auto &hdr = header_of(map);
+  return hdr.capacity - offset < sizeof(record_header) ||
+         record_at(map, offset)->length == WRAP;
+}
+
+auto map_file(int fd, std::size_t size, bool writable,
+              std::error_code &error) noexcept -> std::span<std::byte>
+{
+  auto prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+  // Prefault the mapping so that recording doesn't take page faults.
+  auto *addr = mmap(nullptr, size, prot, MAP_SHARED | MAP_POPULATE, fd, 0);
+  if (addr == MAP_FAILED)
+  {
+    error = {errno, std::system_category()};
+    return {};
+  }
+  return {static_cast<std::byte *>(addr), size};
+}
+} // namespace
+
+capture_file::capture_file(capture_file &&other) noexcept
+    : map_{std::exchange(other.map_, {})}
+{}
+
+auto capture_file::operator=(capture_file &&other) noexcept -> capture_file &
+{
+  if (this != &other)
+  {
+    if (map_.data())
+      munmap(map_.data(), map_.size());
+    map_ = std::exchange(other.map_, {});
+  }
+  return *this;
+}
+
+capture_file::~capture_file()
+{
+  if (map_.data())
+    munmap(map_.data(), map_.size());
+}
+
+auto capture_file::create(const char *path, std::size_t size,
+                          std::error_code &error) noexcept -> capture_file
+{
+  auto file = capture_file();
+  size = std::max(size, MIN_SIZE) & ~(ALIGN - 1);
+
+  auto fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0)
+  {
+    error = {errno, std::system_category()};
+    return file;
+  }
+
+  if (ftruncate(fd, static_cast<off_t>(size)))
+    error = {errno, std::system_category()};
+  else
+    file.map_ = map_file(fd, size, true, error);
+  close(fd);
+
+  if (file)
+  {
+    auto &hdr = header_of(file.map_);
+    hdr = capture_header{.magic = capture_header::MAGIC,
+                         .enabled = 1,
+                         .capacity = size - sizeof(capture_header)};
+  }
+  return file;
+}
+
+auto capture_file::open(const char *path, bool writable,
+                        std::error_code &error) noexcept -> capture_file
+{
+  auto file = capture_file();
+  auto fd = ::open(path, (writable ? O_RDWR : O_RDONLY) | O_CLOEXEC);
+  if (fd < 0)
+  {
+    error = {errno, std::system_category()};
+    return file;
+  }
+
+  struct stat info = {};
+  if (fstat(fd, &info))
+    error = {errno, std::system_category()};
+  else if (static_cast<std::size_t>(info.st_size) < sizeof(capture_header))
+    error = std::make_error_code(std::errc::invalid_argument);
+  else
+    file.map_ = map_file(fd, info.st_size, writable, error);
+  close(fd);
+
+  if (file)
+  {
+    const auto &hdr = header_of(file.map_);
+    if (hdr.magic != capture_header::MAGIC ||
+        hdr.capacity > file.map_.size() - sizeof(capture_header))
+    {
+      error = std::make_error_code(std::errc::invalid_argument);
+      file = capture_file();
+    }
+  }
+  return file;
+}
+
+auto capture_file::evict() noexcept -> void
+{
+  auto &hdr = header_of(map_);
+  if (wraps_at(map_, hdr.tail))
+  {
+    hdr.tail = 0;
+    return;
+  }
+
+  hdr.tail += record_size(record_at(map_, hdr.tail)->length);
+  --hdr.count;
+  ++hdr.overwritten;
+}
+
+auto capture_file::record(std::span<const std::byte> address,
+                          std::span<const std::byte> payload) noexcept -> void
+{
+  if (!map_.data())
+    return;
+
+  auto &hdr = header_of(map_);
+  if (!std::atomic_ref(hdr.enabled).load(std::memory_order_relaxed))
+    return;
+
+  const auto size = record_size(payload.size());
+  if (size > hdr.capacity)
+    return;
+
+  // Find contiguous space at the head, evicting the oldest records.
+  while (true)
+  {
+    if (!hdr.count)
+    {
+      hdr.head = hdr.tail = 0;
+      break;
+    }
+
+    if (hdr.tail < hdr.head)
+    {
+      if (hdr.capacity - hdr.head >= size)
+        break;
+
+      if (hdr.head < hdr.capacity)
+        record_at(map_, hdr.head)->length = WRAP;
+      hdr.head = 0;
+      continue;
+    }
+
+    if (hdr.tail - hdr.head >= size)
+      break;
+
+    evict();
+  }
+
+  auto *rec = record_at(map_, hdr.head);
+  *rec = record_header{
+      .length = static_cast<std::uint32_t>(payload.size()),
+      .timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::system_clock::now().time_since_epoch())
+                       .count()};
+  std::memcpy(&rec->address, address.data(),
+              std::min(address.size(), sizeof(rec->address)));
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  std::memcpy(rec + 1, payload.data(), payload.size());
+
+  hdr.head += size;
+  ++hdr.count;
+}
+
+auto capture_file::enable(bool enabled) noexcept -> void
+{
+  if (map_.data())
+  {
+    std::atomic_ref(header_of(map_).enabled)
+        .store(enabled ? 1 : 0, std::memory_order_relaxed);
+  }
+}
+
+auto capture_file::records() const -> generator<capture_record>
+{
+  using namespace std::chrono;
+  const auto &hdr = header();
+  auto offset = hdr.tail;
+
+  for (std::uint64_t i = 0; i < hdr.count; ++i)
+  {
+    if (wraps_at(map_, offset))
+      offset = 0;
+
+    const auto *rec = record_at(map_, offset);
+    auto record = capture_record{
+        .timestamp = system_clock::time_point(duration_cast<system_clock::duration>(
+            nanoseconds(rec->timestamp))),
+        .address = rec->address,
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        .payload = {reinterpret_cast<const std::byte *>(rec + 1), rec->length}};
+    co_yield record;
+
+    offset += record_size(rec->length);
+  }
+}
+
+auto capture_file::header() const noexcept -> const capture_header &
+{
+  return header_of(map_);
+}
+
+capture_file::operator bool() const noexcept { return map_.data() != nullptr; }
+} // namespace echo::detail
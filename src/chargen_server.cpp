@@ -0,0 +1,165 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file chargen_server.cpp
+ * @brief This file defines the TCP and UDP character generator servers
+ * (RFC 864).
+ */
+#include "echo/chargen_server.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <array>
+#include <utility>
+
+#include <sys/socket.h>
+namespace echo {
+auto chargen_pattern::bytes() noexcept -> std::span<const std::byte>
+{
+  static const auto pattern = [] {
+    auto buf = std::array<std::byte, 2 * PERIOD>{};
+    for (std::size_t i = 0; i < buf.size(); ++i)
+    {
+      auto line = (i / STRIDE) % CHARS;
+      auto column = i % STRIDE;
+      if (column < LINE)
+        buf[i] = static_cast<std::byte>(' ' + (line + column) % CHARS);
+      else
+        buf[i] = static_cast<std::byte>(column == LINE ? '\r' : '\n');
+    }
+    return buf;
+  }();
+  return pattern;
+}
+
+auto tcp_chargen_server::initialize(const socket_handle & /*sock*/) noexcept
+    -> std::error_code
+{
+  return {};
+}
+
+auto tcp_chargen_server::stop() noexcept -> void
+{
+  using socket_type = io::socket::native_socket_type;
+  if (std::exchange(stopped_, true))
+    return;
+
+  // The stream never ends, so connections are closed straight away.
+  for (socket_type i = 0; i < static_cast<int>(active_.size()); ++i)
+  {
+    if (active_[i])
+      shutdown(i, SHUT_RDWR);
+  }
+  spdlog::info("TCP chargen: {} bytes sent.", sent_);
+}
+
+auto tcp_chargen_server::generate(async_context &ctx,
+                                  const socket_dialog &socket) -> void
+{
+  using namespace stdexec;
+  using socket_type = io::socket::native_socket_type;
+  auto sockfd = static_cast<socket_type>(*socket.socket);
+  const auto &conn = active_[sockfd];
+  if (!conn)
+    return;
+
+  auto bufs = chargen_pattern::bytes().subspan(conn->offset,
+                                               chargen_pattern::PERIOD);
+  sender auto sendmsg =
+      io::sendmsg(socket, socket_message{.buffers = bufs}, MSG_NOSIGNAL) |
+      then([&, socket, sockfd](auto &&len) {
+        sent_ += len;
+        if (auto &conn = active_[sockfd])
+        {
+          conn->offset = (conn->offset + len) % chargen_pattern::PERIOD;
+          generate(ctx, socket);
+        }
+      }) |
+      upon_error([](auto &&error) {}); // GCOVR_EXCL_LINE
+
+  ctx.scope.spawn(std::move(sendmsg));
+}
+
+auto tcp_chargen_server::service(async_context &ctx,
+                                 const socket_dialog &socket,
+                                 const std::shared_ptr<read_context> &rctx,
+                                 std::span<const std::byte> /*buf*/) -> void
+{
+  using namespace io::socket;
+  auto sockfd = static_cast<native_socket_type>(*socket.socket);
+
+  if (active_.size() < static_cast<std::size_t>(sockfd) + 1)
+  {
+    active_.resize(sockfd + 1);
+  }
+
+  if (rctx && !active_[sockfd])
+  {
+    active_[sockfd] = connection{};
+    rctx->msg.buffers = rctx->buffer = {buffer_};
+    spdlog::debug("New chargen connection on socket {}.", sockfd);
+    generate(ctx, socket);
+  }
+
+  if (!rctx && active_[sockfd])
+  {
+    active_[sockfd].reset();
+    spdlog::debug("End chargen connection on socket {}.", sockfd);
+  }
+
+  submit_recv(ctx, socket, rctx);
+}
+
+auto udp_chargen_server::initialize(const socket_handle & /*sock*/) noexcept
+    -> std::error_code
+{
+  return {};
+}
+
+auto udp_chargen_server::stop() noexcept -> void
+{
+  if (!std::exchange(stopped_, true))
+    spdlog::info("UDP chargen: {} datagrams sent.", sent_);
+}
+
+auto udp_chargen_server::service(async_context &ctx,
+                                 const socket_dialog &socket,
+                                 const std::shared_ptr<read_context> &rctx,
+                                 std::span<const std::byte> /*buf*/) -> void
+{
+  using namespace stdexec;
+  if (!rctx)
+    return;
+
+  auto length = std::uniform_int_distribution<std::size_t>(0, MAX_REPLY);
+  auto bufs = chargen_pattern::bytes().subspan(offset_, length(random_));
+  offset_ = (offset_ + chargen_pattern::STRIDE) % chargen_pattern::PERIOD;
+
+  auto address = dual_stack::reply_address(*rctx->msg.address);
+  auto msg = socket_message{.address = {address}, .buffers = bufs};
+  sender auto sendmsg =
+      io::sendmsg(socket, msg, MSG_NOSIGNAL) |
+      then([&, socket, rctx, msg](auto &&len) {
+        ++sent_;
+        submit_recv(ctx, socket, rctx);
+      }) |
+      upon_error([&, socket, rctx](auto &&error) {
+        submit_recv(ctx, socket, rctx);
+      });
+
+  ctx.scope.spawn(std::move(sendmsg));
+}
+} // namespace echo
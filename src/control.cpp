@@ -0,0 +1,159 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file control.cpp
+ * @brief This file defines the control plane that delivers signals and
+ * control commands to the echo servers.
+ */
+#include "echo/detail/control.hpp"
+
+#include <array>
+#include <bit>
+#include <cerrno>
+#include <utility>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <unistd.h>
+namespace echo::detail {
+// The signals that are read from the signalfd.
+static auto control_signals() noexcept -> sigset_t
+{
+  auto set = sigset_t{};
+  sigemptyset(&set);
+  sigaddset(&set, SIGTERM);
+  sigaddset(&set, SIGINT);
+  sigaddset(&set, SIGHUP);
+  sigaddset(&set, SIGUSR1);
+  sigaddset(&set, SIGUSR2);
+  return set;
+}
+
+control_plane::control_plane(control_plane &&other) noexcept
+    : signals_{std::exchange(other.signals_, -1)},
+      events_{std::exchange(other.events_, -1)},
+      pending_{other.pending_.exchange(0)}
+{}
+
+auto control_plane::operator=(control_plane &&other) noexcept
+    -> control_plane &
+{
+  if (this != &other)
+  {
+    close();
+    signals_ = std::exchange(other.signals_, -1);
+    events_ = std::exchange(other.events_, -1);
+    pending_ = other.pending_.exchange(0);
+  }
+  return *this;
+}
+
+control_plane::~control_plane() { close(); }
+
+auto control_plane::close() noexcept -> void
+{
+  if (signals_ >= 0)
+    ::close(std::exchange(signals_, -1));
+  if (events_ >= 0)
+    ::close(std::exchange(events_, -1));
+}
+
+auto control_plane::create(std::error_code &error) noexcept -> control_plane
+{
+  auto plane = control_plane();
+  auto set = control_signals();
+
+  if (auto err = pthread_sigmask(SIG_BLOCK, &set, nullptr))
+  {
+    error = {err, std::system_category()};
+    return {};
+  }
+
+  plane.signals_ = signalfd(-1, &set, SFD_CLOEXEC | SFD_NONBLOCK);
+  plane.events_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (plane.signals_ < 0 || plane.events_ < 0)
+  {
+    error = {errno, std::system_category()};
+    return {};
+  }
+
+  return plane;
+}
+
+auto control_plane::post(command cmd) noexcept -> void
+{
+  pending_.fetch_or(1U << cmd);
+  auto one = std::uint64_t{1};
+  // A full counter still wakes the reader, so a failed write is harmless.
+  [[maybe_unused]] auto len = ::write(events_, &one, sizeof(one));
+}
+
+auto control_plane::wait() noexcept -> command
+{
+  if (!*this)
+    return STOP;
+
+  while (true)
+  {
+    // Take the lowest pending command, so STOP is handled last.
+    auto pending = pending_.load();
+    while (pending && !pending_.compare_exchange_weak(
+                          pending, pending & (pending - 1)))
+    {}
+    if (pending)
+      return static_cast<command>(std::countr_zero(pending));
+
+    auto info = signalfd_siginfo{};
+    while (::read(signals_, &info, sizeof(info)) == sizeof(info))
+    {
+      switch (info.ssi_signo)
+      {
+        case SIGTERM:
+        case SIGINT:
+        case SIGHUP:
+          return TERMINATE;
+
+        case SIGUSR1:
+          return STATS;
+
+        case SIGUSR2:
+          return UPGRADE;
+
+        default:
+          break;
+      }
+    }
+
+    auto fds = std::array<pollfd, 2>{
+        {{.fd = signals_, .events = POLLIN, .revents = 0},
+         {.fd = events_, .events = POLLIN, .revents = 0}}};
+    if (poll(fds.data(), fds.size(), -1) < 0 && errno != EINTR)
+      return STOP;
+
+    if (fds[1].revents & POLLIN)
+    {
+      auto count = std::uint64_t{};
+      [[maybe_unused]] auto len = ::read(events_, &count, sizeof(count));
+    }
+  }
+}
+
+control_plane::operator bool() const noexcept
+{
+  return signals_ >= 0 && events_ >= 0;
+}
+} // namespace echo::detail
@@ -0,0 +1,123 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file discard_server.cpp
+ * @brief This file defines the TCP and UDP discard servers (RFC 863).
+ */
+#include "echo/discard_server.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <climits>
+#include <utility>
+
+#include <sys/socket.h>
+namespace echo {
+auto tcp_discard_server::initialize(const socket_handle & /*sock*/) noexcept
+    -> std::error_code
+{
+  return {};
+}
+
+auto tcp_discard_server::stop() noexcept -> void
+{
+  using socket_type = io::socket::native_socket_type;
+  if (std::exchange(stopped_, true))
+    return;
+
+  // There is nothing to drain, so connections are closed straight away.
+  for (socket_type i = 0; i < static_cast<int>(active_.size()); ++i)
+  {
+    if (active_[i])
+      shutdown(i, SHUT_RD);
+  }
+  spdlog::info("TCP discard: {} bytes discarded.", discarded_);
+}
+
+auto tcp_discard_server::service(async_context &ctx,
+                                 const socket_dialog &socket,
+                                 const std::shared_ptr<read_context> &rctx,
+                                 std::span<const std::byte> buf) -> void
+{
+  using namespace io::socket;
+  auto sockfd = static_cast<native_socket_type>(*socket.socket);
+
+  if (active_.size() < static_cast<std::size_t>(sockfd) + 1)
+  {
+    active_.resize(sockfd + 1);
+  }
+
+  if (rctx && !active_[sockfd])
+  {
+    active_[sockfd] = true;
+    rctx->msg.buffers = rctx->buffer = {buffer_};
+    spdlog::debug("New discard connection on socket {}.", sockfd);
+  }
+
+  if (!rctx && active_[sockfd])
+  {
+    active_[sockfd] = false;
+    spdlog::debug("End discard connection on socket {}.", sockfd);
+  }
+
+  if (rctx)
+  {
+    discarded_ += buf.size();
+    // MSG_TRUNC frees the rest of the receive queue without copying it.
+    if (auto len = recv(sockfd, nullptr, INT_MAX, MSG_TRUNC | MSG_DONTWAIT);
+        len > 0)
+    {
+      discarded_ += len;
+    }
+  }
+
+  submit_recv(ctx, socket, rctx);
+}
+
+auto udp_discard_server::initialize(const socket_handle &sock) noexcept
+    -> std::error_code
+{
+  sockfd_ = static_cast<io::socket::native_socket_type>(sock);
+  return {};
+}
+
+auto udp_discard_server::stop() noexcept -> void
+{
+  if (!std::exchange(stopped_, true))
+    spdlog::info("UDP discard: {} datagrams discarded.", discarded_);
+}
+
+auto udp_discard_server::service(async_context &ctx,
+                                 const socket_dialog &socket,
+                                 const std::shared_ptr<read_context> &rctx,
+                                 std::span<const std::byte> /*buf*/) -> void
+{
+  if (!rctx)
+    return;
+
+  ++discarded_;
+  // A zero length MSG_TRUNC read drops one datagram without copying it.
+  for (int i = 0; i < BATCH; ++i)
+  {
+    if (recv(sockfd_, nullptr, 0, MSG_TRUNC | MSG_DONTWAIT) < 0)
+      break;
+
+    ++discarded_;
+  }
+
+  submit_recv(ctx, socket, rctx);
+}
+} // namespace echo
@@ -0,0 +1,230 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file echo_journal.cpp
+ * @brief This file implements a decoder for connection-event journals.
+ */
+#include "echo/detail/address.hpp"
+#include "echo/detail/argument_parser.hpp"
+#include "echo/detail/histogram.hpp"
+#include "echo/detail/journal.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace echo::detail;
+
+static constexpr char const *const usage =
+    "usage: {} [--format <summary|csv|json>] [--top <N>] <FILE>...\n";
+
+struct config {
+  std::string_view format = "summary";
+  std::size_t top = 10;
+  std::vector<std::string_view> files;
+};
+
+struct peer_stats {
+  std::uint64_t connections = 0;
+  std::uint64_t bytes = 0;
+};
+
+static auto type_name(const journal_event &event) -> std::string_view
+{
+  switch (event.type)
+  {
+    case journal_event::OPEN:
+      return "open";
+    case journal_event::CLOSE:
+      return "close";
+    default:
+      return "unknown";
+  }
+}
+
+static auto parse_args(int argc,
+                       char const *const *argv) -> std::optional<config>
+{
+  auto conf = config();
+  char const *const progname = std::filesystem::path(*argv).stem().c_str();
+  auto error = [&]() -> std::optional<config> {
+    std::cerr << std::format(usage, progname);
+    return std::nullopt;
+  };
+
+  for (const auto &[flag, value] : argument_parser::parse(argc, argv))
+  {
+    if (flag == "-h" || flag == "--help")
+    {
+      std::cout << std::format(usage, progname);
+      return std::nullopt;
+    }
+
+    if (flag == "--format")
+    {
+      if (value != "summary" && value != "csv" && value != "json")
+        return error();
+
+      conf.format = value;
+      continue;
+    }
+
+    if (flag == "--top")
+    {
+      auto [ptr, err] = std::from_chars(value.cbegin(), value.cend(), conf.top);
+      if (err != std::errc{})
+        return error();
+
+      continue;
+    }
+
+    if (!flag.empty())
+    {
+      std::cerr << std::format("Unknown flag: {}\n", flag);
+      return error();
+    }
+
+    conf.files.push_back(value);
+  }
+
+  if (conf.files.empty())
+    return error();
+
+  return {conf};
+}
+
+static auto print_csv(std::span<const journal_event> events) -> void
+{
+  for (const auto &event : events)
+  {
+    std::cout << std::format("{},{},{},{},{},{}\n", type_name(event),
+                             event.timestamp, format_address(event.peer),
+                             event.connection, event.bytes, event.duration);
+  }
+}
+
+static auto print_json(std::span<const journal_event> events) -> void
+{
+  for (const auto &event : events)
+  {
+    std::cout << std::format(
+        R"({{"type":"{}","timestamp":{},"peer":"{}","connection":{},)"
+        R"("bytes":{},"duration_ns":{}}})"
+        "\n",
+        type_name(event), event.timestamp, format_address(event.peer),
+        event.connection, event.bytes, event.duration);
+  }
+}
+
+struct summary {
+  std::uint64_t opened = 0;
+  std::uint64_t closed = 0;
+  std::uint64_t bytes = 0;
+  histogram durations;
+  std::unordered_map<std::string, peer_stats> peers;
+
+  auto add(std::span<const journal_event> events) -> void
+  {
+    for (const auto &event : events)
+    {
+      if (event.type == journal_event::OPEN)
+      {
+        ++opened;
+        continue;
+      }
+
+      ++closed;
+      bytes += event.bytes;
+      durations.record(histogram::duration(event.duration));
+
+      auto &peer = peers[format_address(event.peer, false)];
+      ++peer.connections;
+      peer.bytes += event.bytes;
+    }
+  }
+
+  auto print(std::size_t top) const -> void
+  {
+    std::cout << std::format("connections opened: {}, closed: {}, "
+                             "bytes echoed: {}\n",
+                             opened, closed, bytes);
+    std::cout << std::format("duration: {}\n", durations.summary());
+
+    const auto buckets = durations.buckets();
+    for (std::size_t i = 0; i < buckets.size(); ++i)
+    {
+      // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+      if (buckets[i])
+        std::cout << std::format("  < 2^{:<2} ns: {}\n", i, buckets[i]);
+    }
+
+    auto ranked = std::vector<std::pair<std::string, peer_stats>>(
+        peers.begin(), peers.end());
+    std::ranges::sort(ranked, [](const auto &lhs, const auto &rhs) {
+      return lhs.second.connections > rhs.second.connections;
+    });
+
+    std::cout << "top peers:\n";
+    for (const auto &[peer, stats] :
+         std::span(ranked).first(std::min(top, ranked.size())))
+    {
+      std::cout << std::format("  {:<42} connections: {:<10} bytes: {}\n",
+                               peer, stats.connections, stats.bytes);
+    }
+  }
+};
+
+auto main(int argc, char *argv[]) -> int
+{
+  auto conf = parse_args(argc, argv);
+  if (!conf)
+    return 1;
+
+  auto totals = summary();
+  if (conf->format == "csv")
+    std::cout << "type,timestamp,peer,connection,bytes,duration_ns\n";
+
+  for (const auto &file : conf->files)
+  {
+    auto error = std::error_code();
+    auto path = std::string(file);
+    auto segment = journal_segment::open(path.c_str(), error);
+    if (error)
+    {
+      std::cerr << std::format("Unable to open {}: {}\n", path,
+                               error.message());
+      return 1;
+    }
+
+    if (conf->format == "csv")
+      print_csv(segment.events());
+    else if (conf->format == "json")
+      print_json(segment.events());
+    else
+      totals.add(segment.events());
+  }
+
+  if (conf->format == "summary")
+    totals.print(conf->top);
+
+  return 0;
+}
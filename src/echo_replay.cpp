@@ -0,0 +1,233 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file echo_replay.cpp
+ * @brief This file implements a tool that inspects and replays UDP captures.
+ */
+#include "echo/detail/address.hpp"
+#include "echo/detail/argument_parser.hpp"
+#include "echo/detail/capture.hpp"
+
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace echo::detail;
+
+static constexpr char const *const usage =
+    "usage: {0} [--record <on|off>] <FILE>\n"
+    "       {0} [--rate <SCALE>] <FILE> <ADDRESS> <PORT>\n";
+
+struct config {
+  std::optional<bool> record;
+  double rate = 1.0;
+  std::string_view file;
+  std::string_view host;
+  unsigned short port = 0;
+};
+
+static auto parse_args(int argc,
+                       char const *const *argv) -> std::optional<config>
+{
+  auto conf = config();
+  char const *const progname = std::filesystem::path(*argv).stem().c_str();
+  auto error = [&]() -> std::optional<config> {
+    std::cerr << std::format(usage, progname);
+    return std::nullopt;
+  };
+
+  auto positional = 0;
+  for (const auto &[flag, value] : argument_parser::parse(argc, argv))
+  {
+    if (flag == "-h" || flag == "--help")
+    {
+      std::cout << std::format(usage, progname);
+      return std::nullopt;
+    }
+
+    if (flag == "--record")
+    {
+      if (value != "on" && value != "off")
+        return error();
+
+      conf.record = (value == "on");
+      continue;
+    }
+
+    if (flag == "--rate")
+    {
+      auto [ptr, err] = std::from_chars(value.cbegin(), value.cend(), conf.rate);
+      if (err != std::errc{} || conf.rate < 0)
+        return error();
+
+      continue;
+    }
+
+    if (!flag.empty())
+    {
+      std::cerr << std::format("Unknown flag: {}\n", flag);
+      return error();
+    }
+
+    switch (positional++)
+    {
+      case 0:
+        conf.file = value;
+        break;
+
+      case 1:
+        conf.host = value;
+        break;
+
+      case 2:
+      {
+        auto [ptr, err] =
+            std::from_chars(value.cbegin(), value.cend(), conf.port);
+        if (err != std::errc{})
+          return error();
+        break;
+      }
+
+      default:
+        return error();
+    }
+  }
+
+  if (conf.file.empty() || (positional != 1 && positional != 3))
+    return error();
+
+  return {conf};
+}
+
+static auto list(const capture_file &file) -> int
+{
+  const auto &hdr = file.header();
+  std::cout << std::format("recording: {}, records: {}, overwritten: {}, "
+                           "capacity: {} bytes\n",
+                           hdr.enabled ? "on" : "off", hdr.count,
+                           hdr.overwritten, hdr.capacity);
+
+  for (const auto &rec : file.records())
+  {
+    std::cout << std::format("{} {} {} bytes\n",
+                             rec.timestamp.time_since_epoch().count(),
+                             format_address(rec.address), rec.payload.size());
+  }
+  return 0;
+}
+
+static auto replay(const capture_file &file, const config &conf) -> int
+{
+  auto target = sockaddr_storage{};
+  auto *addr6 = reinterpret_cast<sockaddr_in6 *>(&target);
+  auto *addr4 = reinterpret_cast<sockaddr_in *>(&target);
+  auto host = std::string(conf.host);
+  auto len = socklen_t{};
+
+  if (inet_pton(AF_INET6, host.c_str(), &addr6->sin6_addr) == 1)
+  {
+    addr6->sin6_family = AF_INET6;
+    addr6->sin6_port = htons(conf.port);
+    len = sizeof(sockaddr_in6);
+  }
+  else if (inet_pton(AF_INET, host.c_str(), &addr4->sin_addr) == 1)
+  {
+    addr4->sin_family = AF_INET;
+    addr4->sin_port = htons(conf.port);
+    len = sizeof(sockaddr_in);
+  }
+  else
+  {
+    std::cerr << std::format("Invalid address: {}\n", conf.host);
+    return 1;
+  }
+
+  auto sockfd = socket(target.ss_family, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  if (sockfd < 0)
+  {
+    std::perror("socket");
+    return 1;
+  }
+
+  // Records are sent at their original spacing divided by the rate. A
+  // rate of 0 sends them back-to-back.
+  using clock = std::chrono::steady_clock;
+  auto start = clock::now();
+  auto first = std::optional<std::chrono::system_clock::time_point>();
+  std::uint64_t sent = 0;
+
+  for (const auto &rec : file.records())
+  {
+    if (!first)
+      first = rec.timestamp;
+
+    if (conf.rate > 0)
+    {
+      auto offset = std::chrono::duration<double>(rec.timestamp - *first);
+      std::this_thread::sleep_until(
+          start + std::chrono::duration_cast<clock::duration>(offset /
+                                                              conf.rate));
+    }
+
+    if (sendto(sockfd, rec.payload.data(), rec.payload.size(), 0,
+               reinterpret_cast<sockaddr *>(&target), len) >= 0)
+    {
+      ++sent;
+    }
+  }
+
+  close(sockfd);
+  std::cout << std::format("Replayed {} of {} datagrams.\n", sent,
+                           file.header().count);
+  return 0;
+}
+
+auto main(int argc, char *argv[]) -> int
+{
+  auto conf = parse_args(argc, argv);
+  if (!conf)
+    return 1;
+
+  auto error = std::error_code();
+  auto path = std::string(conf->file);
+  auto file = capture_file::open(path.c_str(), conf->record.has_value(), error);
+  if (error)
+  {
+    std::cerr << std::format("Unable to open {}: {}\n", path, error.message());
+    return 1;
+  }
+
+  if (conf->record)
+  {
+    file.enable(*conf->record);
+    return 0;
+  }
+
+  if (conf->host.empty())
+    return list(file);
+
+  return replay(file, *conf);
+}
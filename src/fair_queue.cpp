@@ -0,0 +1,98 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file fair_queue.cpp
+ * @brief This file defines a deficit round robin scheduler for TCP
+ * connections.
+ */
+#include "echo/detail/fair_queue.hpp"
+
+#include <cassert>
+#include <utility>
+namespace echo::detail {
+
+fair_queue::fair_queue(std::size_t quantum) noexcept
+    : quantum_{static_cast<std::int64_t>(quantum)}
+{}
+
+auto fair_queue::open(int flow) -> void
+{
+  if (deficits_.size() < static_cast<std::size_t>(flow) + 1)
+    deficits_.resize(flow + 1);
+
+  deficits_[flow] = quantum_;
+  ++running_;
+}
+
+auto fair_queue::close(int flow) noexcept -> void
+{
+  assert(running_ > 0 && "Only running connections can be closed.");
+  deficits_[flow] = 0;
+  --running_;
+}
+
+auto fair_queue::charge(int flow, std::size_t bytes) noexcept -> bool
+{
+  if (!quantum_)
+    return true;
+
+  return (deficits_[flow] -= static_cast<std::int64_t>(bytes)) > 0;
+}
+
+auto fair_queue::idle(int flow) noexcept -> void
+{
+  if (quantum_)
+    deficits_[flow] = quantum_;
+}
+
+auto fair_queue::park(int flow) -> void
+{
+  parked_.push_back(flow);
+  --running_;
+}
+
+auto fair_queue::next() noexcept -> int
+{
+  while (!parked_.empty())
+  {
+    auto flow = parked_.front();
+    parked_.pop_front();
+    if ((deficits_[flow] += quantum_) > 0)
+    {
+      ++running_;
+      return flow;
+    }
+
+    // A single large echo can overdraw the deficit by more than a quantum.
+    parked_.push_back(flow);
+  }
+  return -1;
+}
+
+auto fair_queue::quantum() const noexcept -> std::size_t
+{
+  return static_cast<std::size_t>(quantum_);
+}
+
+auto fair_queue::running() const noexcept -> std::size_t { return running_; }
+
+auto fair_queue::parked() const noexcept -> std::size_t
+{
+  return parked_.size();
+}
+
+fair_queue::operator bool() const noexcept { return quantum_ > 0; }
+} // namespace echo::detail
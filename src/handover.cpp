@@ -0,0 +1,167 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file handover.cpp
+ * @brief This file defines the channel that TCP connections are handed
+ * over on during an upgrade.
+ */
+#include "echo/detail/handover.hpp"
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+namespace echo::detail {
+// Sets the receive timeout on a channel.
+static auto set_timeout(int channel) noexcept -> void
+{
+  using namespace std::chrono;
+  auto timeout = timeval{
+      .tv_sec = duration_cast<seconds>(handover::TIMEOUT).count(),
+      .tv_usec = 0};
+  setsockopt(channel, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+}
+
+handover::~handover() { close(); }
+
+auto handover::send_to(int channel) noexcept -> std::error_code
+{
+  set_timeout(channel);
+
+  auto ready = char{};
+  if (auto len = recv(channel, &ready, sizeof(ready), 0); len != 1)
+  {
+    auto error = len < 0 ? std::error_code(errno, std::system_category())
+                         : std::make_error_code(std::errc::broken_pipe);
+    ::close(channel);
+    return error;
+  }
+
+  if (auto previous = outgoing_.exchange(channel); previous >= 0)
+    ::close(previous);
+
+  return {};
+}
+
+auto handover::sending() const noexcept -> bool { return outgoing_ >= 0; }
+
+auto handover::send(int sockfd, const record &state) noexcept
+    -> std::error_code
+{
+  auto control = std::array<char, CMSG_SPACE(sizeof(int))>{};
+  auto iov = iovec{.iov_base = const_cast<record *>(&state), // NOLINT
+                   .iov_len = sizeof(state)};
+  auto msg = msghdr{.msg_name = nullptr,
+                    .msg_namelen = 0,
+                    .msg_iov = &iov,
+                    .msg_iovlen = 1,
+                    .msg_control = control.data(),
+                    .msg_controllen = control.size(),
+                    .msg_flags = 0};
+
+  auto *cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+  std::memcpy(CMSG_DATA(cmsg), &sockfd, sizeof(int));
+
+  if (sendmsg(outgoing_, &msg, MSG_NOSIGNAL) < 0)
+    return {errno, std::system_category()};
+
+  return {};
+}
+
+auto handover::receive_from(int channel) noexcept -> void
+{
+  set_timeout(channel);
+  if (incoming_ >= 0)
+    ::close(incoming_);
+
+  incoming_ = channel;
+  ready_ = false;
+}
+
+auto handover::receiving() const noexcept -> bool { return incoming_ >= 0; }
+
+auto handover::receive(record &state) noexcept -> int
+{
+  if (incoming_ < 0)
+    return -1;
+
+  if (!std::exchange(ready_, true))
+  {
+    auto ready = char{1};
+    if (::send(incoming_, &ready, sizeof(ready), MSG_NOSIGNAL) < 0)
+    {
+      close();
+      return -1;
+    }
+  }
+
+  auto control = std::array<char, CMSG_SPACE(sizeof(int))>{};
+  auto iov = iovec{.iov_base = &state, .iov_len = sizeof(state)};
+  auto msg = msghdr{.msg_name = nullptr,
+                    .msg_namelen = 0,
+                    .msg_iov = &iov,
+                    .msg_iovlen = 1,
+                    .msg_control = control.data(),
+                    .msg_controllen = control.size(),
+                    .msg_flags = 0};
+
+  auto len = recvmsg(incoming_, &msg, MSG_CMSG_CLOEXEC);
+  auto *cmsg = CMSG_FIRSTHDR(&msg);
+  if (len != static_cast<ssize_t>(sizeof(state)) || !cmsg ||
+      cmsg->cmsg_type != SCM_RIGHTS)
+  {
+    // End-of-file, a timeout or a malformed message ends the handover.
+    close();
+    return -1;
+  }
+
+  auto sockfd = -1;
+  std::memcpy(&sockfd, CMSG_DATA(cmsg), sizeof(int));
+  return sockfd;
+}
+
+auto handover::close() noexcept -> void
+{
+  if (auto channel = outgoing_.exchange(-1); channel >= 0)
+    ::close(channel);
+
+  if (incoming_ >= 0)
+    ::close(std::exchange(incoming_, -1));
+}
+
+auto handover::detach(int sockfd) noexcept -> std::error_code
+{
+  auto pair = std::array<int, 2>{-1, -1};
+  if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair.data()))
+    return {errno, std::system_category()};
+
+  // The peer is closed, so reads return end-of-file.
+  ::close(pair[1]);
+  auto error = std::error_code();
+  if (dup3(pair[0], sockfd, O_CLOEXEC) < 0)
+    error = {errno, std::system_category()};
+
+  ::close(pair[0]);
+  return error;
+}
+} // namespace echo::detail
@@ -0,0 +1,75 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file histogram.cpp
+ * @brief This file defines a log-scale latency histogram.
+ */
+#include "echo/detail/histogram.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <format>
+namespace echo::detail {
+
+auto histogram::record(duration value) noexcept -> void
+{
+  auto nsec = static_cast<std::uint64_t>(std::max(value.count(), 0L));
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+  ++buckets_[std::min<std::size_t>(std::bit_width(nsec), BUCKETS - 1)];
+  ++count_;
+}
+
+auto histogram::count() const noexcept -> std::uint64_t { return count_; }
+
+auto histogram::percentile(double pct) const noexcept -> duration
+{
+  if (!count_)
+    return duration::zero();
+
+  auto rank = static_cast<std::uint64_t>(
+      std::ceil(std::clamp(pct, 0.0, 100.0) / 100.0 * count_));
+  rank = std::max<std::uint64_t>(rank, 1);
+
+  std::uint64_t seen = 0;
+  for (std::size_t i = 0; i < BUCKETS; ++i)
+  {
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+    if ((seen += buckets_[i]) >= rank)
+      return duration(i ? (1LL << std::min<std::size_t>(i, 62)) - 1 : 0);
+  }
+  return duration::max(); // GCOVR_EXCL_LINE
+}
+
+auto histogram::buckets() const noexcept
+    -> std::span<const std::uint64_t, BUCKETS>
+{
+  return buckets_;
+}
+
+auto histogram::summary() const -> std::string
+{
+  using std::chrono::duration_cast;
+  using micros = std::chrono::duration<double, std::micro>;
+
+  return std::format("n={} p50<={:.1f}us p90<={:.1f}us p99<={:.1f}us "
+                     "p99.9<={:.1f}us",
+                     count_, duration_cast<micros>(percentile(50)).count(),
+                     duration_cast<micros>(percentile(90)).count(),
+                     duration_cast<micros>(percentile(99)).count(),
+                     duration_cast<micros>(percentile(99.9)).count());
+}
+} // namespace echo::detail
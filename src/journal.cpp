@@ -0,0 +1,371 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file journal.cpp
+ * @brief This file defines a binary connection-event journal.
+ */
+#include "echo/detail/journal.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <format>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+namespace echo::detail {
+namespace {
+auto header_of(std::span<std::byte> map) noexcept -> journal_header &
+{
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+  return *reinterpret_cast<journal_header *>(map.data());
+}
+
+auto events_of(std::span<std::byte> map) noexcept -> std::span<journal_event>
+{
+  // The header occupies the first event slot.
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+  auto *first = reinterpret_cast<journal_event *>(map.data()) + 1;
+  return {first, map.size() / sizeof(journal_event) - 1};
+}
+
+auto unmap(std::span<std::byte> map) noexcept -> void
+{
+  if (map.data())
+    munmap(map.data(), map.size());
+}
+
+// Creates a segment file, maps it and writes its header.
+auto create_segment(const std::string &directory, std::size_t size,
+                    std::string &path,
+                    std::error_code &error) noexcept -> std::span<std::byte>
+{
+  using namespace std::chrono;
+  auto now = system_clock::now().time_since_epoch();
+  path = std::format("{}/echo-{}.journal", directory,
+                     duration_cast<nanoseconds>(now).count());
+
+  auto fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+  if (fd < 0)
+  {
+    error = {errno, std::system_category()};
+    return {};
+  }
+
+  auto map = std::span<std::byte>();
+  if (ftruncate(fd, static_cast<off_t>(size)))
+  {
+    error = {errno, std::system_category()};
+  }
+  else
+  {
+    auto *addr = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, 0);
+    if (addr == MAP_FAILED)
+      error = {errno, std::system_category()};
+    else
+      map = {static_cast<std::byte *>(addr), size};
+  }
+  ::close(fd);
+
+  if (error)
+  {
+    unlink(path.c_str());
+    return {};
+  }
+
+  header_of(map) = journal_header{.magic = journal_header::MAGIC,
+                                  .event_size = sizeof(journal_event)};
+  return map;
+}
+} // namespace
+
+// The preparer's thread sleeps until the journal asks for a segment,
+// creates it, and hands it back under the mutex. The journal only takes the
+// mutex twice per segment, so it is never contended for long.
+struct journal::preparer {
+  /**
+   * @brief Starts the thread.
+   * @param dir The journal directory.
+   * @param size The segment size.
+   */
+  preparer(std::string dir, std::size_t size)
+      : directory{std::move(dir)}, segment_size{size},
+        thread{[this](const std::stop_token &stop) { run(stop); }}
+  {}
+
+  /** @brief Stops the thread and removes the unused next segment. */
+  ~preparer()
+  {
+    thread.request_stop();
+    thread.join();
+    if (next.data())
+    {
+      unmap(next);
+      unlink(next_path.c_str());
+    }
+  }
+
+  /** @brief Asks for the next segment, unless it is on its way. */
+  auto request() -> void
+  {
+    {
+      auto lock = std::lock_guard(mtx);
+      if (requested || next.data())
+        return;
+      requested = true;
+    }
+    cv.notify_all();
+  }
+
+  /**
+   * @brief Takes the next segment, once it is no longer being created.
+   * @param path Set to the path of the segment.
+   * @returns The segment mapping, or an empty span if there is none.
+   */
+  auto take(std::string &path) -> std::span<std::byte>
+  {
+    auto lock = std::unique_lock(mtx);
+    cv.wait(lock, [&] { return !requested; });
+    path = std::move(next_path);
+    return std::exchange(next, {});
+  }
+
+  /**
+   * @brief Creates a segment each time one is asked for.
+   * @param stop Stops the thread.
+   */
+  auto run(const std::stop_token &stop) -> void
+  {
+    auto lock = std::unique_lock(mtx);
+    while (cv.wait(lock, stop, [&] { return requested; }))
+    {
+      lock.unlock();
+      auto path = std::string();
+      auto error = std::error_code();
+      auto map = create_segment(directory, segment_size, path, error);
+      lock.lock();
+
+      if (error)
+      {
+        failures.fetch_add(1, std::memory_order_relaxed);
+      }
+      else
+      {
+        next = map;
+        next_path = std::move(path);
+      }
+      requested = false;
+      cv.notify_all();
+    }
+  }
+
+  /** @brief The journal directory. */
+  std::string directory;
+  /** @brief The segment size. */
+  std::size_t segment_size;
+  /** @brief Guards the request and the next segment. */
+  std::mutex mtx;
+  /** @brief Signals requests and finished segments. */
+  std::condition_variable_any cv;
+  /** @brief Set while the next segment is being created. */
+  bool requested = false;
+  /** @brief The next segment mapping. */
+  std::span<std::byte> next;
+  /** @brief The path of the next segment. */
+  std::string next_path;
+  /** @brief The number of segments that could not be created. */
+  std::atomic<std::size_t> failures = 0;
+  /** @brief The thread that creates the segments, started last. */
+  std::jthread thread;
+};
+
+journal::journal() noexcept = default;
+
+journal::journal(journal &&other) noexcept
+    : directory_{std::move(other.directory_)},
+      segment_size_{other.segment_size_}, segments_{other.segments_},
+      files_{std::move(other.files_)}, map_{std::exchange(other.map_, {})},
+      preparer_{std::move(other.preparer_)}
+{}
+
+auto journal::operator=(journal &&other) noexcept -> journal &
+{
+  if (this != &other)
+  {
+    close();
+    directory_ = std::move(other.directory_);
+    segment_size_ = other.segment_size_;
+    segments_ = other.segments_;
+    files_ = std::move(other.files_);
+    map_ = std::exchange(other.map_, {});
+    preparer_ = std::move(other.preparer_);
+  }
+  return *this;
+}
+
+journal::~journal() { close(); }
+
+auto journal::close() noexcept -> void
+{
+  preparer_.reset();
+  unmap(std::exchange(map_, {}));
+}
+
+auto journal::open(std::string directory, std::size_t segment_size,
+                   std::size_t segments,
+                   std::error_code &error) noexcept -> journal
+{
+  auto jrnl = journal();
+  jrnl.directory_ = std::move(directory);
+  jrnl.segment_size_ = std::max(segment_size, 2 * sizeof(journal_event)) /
+                       sizeof(journal_event) * sizeof(journal_event);
+  jrnl.segments_ = std::max<std::size_t>(segments, 1);
+
+  auto path = std::string();
+  jrnl.map_ = create_segment(jrnl.directory_, jrnl.segment_size_, path, error);
+  if (error)
+    return {};
+
+  jrnl.files_.push_back(std::move(path));
+  jrnl.preparer_ =
+      std::make_unique<preparer>(jrnl.directory_, jrnl.segment_size_);
+  return jrnl;
+}
+
+auto journal::rotate() noexcept -> bool
+{
+  auto path = std::string();
+  auto next = preparer_->take(path);
+  if (!next.data())
+    return false;
+
+  unmap(std::exchange(map_, next));
+  files_.push_back(std::move(path));
+  while (files_.size() > segments_)
+  {
+    unlink(files_.front().c_str());
+    files_.pop_front();
+  }
+  return true;
+}
+
+auto journal::append(const journal_event &event) noexcept -> void
+{
+  if (!map_.data())
+    return;
+
+  auto count = header_of(map_).count;
+  auto events = events_of(map_);
+  // The next segment is created while this one still has room, so that a
+  // full segment rarely waits for it.
+  if (count == events.size() / 2)
+    preparer_->request();
+
+  if (count >= events.size())
+  {
+    // Overwriting the oldest events beats losing all of the new ones.
+    if (!rotate())
+    {
+      std::atomic_ref(header_of(map_).count)
+          .store(0, std::memory_order_release);
+    }
+    events = events_of(map_);
+  }
+
+  auto &hdr = header_of(map_);
+  events[hdr.count] = event;
+  // Publish the event to concurrent readers of the segment.
+  std::atomic_ref(hdr.count).store(hdr.count + 1, std::memory_order_release);
+}
+
+auto journal::failures() const noexcept -> std::size_t
+{
+  return preparer_ ? preparer_->failures.load(std::memory_order_relaxed) : 0;
+}
+
+journal::operator bool() const noexcept { return map_.data() != nullptr; }
+
+journal_segment::journal_segment(journal_segment &&other) noexcept
+    : map_{std::exchange(other.map_, {})}
+{}
+
+journal_segment::~journal_segment() { unmap(map_); }
+
+auto journal_segment::open(const char *path,
+                           std::error_code &error) noexcept -> journal_segment
+{
+  auto segment = journal_segment();
+  auto fd = ::open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    error = {errno, std::system_category()};
+    return segment;
+  }
+
+  struct stat info = {};
+  if (fstat(fd, &info))
+  {
+    error = {errno, std::system_category()};
+  }
+  else if (static_cast<std::size_t>(info.st_size) < sizeof(journal_header))
+  {
+    error = std::make_error_code(std::errc::invalid_argument);
+  }
+  else
+  {
+    auto size = static_cast<std::size_t>(info.st_size);
+    auto *addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED)
+      error = {errno, std::system_category()};
+    else
+      segment.map_ = {static_cast<std::byte *>(addr), size};
+  }
+  close(fd);
+
+  if (segment.map_.data())
+  {
+    const auto &hdr = header_of(segment.map_);
+    if (hdr.magic != journal_header::MAGIC ||
+        hdr.event_size != sizeof(journal_event))
+    {
+      error = std::make_error_code(std::errc::invalid_argument);
+      unmap(std::exchange(segment.map_, {}));
+    }
+  }
+  return segment;
+}
+
+auto journal_segment::events() const noexcept
+    -> std::span<const journal_event>
+{
+  if (!map_.data())
+    return {};
+
+  auto events = events_of(map_);
+  auto count = std::atomic_ref(header_of(map_).count)
+                   .load(std::memory_order_acquire);
+  return events.first(std::min<std::size_t>(count, events.size()));
+}
+} // namespace echo::detail
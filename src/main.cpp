@@ -1,84 +1,195 @@
+#include "echo/chargen_server.hpp"
+#include "echo/detail/activation.hpp"
+#include "echo/detail/address.hpp"
+#include "echo/detail/admin.hpp"
+#include "echo/detail/arena.hpp"
 #include "echo/detail/argument_parser.hpp"
+#include "echo/detail/control.hpp"
+#include "echo/detail/handover.hpp"
+#include "echo/detail/supervisor.hpp"
+#include "echo/discard_server.hpp"
 #include "echo/tcp_server.hpp"
 #include "echo/udp_server.hpp"
+#include "echo/xdp_server.hpp"
+#ifdef ECHO_ENABLE_TLS
+#include "echo/tls_server.hpp"
+#endif
 
 #include <spdlog/common-inl.h>
 #include <spdlog/common.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+#include <array>
 #include <charconv>
-#include <csignal>
 #include <filesystem>
 #include <format>
 #include <iostream>
 #include <thread>
 
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
 using namespace net::service;
 using namespace echo;
 
-using tcp_echo_server = basic_context_thread<tcp_server>;
-using udp_echo_server = basic_context_thread<udp_server>;
+#ifdef ECHO_ENABLE_TLS
+using tls_echo_server = basic_context_thread<tls_server>;
+#endif
 
 static constexpr unsigned short PORT = 7;
 static constexpr char const *const usage =
-    "usage: {} [--log-level <LEVEL>] [<PORT>]\n";
+    "usage: {} [--log-level <LEVEL>] [--preset <NAME>] "
+    "[--tcp-fastopen <QLEN>] [--tcp-defer-accept <SECONDS>] [--backlog <N>] "
+    "[--tcp-quantum <BYTES>] [--tcp-coalesce <on|off>] "
+    "[--pacing-rate <BYTES/S>] [--workers <N>] "
+    "[--timestamps <on|off>] "
+    "[--capture <FILE>] [--capture-size <MiB>] [--journal <DIR>] "
+    "[--journal-size <MiB>] [--journal-segments <N>] "
+    "[--memory-budget <MiB>] [--hugepages <MiB>] [--mlock <on|off>] "
+    "[--admin <PATH>] "
+    "[--udp-depth <N>] [--udp-retries <N>] "
+    "[--udp-large <N>] [--netem-delay <MS>] [--netem-jitter <MS>] "
+    "[--netem-distribution <fixed|uniform|normal>] [--netem-loss <PERCENT>] "
+    "[--netem-reorder <N>] "
+    "[--xdp <IFNAME>] [--xdp-mode <native|generic>] "
+    "[--xdp-reflect <on|off>] "
+    "[--discard-port <PORT>] [--chargen-port <PORT>] "
+    "[--tls-port <PORT> --tls-cert <FILE> --tls-key <FILE>] [<PORT>]\n";
+
+// Server configurations that can be selected with --preset.
+static constexpr auto presets =
+    std::array<std::string_view, 4>{"default", "minimal", "bulk", "ipv6-only"};
 
-static auto signal_mask() -> sigset_t *
+struct config {
+  unsigned short port = PORT;
+  std::string_view preset = "default";
+  tcp_server::options tcp;
+  udp_server::options udp;
+  xdp_server::options xdp;
+  std::optional<unsigned short> tls_port;
+  std::optional<unsigned short> discard_port;
+  std::optional<unsigned short> chargen_port;
+  std::string_view tls_cert;
+  std::string_view tls_key;
+  // The installed executable and the arguments to upgrade with.
+  std::string executable;
+  char **argv = nullptr;
+  // The listeners passed by the service manager.
+  std::vector<int> listeners;
+  // The number of worker processes, 0 to serve in this process.
+  std::size_t workers = 0;
+  // The pipe a worker reports readiness on, -1 outside a worker.
+  int ready = -1;
+  // The size of the buffer arena in bytes, 0 to allocate from the heap.
+  std::size_t hugepages = 0;
+  // Lock the process memory so that it is never paged out.
+  bool mlock = false;
+  // The admin socket path, empty for none.
+  std::string admin;
+};
+
+// Starts the installed echo-server and hands the listeners and idle TCP
+// connections over to it.
+static auto upgrade(const config &conf,
+                    detail::handover &handover) -> std::error_code
 {
-  static auto set = sigset_t{};
-  static sigset_t *setp = nullptr;
-  static auto mtx = std::mutex{};
+  // Only the echo listeners of a single process can be inherited.
+  if (conf.tls_port || conf.discard_port || conf.chargen_port || conf.workers)
+    return std::make_error_code(std::errc::operation_not_supported);
 
-  if (auto lock = std::lock_guard{mtx}; !setp)
+  auto sockets = detail::sockets();
+  auto fds = std::vector<int>();
+  for (auto type : {SOCK_STREAM, SOCK_DGRAM})
   {
-    sigemptyset(&set);
-    sigaddset(&set, SIGTERM);
-    sigaddset(&set, SIGHUP);
-    sigaddset(&set, SIGINT);
-    setp = &set;
+    if (auto fd = detail::find_listener(sockets, type, conf.port); fd >= 0)
+      fds.push_back(fd);
   }
-  return setp;
-}
 
-static auto signal_handler(tcp_echo_server &tcp_server,
-                           udp_echo_server &udp_server) -> std::jthread
-{
-  static const sigset_t *sigmask = nullptr;
-  static auto mtx = std::mutex();
+  auto channel = std::array<int, 2>{};
+  if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, channel.data()))
+    return {errno, std::system_category()};
 
-  if (auto lock = std::lock_guard{mtx}; !sigmask)
+  fds.push_back(channel[1]);
+  auto env = std::format("{}={}", detail::handover::ENV,
+                         detail::LISTEN_FDS_START + fds.size() - 1);
+  auto pid = detail::spawn(conf.executable.c_str(), conf.argv, fds, {env});
+  auto error = std::error_code(errno, std::system_category());
+  close(channel[1]);
+  if (pid < 0)
   {
-    sigmask = signal_mask();
-    pthread_sigmask(SIG_BLOCK, sigmask, nullptr);
+    close(channel[0]);
+    return error;
+  }
+
+  if ((error = handover.send_to(channel[0])))
+    waitpid(pid, nullptr, WNOHANG);
 
-    return std::jthread([&](const std::stop_token &token) noexcept {
-      static const auto timeout = timespec{.tv_sec = 0, .tv_nsec = 50000000};
+  return error;
+}
+
+// Handles control commands until the control plane is stopped. Servers
+// must be started after the control plane is created, so that their
+// threads inherit its signal mask.
+static auto control_loop(std::vector<async_context *> servers,
+                         detail::control_plane &control, const config &conf,
+                         std::shared_ptr<detail::handover> handover,
+                         const xdp_server *xdp) -> std::jthread
+{
+  return std::jthread([&control, &conf, xdp, servers = std::move(servers),
+                       handover = std::move(handover)](
+                          const std::stop_token &token) noexcept {
+    using enum detail::control_plane::command;
+    auto stop = std::stop_callback(token, [&] { control.post(STOP); });
 
-      while (!token.stop_requested())
+    while (true)
+    {
+      switch (control.wait())
       {
-        using enum tcp_echo_server::signals;
-        switch (sigtimedwait(sigmask, nullptr, &timeout))
-        {
-          case SIGTERM:
-          case SIGHUP:
-          case SIGINT:
-            tcp_server.signal(terminate);
-            udp_server.signal(terminate);
-            break;
+        case TERMINATE:
+          detail::notify("STOPPING=1");
+          for (auto *server : servers)
+            server->signal(async_context::terminate);
+          break;
 
-          default:
+        case STATS:
+          if (conf.tcp.budget)
+            spdlog::info("Memory budget: {}.", conf.tcp.budget->summary());
+
+          if (auto error = std::error_code(); xdp && conf.xdp.reflect)
+          {
+            auto totals = xdp->counters(error);
+            if (!error)
+            {
+              spdlog::info("XDP echo: {} datagrams, {} bytes.",
+                           totals.packets, totals.bytes);
+            }
+          }
+          break;
+
+        case UPGRADE:
+          if (auto error = upgrade(conf, *handover))
+          {
+            spdlog::warn("Upgrade failed: {}.", error.message());
             break;
-        }
-      }
-    });
-  }
+          }
 
-  return {};
-}
+          spdlog::info("Upgrade started. Handing over to the new process.");
+          for (auto *server : servers)
+            server->signal(async_context::terminate);
+          break;
 
-struct config {
-  unsigned short port = PORT;
-};
+        case STOP:
+          return;
+
+        default:
+          break;
+      }
+    }
+  });
+}
 
 static auto set_loglevel(std::string_view value) -> int
 {
@@ -109,6 +220,44 @@ static auto set_loglevel(std::string_view value) -> int
   return -1;
 }
 
+template <typename T>
+static auto parse_number(std::string_view value, T &number) -> int
+{
+  auto [ptr, err] = std::from_chars(value.cbegin(), value.cend(), number);
+  if (err != std::errc{} || ptr != value.cend())
+  {
+    std::cerr << std::format("Invalid number: {}\n", value);
+    return -1;
+  }
+  return 0;
+}
+
+static auto parse_port(std::string_view value,
+                       std::optional<unsigned short> &port) -> int
+{
+  auto number = static_cast<unsigned short>(0);
+  auto [ptr, err] = std::from_chars(value.cbegin(), value.cend(), number);
+  if (err != std::errc{} || ptr != value.cend())
+  {
+    std::cerr << std::format("Invalid port number: {}\n", value);
+    return -1;
+  }
+  port = number;
+  return 0;
+}
+
+static auto parse_switch(std::string_view value, bool &enabled) -> int
+{
+  if (value == "on" || value == "off")
+  {
+    enabled = (value == "on");
+    return 0;
+  }
+
+  std::cerr << std::format("Expected on or off: {}\n", value);
+  return -1;
+}
+
 auto parse_args(int argc, char const *const *argv) -> std::optional<config>
 {
   using namespace echo::detail;
@@ -140,6 +289,316 @@ auto parse_args(int argc, char const *const *argv) -> std::optional<config>
         return error();
       }
 
+      if (flag == "--preset")
+      {
+        if (std::ranges::find(presets, value) != presets.end())
+        {
+          conf.preset = value;
+          continue;
+        }
+
+        std::cerr << std::format("Unknown preset: {}\n", value)
+                  << "Valid presets are: default, minimal, bulk, ipv6-only\n";
+        return error();
+      }
+
+      if (flag == "--tcp-fastopen")
+      {
+        if (!parse_number(value, conf.tcp.fastopen))
+          continue;
+
+        return error();
+      }
+
+      if (flag == "--tcp-defer-accept")
+      {
+        if (!parse_number(value, conf.tcp.defer_accept))
+          continue;
+
+        return error();
+      }
+
+      if (flag == "--backlog")
+      {
+        if (!parse_number(value, conf.tcp.backlog))
+          continue;
+
+        return error();
+      }
+
+      if (flag == "--tcp-quantum")
+      {
+        if (!parse_number(value, conf.tcp.quantum))
+          continue;
+
+        return error();
+      }
+
+      if (flag == "--tcp-coalesce")
+      {
+        if (!parse_switch(value, conf.tcp.coalesce))
+          continue;
+
+        return error();
+      }
+
+      if (flag == "--pacing-rate")
+      {
+        if (!parse_number(value, conf.tcp.pacing_rate))
+          continue;
+
+        return error();
+      }
+
+      if (flag == "--workers")
+      {
+        if (!parse_number(value, conf.workers))
+        {
+          conf.tcp.reuseport = conf.udp.reuseport = conf.workers > 0;
+          continue;
+        }
+
+        return error();
+      }
+
+      if (flag == "--timestamps")
+      {
+        if (!parse_switch(value, conf.udp.timestamps))
+        {
+          conf.tcp.timestamps = conf.udp.timestamps;
+          continue;
+        }
+
+        return error();
+      }
+
+      if (flag == "--capture")
+      {
+        conf.udp.capture = value;
+        continue;
+      }
+
+      if (flag == "--capture-size")
+      {
+        auto mebibytes = std::size_t{};
+        if (!parse_number(value, mebibytes))
+        {
+          conf.udp.capture_size = mebibytes * 1024 * 1024;
+          continue;
+        }
+
+        return error();
+      }
+
+      if (flag == "--journal")
+      {
+        conf.tcp.journal = value;
+        continue;
+      }
+
+      if (flag == "--journal-size")
+      {
+        auto mebibytes = std::size_t{};
+        if (!parse_number(value, mebibytes))
+        {
+          conf.tcp.journal_size = mebibytes * 1024 * 1024;
+          continue;
+        }
+
+        return error();
+      }
+
+      if (flag == "--journal-segments")
+      {
+        if (!parse_number(value, conf.tcp.journal_segments))
+          continue;
+
+        return error();
+      }
+
+      if (flag == "--memory-budget")
+      {
+        auto mebibytes = std::size_t{};
+        if (!parse_number(value, mebibytes))
+        {
+          conf.tcp.budget =
+              std::make_shared<memory_budget>(mebibytes * 1024 * 1024);
+          conf.udp.budget = conf.tcp.budget;
+          continue;
+        }
+
+        return error();
+      }
+
+      if (flag == "--admin")
+      {
+        conf.admin = value;
+        continue;
+      }
+
+      if (flag == "--hugepages")
+      {
+        auto mebibytes = std::size_t{};
+        if (!parse_number(value, mebibytes))
+        {
+          conf.hugepages = mebibytes * 1024 * 1024;
+          continue;
+        }
+
+        return error();
+      }
+
+      if (flag == "--mlock")
+      {
+        if (!parse_switch(value, conf.mlock))
+          continue;
+
+        return error();
+      }
+
+      if (flag == "--udp-depth")
+      {
+        if (!parse_number(value, conf.udp.depth))
+          continue;
+
+        return error();
+      }
+
+      if (flag == "--udp-retries")
+      {
+        if (!parse_number(value, conf.udp.retries))
+          continue;
+
+        return error();
+      }
+
+      if (flag == "--udp-large")
+      {
+        if (!parse_number(value, conf.udp.large))
+          continue;
+
+        return error();
+      }
+
+      if (flag == "--netem-delay" || flag == "--netem-jitter")
+      {
+        using std::chrono::microseconds;
+        auto milliseconds = 0.0;
+        if (!parse_number(value, milliseconds) && milliseconds >= 0)
+        {
+          auto delay = microseconds(static_cast<microseconds::rep>(
+              milliseconds * 1000));
+          auto &netem = conf.udp.netem;
+          (flag == "--netem-delay" ? netem.delay : netem.jitter) = delay;
+          conf.tcp.netem = netem;
+          continue;
+        }
+
+        return error();
+      }
+
+      if (flag == "--netem-distribution")
+      {
+        constexpr auto shapes = std::array<std::string_view, 3>{
+            "fixed", "uniform", "normal"};
+        if (auto it = std::ranges::find(shapes, value); it != shapes.end())
+        {
+          conf.udp.netem.shape = static_cast<netem_options::distribution>(
+              it - shapes.begin());
+          conf.tcp.netem = conf.udp.netem;
+          continue;
+        }
+
+        std::cerr << std::format("Expected fixed, uniform or normal: {}\n",
+                                 value);
+        return error();
+      }
+
+      if (flag == "--netem-loss")
+      {
+        auto &loss = conf.udp.netem.loss;
+        if (!parse_number(value, loss) && loss >= 0 && loss <= 100)
+        {
+          conf.tcp.netem = conf.udp.netem;
+          continue;
+        }
+
+        return error();
+      }
+
+      if (flag == "--netem-reorder")
+      {
+        if (!parse_number(value, conf.udp.netem.reorder))
+        {
+          conf.tcp.netem = conf.udp.netem;
+          continue;
+        }
+
+        return error();
+      }
+
+      if (flag == "--xdp")
+      {
+        conf.xdp.interface = value;
+        continue;
+      }
+
+      if (flag == "--xdp-mode")
+      {
+        if (value == "native" || value == "generic")
+        {
+          conf.xdp.generic = (value == "generic");
+          continue;
+        }
+
+        std::cerr << std::format("Expected native or generic: {}\n", value);
+        return error();
+      }
+
+      if (flag == "--xdp-reflect")
+      {
+        if (!parse_switch(value, conf.xdp.reflect))
+          continue;
+
+        return error();
+      }
+
+      if (flag == "--discard-port")
+      {
+        if (!parse_port(value, conf.discard_port))
+          continue;
+
+        return error();
+      }
+
+      if (flag == "--chargen-port")
+      {
+        if (!parse_port(value, conf.chargen_port))
+          continue;
+
+        return error();
+      }
+
+      if (flag == "--tls-port")
+      {
+        if (!parse_port(value, conf.tls_port))
+          continue;
+
+        return error();
+      }
+
+      if (flag == "--tls-cert")
+      {
+        conf.tls_cert = value;
+        continue;
+      }
+
+      if (flag == "--tls-key")
+      {
+        conf.tls_key = value;
+        continue;
+      }
+
       std::cerr << std::format("Unknown flag: {}\n", flag);
       return error();
     }
@@ -153,36 +612,456 @@ auto parse_args(int argc, char const *const *argv) -> std::optional<config>
     }
   }
 
+  if (conf.tls_port && (conf.tls_cert.empty() || conf.tls_key.empty()))
+  {
+    std::cerr << "--tls-port requires --tls-cert and --tls-key.\n";
+    return error();
+  }
+
+#ifndef ECHO_ENABLE_TLS
+  if (conf.tls_port)
+  {
+    std::cerr << "This echo-server was built without TLS support.\n";
+    return error();
+  }
+#endif
+
   return {conf};
 }
 
-auto main(int argc, char *argv[]) -> int
+// Answers a command on the admin socket.
+static auto
+admin_command(std::string_view line, detail::control_plane &control,
+              const std::shared_ptr<detail::connection_table> &table,
+              const std::vector<const detail::loop_stats *> &loops)
+    -> std::string
+{
+  auto space = line.find(' ');
+  auto cmd = line.substr(0, space);
+  auto arg = space == line.npos ? std::string_view() : line.substr(space + 1);
+
+  if (cmd == "connections")
+  {
+    auto out =
+        std::string("fd peer age_ms bytes_in bytes_out pending buffer\n");
+    for (const auto &conn : table->snapshot())
+    {
+      out += std::format("{} {} {} {} {} {} {}\n", conn.fd,
+                         detail::format_address(conn.peer), conn.age.count(),
+                         conn.bytes_in, conn.bytes_out, conn.pending,
+                         conn.buffer_size);
+    }
+    return out;
+  }
+
+  if (cmd == "loops")
+  {
+    auto out = std::string("server tid events bytes_in bytes_out cpu_ms\n");
+    for (const auto *loop : loops)
+    {
+      auto tid = loop->tid.load();
+      out += std::format("{} {} {} {} {} {}\n", loop->name, tid,
+                         loop->events.load(), loop->bytes_in.load(),
+                         loop->bytes_out.load(),
+                         tid ? detail::cpu_time(tid).count() : 0);
+    }
+    return out;
+  }
+
+  if (cmd == "drain")
+  {
+    control.post(detail::control_plane::TERMINATE);
+    return "draining\n";
+  }
+
+  if (cmd == "close")
+  {
+    auto fd = -1;
+    if (parse_number(arg, fd) || !table->shutdown(fd))
+      return std::format("error: no connection on {}\n", arg);
+    return std::format("closed {}\n", fd);
+  }
+
+  if (cmd == "help")
+    return "connections\nloops\ndrain\nclose <fd>\n";
+
+  return std::format("error: unknown command: {}\n", cmd);
+}
+
+// Answers admin commands until the returned thread is stopped.
+static auto admin_loop(detail::admin_socket &admin,
+                       detail::control_plane &control,
+                       std::shared_ptr<detail::connection_table> table,
+                       std::vector<const detail::loop_stats *> loops)
+    -> std::jthread
+{
+  return std::jthread([&admin, &control, table = std::move(table),
+                       loops = std::move(loops)](const std::stop_token &token) {
+    auto stop = std::stop_callback(token, [&] { admin.stop(); });
+    admin.run([&](std::string_view line) {
+      return admin_command(line, control, table, loops);
+    });
+  });
+}
+
+template <typename TCPServer, typename UDPServer>
+static auto run(const config &conf) -> int
 {
   using namespace io::socket;
 
-  if (auto conf = parse_args(argc, argv))
+  auto address = socket_address<sockaddr_in6>{};
+  address->sin6_family = AF_INET6;
+  address->sin6_port = htons(conf.port);
+
+  auto tcp_server = basic_context_thread<TCPServer>{};
+  auto udp_server = basic_context_thread<UDPServer>{};
+
+  auto servers = std::vector<async_context *>{&tcp_server, &udp_server};
+
+#ifdef ECHO_ENABLE_TLS
+  auto tls_server = std::optional<tls_echo_server>();
+  auto tls_context = tls_server::context_ptr();
+  if (conf.tls_port)
+  {
+    tls_context =
+        tls_server::make_context(std::string(conf.tls_cert).c_str(),
+                                 std::string(conf.tls_key).c_str());
+    if (!tls_context)
+      return 1;
+
+    servers.push_back(&tls_server.emplace());
+  }
+#endif
+
+  auto tcp_discard = std::optional<basic_context_thread<tcp_discard_server>>();
+  auto udp_discard = std::optional<basic_context_thread<udp_discard_server>>();
+  if (conf.discard_port)
+  {
+    servers.push_back(&tcp_discard.emplace());
+    servers.push_back(&udp_discard.emplace());
+  }
+
+  auto tcp_chargen = std::optional<basic_context_thread<tcp_chargen_server>>();
+  auto udp_chargen = std::optional<basic_context_thread<udp_chargen_server>>();
+  if (conf.chargen_port)
+  {
+    servers.push_back(&tcp_chargen.emplace());
+    servers.push_back(&udp_chargen.emplace());
+  }
+  const auto contexts = servers;
+
+  auto error = std::error_code();
+  auto control = detail::control_plane::create(error);
+  if (error)
   {
-    auto address = socket_address<sockaddr_in6>{};
-    address->sin6_family = AF_INET6;
-    address->sin6_port = htons(conf->port);
+    spdlog::error("Unable to create the control plane: {}.", error.message());
+    return 1;
+  }
+  // During an upgrade the old process hands its TCP connections over.
+  auto handover = std::make_shared<detail::handover>();
+  if (const auto *value = std::getenv(detail::handover::ENV))
+  {
+    auto channel = -1;
+    if (!parse_number(std::string_view(value), channel))
+      handover->receive_from(channel);
+    unsetenv(detail::handover::ENV);
+  }
+
+  // XDP starts before the UDP server, which keeps serving whatever the
+  // program passes to the kernel, and everything if XDP can't be set up.
+  // Its threads block signals like the servers' threads.
+  auto xdp = std::optional<xdp_server>();
+  if (!conf.xdp.interface.empty())
+  {
+    if (auto error = xdp.emplace(conf.port, conf.xdp).start())
+    {
+      spdlog::warn("Unable to start XDP on {}: {}.", conf.xdp.interface,
+                   error.message());
+      xdp.reset();
+    }
+    else if (conf.xdp.reflect)
+    {
+      spdlog::info("XDP echo on {}.", conf.xdp.interface);
+    }
+    else
+    {
+      spdlog::info("AF_XDP echo on {} with {} queues.", conf.xdp.interface,
+                   xdp->queues());
+    }
+  }
+
+  auto controller = control_loop(std::move(servers), control, conf, handover,
+                                 xdp ? &*xdp : nullptr);
+
+  // Listeners passed by the service manager replace the sockets that the
+  // servers bind, so the servers bind to ephemeral ports instead.
+  const auto &inherited = conf.listeners;
+  auto tcp_options = conf.tcp;
+  tcp_options.handover = handover;
+  auto tcp_address = address;
+  tcp_options.inherited =
+      detail::find_listener(inherited, SOCK_STREAM, conf.port);
+  if (tcp_options.inherited >= 0)
+    tcp_address->sin6_port = 0;
+
+  tcp_options.started = std::make_shared<std::error_code>();
+
+  auto udp_options = conf.udp;
+  udp_options.started = std::make_shared<std::error_code>();
+  auto udp_address = address;
+  udp_options.inherited =
+      detail::find_listener(inherited, SOCK_DGRAM, conf.port);
+  if (udp_options.inherited >= 0)
+    udp_address->sin6_port = 0;
+
+  // The admin socket reports on the connections and event loops of the
+  // echo servers. Presets without accounting report nothing.
+  auto admin = detail::admin_socket();
+  auto admin_thread = std::jthread();
+  if (!conf.admin.empty())
+  {
+    tcp_options.connections = std::make_shared<detail::connection_table>();
+    tcp_options.loop = std::make_shared<detail::loop_stats>("tcp");
+    udp_options.loop = std::make_shared<detail::loop_stats>("udp");
+
+    admin = detail::admin_socket::create(conf.admin, error);
+    if (error)
+    {
+      spdlog::warn("Unable to create the admin socket {}: {}.", conf.admin,
+                   error.message());
+    }
+    else
+    {
+      spdlog::info("Admin socket listening on {}.", conf.admin);
+      auto loops = std::vector<const detail::loop_stats *>{
+          tcp_options.loop.get(), udp_options.loop.get()};
+      admin_thread = admin_loop(admin, control, tcp_options.connections,
+                                std::move(loops));
+    }
+  }
+
+  // The servers start in parallel.
+  spdlog::info("Echo server starting on TCP port {}{}.", conf.port,
+               tcp_options.inherited >= 0 ? " (inherited)" : "");
+  tcp_server.start(tcp_address, tcp_options);
+
+  spdlog::info("Echo server starting on UDP port {}{}.", conf.port,
+               udp_options.inherited >= 0 ? " (inherited)" : "");
+  udp_server.start(udp_address, udp_options);
+
+#ifdef ECHO_ENABLE_TLS
+  if (tls_server)
+  {
+    auto tls_address = address;
+    tls_address->sin6_port = htons(*conf.tls_port);
+
+    spdlog::info("Echo server starting on TLS port {}.", *conf.tls_port);
+    tls_server->start(tls_address, tls_context);
+  }
+#endif
+
+  if (conf.discard_port)
+  {
+    auto discard_address = address;
+    discard_address->sin6_port = htons(*conf.discard_port);
+
+    spdlog::info("Discard server starting on port {}.", *conf.discard_port);
+    tcp_discard->start(discard_address);
+    udp_discard->start(discard_address);
+  }
+
+  if (conf.chargen_port)
+  {
+    auto chargen_address = address;
+    chargen_address->sin6_port = htons(*conf.chargen_port);
+
+    spdlog::info("Chargen server starting on port {}.", *conf.chargen_port);
+    tcp_chargen->start(chargen_address);
+    udp_chargen->start(chargen_address);
+  }
+
+  for (auto *server : contexts)
+    server->state.wait(async_context::PENDING);
+
+  // A server that couldn't bind or adopt its socket isn't echoing, so the
+  // service manager is told why instead of that the process is ready.
+  error = *tcp_options.started ? *tcp_options.started : *udp_options.started;
+  if (error)
+  {
+    spdlog::error("Unable to start the echo server: {}.", error.message());
+    if (conf.ready < 0)
+    {
+      detail::notify(std::format("STATUS=Unable to start: {}\nERRNO={}",
+                                 error.message(), error.value()));
+    }
+
+    for (auto *server : contexts)
+      server->signal(async_context::terminate);
+    for (auto *server : contexts)
+      server->state.wait(async_context::STARTED);
+    return 1;
+  }
+
+  // Workers report to the supervisor, which notifies for all of them.
+  if (conf.ready >= 0)
+  {
+    detail::supervisor::ready(conf.ready);
+  }
+  else if (auto error = detail::notify(std::format(
+               "READY=1\nSTATUS=Echoing on port {}\nMAINPID={}", conf.port,
+               getpid())))
+  {
+    spdlog::warn("Unable to notify the service manager: {}.",
+                 error.message());
+  }
 
-    auto tcp_server = tcp_echo_server{};
-    auto udp_server = udp_echo_server{};
+  for (auto *server : contexts)
+    server->state.wait(async_context::STARTED);
 
-    auto sighandler = signal_handler(tcp_server, udp_server);
+  if (conf.tcp.budget)
+    spdlog::info("Memory budget: {}.", conf.tcp.budget->summary());
 
-    spdlog::info("Echo server starting on TCP port {}.", conf->port);
-    tcp_server.start(address);
-    tcp_server.state.wait(async_context::PENDING);
+  spdlog::info("Echo server stopped.");
+  return 0;
+}
+
+static auto dispatch(const config &conf) -> int
+{
+  // Only the full servers check for held echoes, parked connections, a
+  // journal and a capture, so these options replace the preset.
+  if (conf.udp.netem || conf.tcp.quantum || !conf.tcp.journal.empty() ||
+      !conf.udp.capture.empty())
+  {
+    if (conf.preset != "default")
+    {
+      spdlog::warn("Network emulation, fair scheduling, the journal and the "
+                   "capture use the default preset.");
+    }
+    return run<full_tcp_server, full_udp_server>(conf);
+  }
+
+  if (conf.preset == "minimal")
+  {
+    if (conf.tcp.budget)
+      spdlog::warn("The minimal preset has no memory budget.");
+    if (!conf.admin.empty())
+      spdlog::warn("The minimal preset doesn't account for the admin socket.");
+    return run<minimal_tcp_server, minimal_udp_server>(conf);
+  }
+
+  if (conf.preset == "bulk")
+    return run<bulk_tcp_server, bulk_udp_server>(conf);
+
+  if (conf.preset == "ipv6-only")
+    return run<ipv6_tcp_server, ipv6_udp_server>(conf);
+
+  return run<tcp_server, udp_server>(conf);
+}
+
+// Runs the servers with their buffers in an arena local to this process.
+// Workers call this after the fork, so each binds its arena to the node it
+// runs on, and locks its own memory, since memory locks aren't inherited.
+static auto serve(const config &conf) -> int
+{
+  auto buffers = detail::arena();
+  if (conf.hugepages)
+  {
+    auto error = std::error_code();
+    buffers = detail::arena::create(conf.hugepages, error);
+    if (error)
+    {
+      spdlog::warn("Unable to map the buffer arena: {}.", error.message());
+    }
+    else
+    {
+      spdlog::info("Buffer arena: {} MiB of {} pages on node {}.",
+                   buffers.size() / (1024 * 1024),
+                   buffers.hugetlb() ? "huge" : "transparent huge",
+                   buffers.node());
+      detail::arena::install(&buffers);
+    }
+  }
+
+  if (conf.mlock && mlockall(MCL_CURRENT | MCL_FUTURE))
+  {
+    spdlog::warn("Unable to lock memory: {}.",
+                 std::error_code(errno, std::system_category()).message());
+  }
+
+  // The servers have freed their buffers by the time run() returns.
+  auto status = dispatch(conf);
+  detail::arena::install(nullptr);
+  return status;
+}
 
-    spdlog::info("Echo server starting on UDP port {}.", conf->port);
-    udp_server.start(address);
-    udp_server.state.wait(async_context::PENDING);
+static auto log_exit(const detail::supervisor::worker_exit &exit) -> void
+{
+  const auto *restarting = exit.restarting ? " Restarting." : "";
+  if (WIFSIGNALED(exit.status))
+  {
+    spdlog::warn("Worker {} (pid {}) was killed by signal {}.{}", exit.index,
+                 exit.pid, WTERMSIG(exit.status), restarting);
+  }
+  else if (WEXITSTATUS(exit.status) != 0 || exit.restarting)
+  {
+    spdlog::warn("Worker {} (pid {}) exited with status {}.{}", exit.index,
+                 exit.pid, WEXITSTATUS(exit.status), restarting);
+  }
+  else
+  {
+    spdlog::info("Worker {} (pid {}) stopped.", exit.index, exit.pid);
+  }
+}
+
+// Runs the servers in worker processes that share the ports.
+static auto supervise(const config &conf) -> int
+{
+  auto worker = [&](std::size_t index, int ready) {
+    auto worker_conf = conf;
+    worker_conf.ready = ready;
+    // The companion services can't share their ports, and an interface
+    // only takes one XDP program, so only the first worker runs them.
+    if (index > 0)
+    {
+      worker_conf.tls_port = worker_conf.discard_port =
+          worker_conf.chargen_port = std::nullopt;
+      worker_conf.xdp.interface.clear();
+    }
+    // Each worker answers on its own admin socket.
+    if (!worker_conf.admin.empty())
+      worker_conf.admin += std::format(".{}", index);
+
+    unsetenv("NOTIFY_SOCKET");
+    spdlog::info("Worker {} started with pid {}.", index, getpid());
+    return serve(worker_conf);
+  };
+
+  auto error = std::error_code();
+  auto supervisor = detail::supervisor(conf.workers, worker, log_exit);
+  spdlog::info("Starting {} workers.", conf.workers);
+  auto status = supervisor.run(error);
+  if (error)
+    spdlog::error("Unable to supervise the workers: {}.", error.message());
+
+  spdlog::info("Echo server stopped.");
+  return status;
+}
+
+auto main(int argc, char *argv[]) -> int
+{
+  if (auto conf = parse_args(argc, argv))
+  {
+    auto error = std::error_code();
+    conf->executable = std::filesystem::read_symlink("/proc/self/exe", error);
+    if (error)
+      conf->executable = *argv;
+    conf->argv = argv;
+    conf->listeners = detail::listen_fds();
 
-    tcp_server.state.wait(async_context::STARTED);
-    udp_server.state.wait(async_context::STARTED);
+    if (conf->workers > 0)
+      return supervise(*conf);
 
-    spdlog::info("Echo server stopped.");
+    return serve(*conf);
   }
   return 0;
 }
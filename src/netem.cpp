@@ -0,0 +1,267 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file netem.cpp
+ * @brief This file defines the network emulator that holds echoes for a
+ * random delay.
+ */
+#include "echo/detail/netem.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <format>
+#include <utility>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+namespace echo::detail {
+
+auto netem_options::delayed() const noexcept -> bool
+{
+  return delay.count() > 0 || jitter.count() > 0;
+}
+
+netem_options::operator bool() const noexcept
+{
+  return delayed() || loss > 0 || reorder > 1;
+}
+
+// Forwards each expiry of the timerfd to the socket until stopped.
+static auto forward(int timer, int socket, int stop) noexcept -> void
+{
+  auto fds = std::array<pollfd, 2>{
+      {{.fd = timer, .events = POLLIN, .revents = 0},
+       {.fd = stop, .events = POLLIN, .revents = 0}}};
+
+  while (true)
+  {
+    if (poll(fds.data(), fds.size(), -1) < 0 && errno != EINTR)
+      return;
+
+    if (fds[1].revents & POLLIN)
+      return;
+
+    auto expiries = std::uint64_t{};
+    if (fds[0].revents & POLLIN &&
+        ::read(timer, &expiries, sizeof(expiries)) == sizeof(expiries))
+    {
+      // A full socket already has a tick waiting to be read.
+      auto tick = std::byte{};
+      [[maybe_unused]] auto len =
+          send(socket, &tick, sizeof(tick), MSG_DONTWAIT | MSG_NOSIGNAL);
+    }
+  }
+}
+
+netem::netem(netem &&other) noexcept
+    : options_{other.options_}, random_{other.random_},
+      wheel_{std::move(other.wheel_)}, window_{std::move(other.window_)},
+      position_{other.position_}, epoch_{other.epoch_},
+      timer_{std::exchange(other.timer_, -1)},
+      sockets_{std::exchange(other.sockets_, {-1, -1})},
+      stop_{std::exchange(other.stop_, -1)}, ticking_{other.ticking_},
+      thread_{std::move(other.thread_)}, held_{other.held_},
+      lost_{other.lost_}, reordered_{other.reordered_},
+      overflows_{other.overflows_}
+{}
+
+auto netem::operator=(netem &&other) noexcept -> netem &
+{
+  if (this != &other)
+  {
+    close();
+    options_ = other.options_;
+    random_ = other.random_;
+    wheel_ = std::move(other.wheel_);
+    window_ = std::move(other.window_);
+    position_ = other.position_;
+    epoch_ = other.epoch_;
+    timer_ = std::exchange(other.timer_, -1);
+    sockets_ = std::exchange(other.sockets_, {-1, -1});
+    stop_ = std::exchange(other.stop_, -1);
+    ticking_ = other.ticking_;
+    thread_ = std::move(other.thread_);
+    held_ = other.held_;
+    lost_ = other.lost_;
+    reordered_ = other.reordered_;
+    overflows_ = other.overflows_;
+  }
+  return *this;
+}
+
+netem::~netem() { close(); }
+
+auto netem::close() noexcept -> void
+{
+  if (thread_.joinable())
+  {
+    auto one = std::uint64_t{1};
+    [[maybe_unused]] auto len = ::write(stop_, &one, sizeof(one));
+    thread_.join();
+  }
+
+  for (auto *fd : {&timer_, &sockets_[0], &sockets_[1], &stop_})
+  {
+    if (*fd >= 0)
+      ::close(std::exchange(*fd, -1));
+  }
+}
+
+auto netem::create(const netem_options &options,
+                   std::error_code &error) noexcept -> netem
+{
+  auto emulator = netem();
+  emulator.options_ = options;
+  emulator.random_.seed(std::random_device()());
+  emulator.window_.assign(std::max<std::size_t>(options.reorder, 1) - 1,
+                          timer_wheel::NONE);
+  emulator.epoch_ = clock::now();
+
+  emulator.timer_ =
+      timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+  emulator.stop_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (emulator.timer_ < 0 || emulator.stop_ < 0 ||
+      socketpair(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0,
+                 emulator.sockets_.data()))
+  {
+    error = {errno, std::system_category()};
+    return {};
+  }
+
+  emulator.thread_ = std::jthread(forward, emulator.timer_,
+                                  emulator.sockets_[1], emulator.stop_);
+  return emulator;
+}
+
+auto netem::lost() -> bool
+{
+  if (options_.loss <= 0)
+    return false;
+
+  if (std::bernoulli_distribution(options_.loss / 100)(random_))
+  {
+    ++lost_;
+    return true;
+  }
+  return false;
+}
+
+auto netem::sample() -> std::chrono::microseconds
+{
+  using std::chrono::microseconds;
+  auto mean = static_cast<double>(options_.delay.count());
+  auto jitter = static_cast<double>(options_.jitter.count());
+  auto delay = mean;
+
+  switch (options_.shape)
+  {
+    case netem_options::UNIFORM:
+      delay = std::uniform_real_distribution(mean - jitter,
+                                             mean + jitter)(random_);
+      break;
+
+    case netem_options::NORMAL:
+      delay = std::normal_distribution(mean, jitter)(random_);
+      break;
+
+    default:
+      break;
+  }
+
+  return microseconds(static_cast<microseconds::rep>(std::max(delay, 0.0)));
+}
+
+auto netem::now() const noexcept -> timer_wheel::tick_type
+{
+  return (clock::now() - epoch_) / TICK;
+}
+
+auto netem::tick(bool ticking) noexcept -> void
+{
+  if (std::exchange(ticking_, ticking) == ticking)
+    return;
+
+  auto spec = itimerspec{};
+  if (ticking)
+  {
+    spec.it_interval.tv_nsec = std::chrono::nanoseconds(TICK).count();
+    spec.it_value = spec.it_interval;
+  }
+
+  timerfd_settime(timer_, 0, &spec, nullptr);
+}
+
+auto netem::hold(std::uint32_t id, bool reorder) -> bool
+{
+  if (wheel_.size() >= options_.limit)
+  {
+    ++overflows_;
+    return false;
+  }
+
+  // Delays are rounded up, so nothing is released early.
+  auto delay = (sample() + TICK - std::chrono::microseconds(1)) / TICK;
+  auto timer = wheel_.schedule(id, now() + delay);
+  ++held_;
+
+  if (reorder && !window_.empty())
+  {
+    auto &slot = window_[position_];
+    position_ = (position_ + 1) % window_.size();
+
+    // Take the place of an earlier echo that is still held.
+    auto pick = std::uniform_int_distribution<std::size_t>(
+        0, window_.size() - 1)(random_);
+    if (auto other = window_[pick];
+        other != timer && wheel_.id(other) != timer_wheel::NONE)
+    {
+      wheel_.swap(timer, other);
+      ++reordered_;
+    }
+    slot = timer;
+  }
+
+  tick(true);
+  return true;
+}
+
+auto netem::expire(std::vector<std::uint32_t> &ids) -> void
+{
+  wheel_.advance(now(), ids);
+  tick(!wheel_.empty());
+}
+
+auto netem::clear(std::vector<std::uint32_t> &ids) -> void
+{
+  wheel_.clear(ids);
+  tick(false);
+}
+
+auto netem::fd() const noexcept -> int { return sockets_[0]; }
+
+auto netem::size() const noexcept -> std::size_t { return wheel_.size(); }
+
+auto netem::summary() const -> std::string
+{
+  return std::format("{} held, {} lost, {} reordered, {} over the limit",
+                     held_, lost_, reordered_, overflows_);
+}
+
+netem::operator bool() const noexcept { return sockets_[0] >= 0; }
+} // namespace echo::detail
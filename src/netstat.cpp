@@ -0,0 +1,83 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file netstat.cpp
+ * @brief This file defines readers for kernel listen queue counters.
+ */
+#include "echo/detail/netstat.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+namespace echo::detail {
+
+auto parse_netstat(std::istream &netstat) -> std::optional<listen_stats>
+{
+  // /proc/net/netstat is a sequence of line pairs. The first line of
+  // each pair names the counters and the second holds their values.
+  auto names = std::string();
+  auto values = std::string();
+  while (std::getline(netstat, names) && std::getline(netstat, values))
+  {
+    if (!names.starts_with("TcpExt:"))
+      continue;
+
+    auto stats = listen_stats{};
+    auto found = 0;
+    auto name_stream = std::istringstream(names);
+    auto value_stream = std::istringstream(values);
+    auto name = std::string();
+    auto value = std::string();
+    while (name_stream >> name && value_stream >> value)
+    {
+      if (name == "ListenOverflows")
+      {
+        stats.overflows = std::stoull(value);
+        ++found;
+      }
+      else if (name == "ListenDrops")
+      {
+        stats.drops = std::stoull(value);
+        ++found;
+      }
+    }
+
+    if (found == 2)
+      return stats;
+  }
+  return std::nullopt;
+}
+
+auto read_listen_stats(int sockfd) -> listen_stats
+{
+  auto file = std::ifstream("/proc/net/netstat");
+  auto stats = parse_netstat(file).value_or(listen_stats{});
+
+  // For listening sockets, tcpi_unacked is the current accept queue
+  // length and tcpi_sacked is the maximum backlog.
+  auto info = tcp_info{};
+  auto len = static_cast<socklen_t>(sizeof(info));
+  if (sockfd >= 0 && !getsockopt(sockfd, IPPROTO_TCP, TCP_INFO, &info, &len))
+  {
+    stats.queued = info.tcpi_unacked;
+    stats.backlog = info.tcpi_sacked;
+  }
+  return stats;
+}
+} // namespace echo::detail
@@ -0,0 +1,152 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file retry_queue.cpp
+ * @brief This file defines a bounded queue of UDP replies waiting to be
+ * retried, and per-errno drop counters.
+ */
+#include "echo/detail/retry_queue.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <format>
+#include <numeric>
+
+#include <sys/uio.h>
+namespace echo::detail {
+
+auto send_drops::drop(int error) noexcept -> void
+{
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+  ++by_errno[std::clamp(error, 0, static_cast<int>(ERRNOS) - 1)];
+}
+
+auto send_drops::total() const noexcept -> std::uint64_t
+{
+  return std::accumulate(by_errno.begin(), by_errno.end(), std::uint64_t{});
+}
+
+auto send_drops::summary() const -> std::string
+{
+  auto out = std::format("{} queued, {} retried, {} dropped", queued, retried,
+                         total());
+  auto sep = " (";
+  for (std::size_t error = 0; error < ERRNOS; ++error)
+  {
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+    if (auto count = by_errno[error])
+    {
+      const char *name = strerrorname_np(static_cast<int>(error));
+      out += std::format("{}{} {}", sep, name ? name : "E?", count);
+      sep = ", ";
+    }
+  }
+  if (*sep == ',')
+    out += ")";
+  return out;
+}
+
+retry_queue::retry_queue(std::size_t capacity, std::size_t size)
+    : entries_(capacity), storage_(capacity * size), size_{size}
+{}
+
+auto retry_queue::push(std::span<const std::byte> address,
+                       std::span<const std::byte> payload) noexcept -> bool
+{
+  if (count_ == entries_.size() || payload.size() > size_ ||
+      address.size() > sizeof(sockaddr_in6))
+  {
+    return false;
+  }
+
+  auto index = (head_ + count_++) % entries_.size();
+  auto slot = std::span(storage_).subspan(index * size_, payload.size());
+  std::ranges::copy(payload, slot.begin());
+
+  auto &entry = entries_[index];
+  entry.address = {};
+  std::memcpy(&entry.address, address.data(), address.size());
+  entry.addrlen = static_cast<socklen_t>(address.size());
+  entry.payload = slot;
+  return true;
+}
+
+auto retry_queue::front() const noexcept -> const entry &
+{
+  assert(count_ > 0 && "The queue must not be empty.");
+  return entries_[head_];
+}
+
+auto retry_queue::pop() noexcept -> void
+{
+  assert(count_ > 0 && "The queue must not be empty.");
+  head_ = (head_ + 1) % entries_.size();
+  --count_;
+}
+
+auto retry_queue::flush(int sockfd, send_drops &drops) noexcept -> std::size_t
+{
+  std::size_t sent = 0;
+  auto iovs = std::array<iovec, BATCH>();
+  auto msgs = std::array<mmsghdr, BATCH>();
+
+  while (count_ > 0)
+  {
+    auto batch = std::min(count_, BATCH);
+    for (std::size_t i = 0; i < batch; ++i)
+    {
+      auto &entry = entries_[(head_ + i) % entries_.size()];
+      // NOLINTBEGIN(cppcoreguidelines-pro-bounds-constant-array-index)
+      iovs[i] = {.iov_base = const_cast<std::byte *>(entry.payload.data()),
+                 .iov_len = entry.payload.size()};
+      msgs[i] = {.msg_hdr = {.msg_name = &entry.address,
+                             .msg_namelen = entry.addrlen,
+                             .msg_iov = &iovs[i],
+                             .msg_iovlen = 1},
+                 .msg_len = 0};
+      // NOLINTEND(cppcoreguidelines-pro-bounds-constant-array-index)
+    }
+
+    auto len = sendmmsg(sockfd, msgs.data(), static_cast<unsigned>(batch),
+                        MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (len < 0)
+    {
+      if (is_retryable(errno))
+        break;
+
+      drops.drop(errno);
+      pop();
+      continue;
+    }
+
+    for (int i = 0; i < len; ++i)
+      pop();
+    sent += static_cast<std::size_t>(len);
+    drops.retried += static_cast<std::uint64_t>(len);
+  }
+  return sent;
+}
+
+auto retry_queue::size() const noexcept -> std::size_t { return count_; }
+
+auto retry_queue::empty() const noexcept -> bool { return count_ == 0; }
+
+auto retry_queue::capacity() const noexcept -> std::size_t
+{
+  return entries_.size();
+}
+} // namespace echo::detail
@@ -0,0 +1,253 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file supervisor.cpp
+ * @brief This file defines the supervisor that runs the echo servers in
+ * pre-forked worker processes.
+ */
+#include "echo/detail/supervisor.hpp"
+#include "echo/detail/activation.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <format>
+#include <utility>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/signalfd.h>
+#include <sys/wait.h>
+#include <unistd.h>
+namespace echo::detail {
+// The signals that are read from the signalfd.
+static auto supervisor_signals() noexcept -> sigset_t
+{
+  auto set = sigset_t{};
+  sigemptyset(&set);
+  sigaddset(&set, SIGTERM);
+  sigaddset(&set, SIGINT);
+  sigaddset(&set, SIGHUP);
+  sigaddset(&set, SIGUSR1);
+  sigaddset(&set, SIGUSR2);
+  sigaddset(&set, SIGCHLD);
+  return set;
+}
+
+supervisor::supervisor(std::size_t workers, worker_type worker,
+                       observer_type observer)
+    : worker_{std::move(worker)}, observer_{std::move(observer)},
+      slots_(workers)
+{}
+
+supervisor::~supervisor() { close(); }
+
+auto supervisor::close() noexcept -> void
+{
+  if (signals_ >= 0)
+    ::close(std::exchange(signals_, -1));
+  for (auto &end : ready_)
+  {
+    if (end >= 0)
+      ::close(std::exchange(end, -1));
+  }
+}
+
+auto supervisor::ready(int ready) noexcept -> void
+{
+  if (ready < 0)
+    return;
+
+  auto byte = char{1};
+  while (write(ready, &byte, 1) < 0 && errno == EINTR)
+    ;
+  ::close(ready);
+}
+
+auto supervisor::spawn(std::size_t index) -> std::error_code
+{
+  auto pid = fork();
+  if (pid < 0)
+    return {errno, std::system_category()};
+
+  if (pid == 0)
+  {
+    // The worker sets up its own signal handling.
+    sigprocmask(SIG_SETMASK, &mask_, nullptr);
+    ::close(signals_);
+    ::close(ready_[0]);
+    std::exit(worker_(index, ready_[1]));
+  }
+
+  slots_[index].pid = pid;
+  slots_[index].started = clock::now();
+  return {};
+}
+
+auto supervisor::forward(int signo) noexcept -> void
+{
+  for (const auto &slot : slots_)
+  {
+    if (slot.pid > 0)
+      kill(slot.pid, signo);
+  }
+}
+
+auto supervisor::reap() -> void
+{
+  auto status = 0;
+  for (pid_t pid = 0; (pid = waitpid(-1, &status, WNOHANG)) > 0;)
+  {
+    auto it = std::ranges::find(slots_, pid, &slot::pid);
+    if (it == slots_.end())
+      continue;
+
+    auto failed = !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+    if (stopping_)
+      failed_ = failed_ || failed;
+
+    // A worker that keeps crashing on start up is restarted slowly.
+    auto now = clock::now();
+    it->pid = -1;
+    it->restart = std::max(now, it->started + RESTART_DELAY);
+
+    if (observer_)
+    {
+      observer_({.index = static_cast<std::size_t>(it - slots_.begin()),
+                 .pid = pid,
+                 .status = status,
+                 .restarting = !stopping_});
+    }
+  }
+}
+
+auto supervisor::timeout() const noexcept -> int
+{
+  using namespace std::chrono;
+  if (stopping_)
+    return -1;
+
+  auto timeout = -1;
+  auto now = clock::now();
+  for (const auto &slot : slots_)
+  {
+    if (slot.pid > 0)
+      continue;
+
+    auto wait = duration_cast<milliseconds>(slot.restart - now).count();
+    auto ms = static_cast<int>(std::max<decltype(wait)>(wait, 0));
+    timeout = timeout < 0 ? ms : std::min(timeout, ms);
+  }
+  return timeout;
+}
+
+auto supervisor::run(std::error_code &error) -> int
+{
+  auto set = supervisor_signals();
+  if (auto err = sigprocmask(SIG_BLOCK, &set, &mask_))
+  {
+    error = {err, std::system_category()};
+    return 1;
+  }
+
+  signals_ = signalfd(-1, &set, SFD_CLOEXEC | SFD_NONBLOCK);
+  if (signals_ < 0 || pipe2(ready_.data(), O_CLOEXEC))
+  {
+    error = {errno, std::system_category()};
+    return 1;
+  }
+  fcntl(ready_[0], F_SETFL, O_NONBLOCK);
+
+  for (std::size_t i = 0; i < slots_.size(); ++i)
+  {
+    if ((error = spawn(i)))
+    {
+      stopping_ = true;
+      forward(SIGTERM);
+      break;
+    }
+  }
+
+  auto ready = 0UL;
+  auto running = [&] {
+    return std::ranges::any_of(slots_, [](auto pid) { return pid > 0; },
+                               &slot::pid);
+  };
+
+  while (!stopping_ || running())
+  {
+    auto fds = std::array<pollfd, 2>{
+        pollfd{.fd = signals_, .events = POLLIN, .revents = 0},
+        pollfd{.fd = ready_[0], .events = POLLIN, .revents = 0}};
+    if (poll(fds.data(), fds.size(), timeout()) < 0 && errno != EINTR)
+    {
+      error = {errno, std::system_category()};
+      stopping_ = true;
+      forward(SIGTERM);
+    }
+
+    // Restarted workers report readiness again, only the first round
+    // counts.
+    auto byte = char{};
+    while (read(ready_[0], &byte, 1) > 0)
+    {
+      if (++ready == slots_.size())
+      {
+        notify(std::format("READY=1\nSTATUS={} workers running\nMAINPID={}",
+                           slots_.size(), getpid()));
+      }
+    }
+
+    auto info = signalfd_siginfo{};
+    while (read(signals_, &info, sizeof(info)) == sizeof(info))
+    {
+      switch (info.ssi_signo)
+      {
+        case SIGTERM:
+        case SIGINT:
+        case SIGHUP:
+          if (!std::exchange(stopping_, true))
+            notify("STOPPING=1");
+          forward(SIGTERM);
+          break;
+
+        case SIGUSR1:
+          forward(SIGUSR1);
+          break;
+
+        case SIGCHLD:
+          reap();
+          break;
+
+        default:
+          break;
+      }
+    }
+
+    if (stopping_)
+      continue;
+
+    auto now = clock::now();
+    for (std::size_t i = 0; i < slots_.size(); ++i)
+    {
+      if (slots_[i].pid < 0 && slots_[i].restart <= now && spawn(i))
+        slots_[i].restart = now + RESTART_DELAY;
+    }
+  }
+
+  return failed_ || error ? 1 : 0;
+}
+} // namespace echo::detail
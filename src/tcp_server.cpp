@@ -18,25 +18,29 @@
  * @brief This file defines the TCP echo server.
  */
 #include "echo/tcp_server.hpp"
+#include "echo/detail/activation.hpp"
+#include "echo/detail/netstat.hpp"
+#include "echo/detail/probes.hpp"
 
-#include <spdlog/spdlog.h>
-
+#include <algorithm>
 #include <cassert>
 #include <charconv>
 #include <string_view>
+#include <type_traits>
+#include <utility>
 
 #include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
 namespace echo {
 // Additional buffer length for the port number, the square brackets,
 // the colon, and the null byte.
 static constexpr auto BUFLEN = 9UL;
 
-// Dynamically configurable TCP buffer sizes for TCP sessions.
-static constexpr auto TCP_BUFSIZE = 4 * 1024UL;
-
-static inline auto
-getpeername_(const tcp_server::socket_dialog &socket,
-             std::span<char> buf) noexcept -> std::string_view
+template <typename SocketDialog>
+static inline auto getpeername_(const SocketDialog &socket,
+                                std::span<char> buf) noexcept -> std::string_view
 {
   assert(buf.size() >= INET6_ADDRSTRLEN + BUFLEN &&
          "Buffer must be large enough to print an IPv6 address and a port "
@@ -78,71 +82,683 @@ getpeername_(const tcp_server::socket_dialog &socket,
   return {buf.data()};
 }
 
+template <typename SocketDialog>
+static inline auto peername_(const SocketDialog &socket) noexcept -> sockaddr_in6
+{
+  using namespace io::socket;
+  using io::getpeername;
+
+  auto peer = sockaddr_in6{};
+  auto addr = socket_address<sockaddr_in6>();
+  auto span = getpeername(socket, addr);
+  if (span.data())
+    std::memcpy(&peer, span.data(), std::min(span.size(), sizeof(peer)));
+
+  return peer;
+}
+
+// Echoes what is queued on a socket without blocking. Sends `pending`, then
+// reads the socket into `buffer` and sends that, until the socket has
+// nothing left to read, can't take the whole echo, or `limit` bytes have
+// been echoed. Bytes the socket didn't take are left in `pending`. No
+// sender is built and the read context is never copied, so nothing is
+// allocated however many round trips are echoed.
+//
+// When coalescing, the rest of the buffer is filled with whatever input is
+// already queued before it is sent, so many small writes are echoed in one
+// segment. A full buffer is sent with MSG_MORE, since more input is likely
+// queued behind it, and the corked bytes are pushed out as soon as the
+// input runs dry. Nothing ever waits for input that hasn't arrived.
+static inline auto echo_inline(int sockfd, std::span<std::byte> buffer,
+                               std::span<const std::byte> &pending,
+                               std::size_t limit,
+                               bool coalesce = false) noexcept -> std::size_t
+{
+  auto echoed = 0UL;
+  while (true)
+  {
+    // Input is only gathered behind bytes that start the buffer.
+    auto drained = false;
+    if (coalesce && pending.data() == buffer.data())
+    {
+      while (pending.size() < buffer.size())
+      {
+        auto len = recv(sockfd, buffer.data() + pending.size(),
+                        buffer.size() - pending.size(), MSG_DONTWAIT);
+        if ((drained = len <= 0))
+          break;
+
+        ECHO_PROBE(tcp_recv, sockfd, len);
+        pending = buffer.first(pending.size() + len);
+      }
+    }
+
+    auto more = coalesce && !drained && !pending.empty() &&
+                echoed + pending.size() < limit;
+    while (!pending.empty())
+    {
+      auto iov = iovec{.iov_base = const_cast<std::byte *>(pending.data()),
+                       .iov_len = pending.size()};
+      auto msg = msghdr{};
+      msg.msg_iov = &iov;
+      msg.msg_iovlen = 1;
+      // The echo path sends what is left without MSG_MORE.
+      auto len = sendmsg(sockfd, &msg,
+                         MSG_NOSIGNAL | MSG_DONTWAIT | (more ? MSG_MORE : 0));
+      if (len <= 0)
+        return echoed;
+
+      ECHO_PROBE(tcp_sent, sockfd, len);
+      pending = pending.subspan(len);
+      echoed += len;
+    }
+
+    if (echoed >= limit || drained)
+      return echoed;
+
+    // The receive is re-armed to see end of file and errors.
+    auto len = recv(sockfd, buffer.data(), buffer.size(), MSG_DONTWAIT);
+    if (len <= 0)
+    {
+      // Clearing TCP_CORK pushes out the bytes sent with MSG_MORE.
+      if (more)
+      {
+        auto off = 0;
+        setsockopt(sockfd, IPPROTO_TCP, TCP_CORK, &off, sizeof(off));
+      }
+      return echoed;
+    }
+
+    ECHO_PROBE(tcp_recv, sockfd, len);
+    pending = buffer.first(len);
+  }
+}
+
+// Constructs an operation in place from the result of `fn`, for operations
+// that can't be moved.
+template <typename Fn> struct emplace_from {
+  Fn fn;
+  // NOLINTNEXTLINE(google-explicit-constructor)
+  operator std::invoke_result_t<Fn>() && { return std::move(fn)(); }
+};
+
 // Don't include the tcp_service method definitions if we are
 // testing the static methods.
 #ifndef ECHO_SERVER_STATIC_TEST
-auto tcp_server::initialize(const socket_handle &sock) noexcept
+template <typename Buffers, typename Stats, typename Logging, typename Family,
+          typename Accounting, typename Budget, typename Emulation,
+          typename Scheduling, typename Journal>
+auto basic_tcp_server<Buffers, Stats, Logging, Family, Accounting, Budget,
+                      Emulation, Scheduling, Journal>::initialize(
+    const socket_handle &sock) noexcept -> std::error_code
+{
+  using socket_type = io::socket::native_socket_type;
+  listener_ = static_cast<socket_type>(sock);
+  // Kept for start(), which reports it to whoever started the server.
+  error_ = prepare();
+  return error_;
+}
+
+template <typename Buffers, typename Stats, typename Logging, typename Family,
+          typename Accounting, typename Budget, typename Emulation,
+          typename Scheduling, typename Journal>
+auto basic_tcp_server<Buffers, Stats, Logging, Family, Accounting, Budget,
+                      Emulation, Scheduling, Journal>::prepare() noexcept
     -> std::error_code
 {
+  if (auto error = Family::initialize(listener_))
+    return error;
+
+  int enable = 1;
+  if (options_.reuseport &&
+      setsockopt(listener_, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)))
+  {
+    return {errno, std::system_category()};
+  }
+
+  if (auto error = configure(listener_))
+    return error;
+
+  if (Journal::enabled && !options_.journal.empty())
+  {
+    if (auto error = journal_.open(options_.journal, options_.journal_size,
+                                   options_.journal_segments))
+    {
+      return error;
+    }
+  }
+
+  if (Emulation::enabled && options_.netem.delayed())
+  {
+    if (auto error = emulation_.create(options_.netem))
+      return error;
+  }
+
+  if (Scheduling::enabled)
+  {
+    if (auto error = scheduling_.create())
+      return error;
+  }
+
   return {};
 }
 
-auto tcp_server::stop() noexcept -> void
+template <typename Buffers, typename Stats, typename Logging, typename Family,
+          typename Accounting, typename Budget, typename Emulation,
+          typename Scheduling, typename Journal>
+auto basic_tcp_server<Buffers, Stats, Logging, Family, Accounting, Budget,
+                      Emulation, Scheduling, Journal>::configure(
+    io::socket::native_socket_type sockfd) noexcept -> std::error_code
+{
+  if (options_.fastopen > 0 &&
+      setsockopt(sockfd, IPPROTO_TCP, TCP_FASTOPEN, &options_.fastopen,
+                 sizeof(options_.fastopen)))
+  {
+    return {errno, std::system_category()};
+  }
+
+  if (options_.defer_accept > 0 &&
+      setsockopt(sockfd, IPPROTO_TCP, TCP_DEFER_ACCEPT,
+                 &options_.defer_accept, sizeof(options_.defer_accept)))
+  {
+    return {errno, std::system_category()};
+  }
+
+  return {};
+}
+
+template <typename Buffers, typename Stats, typename Logging, typename Family,
+          typename Accounting, typename Budget, typename Emulation,
+          typename Scheduling, typename Journal>
+auto basic_tcp_server<Buffers, Stats, Logging, Family, Accounting, Budget,
+                      Emulation, Scheduling, Journal>::configure_connection(
+    io::socket::native_socket_type sockfd) noexcept -> void
+{
+  scheduling_.open(sockfd);
+
+  // Pacing is best effort, it needs the fq qdisc or TCP internal pacing.
+  if (options_.pacing_rate > 0)
+  {
+    setsockopt(sockfd, SOL_SOCKET, SO_MAX_PACING_RATE, &options_.pacing_rate,
+               sizeof(options_.pacing_rate));
+  }
+}
+
+template <typename Buffers, typename Stats, typename Logging, typename Family,
+          typename Accounting, typename Budget, typename Emulation,
+          typename Scheduling, typename Journal>
+auto basic_tcp_server<Buffers, Stats, Logging, Family, Accounting, Budget,
+                      Emulation, Scheduling, Journal>::account(
+    io::socket::native_socket_type sockfd, connection &conn) -> void
+{
+  conn.entry = accounting_.open(sockfd, conn.opened, conn.buffer.size());
+}
+
+template <typename Buffers, typename Stats, typename Logging, typename Family,
+          typename Accounting, typename Budget, typename Emulation,
+          typename Scheduling, typename Journal>
+auto basic_tcp_server<Buffers, Stats, Logging, Family, Accounting, Budget,
+                      Emulation, Scheduling, Journal>::park(
+    async_context &ctx, io::socket::native_socket_type sockfd) -> void
+{
+  scheduling_.park(sockfd);
+  ECHO_PROBE(tcp_park, sockfd, scheduling_.parked());
+
+  // A parked connection is released at the end of the loop iteration,
+  // after the connections that are already ready have had their turn.
+  if (scheduling_.wakeups() >= 0 && !drain_timeout_)
+    scheduling_.notify();
+  else
+    release(ctx);
+}
+
+template <typename Buffers, typename Stats, typename Logging, typename Family,
+          typename Accounting, typename Budget, typename Emulation,
+          typename Scheduling, typename Journal>
+auto basic_tcp_server<Buffers, Stats, Logging, Family, Accounting, Budget,
+                      Emulation, Scheduling, Journal>::release(
+    async_context &ctx) -> void
+{
+  auto sockfd = scheduling_.next();
+  if (sockfd < 0)
+    return;
+
+  ECHO_PROBE(tcp_release, sockfd);
+  rearm(ctx, sockfd);
+}
+
+template <typename Buffers, typename Stats, typename Logging, typename Family,
+          typename Accounting, typename Budget, typename Emulation,
+          typename Scheduling, typename Journal>
+auto basic_tcp_server<Buffers, Stats, Logging, Family, Accounting, Budget,
+                      Emulation, Scheduling, Journal>::rearm(
+    async_context &ctx, io::socket::native_socket_type sockfd) -> void
+{
+  if (receives_.size() < static_cast<std::size_t>(sockfd) + 1)
+    receives_.resize(sockfd + 1);
+
+  // Each descriptor allocates its operations once, the first time its
+  // receive is re-armed, and keeps them for the life of the server.
+  auto &state = receives_[sockfd];
+  if (!state)
+    state = std::make_unique<receive_state>();
+
+  // An operation that completes inside start() re-arms the receive through
+  // this loop, so the stack doesn't grow with each echo.
+  if (std::exchange(state->starting, true))
+  {
+    state->again = true;
+    return;
+  }
+
+  state->current ^= 1U;
+  auto &operation = state->operations[state->current];
+  do
+  {
+    state->again = false;
+    auto &conn = *active_[sockfd];
+    operation.emplace(emplace_from{[&] {
+      return stdexec::connect(
+          ctx.scope.nest(io::recvmsg(*conn.socket, conn.rctx->msg, 0)),
+          receiver{.server = this, .ctx = &ctx, .sockfd = sockfd});
+    }});
+    stdexec::start(*operation);
+  } while (state->again && active_[sockfd]);
+  state->starting = false;
+}
+
+template <typename Buffers, typename Stats, typename Logging, typename Family,
+          typename Accounting, typename Budget, typename Emulation,
+          typename Scheduling, typename Journal>
+auto basic_tcp_server<Buffers, Stats, Logging, Family, Accounting, Budget,
+                      Emulation, Scheduling, Journal>::received(
+    async_context &ctx, io::socket::native_socket_type sockfd,
+    std::size_t len) -> void
+{
+  auto &conn = active_[sockfd];
+  if (!conn)
+    return;
+
+  // Copies, because servicing the end of the connection resets it.
+  auto socket = *conn->socket;
+  auto rctx = len ? conn->rctx : nullptr;
+  service(ctx, socket, rctx, std::span(conn->buffer).first(len));
+}
+
+template <typename Buffers, typename Stats, typename Logging, typename Family,
+          typename Accounting, typename Budget, typename Emulation,
+          typename Scheduling, typename Journal>
+auto basic_tcp_server<Buffers, Stats, Logging, Family, Accounting, Budget,
+                      Emulation, Scheduling,
+                      Journal>::start(async_context &ctx) noexcept -> void
+{
+  Base::start(ctx);
+  accounting_.start();
+
+  auto error = error_;
+  if (options_.inherited >= 0 && listener_ >= 0)
+  {
+    // The poller watches the listener by descriptor number, so duplicating
+    // the inherited listener onto it hands over its queued connections.
+    auto inherited = std::exchange(options_.inherited, -1);
+    auto adopted = detail::adopt_socket(inherited, listener_);
+    if (!adopted)
+      adopted = configure(listener_);
+
+    if (adopted)
+    {
+      Logging::warn("Unable to adopt the inherited TCP listener: {}.",
+                    adopted.message());
+      error = adopted;
+    }
+  }
+
+  // The service doesn't say why its listener failed to bind, only that it
+  // isn't listening.
+  if (!error && !detail::serving(listener_))
+    error = std::make_error_code(std::errc::address_not_available);
+
+  if (options_.started)
+    *options_.started = error;
+
+  // Calling listen() again on a listening socket updates its backlog.
+  if (options_.backlog > 0 && listener_ >= 0)
+    listen(listener_, options_.backlog);
+
+  if (options_.handover && options_.handover->receiving())
+    take_over(ctx);
+
+  if (Emulation::enabled && emulation_.start() >= 0)
+  {
+    auto socket = ctx.poller.emplace(socket_handle(emulation_.ticks()));
+    auto rctx = std::make_shared<read_context>();
+    rctx->msg.buffers = rctx->buffer = {emulation_.buffer()};
+    this->submit_recv(ctx, socket, rctx);
+  }
+
+  if (Scheduling::enabled && scheduling_.start() >= 0)
+  {
+    auto socket = ctx.poller.emplace(socket_handle(scheduling_.wakeups()));
+    auto rctx = std::make_shared<read_context>();
+    rctx->msg.buffers = rctx->buffer = {scheduling_.buffer()};
+    this->submit_recv(ctx, socket, rctx);
+  }
+}
+
+template <typename Buffers, typename Stats, typename Logging, typename Family,
+          typename Accounting, typename Budget, typename Emulation,
+          typename Scheduling, typename Journal>
+auto basic_tcp_server<Buffers, Stats, Logging, Family, Accounting, Budget,
+                      Emulation, Scheduling, Journal>::take_over(
+    async_context &ctx) -> void
+{
+  using namespace std::chrono;
+  using clock_duration = detail::wall_clock::duration;
+  auto state = detail::handover::record{};
+  auto count = 0UL;
+
+  for (int sockfd = 0; (sockfd = options_.handover->receive(state)) >= 0;)
+  {
+    if (!budget_.try_acquire(Buffers::size))
+    {
+      ::close(sockfd);
+      continue;
+    }
+
+    if (active_.size() < static_cast<std::size_t>(sockfd) + 1)
+      active_.resize(sockfd + 1);
+
+    auto opened = duration_cast<clock_duration>(nanoseconds(state.opened));
+    auto &conn = active_[sockfd] =
+        connection{.buffer = Buffers::make(),
+                   .opened = detail::wall_clock::time_point(opened),
+                   .bytes = state.bytes,
+                   .peer = state.peer};
+
+    conn->socket = ctx.poller.emplace(socket_handle(sockfd));
+    conn->rctx = std::make_shared<read_context>();
+    conn->rctx->msg.buffers = conn->rctx->buffer = {conn->buffer};
+    configure_connection(sockfd);
+    account(sockfd, *conn);
+    ECHO_PROBE(tcp_open, sockfd);
+    rearm(ctx, sockfd);
+    ++count;
+  }
+
+  Logging::info("Took over {} TCP connections.", count);
+}
+
+template <typename Buffers, typename Stats, typename Logging, typename Family,
+          typename Accounting, typename Budget, typename Emulation,
+          typename Scheduling, typename Journal>
+auto basic_tcp_server<Buffers, Stats, Logging, Family, Accounting, Budget,
+                      Emulation, Scheduling, Journal>::hand_over() noexcept
+    -> void
 {
+  using namespace std::chrono;
   using socket_type = io::socket::native_socket_type;
+  auto &handover = *options_.handover;
+  auto count = 0UL;
+
+  for (socket_type i = 0; i < static_cast<int>(active_.size()); ++i)
+  {
+    // Connections with an echo in flight are drained here instead.
+    auto &conn = active_[i];
+    if (!conn || conn->sending || conn->handed_over)
+      continue;
+
+    auto state = detail::handover::record{
+        .peer = conn->peer,
+        .bytes = conn->bytes,
+        .opened = duration_cast<nanoseconds>(conn->opened.time_since_epoch())
+                      .count()};
+    auto len = static_cast<socklen_t>(sizeof(state.peer));
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    getpeername(i, reinterpret_cast<sockaddr *>(&state.peer), &len);
+
+    if (handover.send(i, state) || detail::handover::detach(i))
+      break;
+
+    conn->handed_over = true;
+    ++count;
+  }
+
+  // The new process accepts new connections from now on.
+  detail::handover::detach(listener_);
+  handover.close();
+  Logging::info("Handed over {} TCP connections.", count);
+}
+
+template <typename Buffers, typename Stats, typename Logging, typename Family,
+          typename Accounting, typename Budget, typename Emulation,
+          typename Scheduling, typename Journal>
+auto basic_tcp_server<Buffers, Stats, Logging, Family, Accounting, Budget,
+                      Emulation, Scheduling, Journal>::stop() noexcept -> void
+{
+  using socket_type = io::socket::native_socket_type;
+
+  if (options_.handover && options_.handover->sending())
+    hand_over();
 
   if (drain_timeout_)
   {
     if (clock::now() >= *drain_timeout_)
     {
-      spdlog::info("Stop requested. Closing TCP connections...");
+      Logging::info("Stop requested. Closing TCP connections...");
       for (socket_type i = 0; i < static_cast<int>(active_.size()); ++i)
       {
         if (active_[i])
+        {
+          ECHO_PROBE(drain_close, i);
           shutdown(i, SHUT_RD);
+        }
       }
     }
   }
   else
   {
-    spdlog::info("Stop requested. Draining TCP connections...");
+    ECHO_PROBE(drain_start, active_.size());
+
+    if (Logging::enabled)
+    {
+      auto stats = detail::read_listen_stats(listener_);
+      Logging::info("TCP listen queue: {}/{} queued, {} overflows, {} drops.",
+                    stats.queued, stats.backlog, stats.overflows, stats.drops);
+    }
+
+    stats_.log("TCP");
+
+    if (Journal::enabled && journal_.failures())
+    {
+      Logging::warn("Unable to create {} TCP journal segments.",
+                    journal_.failures());
+    }
+
+    // Held echoes are sent now, and the emulator stops ticking.
+    if (Emulation::enabled && emulation_)
+    {
+      emulation_.stop();
+      Logging::info("TCP network emulation: {}.", emulation_.summary());
+    }
+
+    // Parked connections are released so that they can drain.
+    scheduling_.stop();
+
+    Logging::info("Stop requested. Draining TCP connections...");
     drain_timeout_ = clock::now() + DRAIN_TIMER;
   }
 }
 
-auto tcp_server::echo(async_context &ctx, const socket_dialog &socket,
-                      const std::shared_ptr<read_context> &rctx,
-                      const socket_message &msg) -> void
+template <typename Buffers, typename Stats, typename Logging, typename Family,
+          typename Accounting, typename Budget, typename Emulation,
+          typename Scheduling, typename Journal>
+auto basic_tcp_server<Buffers, Stats, Logging, Family, Accounting, Budget,
+                      Emulation, Scheduling, Journal>::echo(
+    async_context &ctx, const socket_dialog &socket,
+    const std::shared_ptr<read_context> &rctx, const socket_message &msg)
+    -> void
 {
   using namespace stdexec;
+  using socket_type = io::socket::native_socket_type;
   if (!msg.buffers)
   {
-    submit_recv(ctx, socket, rctx);
+    this->submit_recv(ctx, socket, rctx);
     return;
   }
 
+  auto sockfd = static_cast<socket_type>(*socket.socket);
+  ECHO_PROBE(tcp_send, sockfd);
+  if (auto &conn = active_[sockfd])
+    conn->sending = true;
+
   sender auto sendmsg =
       io::sendmsg(socket, msg, MSG_NOSIGNAL) |
-      then([&, socket, rctx, bufs = msg.buffers](auto &&len) mutable {
+      then([&, socket, rctx, sockfd, bufs = msg.buffers](auto &&len) mutable {
+        ECHO_PROBE(tcp_sent, sockfd, len);
+        auto turn = sent(sockfd, len);
         if (bufs += len; bufs)
+        {
+          ECHO_PROBE(tcp_partial, sockfd, len);
           // NOLINTNEXTLINE(readability-avoid-return-with-void-value)
           return echo(ctx, socket, rctx, {.buffers = bufs});
+        }
 
-        submit_recv(ctx, socket, rctx);
+        finish(ctx, sockfd, turn);
       }) |
       upon_error([](auto &&error) {}); // GCOVR_EXCL_LINE
 
   ctx.scope.spawn(std::move(sendmsg));
 }
 
-auto tcp_server::service(async_context &ctx, const socket_dialog &socket,
-                         const std::shared_ptr<read_context> &rctx,
-                         std::span<const std::byte> buf) -> void
+template <typename Buffers, typename Stats, typename Logging, typename Family,
+          typename Accounting, typename Budget, typename Emulation,
+          typename Scheduling, typename Journal>
+auto basic_tcp_server<Buffers, Stats, Logging, Family, Accounting, Budget,
+                      Emulation, Scheduling, Journal>::sent(
+    io::socket::native_socket_type sockfd, std::size_t len) noexcept -> bool
+{
+  auto &conn = active_[sockfd];
+  if (!conn)
+    return true;
+
+  conn->bytes += len;
+  accounting_.sent(conn->entry, len);
+  return scheduling_.charge(sockfd, len);
+}
+
+template <typename Buffers, typename Stats, typename Logging, typename Family,
+          typename Accounting, typename Budget, typename Emulation,
+          typename Scheduling, typename Journal>
+auto basic_tcp_server<Buffers, Stats, Logging, Family, Accounting, Budget,
+                      Emulation, Scheduling, Journal>::finish(
+    async_context &ctx, io::socket::native_socket_type sockfd, bool turn)
+    -> void
+{
+  auto &conn = active_[sockfd];
+  if (!conn)
+    return;
+
+  conn->sending = false;
+  if (Stats::enabled && options_.timestamps)
+    stats_.processing(conn->dispatched);
+
+  if (!turn)
+  {
+    park(ctx, sockfd);
+    return;
+  }
+
+  // A connection that goes idle within its deficit starts afresh, one
+  // that still has input queued carries on with what is left of it.
+  scheduling_.idle(sockfd);
+  rearm(ctx, sockfd);
+}
+
+template <typename Buffers, typename Stats, typename Logging, typename Family,
+          typename Accounting, typename Budget, typename Emulation,
+          typename Scheduling, typename Journal>
+auto basic_tcp_server<Buffers, Stats, Logging, Family, Accounting, Budget,
+                      Emulation, Scheduling, Journal>::hold(
+    io::socket::native_socket_type sockfd, std::span<const std::byte> buf)
+    -> bool
+{
+  auto id = static_cast<std::uint32_t>(sockfd);
+  if (!emulation_.hold(id, false))
+    return false;
+
+  emulation_.held(id) = buf;
+  auto &conn = *active_[sockfd];
+  // Held echoes are drained rather than handed over.
+  conn.sending = true;
+  accounting_.received(conn.entry, buf.size());
+
+  ECHO_PROBE(tcp_hold, sockfd);
+  return true;
+}
+
+template <typename Buffers, typename Stats, typename Logging, typename Family,
+          typename Accounting, typename Budget, typename Emulation,
+          typename Scheduling, typename Journal>
+auto basic_tcp_server<Buffers, Stats, Logging, Family, Accounting, Budget,
+                      Emulation, Scheduling, Journal>::expire(
+    async_context &ctx, bool all) -> void
+{
+  for (auto id : emulation_.expire(all))
+  {
+    auto &&held = emulation_.held(id);
+    auto &conn = active_[id];
+    if (!conn || held.empty())
+      continue;
+
+    auto bytes = std::exchange(held, {});
+    echo(ctx, *conn->socket, conn->rctx, {.buffers = bytes});
+  }
+}
+
+template <typename Buffers, typename Stats, typename Logging, typename Family,
+          typename Accounting, typename Budget, typename Emulation,
+          typename Scheduling, typename Journal>
+auto basic_tcp_server<Buffers, Stats, Logging, Family, Accounting, Budget,
+                      Emulation, Scheduling, Journal>::service(
+    async_context &ctx, const socket_dialog &socket,
+    const std::shared_ptr<read_context> &rctx, std::span<const std::byte> buf)
+    -> void
 {
   using namespace io::socket;
+  using namespace std::chrono;
   auto addrstr = std::array<char, INET6_ADDRSTRLEN + BUFLEN>();
   auto sockfd = static_cast<native_socket_type>(*socket.socket);
 
+  // The tick socket is shut down when the server stops, which sends every
+  // held echo.
+  if (Emulation::enabled && sockfd == emulation_.ticks())
+  {
+    auto stopping = !rctx || drain_timeout_.has_value();
+    expire(ctx, stopping);
+    if (!stopping)
+      this->submit_recv(ctx, socket, rctx);
+    return;
+  }
+
+  // The wakeup socket is shut down when the server stops, which releases
+  // every parked connection.
+  if (Scheduling::enabled && sockfd == scheduling_.wakeups())
+  {
+    scheduling_.clear();
+    if (!rctx || drain_timeout_)
+    {
+      while (scheduling_.parked())
+        release(ctx);
+      return;
+    }
+
+    release(ctx);
+    if (scheduling_.parked())
+      scheduling_.notify();
+    this->submit_recv(ctx, socket, rctx);
+    return;
+  }
+
   if (active_.size() < static_cast<std::size_t>(sockfd) + 1)
   {
     active_.resize(sockfd + 1);
@@ -150,19 +766,130 @@ auto tcp_server::service(async_context &ctx, const socket_dialog &socket,
 
   if (rctx && !active_[sockfd])
   {
-    auto &bufptr = active_[sockfd] = buffer_type(TCP_BUFSIZE);
-    rctx->msg.buffers = rctx->buffer = {*bufptr};
-    spdlog::info("New TCP connection from {}.", getpeername_(socket, addrstr));
+    if (!budget_.try_admit(Buffers::size))
+    {
+      // Existing sessions keep their buffers, new ones are closed.
+      if (!std::exchange(shedding_, true))
+      {
+        Logging::warn("Memory budget {}. Shedding new TCP connections.",
+                      budget_.summary());
+      }
+      ECHO_PROBE(tcp_shed, sockfd);
+      shutdown(sockfd, SHUT_RDWR);
+      this->submit_recv(ctx, socket, rctx);
+      return;
+    }
+
+    if (Budget::enabled && std::exchange(shedding_, false))
+    {
+      Logging::info("Memory budget {}. Accepting new TCP connections.",
+                    budget_.summary());
+    }
+
+    auto &conn = active_[sockfd] =
+        connection{.buffer = Buffers::make(),
+                   .opened = detail::wall_clock::now(),
+                   .socket = socket,
+                   .rctx = rctx};
+    rctx->msg.buffers = rctx->buffer = {conn->buffer};
+    configure_connection(sockfd);
+    account(sockfd, *conn);
+    ECHO_PROBE(tcp_open, sockfd);
+
+    if (Journal::enabled && journal_)
+    {
+      conn->peer = peername_(socket);
+      journal_.append(
+          {.timestamp = static_cast<std::uint64_t>(
+               duration_cast<nanoseconds>(conn->opened.time_since_epoch())
+                   .count()),
+           .connection = static_cast<std::uint32_t>(sockfd),
+           .type = detail::journal_event::OPEN,
+           .peer = conn->peer});
+    }
+    else if (Logging::enabled)
+    {
+      Logging::info("New TCP connection from {}.",
+                    getpeername_(socket, addrstr));
+    }
   }
 
   if (!rctx && active_[sockfd])
   {
+    // A connection that was handed over lives on in the new process.
+    const auto handed_over = active_[sockfd]->handed_over;
+    if (Journal::enabled && journal_ && !handed_over)
+    {
+      const auto &conn = *active_[sockfd];
+      auto now = detail::wall_clock::now();
+      journal_.append(
+          {.timestamp = static_cast<std::uint64_t>(
+               duration_cast<nanoseconds>(now.time_since_epoch()).count()),
+           .bytes = conn.bytes,
+           .duration = static_cast<std::uint64_t>(
+               duration_cast<nanoseconds>(now - conn.opened).count()),
+           .connection = static_cast<std::uint32_t>(sockfd),
+           .type = detail::journal_event::CLOSE,
+           .peer = conn.peer});
+    }
+    else if (Logging::enabled && !handed_over)
+    {
+      Logging::info("End TCP connection from {}.",
+                    getpeername_(socket, addrstr));
+    }
+
+    // The entry closes before the socket, see connection_table.
+    accounting_.close(sockfd);
     active_[sockfd].reset();
-    spdlog::info("End TCP connection from {}.", getpeername_(socket, addrstr));
+    scheduling_.close(sockfd);
+    budget_.release(Buffers::size);
+    ECHO_PROBE(tcp_close, sockfd);
+  }
+
+  ECHO_PROBE(tcp_recv, sockfd, buf.size());
+  accounting_.event();
+  if (Stats::enabled && options_.timestamps && active_[sockfd])
+    active_[sockfd]->dispatched = Stats::now();
+
+  // Each event on a running connection gives a parked one its turn.
+  if (scheduling_.parked())
+    release(ctx);
+
+  // The sender chain is only needed once the socket pushes back.
+  if (auto &conn = active_[sockfd]; conn && !buf.empty())
+  {
+    if (Emulation::enabled && emulation_ && !drain_timeout_ &&
+        hold(sockfd, buf))
+      return;
+
+    auto limit = scheduling_.limit(INLINE_BYTES);
+    auto echoed =
+        echo_inline(sockfd, conn->buffer, buf, limit, options_.coalesce);
+    // Whatever was read is either echoed or still pending.
+    accounting_.received(conn->entry, echoed + buf.size());
+
+    auto turn = sent(sockfd, echoed);
+    if (buf.empty())
+    {
+      finish(ctx, sockfd, turn);
+      return;
+    }
   }
 
   echo(ctx, socket, rctx, {.buffers = buf});
 }
+
+template class basic_tcp_server<>;
+template class basic_tcp_server<heap_buffers<TCP_BUFSIZE>, null_stats,
+                                null_logging, dual_stack, null_accounting,
+                                null_budget>;
+template class basic_tcp_server<heap_buffers<64 * 1024UL>, null_stats>;
+template class basic_tcp_server<heap_buffers<TCP_BUFSIZE>, latency_histograms,
+                                spdlog_logging, ipv6_only>;
+template class basic_tcp_server<heap_buffers<TCP_BUFSIZE>, latency_histograms,
+                                spdlog_logging, dual_stack, live_accounting,
+                                shared_budget, network_emulation,
+                                fair_scheduling, binary_journal>;
 #endif // ECHO_SERVER_STATIC_TEST
 
 } // namespace echo
@@ -0,0 +1,143 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file timer_wheel.cpp
+ * @brief This file defines a hashed timing wheel.
+ */
+#include "echo/detail/timer_wheel.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+namespace echo::detail {
+
+timer_wheel::timer_wheel() : slots_(SLOTS) {}
+
+auto timer_wheel::schedule(std::uint32_t id,
+                           tick_type due) -> std::uint32_t
+{
+  assert(id != NONE && "Timers must have an id.");
+  auto timer = free_;
+  if (timer == NONE)
+  {
+    timer = static_cast<std::uint32_t>(nodes_.size());
+    nodes_.emplace_back();
+  }
+  else
+  {
+    free_ = nodes_[timer].next;
+  }
+
+  due = std::max(due, now_ + 1);
+  nodes_[timer] = {.due = due, .id = id, .next = NONE};
+
+  auto &slot = slots_[due % SLOTS];
+  if (slot.tail == NONE)
+    slot.head = timer;
+  else
+    nodes_[slot.tail].next = timer;
+
+  slot.tail = timer;
+  ++size_;
+  return timer;
+}
+
+auto timer_wheel::expire(std::size_t index, tick_type now,
+                         std::vector<std::uint32_t> &expired) -> void
+{
+  auto &slot = slots_[index];
+  auto timer = std::exchange(slot.head, NONE);
+  slot.tail = NONE;
+
+  while (timer != NONE)
+  {
+    auto &node = nodes_[timer];
+    auto next = std::exchange(node.next, NONE);
+    if (node.due <= now)
+    {
+      expired.push_back(std::exchange(node.id, NONE));
+      node.next = std::exchange(free_, timer);
+      --size_;
+    }
+    else
+    {
+      // Timers that are due on a later rotation stay in order.
+      if (slot.tail == NONE)
+        slot.head = timer;
+      else
+        nodes_[slot.tail].next = timer;
+
+      slot.tail = timer;
+    }
+    timer = next;
+  }
+}
+
+auto timer_wheel::advance(tick_type now,
+                          std::vector<std::uint32_t> &expired) -> void
+{
+  // Every slot is visited at most once, however far the wheel advances.
+  auto last = std::min(now, now_ + SLOTS);
+  for (auto tick = now_ + 1; tick <= last && size_; ++tick)
+    expire(tick % SLOTS, now, expired);
+
+  now_ = std::max(now, now_);
+}
+
+auto timer_wheel::clear(std::vector<std::uint32_t> &expired) -> void
+{
+  auto pending = std::vector<std::pair<tick_type, std::uint32_t>>();
+  pending.reserve(size_);
+  for (auto tick = now_ + 1; tick <= now_ + SLOTS; ++tick)
+  {
+    auto &slot = slots_[tick % SLOTS];
+    for (auto timer = slot.head; timer != NONE; timer = nodes_[timer].next)
+      pending.emplace_back(nodes_[timer].due, timer);
+
+    slot = {};
+  }
+
+  // Timers that are due on the same tick keep the order of their slot.
+  std::ranges::stable_sort(pending, {}, &decltype(pending)::value_type::first);
+  for (auto [due, timer] : pending)
+  {
+    auto &node = nodes_[timer];
+    expired.push_back(std::exchange(node.id, NONE));
+    node.next = std::exchange(free_, timer);
+  }
+  size_ = 0;
+}
+
+auto timer_wheel::id(std::uint32_t timer) const noexcept -> std::uint32_t
+{
+  return timer < nodes_.size() ? nodes_[timer].id : NONE;
+}
+
+auto timer_wheel::swap(std::uint32_t first,
+                       std::uint32_t second) noexcept -> void
+{
+  assert(id(first) != NONE && id(second) != NONE &&
+         "Only pending timers can be swapped.");
+  std::swap(nodes_[first].id, nodes_[second].id);
+}
+
+auto timer_wheel::now() const noexcept -> tick_type { return now_; }
+
+auto timer_wheel::size() const noexcept -> std::size_t { return size_; }
+
+auto timer_wheel::empty() const noexcept -> bool { return size_ == 0; }
+
+} // namespace echo::detail
@@ -0,0 +1,57 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file timestamps.cpp
+ * @brief This file defines helpers for kernel packet timestamps.
+ */
+#include "echo/detail/timestamps.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <linux/sockios.h>
+#include <sys/ioctl.h>
+#include <time.h>
+namespace echo::detail {
+
+auto enable_rx_timestamps(int sockfd) noexcept -> bool
+{
+  // The first SIOCGSTAMPNS turns on SOCK_TIMESTAMP for the socket. It
+  // fails with ENOENT because nothing has been received yet.
+  auto stamp = timespec{};
+  return !ioctl(sockfd, SIOCGSTAMPNS, &stamp) || errno == ENOENT;
+}
+
+auto rx_timestamp(int sockfd) noexcept -> std::optional<wall_clock::time_point>
+{
+  using namespace std::chrono;
+
+  auto stamp = timespec{};
+  if (ioctl(sockfd, SIOCGSTAMPNS, &stamp))
+    return std::nullopt;
+
+  return wall_clock::time_point(duration_cast<wall_clock::duration>(
+      seconds(stamp.tv_sec) + nanoseconds(stamp.tv_nsec)));
+}
+
+auto latency_stats::log(std::string_view name) const -> void
+{
+  if (queueing.count())
+    spdlog::info("{} kernel queueing: {}.", name, queueing.summary());
+
+  if (processing.count())
+    spdlog::info("{} processing: {}.", name, processing.summary());
+}
+} // namespace echo::detail
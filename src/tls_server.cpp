@@ -0,0 +1,428 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file tls_server.cpp
+ * @brief This file defines the TLS echo server.
+ */
+#include "echo/tls_server.hpp"
+
+#include <openssl/core_names.h>
+#include <openssl/crypto.h>
+#include <openssl/err.h>
+#include <openssl/kdf.h>
+#include <openssl/ssl.h>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstring>
+#include <string_view>
+
+#include <linux/tls.h>
+#include <netinet/tcp.h>
+namespace echo {
+// A TLS record carries at most 16 KiB of plaintext plus its framing.
+static constexpr auto TLS_BUFSIZE = 17 * 1024UL;
+
+// TLS 1.3 cipher suite identifiers (RFC 8446 B.4).
+static constexpr auto TLS_AES_128_GCM_SHA256 = 0x1301U;
+static constexpr auto TLS_AES_256_GCM_SHA384 = 0x1302U;
+static constexpr auto TLS_CHACHA20_POLY1305_SHA256 = 0x1303U;
+
+// The TLS 1.3 per-record nonce length.
+static constexpr auto TLS13_IV_LEN = 12UL;
+
+static auto ssl_error_(std::string_view what) -> void
+{
+  auto buf = std::array<char, 256>{};
+  while (auto err = ERR_get_error())
+  {
+    ERR_error_string_n(err, buf.data(), buf.size());
+    spdlog::error("{}: {}", what, buf.data());
+  }
+}
+
+static auto unhex_(std::string_view hex) -> std::vector<unsigned char>
+{
+  auto bytes = std::vector<unsigned char>(hex.size() / 2);
+  for (std::size_t i = 0; i < bytes.size(); ++i)
+  {
+    const auto *first = hex.data() + 2 * i;
+    auto [ptr, err] = std::from_chars(first, first + 2, bytes[i], 16);
+    if (err != std::errc{})
+    {
+      OPENSSL_cleanse(bytes.data(), bytes.size());
+      return {};
+    }
+  }
+  return bytes;
+}
+
+// Captures the application traffic secrets so that they can be
+// installed into the kernel once the handshake completes.
+static auto keylog_(const SSL *ssl, const char *line) -> void
+{
+  auto *secrets = static_cast<tls_server::traffic_secrets *>(
+      SSL_get_app_data(const_cast<SSL *>(ssl)));
+  if (!secrets)
+    return;
+
+  auto entry = std::string_view(line);
+  auto label = entry.substr(0, entry.find(' '));
+  auto secret = entry.substr(entry.rfind(' ') + 1);
+
+  if (label == "CLIENT_TRAFFIC_SECRET_0")
+    secrets->client = unhex_(secret);
+  else if (label == "SERVER_TRAFFIC_SECRET_0")
+    secrets->server = unhex_(secret);
+}
+
+// HKDF-Expand-Label from RFC 8446 Section 7.1 with an empty context.
+static auto expand_label_(const EVP_MD *digest,
+                          std::span<const unsigned char> secret,
+                          std::string_view label,
+                          std::span<unsigned char> out) -> bool
+{
+  static constexpr auto PREFIX = std::string_view("tls13 ");
+
+  auto info = std::vector<unsigned char>();
+  info.push_back(static_cast<unsigned char>(out.size() >> 8));
+  info.push_back(static_cast<unsigned char>(out.size()));
+  info.push_back(static_cast<unsigned char>(PREFIX.size() + label.size()));
+  info.insert(info.end(), PREFIX.begin(), PREFIX.end());
+  info.insert(info.end(), label.begin(), label.end());
+  info.push_back(0);
+
+  auto *pctx = EVP_PKEY_CTX_new_id(EVP_PKEY_HKDF, nullptr);
+  if (!pctx)
+    return false;
+
+  auto len = out.size();
+  auto result =
+      EVP_PKEY_derive_init(pctx) > 0 &&
+      EVP_PKEY_CTX_set_hkdf_mode(pctx, EVP_PKEY_HKDEF_MODE_EXPAND_ONLY) > 0 &&
+      EVP_PKEY_CTX_set_hkdf_md(pctx, digest) > 0 &&
+      EVP_PKEY_CTX_set1_hkdf_key(pctx, secret.data(),
+                                 static_cast<int>(secret.size())) > 0 &&
+      EVP_PKEY_CTX_add1_hkdf_info(pctx, info.data(),
+                                  static_cast<int>(info.size())) > 0 &&
+      EVP_PKEY_derive(pctx, out.data(), &len) > 0 && len == out.size();
+
+  EVP_PKEY_CTX_free(pctx);
+  return result;
+}
+
+template <typename CryptoInfo>
+static auto set_crypto_info_(int sockfd, int direction, unsigned cipher_type,
+                             std::span<const unsigned char> key,
+                             std::span<const unsigned char> ivec) -> bool
+{
+  auto info = CryptoInfo{};
+  info.info.version = TLS_1_3_VERSION;
+  info.info.cipher_type = cipher_type;
+
+  // The kernel splits the TLS 1.3 nonce into an implicit salt and an iv.
+  // ChaCha20-Poly1305 has no salt, and carries the whole nonce in the iv.
+  const auto salt = sizeof(info.salt);
+  std::memcpy(info.salt, ivec.data(), salt);
+  std::memcpy(info.iv, ivec.data() + salt, sizeof(info.iv));
+  std::memcpy(info.key, key.data(), sizeof(info.key));
+
+  auto installed =
+      setsockopt(sockfd, SOL_TLS, direction, &info, sizeof(info)) == 0;
+  OPENSSL_cleanse(&info, sizeof(info));
+  return installed;
+}
+
+// Installs one direction of the record layer into the kernel.
+static auto install_(int sockfd, int direction, const SSL *ssl,
+                     std::span<const unsigned char> secret) -> bool
+{
+  const auto *cipher = SSL_get_current_cipher(ssl);
+  const auto *digest = SSL_CIPHER_get_handshake_digest(cipher);
+  auto ivec = std::array<unsigned char, TLS13_IV_LEN>{};
+  auto key = std::array<unsigned char, TLS_CIPHER_AES_GCM_256_KEY_SIZE>{};
+
+  auto derive = [&](std::size_t keylen) {
+    return expand_label_(digest, secret, "key", std::span(key).first(keylen)) &&
+           expand_label_(digest, secret, "iv", ivec);
+  };
+
+  auto installed = false;
+  switch (SSL_CIPHER_get_protocol_id(cipher))
+  {
+    case TLS_AES_128_GCM_SHA256:
+      installed =
+          derive(TLS_CIPHER_AES_GCM_128_KEY_SIZE) &&
+          set_crypto_info_<tls12_crypto_info_aes_gcm_128>(
+              sockfd, direction, TLS_CIPHER_AES_GCM_128,
+              std::span(key).first(TLS_CIPHER_AES_GCM_128_KEY_SIZE), ivec);
+      break;
+
+    case TLS_AES_256_GCM_SHA384:
+      installed = derive(TLS_CIPHER_AES_GCM_256_KEY_SIZE) &&
+                  set_crypto_info_<tls12_crypto_info_aes_gcm_256>(
+                      sockfd, direction, TLS_CIPHER_AES_GCM_256, key, ivec);
+      break;
+
+    case TLS_CHACHA20_POLY1305_SHA256:
+      installed =
+          derive(TLS_CIPHER_CHACHA20_POLY1305_KEY_SIZE) &&
+          set_crypto_info_<tls12_crypto_info_chacha20_poly1305>(
+              sockfd, direction, TLS_CIPHER_CHACHA20_POLY1305, key, ivec);
+      break;
+
+    default:
+      break;
+  }
+
+  // The kernel keeps its own copy of the key.
+  OPENSSL_cleanse(key.data(), key.size());
+  OPENSSL_cleanse(ivec.data(), ivec.size());
+  return installed;
+}
+
+// Hands the record layer to kernel TLS. This is only possible when the
+// session is TLS 1.3, and no application data records have been
+// buffered in user-space, so that both record sequence numbers are zero.
+static auto offload_(int sockfd, tls_server::session &conn) -> bool
+{
+  auto *ssl = conn.ssl.get();
+  const auto &secrets = *conn.secrets;
+
+  if (SSL_version(ssl) != TLS1_3_VERSION || secrets.client.empty() ||
+      secrets.server.empty() || SSL_has_pending(ssl) ||
+      BIO_ctrl_pending(SSL_get_rbio(ssl)) || BIO_ctrl_pending(SSL_get_wbio(ssl)))
+  {
+    return false;
+  }
+
+  static constexpr auto ULP = std::string_view("tls");
+  if (setsockopt(sockfd, SOL_TCP, TCP_ULP, ULP.data(), ULP.size()))
+    return false;
+
+  if (!install_(sockfd, TLS_TX, ssl, secrets.server) ||
+      !install_(sockfd, TLS_RX, ssl, secrets.client))
+  {
+    // A half-configured record layer can't be recovered.
+    spdlog::warn("Unable to configure kernel TLS on socket {}.", sockfd);
+    shutdown(sockfd, SHUT_RD);
+    return false;
+  }
+  return true;
+}
+
+// Drops the traffic secrets once the handshake is over, whether or not the
+// session was offloaded, so that they don't outlive the handshake.
+static auto drop_secrets_(tls_server::session &conn) noexcept -> void
+{
+  SSL_set_app_data(conn.ssl.get(), nullptr);
+  conn.secrets.reset();
+}
+
+// Moves all ciphertext produced by OpenSSL into the pending buffer.
+static auto flush_(tls_server::session &conn) -> void
+{
+  auto *wbio = SSL_get_wbio(conn.ssl.get());
+  while (auto len = BIO_ctrl_pending(wbio))
+  {
+    auto offset = conn.pending.size();
+    conn.pending.resize(offset + len);
+    BIO_read(wbio, conn.pending.data() + offset, static_cast<int>(len));
+  }
+}
+
+tls_server::traffic_secrets::~traffic_secrets()
+{
+  OPENSSL_cleanse(client.data(), client.size());
+  OPENSSL_cleanse(server.data(), server.size());
+}
+
+auto tls_server::session::ssl_deleter::operator()(SSL *ssl) const noexcept
+    -> void
+{
+  SSL_free(ssl);
+}
+
+auto tls_server::make_context(const char *certificate,
+                              const char *private_key) noexcept -> context_ptr
+{
+  auto context = context_ptr(SSL_CTX_new(TLS_server_method()), SSL_CTX_free);
+  if (!context)
+  {
+    ssl_error_("Unable to create the TLS context");
+    return nullptr;
+  }
+
+  auto *ctx = context.get();
+  if (!SSL_CTX_use_certificate_chain_file(ctx, certificate) ||
+      !SSL_CTX_use_PrivateKey_file(ctx, private_key, SSL_FILETYPE_PEM) ||
+      !SSL_CTX_check_private_key(ctx))
+  {
+    ssl_error_("Unable to load the TLS certificate");
+    return nullptr;
+  }
+
+  SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+  SSL_CTX_set_options(ctx, SSL_OP_NO_RENEGOTIATION);
+  // Session tickets would be sent with the application traffic keys
+  // and advance the record sequence number before the kernel takes over.
+  SSL_CTX_set_num_tickets(ctx, 0);
+  SSL_CTX_set_keylog_callback(ctx, keylog_);
+  return context;
+}
+
+auto tls_server::initialize(const socket_handle &sock) noexcept
+    -> std::error_code
+{
+  return {};
+}
+
+auto tls_server::stop() noexcept -> void
+{
+  using socket_type = io::socket::native_socket_type;
+
+  if (drain_timeout_)
+  {
+    if (clock::now() >= *drain_timeout_)
+    {
+      spdlog::info("Stop requested. Closing TLS connections...");
+      for (socket_type i = 0; i < static_cast<int>(active_.size()); ++i)
+      {
+        if (active_[i])
+          shutdown(i, SHUT_RD);
+      }
+    }
+  }
+  else
+  {
+    spdlog::info("Stop requested. Draining TLS connections...");
+    drain_timeout_ = clock::now() + DRAIN_TIMER;
+  }
+}
+
+auto tls_server::echo(async_context &ctx, const socket_dialog &socket,
+                      const std::shared_ptr<read_context> &rctx,
+                      const socket_message &msg) -> void
+{
+  using namespace stdexec;
+  if (!msg.buffers)
+  {
+    submit_recv(ctx, socket, rctx);
+    return;
+  }
+
+  sender auto sendmsg =
+      io::sendmsg(socket, msg, MSG_NOSIGNAL) |
+      then([&, socket, rctx, bufs = msg.buffers](auto &&len) mutable {
+        if (bufs += len; bufs)
+          // NOLINTNEXTLINE(readability-avoid-return-with-void-value)
+          return echo(ctx, socket, rctx, {.buffers = bufs});
+
+        submit_recv(ctx, socket, rctx);
+      }) |
+      upon_error([](auto &&error) {}); // GCOVR_EXCL_LINE
+
+  ctx.scope.spawn(std::move(sendmsg));
+}
+
+auto tls_server::service(async_context &ctx, const socket_dialog &socket,
+                         const std::shared_ptr<read_context> &rctx,
+                         std::span<const std::byte> buf) -> void
+{
+  using namespace io::socket;
+  auto sockfd = static_cast<native_socket_type>(*socket.socket);
+
+  if (active_.size() < static_cast<std::size_t>(sockfd) + 1)
+  {
+    active_.resize(sockfd + 1);
+  }
+
+  if (rctx && !active_[sockfd])
+  {
+    auto conn = session{.ssl = {SSL_new(context_.get()), {}},
+                        .secrets = std::make_unique<traffic_secrets>(),
+                        .buffer = buffer_type(TLS_BUFSIZE)};
+    if (!conn.ssl)
+    {
+      ssl_error_("Unable to create a TLS session");
+      shutdown(sockfd, SHUT_RD);
+      echo(ctx, socket, rctx, {});
+      return;
+    }
+
+    SSL_set_bio(conn.ssl.get(), BIO_new(BIO_s_mem()), BIO_new(BIO_s_mem()));
+    SSL_set_app_data(conn.ssl.get(), conn.secrets.get());
+    SSL_set_accept_state(conn.ssl.get());
+
+    auto &bufptr = active_[sockfd] = std::move(conn);
+    rctx->msg.buffers = rctx->buffer = {bufptr->buffer};
+    spdlog::debug("New TLS connection on socket {}.", sockfd);
+  }
+
+  if (!rctx && active_[sockfd])
+  {
+    active_[sockfd].reset();
+    spdlog::debug("End TLS connection on socket {}.", sockfd);
+  }
+
+  if (!rctx || active_[sockfd]->offloaded)
+  {
+    // The kernel has already decrypted the record, so this is a plain echo.
+    echo(ctx, socket, rctx, {.buffers = buf});
+    return;
+  }
+
+  auto &conn = *active_[sockfd];
+  auto *ssl = conn.ssl.get();
+  conn.pending.clear();
+  BIO_write(SSL_get_rbio(ssl), buf.data(), static_cast<int>(buf.size()));
+
+  if (!SSL_is_init_finished(ssl))
+  {
+    if (auto ret = SSL_do_handshake(ssl); ret <= 0)
+    {
+      if (SSL_get_error(ssl, ret) != SSL_ERROR_WANT_READ)
+      {
+        ssl_error_("TLS handshake failed");
+        shutdown(sockfd, SHUT_RD);
+        drop_secrets_(conn);
+      }
+    }
+    else
+    {
+      if (!BIO_ctrl_pending(SSL_get_wbio(ssl)) && offload_(sockfd, conn))
+      {
+        conn.offloaded = true;
+        spdlog::debug("Kernel TLS enabled on socket {}.", sockfd);
+      }
+      drop_secrets_(conn);
+    }
+  }
+
+  if (SSL_is_init_finished(ssl) && !conn.offloaded)
+  {
+    auto plaintext = std::array<std::byte, TLS_BUFSIZE>();
+    int len = 0;
+    while ((len = SSL_read(ssl, plaintext.data(), plaintext.size())) > 0)
+      SSL_write(ssl, plaintext.data(), len);
+  }
+
+  flush_(conn);
+  echo(ctx, socket, rctx, {.buffers = std::span(conn.pending)});
+}
+} // namespace echo
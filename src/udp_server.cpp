@@ -18,27 +18,413 @@
  * @brief This file defines the UDP echo server.
  */
 #include "echo/udp_server.hpp"
+#include "echo/detail/activation.hpp"
+#include "echo/detail/probes.hpp"
+
+#include <algorithm>
+#include <array>
+#include <utility>
+
+#include <fcntl.h>
+#include <unistd.h>
 
 namespace echo {
-[[nodiscard]] auto
-udp_server::initialize(const socket_handle &sock) noexcept -> std::error_code
+// The length of a reply address.
+static inline auto
+address_length(const io::socket::socket_address<sockaddr_in6> &address) noexcept
+    -> std::size_t
+{
+  return address->sin6_family == AF_INET ? sizeof(sockaddr_in)
+                                         : sizeof(sockaddr_in6);
+}
+
+// Converts a queued reply address back into a socket address.
+static inline auto to_address(const sockaddr_in6 &addr) noexcept
+    -> io::socket::socket_address<sockaddr_in6>
+{
+  using namespace io::socket;
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+  const auto *ptr = reinterpret_cast<const struct sockaddr *>(&addr);
+  if (addr.sin6_family == AF_INET)
+    return socket_address<sockaddr_in>(ptr);
+
+  return socket_address<sockaddr_in6>(ptr);
+}
+
+template <typename Buffers, typename Stats, typename Logging, typename Family,
+          typename Accounting, typename Budget, typename Emulation,
+          typename Capture>
+auto basic_udp_server<Buffers, Stats, Logging, Family, Accounting, Budget,
+                      Emulation, Capture>::initialize(
+    const socket_handle &sock) noexcept -> std::error_code
+{
+  using socket_type = io::socket::native_socket_type;
+  sockfd_ = static_cast<socket_type>(sock);
+  // Kept for start(), which reports it to whoever started the server.
+  error_ = prepare();
+  return error_;
+}
+
+template <typename Buffers, typename Stats, typename Logging, typename Family,
+          typename Accounting, typename Budget, typename Emulation,
+          typename Capture>
+auto basic_udp_server<Buffers, Stats, Logging, Family, Accounting, Budget,
+                      Emulation, Capture>::prepare() noexcept
+    -> std::error_code
 {
+  if (auto error = Family::initialize(sockfd_))
+    return error;
+
+  int enable = 1;
+  if (options_.reuseport &&
+      setsockopt(sockfd_, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)))
+  {
+    return {errno, std::system_category()};
+  }
+
+  if (Stats::enabled && options_.timestamps &&
+      !detail::enable_rx_timestamps(sockfd_))
+  {
+    return {errno, std::system_category()};
+  }
+
+  // The receive buffer handles one reply, the pools handle the rest.
+  auto depth = std::max<std::size_t>(options_.depth, 1);
+  auto large = RECVSIZE > Buffers::size ? options_.large : 0;
+  auto bytes = (depth - 1 + options_.retries) * Buffers::size +
+               (large + 1) * RECVSIZE;
+  if (!budget_.try_acquire(bytes))
+    return std::make_error_code(std::errc::not_enough_memory);
+
+  charged_ = bytes;
+  pool_ = detail::buffer_pool(depth - 1, Buffers::size);
+  large_pool_ = detail::buffer_pool(large, RECVSIZE);
+  retry_ = detail::retry_queue(options_.retries, Buffers::size);
+
+  if (Capture::enabled && !options_.capture.empty())
+  {
+    if (auto error = capture_.create(options_.capture, options_.capture_size))
+      return error;
+  }
+
+  if (Emulation::enabled && options_.netem)
+  {
+    if (auto error = emulation_.create(options_.netem))
+      return error;
+  }
   return {};
 }
 
-auto udp_server::echo(async_context &ctx, const socket_dialog &socket,
-                      const std::shared_ptr<read_context> &rctx,
-                      const socket_message &msg) -> void
+template <typename Buffers, typename Stats, typename Logging, typename Family,
+          typename Accounting, typename Budget, typename Emulation,
+          typename Capture>
+auto basic_udp_server<Buffers, Stats, Logging, Family, Accounting, Budget,
+                      Emulation, Capture>::start(
+    async_context &ctx) noexcept -> void
+{
+  Base::start(ctx);
+  accounting_.start();
+
+  auto error = error_;
+  if (options_.inherited >= 0 && sockfd_ >= 0)
+  {
+    // The poller watches the socket by descriptor number, so duplicating
+    // the inherited socket onto it hands over its queued datagrams.
+    auto inherited = std::exchange(options_.inherited, -1);
+    auto adopted = detail::adopt_socket(inherited, sockfd_);
+    if (!adopted && Stats::enabled && options_.timestamps &&
+        !detail::enable_rx_timestamps(sockfd_))
+    {
+      adopted = {errno, std::system_category()};
+    }
+
+    if (adopted)
+    {
+      Logging::warn("Unable to adopt the inherited UDP socket: {}.",
+                    adopted.message());
+      error = adopted;
+    }
+  }
+
+  // The service doesn't say why its socket failed to bind, only that it
+  // isn't bound.
+  if (!error && !detail::serving(sockfd_))
+    error = std::make_error_code(std::errc::address_not_available);
+
+  if (options_.started)
+    *options_.started = error;
+
+  if (Emulation::enabled && emulation_.start() >= 0)
+  {
+    auto socket = ctx.poller.emplace(socket_handle(emulation_.ticks()));
+    auto rctx = std::make_shared<read_context>();
+    rctx->msg.buffers = rctx->buffer;
+    this->submit_recv(ctx, socket, rctx);
+  }
+}
+
+template <typename Buffers, typename Stats, typename Logging, typename Family,
+          typename Accounting, typename Budget, typename Emulation,
+          typename Capture>
+auto basic_udp_server<Buffers, Stats, Logging, Family, Accounting, Budget,
+                      Emulation, Capture>::stop() noexcept -> void
+{
+  if (!std::exchange(stopped_, true))
+  {
+    // Held replies are sent now, and the emulator stops ticking.
+    if (Emulation::enabled && emulation_)
+    {
+      expire(true);
+      emulation_.stop();
+      Logging::info("UDP network emulation: {}.", emulation_.summary());
+    }
+
+    if (!flushing_)
+      retry_.flush(sockfd_, drops_);
+
+    stats_.log("UDP");
+    Logging::info("UDP replies: {}.", drops_.summary());
+    Logging::info("UDP datagrams: {} large, {} truncated.", large_,
+                  truncated_);
+    budget_.release(charged_);
+  }
+}
+
+template <typename Buffers, typename Stats, typename Logging, typename Family,
+          typename Accounting, typename Budget, typename Emulation,
+          typename Capture>
+auto basic_udp_server<Buffers, Stats, Logging, Family, Accounting, Budget,
+                      Emulation, Capture>::echo(
+    async_context &ctx, const socket_dialog &socket,
+    const std::shared_ptr<read_context> &rctx,
+    const socket_address<sockaddr_in6> &address,
+    std::span<const std::byte> buf) -> void
+{
+  using namespace stdexec;
+  auto msg = socket_message{.address = {address}, .buffers = buf};
+  sender auto sendmsg =
+      io::sendmsg(socket, msg, MSG_NOSIGNAL) |
+      then([&, socket, rctx, msg,
+            dispatched = dispatched_](auto &&len) mutable {
+        ECHO_PROBE(udp_sent, len);
+        accounting_.sent(len);
+        if (Stats::enabled && options_.timestamps)
+          stats_.processing(dispatched);
+        this->submit_recv(ctx, socket, rctx);
+        flush(ctx, socket);
+      }) |
+      upon_error([&, socket, rctx, address, buf](auto &&error) mutable {
+        // Copy the reply out before the receive buffer is reused.
+        defer(address, buf, detail::error_number(error));
+        this->submit_recv(ctx, socket, rctx);
+      });
+
+  ctx.scope.spawn(std::move(sendmsg));
+}
+
+template <typename Buffers, typename Stats, typename Logging, typename Family,
+          typename Accounting, typename Budget, typename Emulation,
+          typename Capture>
+auto basic_udp_server<Buffers, Stats, Logging, Family, Accounting, Budget,
+                      Emulation, Capture>::reply(
+    async_context &ctx, const socket_dialog &socket,
+    const socket_address<sockaddr_in6> &address, std::span<std::byte> block)
+    -> void
+{
+  using namespace stdexec;
+  auto msg = socket_message{.address = {address},
+                            .buffers = std::span<const std::byte>(block)};
+  sender auto sendmsg =
+      io::sendmsg(socket, msg, MSG_NOSIGNAL) |
+      then([&, socket, block, msg,
+            dispatched = dispatched_](auto &&len) mutable {
+        ECHO_PROBE(udp_sent, len);
+        accounting_.sent(len);
+        if (Stats::enabled && options_.timestamps)
+          stats_.processing(dispatched);
+        recycle(block);
+        flush(ctx, socket);
+      }) |
+      upon_error([&, address, block](auto &&error) mutable {
+        defer(address, block, detail::error_number(error));
+        recycle(block);
+      });
+
+  ctx.scope.spawn(std::move(sendmsg));
+}
+
+template <typename Buffers, typename Stats, typename Logging, typename Family,
+          typename Accounting, typename Budget, typename Emulation,
+          typename Capture>
+auto basic_udp_server<Buffers, Stats, Logging, Family, Accounting, Budget,
+                      Emulation, Capture>::recycle(
+    std::span<std::byte> block) noexcept -> void
+{
+  // Replies are trimmed to the datagram, which only fits in one pool.
+  if (block.size() > Buffers::size)
+    large_pool_.release(block);
+  else
+    pool_.release(block);
+}
+
+template <typename Buffers, typename Stats, typename Logging, typename Family,
+          typename Accounting, typename Budget, typename Emulation,
+          typename Capture>
+auto basic_udp_server<Buffers, Stats, Logging, Family, Accounting, Budget,
+                      Emulation, Capture>::defer(
+    socket_address<sockaddr_in6> address, std::span<const std::byte> buf,
+    int error) -> void
+{
+  const auto *ptr =
+      // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+      reinterpret_cast<const std::byte *>(std::ranges::data(address));
+
+  if (detail::is_retryable(error) &&
+      retry_.push({ptr, address_length(address)}, buf))
+  {
+    backpressure_ = error;
+    ++drops_.queued;
+    ECHO_PROBE(udp_queued, retry_.size());
+    return;
+  }
+
+  drops_.drop(error);
+  ECHO_PROBE(udp_drop, error);
+}
+
+template <typename Buffers, typename Stats, typename Logging, typename Family,
+          typename Accounting, typename Budget, typename Emulation,
+          typename Capture>
+auto basic_udp_server<Buffers, Stats, Logging, Family, Accounting, Budget,
+                      Emulation, Capture>::flush(
+    async_context &ctx, const socket_dialog &socket) -> void
 {
   using namespace stdexec;
-  sender auto sendmsg = io::sendmsg(socket, msg, MSG_NOSIGNAL) |
-                        then([&, socket, rctx, msg](auto &&len) mutable {
-                          submit_recv(ctx, socket, rctx);
-                        }) |
-                        upon_error([](auto &&error) {}); // GCOVR_EXCL_LINE
+  if (flushing_ || retry_.empty())
+    return;
+
+  retry_.flush(sockfd_, drops_);
+  if (retry_.empty())
+    return;
+
+  flushing_ = true;
+  const auto &front = retry_.front();
+  auto msg = socket_message{.address = {to_address(front.address)},
+                            .buffers = front.payload};
+  sender auto sendmsg =
+      io::sendmsg(socket, msg, MSG_NOSIGNAL) |
+      then([&, socket, msg](auto &&len) mutable {
+        flushing_ = false;
+        retry_.pop();
+        ++drops_.retried;
+        flush(ctx, socket);
+      }) |
+      upon_error([&](auto &&error) {
+        // Retryable errors leave the reply queued for the next event.
+        flushing_ = false;
+        if (auto errnum = detail::error_number(error);
+            !detail::is_retryable(errnum))
+        {
+          drops_.drop(errnum);
+          retry_.pop();
+        }
+      });
 
   ctx.scope.spawn(std::move(sendmsg));
 }
+
+template <typename Buffers, typename Stats, typename Logging, typename Family,
+          typename Accounting, typename Budget, typename Emulation,
+          typename Capture>
+auto basic_udp_server<Buffers, Stats, Logging, Family, Accounting, Budget,
+                      Emulation, Capture>::hold(
+    const socket_address<sockaddr_in6> &address,
+    std::span<const std::byte> buf) -> void
+{
+  if (emulation_.lost())
+    return;
+
+  // Payloads keep their capacity, so a steady load doesn't allocate.
+  auto id = emulation_.acquire();
+  auto &&reply = emulation_.held(id);
+  reply.address = address;
+  reply.payload.assign(buf.begin(), buf.end());
+  if (!emulation_.hold(id, true))
+  {
+    emulation_.release(id);
+    drops_.drop(ENOBUFS);
+    ECHO_PROBE(udp_drop, ENOBUFS);
+    return;
+  }
+  ECHO_PROBE(udp_hold, emulation_.size());
+}
+
+template <typename Buffers, typename Stats, typename Logging, typename Family,
+          typename Accounting, typename Budget, typename Emulation,
+          typename Capture>
+auto basic_udp_server<Buffers, Stats, Logging, Family, Accounting, Budget,
+                      Emulation, Capture>::expire(bool all)
+    -> void
+{
+  // Due replies are sent in batches, like the retry queue.
+  constexpr auto BATCH = detail::retry_queue::BATCH;
+  auto due = emulation_.expire(all);
+
+  if (!flushing_ && !retry_.empty())
+    retry_.flush(sockfd_, drops_);
+
+  for (auto first = 0UL; first < due.size(); first += BATCH)
+  {
+    auto count = std::min(BATCH, due.size() - first);
+    auto msgs = std::array<mmsghdr, BATCH>{};
+    auto iovs = std::array<iovec, BATCH>{};
+    for (auto i = 0UL; i < count; ++i)
+    {
+      auto &&reply = emulation_.held(due[first + i]);
+      iovs[i] = {.iov_base = reply.payload.data(),
+                 .iov_len = reply.payload.size()};
+      msgs[i].msg_hdr.msg_name = std::ranges::data(reply.address);
+      msgs[i].msg_hdr.msg_namelen = address_length(reply.address);
+      msgs[i].msg_hdr.msg_iov = &iovs[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    // Replies stay in order behind the ones waiting to be retried.
+    auto next = 0UL;
+    while (next < count && retry_.empty())
+    {
+      auto len = sendmmsg(sockfd_, msgs.data() + next,
+                          static_cast<unsigned>(count - next),
+                          MSG_DONTWAIT | MSG_NOSIGNAL);
+      if (len < 0)
+      {
+        auto &&reply = emulation_.held(due[first + next++]);
+        defer(reply.address, reply.payload, errno);
+        continue;
+      }
+
+      for (auto i = next; i < next + len; ++i)
+      {
+        auto size = emulation_.held(due[first + i]).payload.size();
+        ECHO_PROBE(udp_sent, size);
+        accounting_.sent(size);
+      }
+      next += len;
+    }
+
+    for (auto i = 0UL; i < count; ++i)
+    {
+      auto id = due[first + i];
+      auto &&reply = emulation_.held(id);
+      if (i >= next)
+        defer(reply.address, reply.payload, backpressure_);
+
+      reply.payload.clear();
+      emulation_.release(id);
+    }
+  }
+}
+
 /**
  * @brief Receives the bytes emitted by the service_base reader.
  * @param ctx The asynchronous context of the message.
@@ -46,22 +432,110 @@ auto udp_server::echo(async_context &ctx, const socket_dialog &socket,
  * @param rctx The read context that manages the read buffer lifetime.
  * @param buf The bytes that were read from the socket.
  */
-auto udp_server::service(async_context &ctx, const socket_dialog &socket,
-                         const std::shared_ptr<read_context> &rctx,
-                         std::span<const std::byte> buf) -> void
+template <typename Buffers, typename Stats, typename Logging, typename Family,
+          typename Accounting, typename Budget, typename Emulation,
+          typename Capture>
+auto basic_udp_server<Buffers, Stats, Logging, Family, Accounting, Budget,
+                      Emulation, Capture>::service(
+    async_context &ctx, const socket_dialog &socket,
+    const std::shared_ptr<read_context> &rctx, std::span<const std::byte> buf)
+    -> void
 {
   using namespace io::socket;
   if (!rctx)
     return;
 
+  // The tick socket is left unarmed once the server stops.
+  if (Emulation::enabled &&
+      static_cast<native_socket_type>(*socket.socket) == emulation_.ticks())
+  {
+    if (!stopped_)
+    {
+      expire(false);
+      this->submit_recv(ctx, socket, rctx);
+    }
+    return;
+  }
+
+  ECHO_PROBE(udp_recv, buf.size());
+  accounting_.event();
+  accounting_.received(buf.size());
+
+  if (rctx->msg.flags & MSG_TRUNC)
+  {
+    // Only payloads beyond the IP limits, like IPv6 jumbograms, get here.
+    // An echo of part of the datagram would be wrong, so it is dropped.
+    ++truncated_;
+    ECHO_PROBE(udp_truncated, buf.size());
+    this->submit_recv(ctx, socket, rctx);
+    return;
+  }
+
+  if (Stats::enabled && options_.timestamps)
+  {
+    dispatched_ = Stats::now();
+    if (auto arrived = detail::rx_timestamp(sockfd_))
+      stats_.queueing(*arrived, dispatched_);
+  }
+
   auto address = *rctx->msg.address;
-  if (address->sin6_family == AF_INET)
+  if (Capture::enabled && capture_)
   {
     const auto *ptr =
         // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-        reinterpret_cast<struct sockaddr *>(std::ranges::data(address));
-    address = socket_address<sockaddr_in>(ptr);
+        reinterpret_cast<const std::byte *>(std::ranges::data(address));
+    capture_.record({ptr, sizeof(sockaddr_in6)}, buf);
+  }
+
+  auto reply_to = Family::reply_address(address);
+  flush(ctx, socket);
+  if (Emulation::enabled && emulation_ && !stopped_)
+  {
+    hold(reply_to, buf);
+    this->submit_recv(ctx, socket, rctx);
+    return;
+  }
+
+  if (!retry_.empty())
+  {
+    // Keep replies in order behind the ones waiting to be retried.
+    defer(reply_to, buf, backpressure_);
+    this->submit_recv(ctx, socket, rctx);
+    return;
   }
-  echo(ctx, socket, rctx, {.address = {address}, .buffers = buf});
+
+  auto large = buf.size() > Buffers::size;
+  if (large)
+  {
+    ++large_;
+    ECHO_PROBE(udp_large, buf.size());
+  }
+
+  // Large replies can't be queued for a retry, so they are dropped under
+  // backpressure and counted against the errno.
+  auto &pool = large ? large_pool_ : pool_;
+  if (auto block = pool.acquire(); !block.empty())
+  {
+    std::ranges::copy(buf, block.begin());
+    // Re-arm the receive before replying so that the next datagram is read
+    // while this reply is still in flight.
+    this->submit_recv(ctx, socket, rctx);
+    reply(ctx, socket, reply_to, block.first(buf.size()));
+    return;
+  }
+
+  echo(ctx, socket, rctx, reply_to, buf);
 }
+
+template class basic_udp_server<>;
+template class basic_udp_server<heap_buffers<UDP_BUFSIZE>, null_stats,
+                                null_logging, dual_stack, null_accounting,
+                                null_budget>;
+template class basic_udp_server<heap_buffers<64 * 1024UL>, null_stats>;
+template class basic_udp_server<heap_buffers<UDP_BUFSIZE>, latency_histograms,
+                                spdlog_logging, ipv6_only>;
+template class basic_udp_server<heap_buffers<UDP_BUFSIZE>, latency_histograms,
+                                spdlog_logging, dual_stack, live_accounting,
+                                shared_budget, network_emulation,
+                                datagram_capture>;
 } // namespace echo
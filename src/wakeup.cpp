@@ -0,0 +1,85 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file wakeup.cpp
+ * @brief This file defines a socket that an event loop posts wakeups to
+ * itself on.
+ */
+#include "echo/detail/wakeup.hpp"
+
+#include <cerrno>
+#include <cstddef>
+#include <utility>
+
+#include <sys/socket.h>
+#include <unistd.h>
+namespace echo::detail {
+
+wakeup::wakeup(wakeup &&other) noexcept
+    : sockets_{std::exchange(other.sockets_, {-1, -1})},
+      pending_{std::exchange(other.pending_, false)}
+{}
+
+auto wakeup::operator=(wakeup &&other) noexcept -> wakeup &
+{
+  if (this != &other)
+  {
+    close();
+    sockets_ = std::exchange(other.sockets_, {-1, -1});
+    pending_ = std::exchange(other.pending_, false);
+  }
+  return *this;
+}
+
+wakeup::~wakeup() { close(); }
+
+auto wakeup::close() noexcept -> void
+{
+  for (auto &fd : sockets_)
+  {
+    if (fd >= 0)
+      ::close(std::exchange(fd, -1));
+  }
+}
+
+auto wakeup::create(std::error_code &error) noexcept -> wakeup
+{
+  auto waker = wakeup();
+  if (socketpair(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0,
+                 waker.sockets_.data()))
+  {
+    error = {errno, std::system_category()};
+    return {};
+  }
+  return waker;
+}
+
+auto wakeup::notify() noexcept -> void
+{
+  if (std::exchange(pending_, true))
+    return;
+
+  auto byte = std::byte{};
+  if (send(sockets_[1], &byte, sizeof(byte), MSG_DONTWAIT | MSG_NOSIGNAL) < 0)
+    pending_ = false;
+}
+
+auto wakeup::clear() noexcept -> void { pending_ = false; }
+
+auto wakeup::fd() const noexcept -> int { return sockets_[0]; }
+
+wakeup::operator bool() const noexcept { return sockets_[0] >= 0; }
+} // namespace echo::detail
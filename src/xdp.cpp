@@ -0,0 +1,262 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file xdp.cpp
+ * @brief This file defines the XDP programs that steer UDP echo traffic.
+ */
+#include "echo/detail/xdp.hpp"
+#include "echo/detail/bpf.hpp"
+
+#include <algorithm>
+
+#include <arpa/inet.h>
+#include <linux/if_ether.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+
+namespace echo::detail {
+// Frame offsets, for Ethernet without VLAN tags and IPv4 without options.
+static constexpr std::int16_t ETH_TYPE = 12;
+static constexpr std::int16_t IP4 = ETH_HLEN;
+static constexpr std::int16_t IP4_FRAG = IP4 + 6;
+static constexpr std::int16_t IP4_PROTO = IP4 + 9;
+static constexpr std::int16_t IP4_ADDRS = IP4 + 12;
+static constexpr std::int16_t UDP4 = IP4 + 20;
+static constexpr std::int16_t IP6 = ETH_HLEN;
+static constexpr std::int16_t IP6_NEXT = IP6 + 6;
+static constexpr std::int16_t IP6_ADDRS = IP6 + 8;
+static constexpr std::int16_t UDP6 = IP6 + 40;
+static constexpr std::int16_t UDP_HLEN = 8;
+
+// Emits the match for a unicast UDP datagram to port. Expects the packet
+// in R7 and its end in R8, and clobbers R2.
+static auto match_udp(bpf::assembler &as, std::uint16_t port,
+                      bpf::assembler::label ipv4, bpf::assembler::label ipv6,
+                      bpf::assembler::label pass) -> void
+{
+  using namespace bpf;
+  auto is_ipv4 = as.make_label();
+  const auto dport = static_cast<std::int32_t>(htons(port));
+
+  as.mov(R2, R7);
+  as.alu(BPF_ADD, R2, ETH_HLEN);
+  as.jump(BPF_JGT, R2, R8, pass);
+  // Multicast and broadcast frames are left to the kernel.
+  as.load(BPF_B, R2, R7, 0);
+  as.jump(BPF_JSET, R2, 1, pass);
+  as.load(BPF_H, R2, R7, ETH_TYPE);
+  as.jump(BPF_JEQ, R2, htons(ETH_P_IP), is_ipv4);
+  as.jump(BPF_JNE, R2, htons(ETH_P_IPV6), pass);
+
+  as.mov(R2, R7);
+  as.alu(BPF_ADD, R2, UDP6 + UDP_HLEN);
+  as.jump(BPF_JGT, R2, R8, pass);
+  as.load(BPF_B, R2, R7, IP6_NEXT);
+  as.jump(BPF_JNE, R2, IPPROTO_UDP, pass);
+  as.load(BPF_H, R2, R7, UDP6 + 2);
+  as.jump(BPF_JNE, R2, dport, pass);
+  as.jump(ipv6);
+
+  as.bind(is_ipv4);
+  as.mov(R2, R7);
+  as.alu(BPF_ADD, R2, UDP4 + UDP_HLEN);
+  as.jump(BPF_JGT, R2, R8, pass);
+  as.load(BPF_B, R2, R7, IP4);
+  as.jump(BPF_JNE, R2, 0x45, pass);
+  as.load(BPF_B, R2, R7, IP4_PROTO);
+  as.jump(BPF_JNE, R2, IPPROTO_UDP, pass);
+  as.load(BPF_H, R2, R7, IP4_FRAG);
+  as.jump(BPF_JSET, R2, htons(IP_MF | IP_OFFMASK), pass);
+  as.load(BPF_H, R2, R7, UDP4 + 2);
+  as.jump(BPF_JNE, R2, dport, pass);
+  as.jump(ipv4);
+}
+
+auto xsk_redirect_program(std::uint16_t port, int xsks, std::size_t max_len)
+    -> std::vector<bpf_insn>
+{
+  using namespace bpf;
+  auto as = assembler();
+  auto redirect = as.make_label();
+  auto pass = as.make_label();
+
+  as.mov(R6, R1);
+  as.load(BPF_W, R7, R6, offsetof(xdp_md, data));
+  as.load(BPF_W, R8, R6, offsetof(xdp_md, data_end));
+  match_udp(as, port, redirect, redirect, pass);
+
+  as.bind(redirect);
+  // Frames that don't fit in a UMEM frame would be dropped by the socket.
+  as.mov(R2, R7);
+  as.alu(BPF_ADD, R2, static_cast<std::int32_t>(max_len));
+  as.jump(BPF_JLT, R2, R8, pass);
+  // Queues without a socket fall back to XDP_PASS.
+  as.load(BPF_W, R2, R6, offsetof(xdp_md, rx_queue_index));
+  as.load_map(R1, xsks);
+  as.mov(R3, XDP_PASS);
+  as.call(BPF_FUNC_redirect_map);
+  as.exit();
+
+  as.bind(pass);
+  as.mov(R0, XDP_PASS);
+  as.exit();
+  return as.finish();
+}
+
+// Emits a swap of two adjacent fields of the packet in R7. Clobbers R2
+// and R3.
+static auto swap_fields(bpf::assembler &as, std::int16_t offset,
+                        std::int16_t size) -> void
+{
+  using namespace bpf;
+  // Fields are swapped in 32-bit words, with a 16-bit tail.
+  for (std::int16_t off = 0; off < size;)
+  {
+    auto width = static_cast<std::uint8_t>(size - off >= 4 ? BPF_W : BPF_H);
+    auto step = static_cast<std::int16_t>(width == BPF_W ? 4 : 2);
+    auto first = static_cast<std::int16_t>(offset + off);
+    auto second = static_cast<std::int16_t>(first + size);
+    as.load(width, R2, R7, first);
+    as.load(width, R3, R7, second);
+    as.store(width, R7, first, R3);
+    as.store(width, R7, second, R2);
+    off = static_cast<std::int16_t>(off + step);
+  }
+}
+
+auto xdp_reflect_program(std::uint16_t port, int counters)
+    -> std::vector<bpf_insn>
+{
+  using namespace bpf;
+  auto as = assembler();
+  auto ipv4 = as.make_label();
+  auto ipv6 = as.make_label();
+  auto count = as.make_label();
+  auto transmit = as.make_label();
+  auto pass = as.make_label();
+
+  as.mov(R6, R1);
+  as.load(BPF_W, R7, R6, offsetof(xdp_md, data));
+  as.load(BPF_W, R8, R6, offsetof(xdp_md, data_end));
+  match_udp(as, port, ipv4, ipv6, pass);
+
+  // The length for the counters comes from the IP header, because the
+  // verifier doesn't allow arithmetic on the end of the packet.
+  as.bind(ipv6);
+  swap_fields(as, IP6_ADDRS, sizeof(in6_addr));
+  swap_fields(as, UDP6, sizeof(std::uint16_t));
+  as.load(BPF_H, R9, R7, IP6 + 4);
+  as.to_host(R9, 16);
+  as.alu(BPF_ADD, R9, UDP6 - IP6);
+  as.jump(count);
+
+  as.bind(ipv4);
+  swap_fields(as, IP4_ADDRS, sizeof(in_addr));
+  swap_fields(as, UDP4, sizeof(std::uint16_t));
+  as.load(BPF_H, R9, R7, IP4 + 2);
+  as.to_host(R9, 16);
+
+  as.bind(count);
+  swap_fields(as, 0, ETH_ALEN);
+  as.store(BPF_W, R10, -4, 0);
+  as.load_map(R1, counters);
+  as.mov(R2, R10);
+  as.alu(BPF_ADD, R2, -4);
+  as.call(BPF_FUNC_map_lookup_elem);
+  as.jump(BPF_JEQ, R0, 0, transmit);
+  // Per-CPU values are only written by their own CPU.
+  as.load(BPF_DW, R1, R0, offsetof(xdp_counters, packets));
+  as.alu(BPF_ADD, R1, 1);
+  as.store(BPF_DW, R0, offsetof(xdp_counters, packets), R1);
+  as.load(BPF_DW, R1, R0, offsetof(xdp_counters, bytes));
+  as.alu(BPF_ADD, R1, R9);
+  as.store(BPF_DW, R0, offsetof(xdp_counters, bytes), R1);
+
+  as.bind(transmit);
+  as.mov(R0, XDP_TX);
+  as.exit();
+
+  as.bind(pass);
+  as.mov(R0, XDP_PASS);
+  as.exit();
+  return as.finish();
+}
+
+auto read_counters(int counters, std::error_code &error) -> xdp_counters
+{
+  auto values = std::vector<xdp_counters>(bpf::possible_cpus());
+  auto key = std::uint32_t{0};
+  if ((error = bpf::lookup(counters, &key, values.data())))
+    return {};
+
+  auto total = xdp_counters();
+  for (const auto &value : values)
+  {
+    total.packets += value.packets;
+    total.bytes += value.bytes;
+  }
+  return total;
+}
+
+// Swaps two equal-sized fields of a frame.
+static auto swap_fields(std::span<std::byte> frame, std::size_t offset,
+                        std::size_t size) noexcept -> void
+{
+  auto first = frame.subspan(offset, size);
+  std::ranges::swap_ranges(first, frame.subspan(offset + size, size));
+}
+
+auto reflect(std::span<std::byte> frame) noexcept -> bool
+{
+  if (frame.size() < ETH_HLEN)
+    return false;
+
+  auto type = static_cast<std::uint16_t>(
+      std::to_integer<unsigned>(frame[ETH_TYPE]) << 8U |
+      std::to_integer<unsigned>(frame[ETH_TYPE + 1]));
+  auto udp = std::size_t{};
+  if (type == ETH_P_IP)
+  {
+    if (frame.size() < UDP4 + UDP_HLEN || frame[IP4] != std::byte{0x45} ||
+        frame[IP4_PROTO] != std::byte{IPPROTO_UDP})
+    {
+      return false;
+    }
+
+    swap_fields(frame, IP4_ADDRS, sizeof(in_addr));
+    udp = UDP4;
+  }
+  else if (type == ETH_P_IPV6)
+  {
+    if (frame.size() < UDP6 + UDP_HLEN ||
+        frame[IP6_NEXT] != std::byte{IPPROTO_UDP})
+    {
+      return false;
+    }
+
+    swap_fields(frame, IP6_ADDRS, sizeof(in6_addr));
+    udp = UDP6;
+  }
+  else
+  {
+    return false;
+  }
+
+  swap_fields(frame, 0, ETH_ALEN);
+  swap_fields(frame, udp, sizeof(std::uint16_t));
+  return true;
+}
+} // namespace echo::detail
@@ -0,0 +1,227 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file xdp_server.cpp
+ * @brief This file defines the AF_XDP UDP echo server.
+ */
+#include "echo/xdp_server.hpp"
+#include "echo/detail/bpf.hpp"
+#include "echo/detail/xdp.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#include <linux/ethtool.h>
+#include <linux/sockios.h>
+#include <net/if.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace echo {
+// The number of receive queues of an interface. Interfaces that don't
+// report their channels, like loopback, have one.
+static auto queue_count(const std::string &interface) noexcept
+    -> std::uint32_t
+{
+  auto channels = ethtool_channels{};
+  channels.cmd = ETHTOOL_GCHANNELS;
+  auto req = ifreq{};
+  interface.copy(req.ifr_name, IFNAMSIZ - 1);
+  req.ifr_data = reinterpret_cast<char *>(&channels);
+
+  auto sockfd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  auto ok = sockfd >= 0 && ioctl(sockfd, SIOCETHTOOL, &req) == 0;
+  if (sockfd >= 0)
+    ::close(sockfd);
+
+  if (!ok)
+    return 1;
+  return std::max(channels.rx_count + channels.combined_count, 1U);
+}
+
+xdp_server::xdp_server(unsigned short port, options opts) noexcept
+    : port_{port}, options_{std::move(opts)}
+{}
+
+xdp_server::~xdp_server() { stop(); }
+
+auto xdp_server::start() noexcept -> std::error_code
+{
+  auto fail = [&](std::error_code error) {
+    close();
+    return error;
+  };
+
+  auto ifindex = if_nametoindex(options_.interface.c_str());
+  if (ifindex == 0)
+    return {errno, std::system_category()};
+
+  auto error = std::error_code();
+  if (options_.reflect)
+  {
+    counters_ = detail::bpf::create_map(
+        BPF_MAP_TYPE_PERCPU_ARRAY, sizeof(std::uint32_t),
+        sizeof(detail::xdp_counters), 1, error);
+    if (error)
+      return fail(error);
+
+    auto program = detail::xdp_reflect_program(port_, counters_);
+    if ((program_ = detail::bpf::load_xdp(program, error)) < 0)
+      return fail(error);
+
+    link_ = detail::bpf::attach_xdp(program_, ifindex, options_.generic,
+                                    error);
+    return error ? fail(error) : error;
+  }
+
+  auto queues = queue_count(options_.interface);
+  xsks_ = detail::bpf::create_map(BPF_MAP_TYPE_XSKMAP, sizeof(std::uint32_t),
+                                  sizeof(int), queues, error);
+  if (error)
+    return fail(error);
+
+  auto program = detail::xsk_redirect_program(
+      port_, xsks_, detail::xsk_socket::MAX_FRAME);
+  if ((program_ = detail::bpf::load_xdp(program, error)) < 0)
+    return fail(error);
+
+  if ((stop_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) < 0)
+    return fail({errno, std::system_category()});
+
+  sockets_.reserve(queues);
+  for (std::uint32_t queue = 0; queue < queues; ++queue)
+  {
+    auto opts = detail::xsk_options{.ifindex = ifindex,
+                                    .queue = queue,
+                                    .frames = options_.frames,
+                                    .copy = options_.generic};
+    auto sock = detail::xsk_socket::create(opts, error);
+    if (error)
+      return fail(error);
+
+    auto fd = sock.fd();
+    if ((error = detail::bpf::update(xsks_, &queue, &fd)))
+      return fail(error);
+    sockets_.push_back(std::move(sock));
+  }
+
+  for (auto &sock : sockets_)
+    threads_.emplace_back([this, &sock] { serve(sock); });
+
+  // Datagrams are only redirected once every queue has a socket.
+  if ((link_ = detail::bpf::attach_xdp(program_, ifindex, options_.generic,
+                                       error)) < 0)
+  {
+    stop();
+    return error;
+  }
+  return {};
+}
+
+auto xdp_server::stop() noexcept -> void
+{
+  // Detach first, so that datagrams go back to the kernel stack.
+  if (link_ >= 0)
+    ::close(std::exchange(link_, -1));
+
+  if (stop_ >= 0)
+  {
+    auto value = std::uint64_t{1};
+    [[maybe_unused]] auto len = write(stop_, &value, sizeof(value));
+  }
+  threads_.clear();
+
+  if (counters_ >= 0)
+  {
+    auto error = std::error_code();
+    auto totals = counters(error);
+    if (!error)
+    {
+      spdlog::info("XDP echo: {} datagrams, {} bytes.", totals.packets,
+                   totals.bytes);
+    }
+  }
+
+  if (!sockets_.empty())
+  {
+    auto packets = std::uint64_t{};
+    auto bytes = std::uint64_t{};
+    for (const auto &sock : sockets_)
+    {
+      packets += sock.packets();
+      bytes += sock.bytes();
+    }
+    spdlog::info("AF_XDP echo: {} datagrams, {} bytes on {} queues.", packets,
+                 bytes, sockets_.size());
+  }
+  close();
+}
+
+auto xdp_server::queues() const noexcept -> std::size_t
+{
+  return sockets_.size();
+}
+
+auto xdp_server::counters(std::error_code &error) const
+    -> detail::xdp_counters
+{
+  if (counters_ < 0)
+  {
+    error = std::make_error_code(std::errc::bad_file_descriptor);
+    return {};
+  }
+  return detail::read_counters(counters_, error);
+}
+
+auto xdp_server::serve(detail::xsk_socket &sock) const noexcept -> void
+{
+  auto fds = std::array<pollfd, 2>{};
+  fds[0] = {.fd = sock.fd(), .events = POLLIN, .revents = 0};
+  fds[1] = {.fd = stop_, .events = POLLIN, .revents = 0};
+  while (true)
+  {
+    if (poll(fds.data(), fds.size(), -1) < 0 && errno != EINTR)
+      return;
+
+    if (fds[1].revents)
+      return;
+
+    if (fds[0].revents)
+    {
+      // Drain what is there before waiting again.
+      while (sock.echo())
+        ;
+    }
+  }
+}
+
+auto xdp_server::close() noexcept -> void
+{
+  sockets_.clear();
+  for (auto *fd : {&link_, &program_, &xsks_, &counters_, &stop_})
+  {
+    if (*fd >= 0)
+      ::close(std::exchange(*fd, -1));
+  }
+}
+} // namespace echo
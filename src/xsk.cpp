@@ -0,0 +1,261 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Echo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Echo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Echo.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file xsk.cpp
+ * @brief This file defines an AF_XDP socket that echoes UDP datagrams.
+ */
+#include "echo/detail/xsk.hpp"
+#include "echo/detail/xdp.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <utility>
+
+#include <linux/if_xdp.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace echo::detail {
+// Reads an index that the kernel writes.
+static auto acquire(const std::uint32_t *index) noexcept -> std::uint32_t
+{
+  return std::atomic_ref(*const_cast<std::uint32_t *>(index))
+      .load(std::memory_order_acquire);
+}
+
+// Publishes an index that the kernel reads.
+static auto release(std::uint32_t *index, std::uint32_t value) noexcept
+    -> void
+{
+  std::atomic_ref(*index).store(value, std::memory_order_release);
+}
+
+// Returns an entry of a ring.
+template <typename T>
+static auto entry(void *entries, std::uint32_t mask,
+                  std::uint32_t index) noexcept -> T &
+{
+  return static_cast<T *>(entries)[index & mask];
+}
+
+xsk_socket::xsk_socket(xsk_socket &&other) noexcept
+    : fd_{std::exchange(other.fd_, -1)},
+      umem_{std::exchange(other.umem_, {})},
+      fill_{std::exchange(other.fill_, {})},
+      completion_{std::exchange(other.completion_, {})},
+      rx_{std::exchange(other.rx_, {})}, tx_{std::exchange(other.tx_, {})},
+      packets_{std::exchange(other.packets_, 0)},
+      bytes_{std::exchange(other.bytes_, 0)}
+{}
+
+auto xsk_socket::operator=(xsk_socket &&other) noexcept -> xsk_socket &
+{
+  if (this != &other)
+  {
+    close();
+    fd_ = std::exchange(other.fd_, -1);
+    umem_ = std::exchange(other.umem_, {});
+    fill_ = std::exchange(other.fill_, {});
+    completion_ = std::exchange(other.completion_, {});
+    rx_ = std::exchange(other.rx_, {});
+    tx_ = std::exchange(other.tx_, {});
+    packets_ = std::exchange(other.packets_, 0);
+    bytes_ = std::exchange(other.bytes_, 0);
+  }
+  return *this;
+}
+
+xsk_socket::~xsk_socket() { close(); }
+
+auto xsk_socket::create(const xsk_options &options,
+                        std::error_code &error) noexcept -> xsk_socket
+{
+  auto fail = [&] {
+    error = {errno, std::system_category()};
+    return xsk_socket();
+  };
+
+  auto sock = xsk_socket();
+  auto frames = options.frames;
+  if (frames == 0 || (frames & (frames - 1)) != 0)
+  {
+    error = std::make_error_code(std::errc::invalid_argument);
+    return sock;
+  }
+
+  if ((sock.fd_ = socket(AF_XDP, SOCK_RAW | SOCK_CLOEXEC, 0)) < 0)
+    return fail();
+
+  auto size = std::size_t{frames} * FRAME_SIZE;
+  auto *umem = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+  if (umem == MAP_FAILED)
+    return fail();
+  sock.umem_ = {static_cast<std::byte *>(umem), size};
+
+  auto reg = xdp_umem_reg{};
+  reg.addr = reinterpret_cast<std::uintptr_t>(umem);
+  reg.len = size;
+  reg.chunk_size = FRAME_SIZE;
+  if (setsockopt(sock.fd_, SOL_XDP, XDP_UMEM_REG, &reg, sizeof(reg)))
+    return fail();
+
+  for (auto opt : {XDP_UMEM_FILL_RING, XDP_UMEM_COMPLETION_RING, XDP_RX_RING,
+                   XDP_TX_RING})
+  {
+    if (setsockopt(sock.fd_, SOL_XDP, opt, &frames, sizeof(frames)))
+      return fail();
+  }
+
+  auto offsets = xdp_mmap_offsets{};
+  auto len = socklen_t{sizeof(offsets)};
+  if (getsockopt(sock.fd_, SOL_XDP, XDP_MMAP_OFFSETS, &offsets, &len))
+    return fail();
+
+  auto map_ring = [&](ring &r, const xdp_ring_offset &off,
+                      std::size_t entry_size, off_t pgoff) {
+    auto length = off.desc + frames * entry_size;
+    auto *ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, sock.fd_, pgoff);
+    if (ptr == MAP_FAILED)
+      return false;
+
+    auto *base = static_cast<std::byte *>(ptr);
+    r.map = {base, length};
+    r.producer = reinterpret_cast<std::uint32_t *>(base + off.producer);
+    r.consumer = reinterpret_cast<std::uint32_t *>(base + off.consumer);
+    r.flags = reinterpret_cast<std::uint32_t *>(base + off.flags);
+    r.entries = base + off.desc;
+    r.mask = frames - 1;
+    return true;
+  };
+
+  if (!map_ring(sock.fill_, offsets.fr, sizeof(std::uint64_t),
+                XDP_UMEM_PGOFF_FILL_RING) ||
+      !map_ring(sock.completion_, offsets.cr, sizeof(std::uint64_t),
+                XDP_UMEM_PGOFF_COMPLETION_RING) ||
+      !map_ring(sock.rx_, offsets.rx, sizeof(xdp_desc), XDP_PGOFF_RX_RING) ||
+      !map_ring(sock.tx_, offsets.tx, sizeof(xdp_desc), XDP_PGOFF_TX_RING))
+  {
+    return fail();
+  }
+
+  // Every frame starts out on the fill ring.
+  for (std::uint32_t i = 0; i < frames; ++i)
+    entry<std::uint64_t>(sock.fill_.entries, sock.fill_.mask, i) =
+        std::uint64_t{i} * FRAME_SIZE;
+  release(sock.fill_.producer, frames);
+
+  auto addr = sockaddr_xdp{};
+  addr.sxdp_family = AF_XDP;
+  addr.sxdp_flags = XDP_USE_NEED_WAKEUP | (options.copy ? XDP_COPY : 0);
+  addr.sxdp_ifindex = options.ifindex;
+  addr.sxdp_queue_id = options.queue;
+  if (bind(sock.fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)))
+    return fail();
+
+  return sock;
+}
+
+auto xsk_socket::echo() noexcept -> std::size_t
+{
+  reclaim();
+
+  auto rx = *rx_.consumer;
+  auto received = acquire(rx_.producer) - rx;
+  if (received == 0)
+    return 0;
+
+  // The rings are as large as the UMEM, so there is always room for every
+  // frame on the transmit and fill rings.
+  auto tx = *tx_.producer;
+  auto fill = *fill_.producer;
+  for (std::uint32_t i = 0; i < received; ++i)
+  {
+    const auto &desc = entry<xdp_desc>(rx_.entries, rx_.mask, rx + i);
+    if (reflect(umem_.subspan(desc.addr, desc.len)))
+    {
+      entry<xdp_desc>(tx_.entries, tx_.mask, tx++) = desc;
+      ++packets_;
+      bytes_ += desc.len;
+    }
+    else
+    {
+      entry<std::uint64_t>(fill_.entries, fill_.mask, fill++) = desc.addr;
+    }
+  }
+
+  release(rx_.consumer, rx + received);
+  release(fill_.producer, fill);
+  if (tx != *tx_.producer)
+  {
+    release(tx_.producer, tx);
+    // In copy mode, and when the driver asks for it, transmits only start
+    // on a system call.
+    if (acquire(tx_.flags) & XDP_RING_NEED_WAKEUP)
+      sendto(fd_, nullptr, 0, MSG_DONTWAIT, nullptr, 0);
+    reclaim();
+  }
+  return received;
+}
+
+auto xsk_socket::reclaim() noexcept -> void
+{
+  auto head = *completion_.consumer;
+  auto completed = acquire(completion_.producer) - head;
+  if (completed == 0)
+    return;
+
+  auto fill = *fill_.producer;
+  for (std::uint32_t i = 0; i < completed; ++i)
+  {
+    entry<std::uint64_t>(fill_.entries, fill_.mask, fill++) =
+        entry<std::uint64_t>(completion_.entries, completion_.mask, head + i);
+  }
+
+  release(completion_.consumer, head + completed);
+  release(fill_.producer, fill);
+}
+
+auto xsk_socket::fd() const noexcept -> int { return fd_; }
+
+auto xsk_socket::packets() const noexcept -> std::uint64_t
+{
+  return packets_;
+}
+
+auto xsk_socket::bytes() const noexcept -> std::uint64_t { return bytes_; }
+
+xsk_socket::operator bool() const noexcept { return fd_ >= 0; }
+
+auto xsk_socket::close() noexcept -> void
+{
+  for (auto *r : {&fill_, &completion_, &rx_, &tx_})
+  {
+    if (!r->map.empty())
+      munmap(r->map.data(), r->map.size());
+    *r = {};
+  }
+
+  if (fd_ >= 0)
+    ::close(std::exchange(fd_, -1));
+
+  if (!umem_.empty())
+    munmap(umem_.data(), umem_.size());
+  umem_ = {};
+}
+} // namespace echo::detail
@@ -0,0 +1,180 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Cloudbus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cloudbus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with Cloudbus.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// NOLINTBEGIN
+#include "echo/detail/activation.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <string>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+using namespace echo::detail;
+
+static auto bound_socket(int type) -> std::pair<int, unsigned short>
+{
+  auto fd = socket(AF_INET, type, 0);
+  auto addr = sockaddr_in{.sin_family = AF_INET};
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+
+  auto len = socklen_t{sizeof(addr)};
+  getsockname(fd, reinterpret_cast<sockaddr *>(&addr), &len);
+  return {fd, ntohs(addr.sin_port)};
+}
+
+TEST(ActivationTest, NoListenFds)
+{
+  unsetenv("LISTEN_PID");
+  unsetenv("LISTEN_FDS");
+  EXPECT_TRUE(listen_fds().empty());
+}
+
+TEST(ActivationTest, ListenFdsForAnotherProcess)
+{
+  setenv("LISTEN_PID", std::to_string(getpid() + 1).c_str(), 1);
+  setenv("LISTEN_FDS", "1", 1);
+  EXPECT_TRUE(listen_fds().empty());
+  EXPECT_EQ(std::getenv("LISTEN_FDS"), nullptr);
+}
+
+TEST(ActivationTest, ListenFds)
+{
+  auto [tcp, tcp_port] = bound_socket(SOCK_STREAM);
+  auto [udp, udp_port] = bound_socket(SOCK_DGRAM);
+  ASSERT_EQ(listen(tcp, 16), 0);
+  ASSERT_EQ(dup2(tcp, LISTEN_FDS_START), LISTEN_FDS_START);
+  ASSERT_EQ(dup2(udp, LISTEN_FDS_START + 1), LISTEN_FDS_START + 1);
+
+  setenv("LISTEN_PID", std::to_string(getpid()).c_str(), 1);
+  setenv("LISTEN_FDS", "2", 1);
+  auto fds = listen_fds();
+  ASSERT_EQ(fds.size(), 2);
+  EXPECT_EQ(std::getenv("LISTEN_PID"), nullptr);
+  EXPECT_TRUE(fcntl(fds[0], F_GETFD) & FD_CLOEXEC);
+
+  EXPECT_EQ(find_listener(fds, SOCK_STREAM, tcp_port), LISTEN_FDS_START);
+  EXPECT_EQ(find_listener(fds, SOCK_DGRAM, udp_port), LISTEN_FDS_START + 1);
+  EXPECT_EQ(find_listener(fds, SOCK_SEQPACKET, tcp_port), -1);
+
+  for (auto fd : {tcp, udp, LISTEN_FDS_START, LISTEN_FDS_START + 1})
+    close(fd);
+}
+
+TEST(ActivationTest, Sockets)
+{
+  auto [sockfd, port] = bound_socket(SOCK_DGRAM);
+  auto fds = sockets();
+  EXPECT_NE(std::ranges::find(fds, sockfd), fds.end());
+  close(sockfd);
+}
+
+TEST(ActivationTest, ListenerMustBeListening)
+{
+  auto [sockfd, port] = bound_socket(SOCK_STREAM);
+  EXPECT_EQ(find_listener({sockfd}, SOCK_STREAM, port), -1);
+  ASSERT_EQ(listen(sockfd, 16), 0);
+  EXPECT_EQ(find_listener({sockfd}, SOCK_STREAM, port), sockfd);
+  close(sockfd);
+}
+
+TEST(ActivationTest, Serving)
+{
+  auto [listener, port] = bound_socket(SOCK_STREAM);
+  EXPECT_FALSE(serving(listener));
+  ASSERT_EQ(listen(listener, 16), 0);
+  EXPECT_TRUE(serving(listener));
+  close(listener);
+
+  auto [sockfd, other] = bound_socket(SOCK_DGRAM);
+  EXPECT_TRUE(serving(sockfd));
+  close(sockfd);
+
+  auto unbound = socket(AF_INET, SOCK_DGRAM, 0);
+  EXPECT_FALSE(serving(unbound));
+  close(unbound);
+  EXPECT_FALSE(serving(-1));
+}
+
+TEST(ActivationTest, Spawn)
+{
+  auto [sockfd, port] = bound_socket(SOCK_DGRAM);
+  char sh[] = "/bin/sh";
+  char flag[] = "-c";
+  char script[] = "test \"$LISTEN_FDS\" = 1 && test \"$LISTEN_PID\" = $$ && "
+                  "test \"$ECHO_TEST\" = yes && test -S /proc/self/fd/3";
+  char *argv[] = {sh, flag, script, nullptr};
+
+  auto pid = spawn(sh, argv, {sockfd}, {"ECHO_TEST=yes"});
+  ASSERT_GT(pid, 0);
+
+  auto status = 0;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  EXPECT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(WEXITSTATUS(status), 0);
+  close(sockfd);
+}
+
+TEST(ActivationTest, AdoptSocket)
+{
+  auto [inherited, port] = bound_socket(SOCK_DGRAM);
+  auto [sockfd, other] = bound_socket(SOCK_DGRAM);
+
+  ASSERT_FALSE(adopt_socket(inherited, sockfd));
+  EXPECT_EQ(fcntl(inherited, F_GETFD), -1);
+  EXPECT_EQ(find_listener({sockfd}, SOCK_DGRAM, port), sockfd);
+  close(sockfd);
+}
+
+TEST(ActivationTest, NotifyWithoutSocket)
+{
+  unsetenv("NOTIFY_SOCKET");
+  EXPECT_FALSE(notify("READY=1"));
+}
+
+TEST(ActivationTest, NotifyAbstractSocket)
+{
+  auto name = "echo-notify-" + std::to_string(getpid());
+  auto addr = sockaddr_un{.sun_family = AF_UNIX};
+  std::copy(name.begin(), name.end(), addr.sun_path + 1);
+  auto len =
+      static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + 1 + name.size());
+
+  auto sockfd = socket(AF_UNIX, SOCK_DGRAM, 0);
+  ASSERT_EQ(bind(sockfd, reinterpret_cast<sockaddr *>(&addr), len), 0);
+
+  setenv("NOTIFY_SOCKET", ("@" + name).c_str(), 1);
+  EXPECT_FALSE(notify("READY=1"));
+
+  auto buf = std::array<char, 64>{};
+  auto n = recv(sockfd, buf.data(), buf.size(), MSG_DONTWAIT);
+  EXPECT_EQ(std::string(buf.data(), n > 0 ? n : 0), "READY=1");
+
+  setenv("NOTIFY_SOCKET", "relative", 1);
+  EXPECT_EQ(notify("READY=1"), std::errc::invalid_argument);
+  unsetenv("NOTIFY_SOCKET");
+  close(sockfd);
+}
+// NOLINTEND
@@ -0,0 +1,129 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Cloudbus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cloudbus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with Cloudbus.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// NOLINTBEGIN
+#include "echo/detail/admin.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+using namespace echo::detail;
+
+TEST(ConnectionEntryTest, Pending)
+{
+  auto entry = connection_entry();
+  entry.received(100);
+  entry.sent(40);
+  EXPECT_EQ(entry.bytes_in, 100);
+  EXPECT_EQ(entry.bytes_out, 40);
+  EXPECT_EQ(entry.pending, 60);
+
+  entry.sent(60);
+  EXPECT_EQ(entry.pending, 0);
+}
+
+TEST(ConnectionTableTest, OpenAndClose)
+{
+  int fds[2] = {-1, -1};
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+  auto table = connection_table();
+  auto &entry = table.open(fds[0], wall_clock::now(), 4096);
+  entry.received(10);
+  EXPECT_EQ(table.size(), 1);
+
+  auto connections = table.snapshot();
+  ASSERT_EQ(connections.size(), 1);
+  EXPECT_EQ(connections[0].fd, fds[0]);
+  EXPECT_EQ(connections[0].bytes_in, 10);
+  EXPECT_EQ(connections[0].pending, 10);
+  EXPECT_EQ(connections[0].buffer_size, 4096);
+
+  table.close(fds[0]);
+  EXPECT_EQ(table.size(), 0);
+  EXPECT_TRUE(table.snapshot().empty());
+
+  close(fds[0]);
+  close(fds[1]);
+}
+
+TEST(ConnectionTableTest, Shutdown)
+{
+  int fds[2] = {-1, -1};
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+  auto table = connection_table();
+  table.open(fds[0], wall_clock::now(), 4096);
+  EXPECT_FALSE(table.shutdown(fds[1]));
+  EXPECT_TRUE(table.shutdown(fds[0]));
+
+  // The server sees end of file on the connection.
+  char byte = 0;
+  EXPECT_EQ(read(fds[0], &byte, 1), 0);
+
+  table.close(fds[0]);
+  EXPECT_FALSE(table.shutdown(fds[0]));
+
+  close(fds[0]);
+  close(fds[1]);
+}
+
+TEST(AdminSocketTest, Command)
+{
+  auto path = std::string("/tmp/echo-admin-test.sock");
+  auto error = std::error_code();
+  auto admin = admin_socket::create(path, error);
+  ASSERT_FALSE(error) << error.message();
+  ASSERT_TRUE(admin);
+
+  auto server = std::thread([&] {
+    admin.run([](std::string_view line) {
+      return std::string("got ").append(line).append("\n");
+    });
+  });
+
+  auto client = socket(AF_UNIX, SOCK_STREAM, 0);
+  ASSERT_GE(client, 0);
+  auto addr = sockaddr_un{};
+  addr.sun_family = AF_UNIX;
+  path.copy(addr.sun_path, sizeof(addr.sun_path) - 1);
+  ASSERT_EQ(
+      connect(client, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)), 0);
+
+  const auto request = std::string_view("help\n");
+  ASSERT_EQ(write(client, request.data(), request.size()), request.size());
+
+  // The response ends with an empty line.
+  auto response = std::string();
+  char buf[256];
+  while (!response.ends_with("\n\n"))
+  {
+    auto len = read(client, buf, sizeof(buf));
+    ASSERT_GT(len, 0);
+    response.append(buf, len);
+  }
+  EXPECT_EQ(response, "got help\n\n");
+  close(client);
+
+  admin.stop();
+  server.join();
+}
+// NOLINTEND
@@ -0,0 +1,102 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Cloudbus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cloudbus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with Cloudbus.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// NOLINTBEGIN
+#include "echo/detail/arena.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <vector>
+using namespace echo::detail;
+
+TEST(ArenaTest, Create)
+{
+  auto error = std::error_code();
+  auto region = arena::create(1, error);
+  ASSERT_FALSE(error);
+  ASSERT_TRUE(region);
+  EXPECT_EQ(region.size(), arena::HUGEPAGE);
+  EXPECT_EQ(region.used(), 0);
+}
+
+TEST(ArenaTest, AllocateAndReuse)
+{
+  auto error = std::error_code();
+  auto region = arena::create(arena::HUGEPAGE, error);
+  ASSERT_FALSE(error);
+
+  auto *first = region.allocate(4096);
+  auto *second = region.allocate(4000);
+  ASSERT_NE(first, nullptr);
+  ASSERT_NE(second, nullptr);
+  EXPECT_EQ(static_cast<std::byte *>(second) - static_cast<std::byte *>(first),
+            4096);
+  EXPECT_TRUE(region.contains(first));
+  EXPECT_EQ(region.used(), 8192);
+
+  // Freed blocks are reused before the region grows.
+  region.deallocate(first, 4096);
+  EXPECT_EQ(region.allocate(3000), first);
+  EXPECT_EQ(region.used(), 8192);
+
+  // Small blocks are still cache line aligned.
+  auto *small = region.allocate(1);
+  EXPECT_EQ(reinterpret_cast<std::uintptr_t>(small) % arena::MIN_BLOCK, 0);
+}
+
+TEST(ArenaTest, Exhausted)
+{
+  auto error = std::error_code();
+  auto region = arena::create(arena::HUGEPAGE, error);
+  ASSERT_FALSE(error);
+
+  EXPECT_NE(region.allocate(arena::HUGEPAGE), nullptr);
+  EXPECT_EQ(region.allocate(1), nullptr);
+
+  auto empty = arena();
+  EXPECT_FALSE(empty);
+  EXPECT_EQ(empty.allocate(1), nullptr);
+  EXPECT_FALSE(empty.contains(&empty));
+}
+
+TEST(ArenaTest, Allocator)
+{
+  using buffer = std::vector<std::byte, arena_allocator<std::byte>>;
+
+  // Without an arena, buffers come from the heap.
+  auto heap = buffer(4096);
+  auto error = std::error_code();
+  auto region = arena::create(arena::HUGEPAGE, error);
+  ASSERT_FALSE(error);
+  EXPECT_FALSE(region.contains(heap.data()));
+
+  arena::install(&region);
+  {
+    auto buf = buffer(4096);
+    EXPECT_TRUE(region.contains(buf.data()));
+    EXPECT_EQ(region.used(), 4096);
+
+    // A heap buffer is still freed to the heap.
+    heap = buffer();
+  }
+
+  auto reused = buffer(4096);
+  EXPECT_EQ(region.used(), 4096);
+  reused = buffer();
+  arena::install(nullptr);
+}
+// NOLINTEND
@@ -0,0 +1,82 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Cloudbus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cloudbus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with Cloudbus.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+// NOLINTBEGIN
+#include "echo/detail/budget.hpp"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+using namespace echo::detail;
+
+TEST(MemoryBudgetTest, AdmitBelowWatermark)
+{
+  auto budget = memory_budget(1000);
+  EXPECT_TRUE(budget.try_admit(800));
+  EXPECT_TRUE(budget.try_admit(100));
+  EXPECT_FALSE(budget.try_admit(1));
+  EXPECT_EQ(budget.used(), 900);
+  EXPECT_EQ(budget.shed(), 1);
+}
+
+TEST(MemoryBudgetTest, AcquireBelowLimit)
+{
+  auto budget = memory_budget(1000);
+  EXPECT_TRUE(budget.try_admit(900));
+  EXPECT_TRUE(budget.try_acquire(100));
+  EXPECT_FALSE(budget.try_acquire(1));
+  EXPECT_FALSE(budget.try_acquire(2000));
+  EXPECT_EQ(budget.used(), budget.limit());
+  EXPECT_EQ(budget.shed(), 2);
+}
+
+TEST(MemoryBudgetTest, ReleaseAndPeak)
+{
+  auto budget = memory_budget(1000);
+  ASSERT_TRUE(budget.try_admit(500));
+  budget.release(500);
+  EXPECT_EQ(budget.used(), 0);
+  EXPECT_EQ(budget.peak(), 500);
+  EXPECT_TRUE(budget.try_admit(900));
+  EXPECT_EQ(budget.summary(), "900/1000 bytes used, peak 900, 0 shed");
+}
+
+TEST(MemoryBudgetTest, ConcurrentCharges)
+{
+  static constexpr std::size_t THREADS = 4;
+  static constexpr std::size_t CHARGES = 10000;
+  auto budget = memory_budget(THREADS * CHARGES);
+
+  auto threads = std::vector<std::jthread>();
+  for (std::size_t i = 0; i < THREADS; ++i)
+  {
+    threads.emplace_back([&] {
+      for (std::size_t j = 0; j < CHARGES; ++j)
+      {
+        if (budget.try_acquire(1))
+          budget.release(1);
+      }
+    });
+  }
+  threads.clear();
+
+  EXPECT_EQ(budget.used(), 0);
+  EXPECT_EQ(budget.shed(), 0);
+  EXPECT_LE(budget.peak(), THREADS);
+}
+// NOLINTEND
@@ -0,0 +1,66 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Cloudbus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cloudbus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with Cloudbus.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+// NOLINTBEGIN
+#include "echo/detail/buffer_pool.hpp"
+
+#include <gtest/gtest.h>
+
+#include <set>
+using namespace echo::detail;
+
+TEST(BufferPoolTest, EmptyPool)
+{
+  auto pool = buffer_pool();
+  EXPECT_EQ(pool.capacity(), 0);
+  EXPECT_TRUE(pool.acquire().empty());
+}
+
+TEST(BufferPoolTest, AcquireRelease)
+{
+  auto pool = buffer_pool(3, 64);
+  EXPECT_EQ(pool.capacity(), 3);
+  EXPECT_EQ(pool.buffer_size(), 64);
+
+  auto buffers = std::set<std::byte *>();
+  for (int i = 0; i < 3; ++i)
+  {
+    auto buf = pool.acquire();
+    ASSERT_EQ(buf.size(), 64);
+    buffers.insert(buf.data());
+  }
+  EXPECT_EQ(buffers.size(), 3);
+  EXPECT_EQ(pool.available(), 0);
+  EXPECT_TRUE(pool.acquire().empty());
+
+  pool.release({*buffers.begin(), 64});
+  EXPECT_EQ(pool.available(), 1);
+  EXPECT_EQ(pool.acquire().data(), *buffers.begin());
+}
+
+TEST(BufferPoolTest, ReleaseIsLIFO)
+{
+  auto pool = buffer_pool(2, 16);
+  auto first = pool.acquire();
+  auto second = pool.acquire();
+
+  pool.release(first.first(4));
+  pool.release(second);
+  EXPECT_EQ(pool.acquire().data(), second.data());
+  EXPECT_EQ(pool.acquire().data(), first.data());
+}
+// NOLINTEND
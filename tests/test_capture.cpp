@@ -0,0 +1,133 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Cloudbus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cloudbus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with Cloudbus.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// NOLINTBEGIN
+#include "echo/detail/capture.hpp"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <string_view>
+#include <vector>
+
+#include <arpa/inet.h>
+using namespace echo::detail;
+
+class CaptureFileTest : public ::testing::Test {
+protected:
+  auto SetUp() -> void override
+  {
+    path = std::filesystem::temp_directory_path() / "echo_test_capture.bin";
+    addr.sin6_family = AF_INET6;
+    addr.sin6_port = htons(9999);
+    addr.sin6_addr = in6addr_loopback;
+  }
+
+  auto TearDown() -> void override { std::filesystem::remove(path); }
+
+  auto record(capture_file &file, std::string_view payload) -> void
+  {
+    file.record(std::as_bytes(std::span(&addr, 1)),
+                std::as_bytes(std::span(payload)));
+  }
+
+  static auto read_all(const capture_file &file) -> std::vector<std::string>
+  {
+    auto payloads = std::vector<std::string>();
+    for (const auto &rec : file.records())
+    {
+      payloads.emplace_back(
+          reinterpret_cast<const char *>(rec.payload.data()),
+          rec.payload.size());
+    }
+    return payloads;
+  }
+
+  std::filesystem::path path;
+  sockaddr_in6 addr{};
+};
+
+TEST_F(CaptureFileTest, RecordAndRead)
+{
+  auto error = std::error_code();
+  auto file = capture_file::create(path.c_str(), 0, error);
+  ASSERT_FALSE(error);
+  ASSERT_TRUE(file);
+
+  record(file, "hello");
+  record(file, "world");
+
+  auto reader = capture_file::open(path.c_str(), false, error);
+  ASSERT_FALSE(error);
+  EXPECT_EQ(read_all(reader), (std::vector<std::string>{"hello", "world"}));
+
+  for (const auto &rec : reader.records())
+  {
+    EXPECT_EQ(rec.address.sin6_port, htons(9999));
+    EXPECT_GT(rec.timestamp.time_since_epoch().count(), 0);
+  }
+}
+
+TEST_F(CaptureFileTest, EnableAndDisable)
+{
+  auto error = std::error_code();
+  auto file = capture_file::create(path.c_str(), 0, error);
+  ASSERT_TRUE(file);
+
+  auto control = capture_file::open(path.c_str(), true, error);
+  ASSERT_TRUE(control);
+
+  control.enable(false);
+  record(file, "dropped");
+  control.enable(true);
+  record(file, "kept");
+
+  EXPECT_EQ(read_all(file), (std::vector<std::string>{"kept"}));
+}
+
+TEST_F(CaptureFileTest, RingOverwritesOldest)
+{
+  auto error = std::error_code();
+  auto file = capture_file::create(path.c_str(), capture_file::MIN_SIZE, error);
+  ASSERT_TRUE(file);
+
+  auto payload = std::string(1000, 'x');
+  for (int i = 0; i < 1000; ++i)
+  {
+    payload[0] = static_cast<char>('a' + i % 26);
+    record(file, payload);
+  }
+
+  const auto &hdr = file.header();
+  EXPECT_GT(hdr.overwritten, 0);
+  EXPECT_EQ(hdr.count + hdr.overwritten, 1000);
+
+  auto payloads = read_all(file);
+  ASSERT_EQ(payloads.size(), hdr.count);
+  // The newest record is the last one written.
+  EXPECT_EQ(payloads.back()[0], static_cast<char>('a' + 999 % 26));
+  for (std::size_t i = 1; i < payloads.size(); ++i)
+    EXPECT_EQ((payloads[i][0] - payloads[i - 1][0] + 26) % 26, 1);
+}
+
+TEST_F(CaptureFileTest, OpenInvalidFile)
+{
+  auto error = std::error_code();
+  auto file = capture_file::open("/nonexistent", false, error);
+  EXPECT_TRUE(error);
+  EXPECT_FALSE(file);
+}
+// NOLINTEND
@@ -0,0 +1,121 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Cloudbus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cloudbus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with Cloudbus.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// NOLINTBEGIN
+#include "echo/chargen_server.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include <arpa/inet.h>
+using namespace net::service;
+using namespace echo;
+
+TEST(ChargenPatternTest, Lines)
+{
+  auto pattern = chargen_pattern::bytes();
+  ASSERT_EQ(pattern.size(), 2 * chargen_pattern::PERIOD);
+
+  auto text = std::string(reinterpret_cast<const char *>(pattern.data()),
+                          pattern.size());
+  EXPECT_EQ(text.substr(0, chargen_pattern::STRIDE),
+            " !\"#$%&'()*+,-./0123456789:;<=>?@ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+            "[\\]^_`abcdefg\r\n");
+  EXPECT_EQ(text.substr(chargen_pattern::STRIDE, 3), "!\"#");
+
+  // The stream repeats after 95 lines.
+  EXPECT_EQ(text.substr(0, chargen_pattern::PERIOD),
+            text.substr(chargen_pattern::PERIOD));
+}
+
+class ChargenServerTest : public ::testing::Test {};
+
+TEST_F(ChargenServerTest, TCPStream)
+{
+  using namespace io::socket;
+
+  auto service = basic_context_thread<tcp_chargen_server>();
+
+  auto addr = socket_address<sockaddr_in>();
+  addr->sin_family = AF_INET;
+  addr->sin_port = htons(8090);
+
+  service.start(addr);
+  service.state.wait(async_context::PENDING);
+  {
+    using namespace io;
+    auto sock = socket_handle(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    addr->sin_addr.s_addr = inet_addr("127.0.0.1");
+    ASSERT_EQ(connect(sock, addr), 0);
+
+    // Read well past the first period.
+    auto pattern = chargen_pattern::bytes();
+    auto buf = std::array<std::byte, 4096>();
+    std::size_t received = 0;
+    while (received < 3 * chargen_pattern::PERIOD)
+    {
+      auto len = recv(static_cast<int>(sock), buf.data(), buf.size(), 0);
+      ASSERT_GT(len, 0);
+      for (std::size_t i = 0; i < static_cast<std::size_t>(len); ++i)
+      {
+        ASSERT_EQ(buf[i], pattern[(received + i) % chargen_pattern::PERIOD]);
+      }
+      received += len;
+    }
+  }
+
+  service.signal(service.terminate);
+  service.state.wait(async_context::STARTED);
+}
+
+TEST_F(ChargenServerTest, UDPReplies)
+{
+  using namespace io::socket;
+
+  auto service = basic_context_thread<udp_chargen_server>();
+
+  auto addr = socket_address<sockaddr_in>();
+  addr->sin_family = AF_INET;
+  addr->sin_port = htons(8090);
+
+  service.start(addr);
+  service.state.wait(async_context::PENDING);
+  {
+    using namespace io;
+    auto sock = socket_handle(AF_INET, SOCK_DGRAM, 0);
+    addr->sin_addr.s_addr = inet_addr("127.0.0.1");
+    ASSERT_EQ(connect(sock, addr), 0);
+
+    auto pattern = chargen_pattern::bytes();
+    auto buf = std::array<std::byte, 1024>();
+    for (std::size_t i = 0; i < 8; ++i)
+    {
+      ASSERT_EQ(send(static_cast<int>(sock), "x", 1, 0), 1);
+      auto len = recv(static_cast<int>(sock), buf.data(), buf.size(), 0);
+      ASSERT_GE(len, 0);
+      ASSERT_LE(len, udp_chargen_server::MAX_REPLY);
+
+      // Each reply starts on the next line.
+      auto line = pattern.subspan(i * chargen_pattern::STRIDE, len);
+      EXPECT_TRUE(std::equal(line.begin(), line.end(), buf.begin()));
+    }
+  }
+
+  service.signal(service.terminate);
+  service.state.wait(async_context::STARTED);
+}
+// NOLINTEND
@@ -0,0 +1,92 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Cloudbus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cloudbus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with Cloudbus.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// NOLINTBEGIN
+#include "echo/detail/control.hpp"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include <signal.h>
+using namespace echo::detail;
+
+class ControlPlaneTest : public ::testing::Test {
+protected:
+  void SetUp() override
+  {
+    auto error = std::error_code();
+    control = control_plane::create(error);
+    ASSERT_FALSE(error) << error.message();
+    ASSERT_TRUE(control);
+  }
+
+  control_plane control;
+};
+
+TEST(ControlPlaneClosedTest, WaitReturnsStop)
+{
+  auto control = control_plane();
+  EXPECT_FALSE(control);
+  EXPECT_EQ(control.wait(), control_plane::STOP);
+}
+
+TEST_F(ControlPlaneTest, PostWakesWaiter)
+{
+  auto waiter = std::thread([&] {
+    EXPECT_EQ(control.wait(), control_plane::STATS);
+  });
+  control.post(control_plane::STATS);
+  waiter.join();
+}
+
+TEST_F(ControlPlaneTest, PostedCommandsAreReturnedOnce)
+{
+  control.post(control_plane::STOP);
+  control.post(control_plane::TERMINATE);
+  control.post(control_plane::TERMINATE);
+
+  EXPECT_EQ(control.wait(), control_plane::TERMINATE);
+  EXPECT_EQ(control.wait(), control_plane::STOP);
+}
+
+TEST_F(ControlPlaneTest, SignalsAreRead)
+{
+  // The signals are blocked, so they are queued on the signalfd.
+  ASSERT_EQ(kill(getpid(), SIGUSR1), 0);
+  EXPECT_EQ(control.wait(), control_plane::STATS);
+
+  ASSERT_EQ(kill(getpid(), SIGTERM), 0);
+  EXPECT_EQ(control.wait(), control_plane::TERMINATE);
+
+  ASSERT_EQ(kill(getpid(), SIGHUP), 0);
+  EXPECT_EQ(control.wait(), control_plane::TERMINATE);
+
+  ASSERT_EQ(kill(getpid(), SIGUSR2), 0);
+  EXPECT_EQ(control.wait(), control_plane::UPGRADE);
+}
+
+TEST_F(ControlPlaneTest, MoveAssignment)
+{
+  control.post(control_plane::STATS);
+  auto other = control_plane();
+  other = std::move(control);
+
+  EXPECT_FALSE(control);
+  ASSERT_TRUE(other);
+  EXPECT_EQ(other.wait(), control_plane::STATS);
+}
+// NOLINTEND
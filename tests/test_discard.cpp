@@ -0,0 +1,120 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Cloudbus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cloudbus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with Cloudbus.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// NOLINTBEGIN
+#include "echo/discard_server.hpp"
+
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>
+#include <poll.h>
+using namespace net::service;
+using namespace echo;
+
+class DiscardServerTest : public ::testing::Test {};
+
+TEST_F(DiscardServerTest, TCPDiscard)
+{
+  using namespace io::socket;
+
+  auto service = basic_context_thread<tcp_discard_server>();
+
+  auto addr = socket_address<sockaddr_in>();
+  addr->sin_family = AF_INET;
+  addr->sin_port = htons(8091);
+
+  service.start(addr);
+  service.state.wait(async_context::PENDING);
+  {
+    using namespace io;
+    auto sock = socket_handle(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    addr->sin_addr.s_addr = inet_addr("127.0.0.1");
+    ASSERT_EQ(connect(sock, addr), 0);
+
+    // Much more than the receive buffer is drained without a reply.
+    auto buf = std::vector<char>(1024 * 1024, 'x');
+    for (int i = 0; i < 16; ++i)
+    {
+      ASSERT_EQ(send(static_cast<int>(sock), buf.data(), buf.size(), 0),
+                buf.size());
+    }
+
+    auto pfd = pollfd{.fd = static_cast<int>(sock), .events = POLLIN};
+    EXPECT_EQ(poll(&pfd, 1, 100), 0);
+  }
+
+  service.signal(service.terminate);
+  service.state.wait(async_context::STARTED);
+}
+
+TEST_F(DiscardServerTest, TCPStopClosesConnections)
+{
+  using namespace io::socket;
+
+  auto service = basic_context_thread<tcp_discard_server>();
+
+  auto addr = socket_address<sockaddr_in>();
+  addr->sin_family = AF_INET;
+  addr->sin_port = htons(8091);
+
+  service.start(addr);
+  service.state.wait(async_context::PENDING);
+  {
+    using namespace io;
+    auto sock = socket_handle(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    addr->sin_addr.s_addr = inet_addr("127.0.0.1");
+    ASSERT_EQ(connect(sock, addr), 0);
+    ASSERT_EQ(send(static_cast<int>(sock), "x", 1, 0), 1);
+
+    service.signal(service.terminate);
+    service.state.wait(async_context::STARTED);
+
+    auto buf = 'x';
+    EXPECT_EQ(recv(static_cast<int>(sock), &buf, 1, 0), 0);
+  }
+}
+
+TEST_F(DiscardServerTest, UDPDiscard)
+{
+  using namespace io::socket;
+
+  auto service = basic_context_thread<udp_discard_server>();
+
+  auto addr = socket_address<sockaddr_in>();
+  addr->sin_family = AF_INET;
+  addr->sin_port = htons(8091);
+
+  service.start(addr);
+  service.state.wait(async_context::PENDING);
+  {
+    using namespace io;
+    auto sock = socket_handle(AF_INET, SOCK_DGRAM, 0);
+    addr->sin_addr.s_addr = inet_addr("127.0.0.1");
+    ASSERT_EQ(connect(sock, addr), 0);
+
+    auto buf = std::vector<char>(1400, 'x');
+    for (int i = 0; i < 256; ++i)
+      ASSERT_EQ(send(static_cast<int>(sock), buf.data(), buf.size(), 0),
+                buf.size());
+
+    auto pfd = pollfd{.fd = static_cast<int>(sock), .events = POLLIN};
+    EXPECT_EQ(poll(&pfd, 1, 100), 0);
+  }
+
+  service.signal(service.terminate);
+  service.state.wait(async_context::STARTED);
+}
+// NOLINTEND
@@ -0,0 +1,137 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Cloudbus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cloudbus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with Cloudbus.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// NOLINTBEGIN
+#include "echo/detail/fair_queue.hpp"
+
+#include <gtest/gtest.h>
+using namespace echo::detail;
+
+TEST(FairQueueTest, NoQuantum)
+{
+  auto queue = fair_queue();
+  EXPECT_FALSE(queue);
+  EXPECT_TRUE(queue.charge(3, 1024 * 1024));
+  EXPECT_EQ(queue.next(), -1);
+}
+
+TEST(FairQueueTest, ChargeWithinQuantum)
+{
+  auto queue = fair_queue(1024);
+  EXPECT_TRUE(queue);
+  queue.open(3);
+  EXPECT_EQ(queue.running(), 1);
+  EXPECT_TRUE(queue.charge(3, 512));
+  EXPECT_TRUE(queue.charge(3, 511));
+  EXPECT_FALSE(queue.charge(3, 1));
+}
+
+TEST(FairQueueTest, Idle)
+{
+  auto queue = fair_queue(1024);
+  EXPECT_EQ(queue.quantum(), 1024);
+  queue.open(3);
+
+  // A connection that goes idle after each echo is never parked.
+  for (auto turn = 0; turn < 10; ++turn)
+  {
+    ASSERT_TRUE(queue.charge(3, 512));
+    queue.idle(3);
+  }
+  EXPECT_TRUE(queue.charge(3, 1023));
+  EXPECT_FALSE(queue.charge(3, 1));
+
+  auto none = fair_queue();
+  none.idle(3);
+  EXPECT_TRUE(none.charge(3, 1024 * 1024));
+}
+
+TEST(FairQueueTest, BusyConnectionKeepsItsDeficit)
+{
+  auto queue = fair_queue(1024);
+  queue.open(3);
+
+  // Small echoes with input still queued add up to a quantum.
+  for (auto turn = 0; turn < 3; ++turn)
+    ASSERT_TRUE(queue.charge(3, 256));
+  EXPECT_FALSE(queue.charge(3, 256));
+  queue.park(3);
+
+  // The quantum is added once per round.
+  EXPECT_EQ(queue.next(), 3);
+  EXPECT_TRUE(queue.charge(3, 1023));
+  EXPECT_FALSE(queue.charge(3, 1));
+}
+
+TEST(FairQueueTest, RoundRobin)
+{
+  auto queue = fair_queue(1024);
+  queue.open(3);
+  queue.open(4);
+  queue.open(5);
+
+  ASSERT_FALSE(queue.charge(3, 1024));
+  queue.park(3);
+  ASSERT_FALSE(queue.charge(4, 1024));
+  queue.park(4);
+  EXPECT_EQ(queue.running(), 1);
+  EXPECT_EQ(queue.parked(), 2);
+
+  // Connections are released in the order they were parked.
+  EXPECT_EQ(queue.next(), 3);
+  EXPECT_EQ(queue.next(), 4);
+  EXPECT_EQ(queue.next(), -1);
+  EXPECT_EQ(queue.running(), 3);
+
+  // A released connection gets a full quantum.
+  EXPECT_TRUE(queue.charge(3, 1023));
+  EXPECT_FALSE(queue.charge(3, 1));
+}
+
+TEST(FairQueueTest, OverdrawnDeficit)
+{
+  auto queue = fair_queue(1024);
+  queue.open(3);
+  queue.open(4);
+
+  // An echo of three quanta waits for the small flow to have two turns.
+  ASSERT_FALSE(queue.charge(3, 3 * 1024));
+  queue.park(3);
+  ASSERT_FALSE(queue.charge(4, 1024));
+  queue.park(4);
+
+  EXPECT_EQ(queue.next(), 4);
+  ASSERT_FALSE(queue.charge(4, 1024));
+  queue.park(4);
+  EXPECT_EQ(queue.next(), 4);
+  ASSERT_FALSE(queue.charge(4, 1024));
+  queue.park(4);
+  EXPECT_EQ(queue.next(), 3);
+  EXPECT_TRUE(queue.charge(3, 1023));
+}
+
+TEST(FairQueueTest, Close)
+{
+  auto queue = fair_queue(1024);
+  queue.open(3);
+  queue.close(3);
+  EXPECT_EQ(queue.running(), 0);
+
+  // A reused descriptor starts with a full quantum.
+  queue.open(3);
+  EXPECT_TRUE(queue.charge(3, 1023));
+}
+// NOLINTEND
@@ -0,0 +1,117 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Cloudbus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cloudbus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with Cloudbus.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// NOLINTBEGIN
+#include "echo/detail/handover.hpp"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <thread>
+
+#include <sys/socket.h>
+#include <unistd.h>
+using namespace echo::detail;
+
+class HandoverTest : public ::testing::Test {
+protected:
+  void SetUp() override
+  {
+    auto channel = std::array<int, 2>{};
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, channel.data()), 0);
+    receiver.receive_from(channel[1]);
+    outgoing = channel[0];
+  }
+
+  handover sender;
+  handover receiver;
+  int outgoing = -1;
+};
+
+TEST_F(HandoverTest, NotConnected)
+{
+  auto unused = handover();
+  auto state = handover::record{};
+  EXPECT_FALSE(unused.sending());
+  EXPECT_FALSE(unused.receiving());
+  EXPECT_EQ(unused.receive(state), -1);
+}
+
+TEST_F(HandoverTest, HandsOverConnections)
+{
+  auto pair = std::array<int, 2>{};
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, pair.data()), 0);
+
+  auto old = std::thread([&] {
+    ASSERT_FALSE(sender.send_to(outgoing));
+    ASSERT_TRUE(sender.sending());
+
+    auto state = handover::record{.bytes = 42, .opened = 7};
+    state.peer.sin6_port = htons(9);
+    EXPECT_FALSE(sender.send(pair[0], state));
+    sender.close();
+  });
+
+  ASSERT_TRUE(receiver.receiving());
+  auto state = handover::record{};
+  auto sockfd = receiver.receive(state);
+  ASSERT_GE(sockfd, 0);
+  EXPECT_EQ(state.bytes, 42);
+  EXPECT_EQ(state.opened, 7);
+  EXPECT_EQ(ntohs(state.peer.sin6_port), 9);
+
+  // The received socket is the same connection.
+  auto data = 'a';
+  auto buf = 'x';
+  ASSERT_EQ(write(pair[1], &data, 1), 1);
+  ASSERT_EQ(read(sockfd, &buf, 1), 1);
+  EXPECT_EQ(buf, data);
+
+  EXPECT_EQ(receiver.receive(state), -1);
+  EXPECT_FALSE(receiver.receiving());
+
+  old.join();
+  for (auto fd : {sockfd, pair[0], pair[1]})
+    close(fd);
+}
+
+TEST_F(HandoverTest, NewProcessExits)
+{
+  receiver.close();
+  EXPECT_TRUE(sender.send_to(outgoing));
+  EXPECT_FALSE(sender.sending());
+}
+
+TEST_F(HandoverTest, Detach)
+{
+  auto pair = std::array<int, 2>{};
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, pair.data()), 0);
+  auto copy = dup(pair[0]);
+
+  ASSERT_FALSE(handover::detach(pair[0]));
+
+  // The descriptor now reads end-of-file, while the connection is still
+  // open through its other descriptor.
+  auto buf = 'x';
+  EXPECT_EQ(read(pair[0], &buf, 1), 0);
+  ASSERT_EQ(write(pair[1], "a", 1), 1);
+  ASSERT_EQ(read(copy, &buf, 1), 1);
+  EXPECT_EQ(buf, 'a');
+
+  for (auto fd : {copy, pair[0], pair[1]})
+    close(fd);
+}
+// NOLINTEND
@@ -0,0 +1,59 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Cloudbus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cloudbus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with Cloudbus.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// NOLINTBEGIN
+#include "echo/detail/histogram.hpp"
+
+#include <gtest/gtest.h>
+using namespace echo::detail;
+using namespace std::chrono_literals;
+
+TEST(HistogramTest, EmptyHistogram)
+{
+  auto hist = histogram();
+  EXPECT_EQ(hist.count(), 0);
+  EXPECT_EQ(hist.percentile(99), 0ns);
+}
+
+TEST(HistogramTest, RecordBuckets)
+{
+  auto hist = histogram();
+  hist.record(0ns);
+  hist.record(-5ns);
+  hist.record(1ns);
+  hist.record(1000ns);
+
+  EXPECT_EQ(hist.count(), 4);
+  auto buckets = hist.buckets();
+  EXPECT_EQ(buckets[0], 2);
+  EXPECT_EQ(buckets[1], 1);
+  EXPECT_EQ(buckets[10], 1); // 512 <= 1000 < 1024
+}
+
+TEST(HistogramTest, Percentiles)
+{
+  auto hist = histogram();
+  for (int i = 0; i < 99; ++i)
+    hist.record(100ns);
+  hist.record(1ms);
+
+  EXPECT_EQ(hist.percentile(50), 127ns);
+  EXPECT_EQ(hist.percentile(99), 127ns);
+  EXPECT_GE(hist.percentile(100), 1ms);
+  EXPECT_LT(hist.percentile(100), 2ms);
+  EXPECT_FALSE(hist.summary().empty());
+}
+// NOLINTEND
@@ -0,0 +1,167 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Cloudbus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cloudbus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with Cloudbus.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// NOLINTBEGIN
+#include "echo/detail/journal.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <thread>
+#include <vector>
+using namespace echo::detail;
+
+class JournalTest : public ::testing::Test {
+protected:
+  auto SetUp() -> void override
+  {
+    directory = std::filesystem::temp_directory_path() / "echo_test_journal";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directory(directory);
+  }
+
+  auto TearDown() -> void override { std::filesystem::remove_all(directory); }
+
+  auto segments() const -> std::vector<std::filesystem::path>
+  {
+    auto paths = std::vector<std::filesystem::path>();
+    for (const auto &entry : std::filesystem::directory_iterator(directory))
+      paths.push_back(entry.path());
+    std::ranges::sort(paths);
+    return paths;
+  }
+
+  // Waits for the journal's thread to create or fail to create segments.
+  template <typename Predicate>
+  static auto eventually(Predicate pred) -> bool
+  {
+    using namespace std::chrono;
+    auto deadline = steady_clock::now() + seconds(5);
+    while (!pred() && steady_clock::now() < deadline)
+      std::this_thread::sleep_for(milliseconds(1));
+    return pred();
+  }
+
+  std::filesystem::path directory;
+};
+
+TEST_F(JournalTest, AppendAndRead)
+{
+  auto error = std::error_code();
+  auto jrnl = journal::open(directory, 4096, 2, error);
+  ASSERT_FALSE(error);
+  ASSERT_TRUE(jrnl);
+
+  jrnl.append({.timestamp = 1, .connection = 5, .type = journal_event::OPEN});
+  jrnl.append({.timestamp = 2,
+               .bytes = 26,
+               .duration = 1,
+               .connection = 5,
+               .type = journal_event::CLOSE});
+
+  auto paths = segments();
+  ASSERT_EQ(paths.size(), 1);
+
+  auto segment = journal_segment::open(paths[0].c_str(), error);
+  ASSERT_FALSE(error);
+  auto events = segment.events();
+  ASSERT_EQ(events.size(), 2);
+  EXPECT_EQ(events[0].type, journal_event::OPEN);
+  EXPECT_EQ(events[1].type, journal_event::CLOSE);
+  EXPECT_EQ(events[1].bytes, 26);
+}
+
+TEST_F(JournalTest, RotateAndRetain)
+{
+  auto error = std::error_code();
+  // Room for the header and 3 events per segment.
+  auto jrnl = journal::open(directory, 4 * sizeof(journal_event), 2, error);
+  ASSERT_TRUE(jrnl);
+
+  for (std::uint64_t i = 0; i < 10; ++i)
+    jrnl.append({.timestamp = i, .type = journal_event::OPEN});
+
+  auto paths = segments();
+  ASSERT_EQ(paths.size(), 2);
+
+  auto segment = journal_segment::open(paths[1].c_str(), error);
+  ASSERT_FALSE(error);
+  auto events = segment.events();
+  ASSERT_EQ(events.size(), 1);
+  EXPECT_EQ(events[0].timestamp, 9);
+}
+
+TEST_F(JournalTest, PrepareNextSegment)
+{
+  auto error = std::error_code();
+  // Room for the header and 4 events per segment.
+  auto jrnl = journal::open(directory, 5 * sizeof(journal_event), 2, error);
+  ASSERT_TRUE(jrnl);
+
+  // The next segment is created in the background once the current one is
+  // half full.
+  jrnl.append({.timestamp = 0, .type = journal_event::OPEN});
+  jrnl.append({.timestamp = 1, .type = journal_event::OPEN});
+  EXPECT_EQ(segments().size(), 1);
+  jrnl.append({.timestamp = 2, .type = journal_event::OPEN});
+  EXPECT_TRUE(eventually([&] { return segments().size() == 2; }));
+
+  // The unused next segment is removed with the journal.
+  jrnl = journal();
+  EXPECT_EQ(segments().size(), 1);
+}
+
+TEST_F(JournalTest, RotateFailure)
+{
+  auto error = std::error_code();
+  // Room for the header and 3 events per segment.
+  auto jrnl = journal::open(directory, 4 * sizeof(journal_event), 2, error);
+  ASSERT_TRUE(jrnl);
+
+  // New segments can't be created once the directory is gone.
+  auto moved = directory;
+  moved += "_moved";
+  std::filesystem::rename(directory, moved);
+  for (std::uint64_t i = 0; i < 5; ++i)
+    jrnl.append({.timestamp = i, .type = journal_event::OPEN});
+
+  // Once each time the segment was half full.
+  EXPECT_TRUE(eventually([&] { return jrnl.failures() == 2; }));
+  EXPECT_EQ(jrnl.failures(), 2);
+  std::filesystem::rename(moved, directory);
+  EXPECT_TRUE(jrnl);
+
+  // The current segment starts over instead of dropping new events.
+  auto paths = segments();
+  ASSERT_EQ(paths.size(), 1);
+  auto segment = journal_segment::open(paths[0].c_str(), error);
+  ASSERT_FALSE(error);
+  auto events = segment.events();
+  ASSERT_EQ(events.size(), 2);
+  EXPECT_EQ(events[0].timestamp, 3);
+  EXPECT_EQ(events[1].timestamp, 4);
+}
+
+TEST_F(JournalTest, OpenInvalidSegment)
+{
+  auto error = std::error_code();
+  auto segment = journal_segment::open("/nonexistent", error);
+  EXPECT_TRUE(error);
+  EXPECT_TRUE(segment.events().empty());
+}
+// NOLINTEND
@@ -0,0 +1,141 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Cloudbus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cloudbus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with Cloudbus.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// NOLINTBEGIN
+#include "echo/detail/netem.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+using namespace echo::detail;
+using namespace std::chrono_literals;
+
+// Waits for a tick and expires the echoes that are due.
+static auto wait(netem &emulator, std::vector<std::uint32_t> &ids) -> bool
+{
+  auto fd = pollfd{};
+  fd.fd = emulator.fd();
+  fd.events = POLLIN;
+  if (poll(&fd, 1, 1000) != 1)
+    return false;
+
+  auto tick = std::byte{};
+  recv(emulator.fd(), &tick, sizeof(tick), 0);
+  emulator.expire(ids);
+  return true;
+}
+
+TEST(NetemOptionsTest, Enabled)
+{
+  auto options = netem_options();
+  EXPECT_FALSE(options);
+  EXPECT_FALSE(options.delayed());
+
+  options.reorder = 1;
+  EXPECT_FALSE(options);
+
+  options.loss = 0.5;
+  EXPECT_TRUE(options);
+  EXPECT_FALSE(options.delayed());
+
+  options.jitter = 1ms;
+  EXPECT_TRUE(options.delayed());
+}
+
+TEST(NetemTest, Delay)
+{
+  auto error = std::error_code();
+  auto emulator = netem::create({.delay = 20ms}, error);
+  ASSERT_FALSE(error);
+  ASSERT_TRUE(emulator);
+
+  auto start = std::chrono::steady_clock::now();
+  ASSERT_TRUE(emulator.hold(1, false));
+  ASSERT_TRUE(emulator.hold(2, false));
+  EXPECT_EQ(emulator.size(), 2);
+
+  auto ids = std::vector<std::uint32_t>();
+  while (ids.size() < 2 && wait(emulator, ids))
+  {}
+
+  EXPECT_GE(std::chrono::steady_clock::now() - start, 20ms);
+  EXPECT_EQ(ids, std::vector<std::uint32_t>({1, 2}));
+  EXPECT_EQ(emulator.size(), 0);
+}
+
+TEST(NetemTest, Distributions)
+{
+  auto error = std::error_code();
+  for (auto shape : {netem_options::UNIFORM, netem_options::NORMAL})
+  {
+    auto emulator = netem::create(
+        {.delay = 5ms, .jitter = 5ms, .shape = shape}, error);
+    ASSERT_FALSE(error);
+
+    for (auto i = 0U; i < 100; ++i)
+      ASSERT_TRUE(emulator.hold(i, false));
+
+    auto ids = std::vector<std::uint32_t>();
+    while (ids.size() < 100 && wait(emulator, ids))
+    {}
+
+    // Every echo comes out once.
+    std::ranges::sort(ids);
+    auto expected = std::vector<std::uint32_t>(100);
+    std::iota(expected.begin(), expected.end(), 0U);
+    EXPECT_EQ(ids, expected);
+  }
+}
+
+TEST(NetemTest, Reorder)
+{
+  auto error = std::error_code();
+  auto emulator = netem::create({.delay = 5ms, .reorder = 8}, error);
+  ASSERT_FALSE(error);
+
+  constexpr auto count = 1000U;
+  for (auto i = 0U; i < count; ++i)
+    ASSERT_TRUE(emulator.hold(i, true));
+
+  auto ids = std::vector<std::uint32_t>();
+  emulator.clear(ids);
+  ASSERT_EQ(ids.size(), count);
+  EXPECT_FALSE(std::ranges::is_sorted(ids));
+
+  std::ranges::sort(ids);
+  EXPECT_EQ(std::ranges::adjacent_find(ids), ids.end());
+}
+
+TEST(NetemTest, LossAndLimit)
+{
+  auto error = std::error_code();
+  auto emulator = netem::create({.loss = 100, .limit = 1}, error);
+  ASSERT_FALSE(error);
+  EXPECT_TRUE(emulator.lost());
+
+  EXPECT_TRUE(emulator.hold(1, false));
+  EXPECT_FALSE(emulator.hold(2, false));
+  EXPECT_EQ(emulator.summary(),
+            "1 held, 1 lost, 0 reordered, 1 over the limit");
+}
+// NOLINTEND
@@ -0,0 +1,65 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Cloudbus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cloudbus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with Cloudbus.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// NOLINTBEGIN
+#include "echo/detail/netstat.hpp"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+using namespace echo::detail;
+
+TEST(NetstatTest, ParseTcpExt)
+{
+  auto netstat = std::istringstream(
+      "TcpExt: SyncookiesSent ListenOverflows ListenDrops TCPHPHits\n"
+      "TcpExt: 0 12 34 56\n"
+      "IpExt: InNoRoutes InTruncatedPkts\n"
+      "IpExt: 0 0\n");
+
+  auto stats = parse_netstat(netstat);
+  ASSERT_TRUE(stats);
+  EXPECT_EQ(stats->overflows, 12);
+  EXPECT_EQ(stats->drops, 34);
+}
+
+TEST(NetstatTest, ParseMissingCounters)
+{
+  auto netstat = std::istringstream("IpExt: InNoRoutes InTruncatedPkts\n"
+                                    "IpExt: 0 0\n");
+  EXPECT_FALSE(parse_netstat(netstat));
+}
+
+TEST(NetstatTest, ReadListenStats)
+{
+  auto sockfd = socket(AF_INET, SOCK_STREAM, 0);
+  ASSERT_GE(sockfd, 0);
+
+  auto addr = sockaddr_in{.sin_family = AF_INET};
+  ASSERT_EQ(bind(sockfd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)),
+            0);
+  ASSERT_EQ(listen(sockfd, 17), 0);
+
+  auto stats = read_listen_stats(sockfd);
+  EXPECT_EQ(stats.queued, 0);
+  EXPECT_EQ(stats.backlog, 17);
+  close(sockfd);
+}
+// NOLINTEND
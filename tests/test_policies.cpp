@@ -0,0 +1,182 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Cloudbus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cloudbus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with Cloudbus.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+// NOLINTBEGIN
+#include "echo/tcp_server.hpp"
+#include "echo/udp_server.hpp"
+
+#include <gtest/gtest.h>
+
+#include <type_traits>
+
+#include <arpa/inet.h>
+using namespace net::service;
+using namespace echo;
+
+class PoliciesTest : public ::testing::Test {};
+
+TEST_F(PoliciesTest, HeapBuffersTest)
+{
+  using buffers = heap_buffers<128>;
+  EXPECT_EQ(buffers::size, 128);
+  EXPECT_EQ(buffers::make().size(), 128);
+}
+
+TEST_F(PoliciesTest, LatencyHistogramsTest)
+{
+  auto stats = latency_histograms();
+  auto now = latency_histograms::now();
+
+  stats.queueing(now - std::chrono::microseconds(1), now);
+  stats.processing(now);
+  EXPECT_EQ(stats.latency.queueing.count(), 1);
+  EXPECT_EQ(stats.latency.processing.count(), 1);
+}
+
+TEST_F(PoliciesTest, LiveAccountingTest)
+{
+  auto loop = std::make_shared<detail::loop_stats>("tcp");
+  auto accounting = live_accounting(nullptr, loop, "tcp");
+  ASSERT_TRUE(accounting.table);
+  EXPECT_EQ(accounting.loop, loop);
+
+  auto entry = accounting.open(5, detail::wall_clock::now(), 128);
+  accounting.event();
+  accounting.received(entry, 10);
+  accounting.sent(entry, 4);
+  EXPECT_EQ(entry->pending.load(), 6);
+  EXPECT_EQ(loop->events.load(), 1);
+  EXPECT_EQ(loop->bytes_in.load(), 10);
+  EXPECT_EQ(loop->bytes_out.load(), 4);
+  EXPECT_EQ(accounting.table->size(), 1);
+
+  accounting.close(5);
+  EXPECT_EQ(accounting.table->size(), 0);
+
+  // A server without loop stats counts into its own.
+  auto own = live_accounting(nullptr, nullptr, "udp");
+  ASSERT_TRUE(own.loop);
+  EXPECT_EQ(own.loop->name, "udp");
+}
+
+TEST_F(PoliciesTest, SharedBudgetTest)
+{
+  auto shared = std::make_shared<detail::memory_budget>(1024);
+  auto budget = shared_budget(shared);
+  EXPECT_TRUE(budget.try_acquire(1024));
+  EXPECT_FALSE(budget.try_admit(1));
+  budget.release(1024);
+  EXPECT_EQ(shared->used(), 0);
+
+  // A server without a budget charges an unlimited one.
+  auto unlimited = shared_budget(nullptr);
+  EXPECT_TRUE(unlimited.try_admit(1UL << 40));
+}
+
+TEST_F(PoliciesTest, NullPoliciesAreEmptyTest)
+{
+  EXPECT_FALSE(null_stats::enabled);
+  EXPECT_FALSE(null_logging::enabled);
+  EXPECT_FALSE(null_accounting::enabled);
+  EXPECT_FALSE(null_budget::enabled);
+  EXPECT_FALSE(null_emulation::enabled);
+  EXPECT_TRUE(std::is_empty_v<null_stats>);
+  EXPECT_TRUE(std::is_empty_v<null_stats::time_point>);
+  EXPECT_TRUE(std::is_empty_v<null_accounting>);
+  EXPECT_TRUE(std::is_empty_v<null_accounting::entry_type>);
+  EXPECT_TRUE(std::is_empty_v<null_budget>);
+  EXPECT_TRUE(std::is_empty_v<null_emulation::state<std::byte>>);
+  EXPECT_TRUE(std::is_empty_v<null_scheduling>);
+  EXPECT_TRUE(std::is_empty_v<null_journal>);
+  EXPECT_TRUE(std::is_empty_v<null_capture>);
+  EXPECT_TRUE(null_budget(nullptr).try_admit(1UL << 40));
+  EXPECT_LT(sizeof(minimal_tcp_server::connection),
+            sizeof(tcp_server::connection));
+}
+
+TEST_F(PoliciesTest, MinimalUDPEchoTest)
+{
+  using namespace io::socket;
+
+  auto service = basic_context_thread<minimal_udp_server>();
+
+  auto addr = socket_address<sockaddr_in>();
+  addr->sin_family = AF_INET;
+  addr->sin_port = htons(8080);
+
+  service.start(addr);
+  service.state.wait(async_context::PENDING);
+  {
+    using namespace io;
+    auto sock = socket_handle(AF_INET, SOCK_DGRAM, 0);
+    addr->sin_addr.s_addr = inet_addr("127.0.0.1");
+
+    auto buf = std::array<char, 1>{'x'};
+    auto msg = socket_message<sockaddr_in>{
+        .address = {socket_address<sockaddr_in>()}, .buffers = buf};
+
+    ASSERT_EQ(sendmsg(sock,
+                      socket_message<sockaddr_in>{
+                          .address = {addr}, .buffers = std::span("a", 1)},
+                      0),
+              1);
+    ASSERT_EQ(recvmsg(sock, msg, 0), 1);
+    EXPECT_EQ(buf[0], 'a');
+  }
+
+  service.signal(service.terminate);
+  service.state.wait(async_context::STARTED);
+}
+
+TEST_F(PoliciesTest, BulkTCPEchoTest)
+{
+  using namespace io::socket;
+
+  auto service = basic_context_thread<bulk_tcp_server>();
+
+  auto addr = socket_address<sockaddr_in>();
+  addr->sin_family = AF_INET;
+  addr->sin_port = htons(8080);
+
+  service.start(addr);
+  service.state.wait(async_context::PENDING);
+  {
+    using namespace io;
+    auto sock = socket_handle(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    addr->sin_addr.s_addr = inet_addr("127.0.0.1");
+    ASSERT_EQ(connect(sock, addr), 0);
+
+    auto out = std::vector<char>(32 * 1024, 'x');
+    auto in = std::vector<char>(out.size());
+    ASSERT_EQ(send(static_cast<int>(sock), out.data(), out.size(), 0),
+              static_cast<ssize_t>(out.size()));
+
+    auto received = std::size_t{};
+    while (received < in.size())
+    {
+      auto len = recv(static_cast<int>(sock), in.data() + received,
+                      in.size() - received, 0);
+      ASSERT_GT(len, 0);
+      received += len;
+    }
+    EXPECT_EQ(in, out);
+  }
+
+  service.signal(service.terminate);
+  service.state.wait(async_context::STARTED);
+}
+// NOLINTEND
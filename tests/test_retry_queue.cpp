@@ -0,0 +1,188 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Cloudbus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cloudbus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with Cloudbus.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+// NOLINTBEGIN
+#include "echo/detail/retry_queue.hpp"
+#include "echo/udp_server.hpp"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <string_view>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+using namespace net::service;
+using namespace echo;
+using namespace echo::detail;
+
+// Fails the next `failures` calls to sendmsg with ENOBUFS.
+static std::atomic<int> failures = 0;
+ssize_t sendmsg(int __fd, const struct msghdr *__message, int flags)
+{
+  if (failures > 0)
+  {
+    --failures;
+    errno = ENOBUFS;
+    return -1;
+  }
+  return syscall(SYS_sendmsg, __fd, __message, flags);
+}
+
+class RetryQueueTest : public ::testing::Test {
+protected:
+  auto SetUp() -> void override
+  {
+    receiver = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    ASSERT_GE(receiver, 0);
+
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = inet_addr("127.0.0.1");
+    ASSERT_EQ(bind(receiver, reinterpret_cast<sockaddr *>(&address),
+                   sizeof(address)),
+              0);
+    auto len = socklen_t{sizeof(address)};
+    getsockname(receiver, reinterpret_cast<sockaddr *>(&address), &len);
+
+    sender = socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT_GE(sender, 0);
+  }
+
+  auto TearDown() -> void override
+  {
+    close(receiver);
+    close(sender);
+  }
+
+  auto address_bytes() const -> std::span<const std::byte>
+  {
+    return {reinterpret_cast<const std::byte *>(&address), sizeof(address)};
+  }
+
+  static auto bytes(const char *str) -> std::span<const std::byte>
+  {
+    return {reinterpret_cast<const std::byte *>(str), std::strlen(str)};
+  }
+
+  int receiver = -1;
+  int sender = -1;
+  sockaddr_in address = {};
+};
+
+TEST_F(RetryQueueTest, ErrorNumber)
+{
+  EXPECT_EQ(error_number(ENOBUFS), ENOBUFS);
+  EXPECT_EQ(error_number(std::error_code(EAGAIN, std::system_category())),
+            EAGAIN);
+  EXPECT_EQ(error_number(std::exception_ptr()), EIO);
+  EXPECT_TRUE(is_retryable(EAGAIN));
+  EXPECT_TRUE(is_retryable(ENOBUFS));
+  EXPECT_FALSE(is_retryable(ECONNREFUSED));
+}
+
+TEST_F(RetryQueueTest, PushPop)
+{
+  auto queue = retry_queue(2, 8);
+  EXPECT_TRUE(queue.empty());
+  EXPECT_TRUE(queue.push(address_bytes(), bytes("abc")));
+  EXPECT_TRUE(queue.push(address_bytes(), bytes("def")));
+  EXPECT_FALSE(queue.push(address_bytes(), bytes("ghi")));
+  EXPECT_FALSE(retry_queue(4, 2).push(address_bytes(), bytes("abc")));
+  EXPECT_EQ(queue.size(), 2);
+
+  const auto &front = queue.front();
+  EXPECT_EQ(front.addrlen, sizeof(sockaddr_in));
+  EXPECT_EQ(std::string_view(reinterpret_cast<const char *>(
+                                 front.payload.data()),
+                             front.payload.size()),
+            "abc");
+
+  queue.pop();
+  EXPECT_TRUE(queue.push(address_bytes(), bytes("ghi")));
+  EXPECT_EQ(queue.size(), 2);
+}
+
+TEST_F(RetryQueueTest, FlushInBatches)
+{
+  auto queue = retry_queue(retry_queue::BATCH * 2, 8);
+  for (std::size_t i = 0; i < queue.capacity(); ++i)
+    ASSERT_TRUE(queue.push(address_bytes(), bytes("x")));
+
+  auto drops = send_drops();
+  EXPECT_EQ(queue.flush(sender, drops), retry_queue::BATCH * 2);
+  EXPECT_TRUE(queue.empty());
+  EXPECT_EQ(drops.retried, retry_queue::BATCH * 2);
+  EXPECT_EQ(drops.total(), 0);
+
+  auto buf = char{};
+  for (std::size_t i = 0; i < retry_queue::BATCH * 2; ++i)
+    ASSERT_EQ(recv(receiver, &buf, 1, 0), 1);
+}
+
+TEST_F(RetryQueueTest, FlushDropsHardErrors)
+{
+  auto queue = retry_queue(4, 8);
+  ASSERT_TRUE(queue.push(address_bytes(), bytes("x")));
+
+  auto drops = send_drops();
+  EXPECT_EQ(queue.flush(-1, drops), 0);
+  EXPECT_TRUE(queue.empty());
+  EXPECT_EQ(drops.by_errno[EBADF], 1);
+  EXPECT_EQ(drops.summary(), "0 queued, 0 retried, 1 dropped (EBADF 1)");
+}
+
+TEST_F(RetryQueueTest, ServerRetriesENOBUFS)
+{
+  using namespace io::socket;
+
+  auto service = basic_context_thread<udp_server>();
+
+  auto addr = socket_address<sockaddr_in>();
+  addr->sin_family = AF_INET;
+  addr->sin_port = htons(8080);
+
+  service.start(addr);
+  service.state.wait(async_context::PENDING);
+  {
+    auto server = sockaddr_in{.sin_family = AF_INET, .sin_port = htons(8080)};
+    server.sin_addr.s_addr = inet_addr("127.0.0.1");
+    ASSERT_EQ(connect(sender, reinterpret_cast<sockaddr *>(&server),
+                      sizeof(server)),
+              0);
+
+    // The first reply fails and is queued. The second datagram flushes it.
+    failures = 1;
+    ASSERT_EQ(send(sender, "a", 1, 0), 1);
+    while (failures > 0)
+      std::this_thread::yield();
+    ASSERT_EQ(send(sender, "b", 1, 0), 1);
+
+    auto buf = std::array<char, 2>();
+    ASSERT_EQ(recv(sender, &buf[0], 1, 0), 1);
+    ASSERT_EQ(recv(sender, &buf[1], 1, 0), 1);
+    EXPECT_EQ(buf[0], 'a');
+    EXPECT_EQ(buf[1], 'b');
+  }
+
+  service.signal(service.terminate);
+  service.state.wait(async_context::STARTED);
+}
+// NOLINTEND
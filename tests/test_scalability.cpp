@@ -0,0 +1,385 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Cloudbus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cloudbus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with Cloudbus.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+// NOLINTBEGIN
+#include "echo/detail/histogram.hpp"
+#include "echo/tcp_server.hpp"
+#include "echo/udp_server.hpp"
+
+#include <gtest/gtest.h>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <unistd.h>
+using namespace net::service;
+using namespace echo;
+using namespace std::chrono;
+
+// The suite is sized with environment variables so that it can be scaled
+// up to C100K on hosts with the file descriptor limits to match.
+static auto env(const char *name, std::size_t fallback) -> std::size_t
+{
+  if (const char *value = std::getenv(name))
+    return std::strtoul(value, nullptr, 10);
+  return fallback;
+}
+
+// Raises RLIMIT_NOFILE to the hard limit and returns the new soft limit.
+static auto raise_nofile() -> std::size_t
+{
+  auto limit = rlimit{};
+  getrlimit(RLIMIT_NOFILE, &limit);
+  limit.rlim_cur = limit.rlim_max;
+  setrlimit(RLIMIT_NOFILE, &limit);
+  getrlimit(RLIMIT_NOFILE, &limit);
+  return limit.rlim_cur;
+}
+
+static auto resident_bytes() -> std::size_t
+{
+  auto statm = std::ifstream("/proc/self/statm");
+  auto size = std::size_t{};
+  auto resident = std::size_t{};
+  statm >> size >> resident;
+  return resident * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+}
+
+static auto open_fds() -> std::size_t
+{
+  auto count = std::size_t{};
+  for ([[maybe_unused]] const auto &entry :
+       std::filesystem::directory_iterator("/proc/self/fd"))
+  {
+    ++count;
+  }
+  return count;
+}
+
+// Client sockets, closed on destruction.
+struct sockets {
+  std::vector<int> fds;
+
+  sockets() = default;
+  sockets(const sockets &) = delete;
+  auto operator=(const sockets &) -> sockets & = delete;
+  ~sockets() { close_all(); }
+
+  auto close_all() -> void
+  {
+    for (auto fd : fds)
+    {
+      if (fd >= 0)
+        close(fd);
+    }
+    fds.clear();
+  }
+};
+
+class ScalabilityTest : public ::testing::Test {
+protected:
+  static constexpr unsigned short PORT = 8080;
+  static constexpr std::size_t PAYLOAD = 64;
+  // Connections are spread over 127.0.0.0/8 source addresses so that the
+  // ephemeral port range doesn't cap the connection count.
+  static constexpr std::size_t PER_SOURCE = 25000;
+
+  auto SetUp() -> void override
+  {
+    spdlog::set_level(spdlog::level::warn);
+    nofile = raise_nofile();
+  }
+
+  auto TearDown() -> void override { spdlog::set_level(spdlog::level::info); }
+
+  static auto server_address() -> sockaddr_in
+  {
+    auto addr = sockaddr_in{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(PORT);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    return addr;
+  }
+
+  static auto source_address(std::size_t i) -> sockaddr_in
+  {
+    auto addr = sockaddr_in{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK + i / PER_SOURCE);
+    return addr;
+  }
+
+  std::size_t nofile = 0;
+};
+
+TEST_F(ScalabilityTest, TCPConnectionsTest)
+{
+  using namespace io::socket;
+
+  // Each connection costs a client and a server descriptor.
+  auto connections =
+      std::min(env("ECHO_SCALE_CONNECTIONS", 20000), (nofile - 256) / 2);
+  if (connections < 1000)
+    GTEST_SKIP() << "RLIMIT_NOFILE is too low: " << nofile;
+
+  const auto rounds = env("ECHO_SCALE_ROUNDS", 4);
+  const auto rss_limit = env("ECHO_SCALE_RSS_PER_CONNECTION", 32 * 1024);
+  const auto p99_limit = milliseconds(env("ECHO_SCALE_P99_MS", 2000));
+
+  const auto baseline_fds = open_fds();
+  auto service = basic_context_thread<tcp_server>();
+
+  auto addr = socket_address<sockaddr_in>();
+  addr->sin_family = AF_INET;
+  addr->sin_port = htons(PORT);
+
+  service.start(addr, tcp_server::options{.backlog = 65535});
+  service.state.wait(async_context::PENDING);
+
+  const auto baseline_rss = resident_bytes();
+  auto clients = sockets();
+  clients.fds.reserve(connections);
+
+  const auto server = server_address();
+  for (std::size_t i = 0; i < connections; ++i)
+  {
+    int fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    ASSERT_GE(fd, 0) << "socket: " << std::strerror(errno);
+    clients.fds.push_back(fd);
+
+    int enable = 1;
+    setsockopt(fd, IPPROTO_IP, IP_BIND_ADDRESS_NO_PORT, &enable,
+               sizeof(enable));
+    auto source = source_address(i);
+    ASSERT_EQ(bind(fd, reinterpret_cast<sockaddr *>(&source), sizeof(source)),
+              0)
+        << "bind: " << std::strerror(errno);
+    ASSERT_EQ(connect(fd, reinterpret_cast<const sockaddr *>(&server),
+                      sizeof(server)),
+              0)
+        << "connect " << i << ": " << std::strerror(errno);
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  }
+
+  int epfd = epoll_create1(EPOLL_CLOEXEC);
+  ASSERT_GE(epfd, 0);
+  for (std::size_t i = 0; i < connections; ++i)
+  {
+    auto event = epoll_event{.events = EPOLLIN, .data = {.u64 = i}};
+    ASSERT_EQ(epoll_ctl(epfd, EPOLL_CTL_ADD, clients.fds[i], &event), 0);
+  }
+
+  // Push a payload through every connection at once and time each echo.
+  auto rtt = detail::histogram();
+  auto sent = std::vector<steady_clock::time_point>(connections);
+  auto received = std::vector<std::size_t>(connections);
+  auto payload = std::array<char, PAYLOAD>();
+  auto events = std::vector<epoll_event>(1024);
+
+  for (std::size_t round = 0; round < rounds; ++round)
+  {
+    payload.fill(static_cast<char>('a' + round % 26));
+    for (std::size_t i = 0; i < connections; ++i)
+    {
+      sent[i] = steady_clock::now();
+      received[i] = 0;
+      ASSERT_EQ(send(clients.fds[i], payload.data(), payload.size(), 0),
+                static_cast<ssize_t>(payload.size()));
+    }
+
+    auto remaining = connections;
+    auto deadline = steady_clock::now() + seconds(30);
+    while (remaining > 0)
+    {
+      ASSERT_LT(steady_clock::now(), deadline)
+          << remaining << " connections did not echo in round " << round;
+
+      int n = epoll_wait(epfd, events.data(), static_cast<int>(events.size()),
+                         100);
+      for (int e = 0; e < n; ++e)
+      {
+        auto i = events[e].data.u64;
+        auto buf = std::array<char, PAYLOAD>();
+        auto len = recv(clients.fds[i], buf.data(), PAYLOAD - received[i], 0);
+        ASSERT_GT(len, 0) << "connection " << i << " closed early";
+        ASSERT_EQ(buf[0], payload[0]);
+
+        if ((received[i] += len) == PAYLOAD)
+        {
+          rtt.record(steady_clock::now() - sent[i]);
+          --remaining;
+        }
+      }
+    }
+  }
+
+  const auto resident = resident_bytes();
+  const auto rss = resident > baseline_rss ? resident - baseline_rss : 0;
+  std::cout << "connections: " << connections
+            << ", RSS per connection: " << rss / connections << " bytes"
+            << ", echo RTT: " << rtt.summary() << "\n";
+  EXPECT_LE(rss / connections, rss_limit);
+  EXPECT_LE(rtt.percentile(99), p99_limit);
+
+  // Half of the clients hang up, the rest are closed by the server's
+  // drain in stop().
+  for (std::size_t i = 0; i < connections; i += 2)
+  {
+    close(clients.fds[i]);
+    clients.fds[i] = -1;
+  }
+
+  service.signal(service.terminate);
+  service.state.wait(async_context::STARTED);
+
+  auto open = connections / 2;
+  auto deadline = steady_clock::now() + seconds(10);
+  while (open > 0 && steady_clock::now() < deadline)
+  {
+    int n =
+        epoll_wait(epfd, events.data(), static_cast<int>(events.size()), 100);
+    for (int e = 0; e < n; ++e)
+    {
+      auto i = events[e].data.u64;
+      auto buf = std::array<char, PAYLOAD>();
+      if (recv(clients.fds[i], buf.data(), buf.size(), 0) <= 0)
+      {
+        epoll_ctl(epfd, EPOLL_CTL_DEL, clients.fds[i], nullptr);
+        --open;
+      }
+    }
+  }
+  EXPECT_EQ(open, 0) << "connections left open after stop()";
+
+  close(epfd);
+  clients.close_all();
+  EXPECT_LE(open_fds(), baseline_fds + 16);
+}
+
+TEST_F(ScalabilityTest, UDPSourcePortsTest)
+{
+  using namespace io::socket;
+
+  auto count = std::min(env("ECHO_SCALE_UDP_SOCKETS", 8192), nofile - 256);
+  if (count < 1000)
+    GTEST_SKIP() << "RLIMIT_NOFILE is too low: " << nofile;
+
+  const auto rounds = env("ECHO_SCALE_ROUNDS", 4);
+  // Bound the datagrams in flight so the server's receive buffer doesn't
+  // overflow.
+  const auto window = env("ECHO_SCALE_UDP_WINDOW", 256);
+
+  auto service = basic_context_thread<udp_server>();
+
+  auto addr = socket_address<sockaddr_in>();
+  addr->sin_family = AF_INET;
+  addr->sin_port = htons(PORT);
+
+  service.start(addr);
+  service.state.wait(async_context::PENDING);
+
+  auto clients = sockets();
+  clients.fds.reserve(count);
+
+  int epfd = epoll_create1(EPOLL_CLOEXEC);
+  ASSERT_GE(epfd, 0);
+
+  const auto server = server_address();
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    ASSERT_GE(fd, 0) << "socket: " << std::strerror(errno);
+    clients.fds.push_back(fd);
+    ASSERT_EQ(connect(fd, reinterpret_cast<const sockaddr *>(&server),
+                      sizeof(server)),
+              0);
+
+    auto event = epoll_event{.events = EPOLLIN, .data = {.u64 = i}};
+    ASSERT_EQ(epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &event), 0);
+  }
+
+  auto rtt = detail::histogram();
+  auto sent = std::vector<steady_clock::time_point>(count);
+  auto pending = std::vector<char>(count);
+  auto events = std::vector<epoll_event>(1024);
+  std::size_t lost = 0;
+  std::size_t total = 0;
+
+  for (std::size_t round = 0; round < rounds; ++round)
+  {
+    for (std::size_t begin = 0; begin < count; begin += window)
+    {
+      auto end = std::min(begin + window, count);
+      for (auto i = begin; i < end; ++i)
+      {
+        // Each datagram carries the index of the socket that sent it.
+        sent[i] = steady_clock::now();
+        pending[i] = 1;
+        ASSERT_EQ(send(clients.fds[i], &i, sizeof(i), 0),
+                  static_cast<ssize_t>(sizeof(i)));
+      }
+
+      auto remaining = end - begin;
+      auto deadline = steady_clock::now() + seconds(1);
+      while (remaining > 0 && steady_clock::now() < deadline)
+      {
+        int n = epoll_wait(epfd, events.data(),
+                           static_cast<int>(events.size()), 10);
+        for (int e = 0; e < n; ++e)
+        {
+          auto i = events[e].data.u64;
+          auto index = std::size_t{};
+          while (recv(clients.fds[i], &index, sizeof(index), 0) ==
+                 sizeof(index))
+          {
+            EXPECT_EQ(index, i) << "echo sent to the wrong source port";
+            // Late echoes from an earlier window were already counted lost.
+            if (std::exchange(pending[i], 0) && i >= begin && i < end)
+            {
+              rtt.record(steady_clock::now() - sent[i]);
+              --remaining;
+            }
+          }
+        }
+      }
+      lost += remaining;
+      total += end - begin;
+    }
+  }
+
+  std::cout << "source ports: " << count << ", datagrams: " << total
+            << ", lost: " << lost << ", echo RTT: " << rtt.summary() << "\n";
+  EXPECT_LE(lost * 100, total);
+
+  close(epfd);
+  service.signal(service.terminate);
+  service.state.wait(async_context::STARTED);
+}
+// NOLINTEND
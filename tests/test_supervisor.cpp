@@ -0,0 +1,150 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Cloudbus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cloudbus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with Cloudbus.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// NOLINTBEGIN
+#include "echo/detail/supervisor.hpp"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <format>
+#include <thread>
+#include <vector>
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+using namespace echo::detail;
+
+class SupervisorTest : public ::testing::Test {
+protected:
+  auto SetUp() -> void override
+  {
+    // Only the supervisor's signalfd may see the stop signal and the worker
+    // exits, so the helper thread must block them too.
+    sigemptyset(&set);
+    sigaddset(&set, SIGTERM);
+    sigaddset(&set, SIGCHLD);
+    ASSERT_EQ(pthread_sigmask(SIG_BLOCK, &set, &old), 0);
+  }
+
+  auto TearDown() -> void override
+  {
+    pthread_sigmask(SIG_SETMASK, &old, nullptr);
+  }
+
+  // Stops the supervisor after a delay.
+  static auto stop_after(std::chrono::milliseconds delay) -> std::jthread
+  {
+    return std::jthread([delay] {
+      std::this_thread::sleep_for(delay);
+      kill(getpid(), SIGTERM);
+    });
+  }
+
+  // A worker that reports readiness and runs until it is stopped.
+  static auto serve(int ready) -> int
+  {
+    auto set = sigset_t{};
+    sigemptyset(&set);
+    sigaddset(&set, SIGTERM);
+    supervisor::ready(ready);
+
+    auto signo = 0;
+    sigwait(&set, &signo);
+    return 0;
+  }
+
+  sigset_t set{};
+  sigset_t old{};
+};
+
+TEST_F(SupervisorTest, StopsWorkers)
+{
+  auto exits = std::vector<supervisor::worker_exit>();
+  auto workers = supervisor(
+      2, [](std::size_t, int ready) { return serve(ready); },
+      [&](const auto &exit) { exits.push_back(exit); });
+
+  auto stop = stop_after(std::chrono::milliseconds(200));
+  auto error = std::error_code();
+  EXPECT_EQ(workers.run(error), 0);
+  EXPECT_FALSE(error);
+
+  ASSERT_EQ(exits.size(), 2);
+  for (const auto &exit : exits)
+  {
+    EXPECT_TRUE(WIFEXITED(exit.status));
+    EXPECT_EQ(WEXITSTATUS(exit.status), 0);
+    EXPECT_FALSE(exit.restarting);
+  }
+}
+
+TEST_F(SupervisorTest, RestartsCrashedWorker)
+{
+  // The first run of the worker crashes, the restarted one serves.
+  auto marker = std::filesystem::temp_directory_path() /
+                std::format("echo-supervisor-{}", getpid());
+  std::filesystem::remove(marker);
+
+  auto exits = std::vector<supervisor::worker_exit>();
+  auto workers = supervisor(
+      1,
+      [&](std::size_t, int ready) {
+        if (!std::filesystem::exists(marker))
+        {
+          std::fclose(std::fopen(marker.c_str(), "w"));
+          std::abort();
+        }
+        return serve(ready);
+      },
+      [&](const auto &exit) { exits.push_back(exit); });
+
+  auto stop = stop_after(supervisor::RESTART_DELAY +
+                         std::chrono::milliseconds(500));
+  auto error = std::error_code();
+  EXPECT_EQ(workers.run(error), 0);
+  std::filesystem::remove(marker);
+
+  ASSERT_EQ(exits.size(), 2);
+  EXPECT_TRUE(WIFSIGNALED(exits[0].status));
+  EXPECT_EQ(WTERMSIG(exits[0].status), SIGABRT);
+  EXPECT_TRUE(exits[0].restarting);
+  EXPECT_TRUE(WIFEXITED(exits[1].status));
+  EXPECT_FALSE(exits[1].restarting);
+  EXPECT_NE(exits[0].pid, exits[1].pid);
+}
+
+TEST_F(SupervisorTest, ReportsFailedStop)
+{
+  // A worker that dies from the stop signal didn't drain.
+  auto workers = supervisor(1, [](std::size_t, int ready) {
+    auto set = sigset_t{};
+    sigemptyset(&set);
+    sigaddset(&set, SIGTERM);
+    pthread_sigmask(SIG_UNBLOCK, &set, nullptr);
+    supervisor::ready(ready);
+    pause();
+    return 0;
+  });
+
+  auto stop = stop_after(std::chrono::milliseconds(200));
+  auto error = std::error_code();
+  EXPECT_EQ(workers.run(error), 1);
+}
+// NOLINTEND
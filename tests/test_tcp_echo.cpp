@@ -19,6 +19,12 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
 #include <arpa/inet.h>
 using namespace net::service;
 using namespace echo;
@@ -61,6 +67,41 @@ TEST_F(TCPEchoServerTest, StartTest)
   }
 }
 
+TEST_F(TCPEchoServerTest, FastOpenTest)
+{
+  using namespace io::socket;
+  using server = basic_context_thread<tcp_server>;
+
+  auto service = server();
+
+  auto addr = socket_address<sockaddr_in>();
+  addr->sin_family = AF_INET;
+  addr->sin_port = htons(8080);
+
+  service.start(addr, tcp_server::options{
+                          .fastopen = 16, .defer_accept = 1, .backlog = 64});
+  service.state.wait(async_context::PENDING);
+  {
+    using namespace io;
+    auto sock = socket_handle(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    addr->sin_addr.s_addr = inet_addr("127.0.0.1");
+
+    // Carry the first byte in the SYN.
+    auto data = 'a';
+    ASSERT_EQ(sendto(static_cast<int>(sock), &data, 1, MSG_FASTOPEN,
+                     reinterpret_cast<sockaddr *>(std::ranges::data(addr)),
+                     sizeof(sockaddr_in)),
+              1);
+
+    auto buf = 'x';
+    ASSERT_EQ(recv(static_cast<int>(sock), &buf, 1, 0), 1);
+    EXPECT_EQ(buf, data);
+  }
+
+  service.signal(service.terminate);
+  service.state.wait(async_context::STARTED);
+}
+
 TEST_F(TCPEchoServerTest, ServerInitiatedSocketClose)
 {
   using namespace io::socket;
@@ -84,4 +125,320 @@ TEST_F(TCPEchoServerTest, ServerInitiatedSocketClose)
     service.state.wait(async_context::STARTED);
   }
 }
+
+TEST_F(TCPEchoServerTest, MemoryBudgetShedTest)
+{
+  using namespace io::socket;
+
+  auto service = basic_context_thread<tcp_server>();
+
+  auto addr = socket_address<sockaddr_in>();
+  addr->sin_family = AF_INET;
+  addr->sin_port = htons(8080);
+
+  // Room for exactly one connection buffer below the watermark.
+  auto budget = std::make_shared<detail::memory_budget>(2 * TCP_BUFSIZE);
+  service.start(addr, tcp_server::options{.budget = budget});
+  service.state.wait(async_context::PENDING);
+  {
+    using namespace io;
+    addr->sin_addr.s_addr = inet_addr("127.0.0.1");
+
+    auto admitted = socket_handle(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    ASSERT_EQ(connect(admitted, addr), 0);
+
+    auto data = 'a';
+    auto buf = 'x';
+    ASSERT_EQ(send(static_cast<int>(admitted), &data, 1, 0), 1);
+    ASSERT_EQ(recv(static_cast<int>(admitted), &buf, 1, 0), 1);
+    EXPECT_EQ(buf, data);
+
+    auto shed = socket_handle(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    ASSERT_EQ(connect(shed, addr), 0);
+    ASSERT_EQ(send(static_cast<int>(shed), &data, 1, MSG_NOSIGNAL), 1);
+    EXPECT_LE(recv(static_cast<int>(shed), &buf, 1, 0), 0);
+
+    // The admitted session is unaffected.
+    ASSERT_EQ(send(static_cast<int>(admitted), &data, 1, 0), 1);
+    ASSERT_EQ(recv(static_cast<int>(admitted), &buf, 1, 0), 1);
+    EXPECT_EQ(budget->used(), TCP_BUFSIZE);
+    EXPECT_EQ(budget->shed(), 1);
+  }
+
+  service.signal(service.terminate);
+  service.state.wait(async_context::STARTED);
+}
+
+TEST_F(TCPEchoServerTest, InheritedListenerTest)
+{
+  using namespace io::socket;
+
+  // A listener that the service manager would hold across restarts.
+  auto addr = socket_address<sockaddr_in>();
+  addr->sin_family = AF_INET;
+  addr->sin_port = htons(8081);
+  addr->sin_addr.s_addr = inet_addr("127.0.0.1");
+
+  auto inherited = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  auto enable = 1;
+  setsockopt(inherited, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+  auto *ptr = reinterpret_cast<sockaddr *>(std::ranges::data(addr));
+  ASSERT_EQ(::bind(inherited, ptr, sizeof(sockaddr_in)), 0);
+  ASSERT_EQ(::listen(inherited, 16), 0);
+
+  // The connection is queued before the server starts.
+  using namespace io;
+  auto sock = socket_handle(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  ASSERT_EQ(connect(sock, addr), 0);
+
+  auto service = basic_context_thread<tcp_server>();
+  auto ephemeral = socket_address<sockaddr_in>();
+  ephemeral->sin_family = AF_INET;
+
+  service.start(ephemeral, tcp_server::options{.inherited = inherited});
+  service.state.wait(async_context::PENDING);
+  {
+    auto data = 'a';
+    auto buf = 'x';
+    ASSERT_EQ(send(static_cast<int>(sock), &data, 1, 0), 1);
+    ASSERT_EQ(recv(static_cast<int>(sock), &buf, 1, 0), 1);
+    EXPECT_EQ(buf, data);
+  }
+
+  service.signal(service.terminate);
+  service.state.wait(async_context::STARTED);
+}
+
+TEST_F(TCPEchoServerTest, HandoverTest)
+{
+  using namespace io::socket;
+
+  auto channel = std::array<int, 2>{};
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, channel.data()), 0);
+  auto outgoing = std::make_shared<detail::handover>();
+  auto incoming = std::make_shared<detail::handover>();
+  incoming->receive_from(channel[1]);
+
+  auto addr = socket_address<sockaddr_in>();
+  addr->sin_family = AF_INET;
+  addr->sin_port = htons(8082);
+
+  auto old_service = basic_context_thread<tcp_server>();
+  old_service.start(addr, tcp_server::options{.handover = outgoing});
+  old_service.state.wait(async_context::PENDING);
+
+  using namespace io;
+  auto sock = socket_handle(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  addr->sin_addr.s_addr = inet_addr("127.0.0.1");
+  ASSERT_EQ(connect(sock, addr), 0);
+
+  auto data = 'a';
+  auto buf = 'x';
+  ASSERT_EQ(send(static_cast<int>(sock), &data, 1, 0), 1);
+  ASSERT_EQ(recv(static_cast<int>(sock), &buf, 1, 0), 1);
+  EXPECT_EQ(buf, data);
+
+  // The old server hands over once the new one is ready.
+  auto upgrade = std::thread([&] {
+    ASSERT_FALSE(outgoing->send_to(channel[0]));
+    old_service.signal(old_service.terminate);
+  });
+
+  auto ephemeral = socket_address<sockaddr_in>();
+  ephemeral->sin_family = AF_INET;
+  auto new_service = basic_context_thread<tcp_server>();
+  new_service.start(ephemeral, tcp_server::options{.handover = incoming});
+  new_service.state.wait(async_context::PENDING);
+  upgrade.join();
+  old_service.state.wait(async_context::STARTED);
+
+  // The same connection is now echoed by the new server.
+  data = 'b';
+  ASSERT_EQ(send(static_cast<int>(sock), &data, 1, 0), 1);
+  ASSERT_EQ(recv(static_cast<int>(sock), &buf, 1, 0), 1);
+  EXPECT_EQ(buf, data);
+
+  new_service.signal(new_service.terminate);
+  new_service.state.wait(async_context::STARTED);
+}
+
+TEST_F(TCPEchoServerTest, FairSchedulingTest)
+{
+  using namespace io::socket;
+
+  auto service = basic_context_thread<full_tcp_server>();
+
+  auto addr = socket_address<sockaddr_in>();
+  addr->sin_family = AF_INET;
+  addr->sin_port = htons(8083);
+
+  service.start(addr, full_tcp_server::options{.quantum = 1024,
+                                          .pacing_rate = 1UL << 30});
+  service.state.wait(async_context::PENDING);
+  {
+    using namespace io;
+    addr->sin_addr.s_addr = inet_addr("127.0.0.1");
+
+    // A bulk transfer is parked every quantum while a small flow runs.
+    constexpr auto BULK = 1024 * 1024;
+    auto bulk = socket_handle(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    ASSERT_EQ(connect(bulk, addr), 0);
+    auto writer = std::thread([&] {
+      auto chunk = std::array<char, 16 * 1024>{};
+      chunk.fill('b');
+      for (auto sent = 0; sent < BULK;)
+      {
+        auto len = send(static_cast<int>(bulk), chunk.data(), chunk.size(), 0);
+        ASSERT_GT(len, 0);
+        sent += len;
+      }
+    });
+
+    auto small = socket_handle(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    ASSERT_EQ(connect(small, addr), 0);
+    for (char data = 'a'; data <= 'z'; ++data)
+    {
+      auto buf = 'x';
+      ASSERT_EQ(send(static_cast<int>(small), &data, 1, 0), 1);
+      ASSERT_EQ(recv(static_cast<int>(small), &buf, 1, 0), 1);
+      EXPECT_EQ(buf, data);
+    }
+
+    auto chunk = std::array<char, 16 * 1024>{};
+    auto received = 0;
+    while (received < BULK)
+    {
+      auto len = recv(static_cast<int>(bulk), chunk.data(), chunk.size(), 0);
+      ASSERT_GT(len, 0);
+      EXPECT_EQ(std::count(chunk.begin(), chunk.begin() + len, 'b'), len);
+      received += len;
+    }
+    writer.join();
+    EXPECT_EQ(received, BULK);
+  }
+
+  service.signal(service.terminate);
+  service.state.wait(async_context::STARTED);
+}
+
+TEST_F(TCPEchoServerTest, FairSchedulingIdleTest)
+{
+  using namespace io::socket;
+
+  auto service = basic_context_thread<full_tcp_server>();
+
+  auto addr = socket_address<sockaddr_in>();
+  addr->sin_family = AF_INET;
+  addr->sin_port = htons(8084);
+
+  service.start(addr, full_tcp_server::options{.quantum = 1024});
+  service.state.wait(async_context::PENDING);
+  {
+    using namespace io;
+    addr->sin_addr.s_addr = inet_addr("127.0.0.1");
+
+    // An idle keepalive connection never gives the parked bulk transfer
+    // its turn, so the bulk transfer releases itself.
+    auto idle = socket_handle(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    ASSERT_EQ(connect(idle, addr), 0);
+
+    constexpr auto BULK = 256 * 1024;
+    auto bulk = socket_handle(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    ASSERT_EQ(connect(bulk, addr), 0);
+    auto timeout = timeval{.tv_sec = 5};
+    setsockopt(static_cast<int>(bulk), SOL_SOCKET, SO_RCVTIMEO, &timeout,
+               sizeof(timeout));
+    auto writer = std::thread([&] {
+      auto chunk = std::array<char, 16 * 1024>{};
+      chunk.fill('b');
+      for (auto sent = 0; sent < BULK;)
+      {
+        auto len = send(static_cast<int>(bulk), chunk.data(), chunk.size(), 0);
+        ASSERT_GT(len, 0);
+        sent += len;
+      }
+    });
+
+    auto chunk = std::array<char, 16 * 1024>{};
+    auto received = 0;
+    while (received < BULK)
+    {
+      auto len = recv(static_cast<int>(bulk), chunk.data(), chunk.size(), 0);
+      ASSERT_GT(len, 0);
+      received += len;
+    }
+    writer.join();
+    EXPECT_EQ(received, BULK);
+  }
+
+  service.signal(service.terminate);
+  service.state.wait(async_context::STARTED);
+}
+
+TEST_F(TCPEchoServerTest, FairSchedulingLatencyTest)
+{
+  using namespace io::socket;
+  using namespace std::chrono;
+
+  auto service = basic_context_thread<full_tcp_server>();
+
+  auto addr = socket_address<sockaddr_in>();
+  addr->sin_family = AF_INET;
+  addr->sin_port = htons(8086);
+
+  service.start(addr, full_tcp_server::options{.quantum = 16 * 1024});
+  service.state.wait(async_context::PENDING);
+  {
+    using namespace io;
+    addr->sin_addr.s_addr = inet_addr("127.0.0.1");
+
+    // A bulk sender keeps its connection saturated, with input always
+    // queued, until the interactive connection is done.
+    auto done = std::atomic<bool>(false);
+    auto bulk = socket_handle(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    ASSERT_EQ(connect(bulk, addr), 0);
+    auto timeout = timeval{.tv_sec = 1};
+    setsockopt(static_cast<int>(bulk), SOL_SOCKET, SO_SNDTIMEO, &timeout,
+               sizeof(timeout));
+    setsockopt(static_cast<int>(bulk), SOL_SOCKET, SO_RCVTIMEO, &timeout,
+               sizeof(timeout));
+    auto writer = std::thread([&] {
+      auto chunk = std::array<char, 64 * 1024>{};
+      while (!done && send(static_cast<int>(bulk), chunk.data(),
+                           chunk.size(), MSG_NOSIGNAL) > 0)
+        ;
+    });
+    auto reader = std::thread([&] {
+      auto chunk = std::array<char, 64 * 1024>{};
+      while (!done &&
+             recv(static_cast<int>(bulk), chunk.data(), chunk.size(), 0) > 0)
+        ;
+    });
+
+    // The interactive connection's round trips aren't queued behind the
+    // bulk transfer, because the bulk connection is parked every quantum.
+    auto small = socket_handle(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    ASSERT_EQ(connect(small, addr), 0);
+    auto slowest = steady_clock::duration::zero();
+    for (auto i = 0; i < 200; ++i)
+    {
+      auto data = static_cast<char>('a' + i % 26);
+      auto buf = 'x';
+      auto start = steady_clock::now();
+      ASSERT_EQ(send(static_cast<int>(small), &data, 1, 0), 1);
+      ASSERT_EQ(recv(static_cast<int>(small), &buf, 1, 0), 1);
+      slowest = std::max(slowest, steady_clock::now() - start);
+      EXPECT_EQ(buf, data);
+    }
+
+    done = true;
+    shutdown(static_cast<int>(bulk), SHUT_RDWR);
+    writer.join();
+    reader.join();
+    EXPECT_LT(slowest, milliseconds(100));
+  }
+
+  service.signal(service.terminate);
+  service.state.wait(async_context::STARTED);
+}
 // NOLINTEND
@@ -0,0 +1,161 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Cloudbus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cloudbus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with Cloudbus.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// NOLINTBEGIN
+#ifndef ECHO_SERVER_STATIC_TEST
+#define ECHO_SERVER_STATIC_TEST
+#include "../src/tcp_server.cpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+using namespace net::service;
+using namespace echo;
+
+// Counts the heap allocations made by every thread, the server's event
+// loop included. The replacement is global, so it lives in a test binary
+// of its own.
+static std::atomic<std::size_t> allocations = 0;
+auto operator new(std::size_t size) -> void *
+{
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (auto *ptr = std::malloc(size ? size : 1))
+    return ptr;
+  throw std::bad_alloc();
+}
+auto operator delete(void *ptr) noexcept -> void { std::free(ptr); }
+auto operator delete(void *ptr, std::size_t) noexcept -> void
+{
+  std::free(ptr);
+}
+
+class EchoInlineAllocationsTest : public ::testing::Test {
+protected:
+  auto SetUp() -> void override
+  {
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets.data()), 0);
+  }
+
+  auto TearDown() -> void override
+  {
+    close(sockets[0]);
+    close(sockets[1]);
+  }
+
+  std::array<int, 2> sockets{};
+  std::array<std::byte, TCP_BUFSIZE> buffer{};
+};
+
+TEST_F(EchoInlineAllocationsTest, InlineEchoDoesNotAllocate)
+{
+  static constexpr auto ROUND_TRIPS = 10000;
+  auto request = std::array<char, 64>{};
+  auto reply = std::array<char, 64>{};
+
+  auto count = 0UL;
+  for (auto i = 0; i < ROUND_TRIPS; ++i)
+  {
+    request.fill(static_cast<char>('a' + i % 26));
+    ASSERT_EQ(send(sockets[1], request.data(), request.size(), 0),
+              request.size());
+
+    auto pending = std::span<const std::byte>();
+    auto before = allocations.load();
+    auto echoed = echo_inline(sockets[0], buffer, pending, 64 * 1024UL);
+    count += allocations.load() - before;
+
+    ASSERT_EQ(echoed, request.size());
+    ASSERT_TRUE(pending.empty());
+    ASSERT_EQ(recv(sockets[1], reply.data(), reply.size(), 0), reply.size());
+    ASSERT_EQ(reply, request);
+  }
+
+  EXPECT_EQ(count, 0);
+}
+
+class EchoServerAllocationsTest : public ::testing::Test {};
+
+// A round trip through a running server re-arms the connection's receive
+// in place, so once the connection is set up nothing is allocated.
+TEST_F(EchoServerAllocationsTest, RoundTripsDoNotAllocate)
+{
+  using namespace io::socket;
+  using server = basic_context_thread<tcp_server>;
+  static constexpr auto WARMUP = 100;
+  static constexpr auto ROUND_TRIPS = 10000;
+
+  auto service = server();
+
+  auto addr = socket_address<sockaddr_in>();
+  addr->sin_family = AF_INET;
+  addr->sin_port = htons(8085);
+
+  service.start(addr);
+  service.state.wait(async_context::PENDING);
+  {
+    auto sock = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    ASSERT_GE(sock, 0);
+    auto peer = sockaddr_in{.sin_family = AF_INET, .sin_port = htons(8085)};
+    peer.sin_addr.s_addr = inet_addr("127.0.0.1");
+    ASSERT_EQ(::connect(sock, reinterpret_cast<const sockaddr *>(&peer),
+                        sizeof(peer)),
+              0);
+
+    auto request = std::array<char, 64>{};
+    auto reply = std::array<char, 64>{};
+    auto round_trip = [&](int i) {
+      request.fill(static_cast<char>('a' + i % 26));
+      if (::send(sock, request.data(), request.size(), 0) != request.size())
+        return false;
+
+      auto received = 0UL;
+      while (received < reply.size())
+      {
+        auto len = ::recv(sock, reply.data() + received,
+                          reply.size() - received, 0);
+        if (len <= 0)
+          return false;
+        received += len;
+      }
+      return reply == request;
+    };
+
+    for (auto i = 0; i < WARMUP; ++i)
+      ASSERT_TRUE(round_trip(i));
+
+    auto before = allocations.load();
+    auto ok = true;
+    for (auto i = 0; i < ROUND_TRIPS && ok; ++i)
+      ok = round_trip(i);
+    auto count = allocations.load() - before;
+
+    ::close(sock);
+    ASSERT_TRUE(ok);
+    EXPECT_EQ(count, 0);
+  }
+
+  service.signal(service.terminate);
+  service.state.wait(async_context::STARTED);
+}
+#undef ECHO_SERVER_STATIC_TEST
+#endif // ECHO_SERVER_STATIC_TEST
+// NOLINTEND
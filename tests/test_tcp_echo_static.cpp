@@ -21,7 +21,12 @@
 
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <thread>
+
 #include <arpa/inet.h>
+#include <poll.h>
+#include <sys/ioctl.h>
 using namespace net::service;
 using namespace echo;
 
@@ -105,6 +110,117 @@ TEST_F(TCPEchoServerTest, TestGetPeernameV6)
   auto address = getpeername_(dialog, buf);
   EXPECT_EQ(address, "[::1]:8081");
 }
+
+class EchoInlineTest : public ::testing::Test {
+protected:
+  auto SetUp() -> void override
+  {
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets.data()), 0);
+  }
+
+  auto TearDown() -> void override
+  {
+    close(sockets[0]);
+    close(sockets[1]);
+  }
+
+  std::array<int, 2> sockets{};
+  std::array<std::byte, TCP_BUFSIZE> buffer{};
+};
+
+TEST_F(EchoInlineTest, Limit)
+{
+  auto request = std::array<char, 3 * TCP_BUFSIZE>{};
+  ASSERT_EQ(send(sockets[1], request.data(), request.size(), 0),
+            request.size());
+
+  // The limit is checked between reads, so one buffer is echoed.
+  auto pending = std::span<const std::byte>();
+  EXPECT_EQ(echo_inline(sockets[0], buffer, pending, 1), TCP_BUFSIZE);
+  EXPECT_EQ(echo_inline(sockets[0], buffer, pending, 64 * 1024UL),
+            2 * TCP_BUFSIZE);
+
+  // The pending bytes are sent before the socket is read.
+  auto bytes = std::array<std::byte, 5>{};
+  pending = bytes;
+  EXPECT_EQ(echo_inline(sockets[0], buffer, pending, 64 * 1024UL), 5);
+}
+
+TEST_F(EchoInlineTest, EndOfFile)
+{
+  // End of file is left for the re-armed receive to see.
+  shutdown(sockets[1], SHUT_WR);
+  auto pending = std::span<const std::byte>();
+  EXPECT_EQ(echo_inline(sockets[0], buffer, pending, 64 * 1024UL), 0);
+  EXPECT_EQ(recv(sockets[0], buffer.data(), buffer.size(), 0), 0);
+}
+
+TEST_F(EchoInlineTest, Coalesce)
+{
+  // Small writes that are already queued are echoed together.
+  auto request = std::array<char, 16>{};
+  for (auto i = 0; i < 10; ++i)
+  {
+    request.fill(static_cast<char>('a' + i));
+    ASSERT_EQ(send(sockets[1], request.data(), request.size(), 0),
+              request.size());
+  }
+
+  auto bytes = std::array<std::byte, 16>{};
+  std::memcpy(buffer.data(), "0123456789abcdef", bytes.size());
+  auto pending = std::span<const std::byte>(buffer).first(bytes.size());
+  EXPECT_EQ(echo_inline(sockets[0], buffer, pending, 64 * 1024UL, true),
+            11 * request.size());
+  EXPECT_TRUE(pending.empty());
+
+  auto reply = std::array<char, 11 * 16>{};
+  ASSERT_EQ(recv(sockets[1], reply.data(), reply.size(), MSG_WAITALL),
+            reply.size());
+  EXPECT_EQ(std::string_view(reply.data(), 17), "0123456789abcdefa");
+  EXPECT_EQ(reply.back(), 'j');
+}
+
+TEST(EchoInlineCorkTest, FullBufferIsPushed)
+{
+  auto listener = socket(AF_INET, SOCK_STREAM, 0);
+  auto addr = sockaddr_in{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  auto len = static_cast<socklen_t>(sizeof(addr));
+  ASSERT_EQ(bind(listener, reinterpret_cast<sockaddr *>(&addr), len), 0);
+  ASSERT_EQ(listen(listener, 1), 0);
+  ASSERT_EQ(getsockname(listener, reinterpret_cast<sockaddr *>(&addr), &len),
+            0);
+
+  auto client = socket(AF_INET, SOCK_STREAM, 0);
+  ASSERT_EQ(connect(client, reinterpret_cast<sockaddr *>(&addr), len), 0);
+  auto server = accept(listener, nullptr, nullptr);
+  ASSERT_GE(server, 0);
+
+  // Exactly a buffer is queued, so it is sent with MSG_MORE and has to be
+  // pushed once the input runs dry.
+  auto request = std::array<char, TCP_BUFSIZE>{};
+  ASSERT_EQ(send(client, request.data(), request.size(), 0), request.size());
+  auto fd = pollfd{.fd = server, .events = POLLIN, .revents = 0};
+  ASSERT_EQ(poll(&fd, 1, 1000), 1);
+  while (ioctl(server, FIONREAD, &len) == 0 && len < request.size())
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+  auto buffer = std::array<std::byte, TCP_BUFSIZE>{};
+  auto pending = std::span<const std::byte>(buffer).first(0);
+  EXPECT_EQ(echo_inline(server, buffer, pending, 64 * 1024UL, true),
+            request.size());
+
+  fd = pollfd{.fd = client, .events = POLLIN, .revents = 0};
+  ASSERT_EQ(poll(&fd, 1, 100), 1);
+  auto reply = std::array<char, TCP_BUFSIZE>{};
+  EXPECT_EQ(recv(client, reply.data(), reply.size(), MSG_WAITALL),
+            reply.size());
+
+  close(server);
+  close(client);
+  close(listener);
+}
 #undef ECHO_SERVER_STATIC_TEST
 #endif // ECHO_SERVER_STATIC_TEST
 // NOLINTEND
@@ -0,0 +1,133 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Cloudbus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cloudbus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with Cloudbus.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// NOLINTBEGIN
+#include "echo/detail/timer_wheel.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+using namespace echo::detail;
+
+TEST(TimerWheelTest, ExpiresInOrder)
+{
+  auto wheel = timer_wheel();
+  auto expired = std::vector<std::uint32_t>();
+  wheel.schedule(1, 5);
+  wheel.schedule(2, 3);
+  wheel.schedule(3, 5);
+  EXPECT_EQ(wheel.size(), 3);
+
+  wheel.advance(2, expired);
+  EXPECT_TRUE(expired.empty());
+
+  wheel.advance(3, expired);
+  EXPECT_EQ(expired, std::vector<std::uint32_t>({2}));
+
+  // Timers that are due on the same tick keep the order they were
+  // scheduled in.
+  expired.clear();
+  wheel.advance(10, expired);
+  EXPECT_EQ(expired, std::vector<std::uint32_t>({1, 3}));
+  EXPECT_TRUE(wheel.empty());
+  EXPECT_EQ(wheel.now(), 10);
+}
+
+TEST(TimerWheelTest, Rotations)
+{
+  auto wheel = timer_wheel();
+  auto expired = std::vector<std::uint32_t>();
+  constexpr auto slots = timer_wheel::SLOTS;
+  wheel.schedule(1, 7 + 2 * slots);
+  wheel.schedule(2, 7);
+
+  wheel.advance(7, expired);
+  EXPECT_EQ(expired, std::vector<std::uint32_t>({2}));
+
+  // A timer a rotation ahead stays in its slot.
+  wheel.advance(7 + slots, expired);
+  EXPECT_EQ(expired.size(), 1);
+  EXPECT_EQ(wheel.size(), 1);
+
+  wheel.advance(7 + 2 * slots, expired);
+  EXPECT_EQ(expired, std::vector<std::uint32_t>({2, 1}));
+}
+
+TEST(TimerWheelTest, PastDue)
+{
+  auto wheel = timer_wheel();
+  auto expired = std::vector<std::uint32_t>();
+  wheel.advance(100, expired);
+  wheel.schedule(1, 50);
+
+  wheel.advance(101, expired);
+  EXPECT_EQ(expired, std::vector<std::uint32_t>({1}));
+}
+
+TEST(TimerWheelTest, ReusesNodes)
+{
+  auto wheel = timer_wheel();
+  auto expired = std::vector<std::uint32_t>();
+  auto first = wheel.schedule(1, 1);
+  EXPECT_EQ(wheel.id(first), 1);
+
+  wheel.advance(1, expired);
+  EXPECT_EQ(wheel.id(first), timer_wheel::NONE);
+  EXPECT_EQ(wheel.schedule(2, 2), first);
+}
+
+TEST(TimerWheelTest, Swap)
+{
+  auto wheel = timer_wheel();
+  auto expired = std::vector<std::uint32_t>();
+  auto first = wheel.schedule(1, 1);
+  auto second = wheel.schedule(2, 2);
+  wheel.swap(first, second);
+  EXPECT_EQ(wheel.id(first), 2);
+  EXPECT_EQ(wheel.id(second), 1);
+
+  wheel.advance(2, expired);
+  EXPECT_EQ(expired, std::vector<std::uint32_t>({2, 1}));
+}
+
+TEST(TimerWheelTest, Clear)
+{
+  auto wheel = timer_wheel();
+  auto expired = std::vector<std::uint32_t>();
+  wheel.schedule(1, 3 + timer_wheel::SLOTS);
+  wheel.schedule(2, 9);
+  wheel.schedule(3, 3);
+
+  wheel.clear(expired);
+  EXPECT_EQ(expired, std::vector<std::uint32_t>({3, 2, 1}));
+  EXPECT_TRUE(wheel.empty());
+  EXPECT_EQ(wheel.now(), 0);
+}
+
+TEST(TimerWheelTest, Many)
+{
+  auto wheel = timer_wheel();
+  auto expired = std::vector<std::uint32_t>();
+  constexpr auto count = 200'000U;
+  for (auto i = 0U; i < count; ++i)
+    wheel.schedule(i, 1 + i % 5000);
+
+  wheel.advance(5000, expired);
+  EXPECT_EQ(expired.size(), count);
+  EXPECT_TRUE(wheel.empty());
+}
+// NOLINTEND
@@ -0,0 +1,205 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Cloudbus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cloudbus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with Cloudbus.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// NOLINTBEGIN
+#include "echo/tls_server.hpp"
+
+#include <gtest/gtest.h>
+
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+using namespace net::service;
+using namespace echo;
+
+class TLSEchoServerTest : public ::testing::Test {
+protected:
+  auto SetUp() -> void override
+  {
+    auto dir = std::filesystem::temp_directory_path();
+    cert = dir / "echo_test_cert.pem";
+    key = dir / "echo_test_key.pem";
+
+    auto *pkey = EVP_EC_gen("P-256");
+    ASSERT_NE(pkey, nullptr);
+
+    auto *x509 = X509_new();
+    ASSERT_NE(x509, nullptr);
+    ASN1_INTEGER_set(X509_get_serialNumber(x509), 1);
+    X509_gmtime_adj(X509_getm_notBefore(x509), 0);
+    X509_gmtime_adj(X509_getm_notAfter(x509), 3600);
+    X509_set_pubkey(x509, pkey);
+    auto *name = X509_get_subject_name(x509);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                               (const unsigned char *)"localhost", -1, -1, 0);
+    X509_set_issuer_name(x509, name);
+    ASSERT_GT(X509_sign(x509, pkey, EVP_sha256()), 0);
+
+    auto *file = std::fopen(cert.c_str(), "w");
+    ASSERT_NE(file, nullptr);
+    PEM_write_X509(file, x509);
+    std::fclose(file);
+
+    file = std::fopen(key.c_str(), "w");
+    ASSERT_NE(file, nullptr);
+    PEM_write_PrivateKey(file, pkey, nullptr, nullptr, 0, nullptr, nullptr);
+    std::fclose(file);
+
+    X509_free(x509);
+    EVP_PKEY_free(pkey);
+  }
+
+  auto TearDown() -> void override
+  {
+    std::filesystem::remove(cert);
+    std::filesystem::remove(key);
+  }
+
+  // The kernel can only offload a session if it has the tls ULP. Setting it
+  // on a socket that isn't connected fails with ENOENT if the ULP is
+  // missing and ENOTCONN otherwise.
+  static auto has_tls_ulp() -> bool
+  {
+    auto probe = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    auto ret = setsockopt(probe, SOL_TCP, TCP_ULP, "tls", 3);
+    auto error = errno;
+    ::close(probe);
+    return !ret || error != ENOENT;
+  }
+
+  // Finds the server's end of a connection made from this process.
+  static auto accepted(int client) -> int
+  {
+    auto local = sockaddr_storage{};
+    auto len = socklen_t(sizeof(local));
+    if (getsockname(client, reinterpret_cast<sockaddr *>(&local), &len))
+      return -1;
+
+    for (const auto &entry :
+         std::filesystem::directory_iterator("/proc/self/fd"))
+    {
+      auto fd = std::stoi(entry.path().filename().string());
+      auto peer = sockaddr_storage{};
+      auto peerlen = socklen_t(sizeof(peer));
+      if (fd != client &&
+          !getpeername(fd, reinterpret_cast<sockaddr *>(&peer), &peerlen) &&
+          peerlen == len && !std::memcmp(&peer, &local, len))
+      {
+        return fd;
+      }
+    }
+    return -1;
+  }
+
+  // The name of the upper layer protocol on the socket.
+  static auto ulp(int fd) -> std::string
+  {
+    auto name = std::array<char, 16>();
+    auto len = socklen_t(name.size());
+    if (fd < 0 || getsockopt(fd, SOL_TCP, TCP_ULP, name.data(), &len))
+      return {};
+    return {name.data(), std::strlen(name.data())};
+  }
+
+  template <typename Predicate>
+  static auto eventually(Predicate pred) -> bool
+  {
+    using namespace std::chrono;
+    auto deadline = steady_clock::now() + seconds(5);
+    while (!pred() && steady_clock::now() < deadline)
+      std::this_thread::sleep_for(milliseconds(1));
+    return pred();
+  }
+
+  std::filesystem::path cert;
+  std::filesystem::path key;
+};
+
+TEST_F(TLSEchoServerTest, MakeContextTest)
+{
+  EXPECT_TRUE(tls_server::make_context(cert.c_str(), key.c_str()));
+  EXPECT_FALSE(tls_server::make_context("/nonexistent", key.c_str()));
+}
+
+TEST_F(TLSEchoServerTest, EchoTest)
+{
+  using namespace io::socket;
+
+  if (!has_tls_ulp())
+    GTEST_SKIP() << "The kernel doesn't have the tls ULP.";
+
+  auto context = tls_server::make_context(cert.c_str(), key.c_str());
+  ASSERT_TRUE(context);
+
+  auto service = basic_context_thread<tls_server>();
+
+  auto addr = socket_address<sockaddr_in>();
+  addr->sin_family = AF_INET;
+  addr->sin_port = htons(8443);
+
+  service.start(addr, context);
+  service.state.wait(async_context::PENDING);
+  {
+    using namespace io;
+    auto sock = socket_handle(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    addr->sin_addr.s_addr = inet_addr("127.0.0.1");
+
+    ASSERT_EQ(connect(sock, addr), 0);
+
+    auto *client_ctx = SSL_CTX_new(TLS_client_method());
+    ASSERT_NE(client_ctx, nullptr);
+    auto *ssl = SSL_new(client_ctx);
+    ASSERT_NE(ssl, nullptr);
+    SSL_set_fd(ssl, static_cast<int>(sock));
+    ASSERT_EQ(SSL_connect(ssl), 1);
+
+    // The server offloads the session once it has read the client's
+    // Finished message, which is sent before any application data.
+    auto client = static_cast<int>(sock);
+    EXPECT_TRUE(eventually([&] { return ulp(accepted(client)) == "tls"; }));
+
+    const char *alphabet = "abcdefghijklmnopqrstuvwxyz";
+    auto *end = alphabet + 26;
+
+    for (auto *it = alphabet; it != end; ++it)
+    {
+      char buf = 'x';
+      ASSERT_EQ(SSL_write(ssl, it, 1), 1);
+      ASSERT_EQ(SSL_read(ssl, &buf, 1), 1);
+      EXPECT_EQ(buf, *it);
+    }
+
+    SSL_free(ssl);
+    SSL_CTX_free(client_ctx);
+  }
+
+  service.signal(service.terminate);
+  service.state.wait(async_context::STARTED);
+}
+// NOLINTEND
@@ -19,7 +19,12 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <string>
+#include <vector>
+
 #include <arpa/inet.h>
+#include <unistd.h>
 using namespace net::service;
 using namespace echo;
 
@@ -62,4 +67,128 @@ TEST_F(UDPEchoServerTest, EchoTest)
     }
   }
 }
+
+TEST_F(UDPEchoServerTest, TimestampsTest)
+{
+  using namespace io::socket;
+
+  auto service = basic_context_thread<udp_server>();
+
+  auto addr = socket_address<sockaddr_in>();
+  addr->sin_family = AF_INET;
+  addr->sin_port = htons(8080);
+
+  service.start(addr, udp_server::options{.timestamps = true});
+  service.state.wait(async_context::PENDING);
+  {
+    using namespace io;
+    auto sock = socket_handle(AF_INET, SOCK_DGRAM, 0);
+    addr->sin_addr.s_addr = inet_addr("127.0.0.1");
+
+    auto buf = std::array<char, 1>{'x'};
+    auto msg = socket_message<sockaddr_in>{
+        .address = {socket_address<sockaddr_in>()}, .buffers = buf};
+
+    auto data = 'a';
+    ASSERT_EQ(sendmsg(sock,
+                      socket_message<sockaddr_in>{
+                          .address = {addr}, .buffers = std::span(&data, 1)},
+                      0),
+              1);
+    ASSERT_EQ(recvmsg(sock, msg, 0), 1);
+    EXPECT_EQ(buf[0], data);
+  }
+
+  service.signal(service.terminate);
+  service.state.wait(async_context::STARTED);
+}
+
+TEST_F(UDPEchoServerTest, DepthTest)
+{
+  using namespace io::socket;
+
+  auto service = basic_context_thread<udp_server>();
+
+  auto addr = socket_address<sockaddr_in>();
+  addr->sin_family = AF_INET;
+  addr->sin_port = htons(8080);
+
+  service.start(addr, udp_server::options{.depth = 8});
+  service.state.wait(async_context::PENDING);
+  {
+    using namespace io;
+    auto sock = socket_handle(AF_INET, SOCK_DGRAM, 0);
+    addr->sin_addr.s_addr = inet_addr("127.0.0.1");
+
+    // Send a burst so that several replies are in flight at once.
+    const auto alphabet = std::string("abcdefghijklmnopqrstuvwxyz");
+    for (const auto &letter : alphabet)
+    {
+      ASSERT_EQ(sendmsg(sock,
+                        socket_message<sockaddr_in>{
+                            .address = {addr},
+                            .buffers = std::span(&letter, 1)},
+                        0),
+                1);
+    }
+
+    auto received = std::string();
+    auto buf = std::array<char, 1>{'x'};
+    auto msg = socket_message<sockaddr_in>{
+        .address = {socket_address<sockaddr_in>()}, .buffers = buf};
+    for (std::size_t i = 0; i < alphabet.size(); ++i)
+    {
+      ASSERT_EQ(recvmsg(sock, msg, 0), 1);
+      received.push_back(buf[0]);
+    }
+
+    std::ranges::sort(received);
+    EXPECT_EQ(received, alphabet);
+  }
+
+  service.signal(service.terminate);
+  service.state.wait(async_context::STARTED);
+}
+
+TEST_F(UDPEchoServerTest, LargeDatagramTest)
+{
+  using namespace io::socket;
+
+  auto service = basic_context_thread<udp_server>();
+
+  auto addr = socket_address<sockaddr_in>();
+  addr->sin_family = AF_INET;
+  addr->sin_port = htons(8080);
+
+  service.start(addr, udp_server::options{.depth = 2});
+  service.state.wait(async_context::PENDING);
+  {
+    addr->sin_addr.s_addr = inet_addr("127.0.0.1");
+    auto sock = ::socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT_GE(sock, 0);
+
+    // The largest IPv4 payload, well past the 4 KiB reply buffers.
+    auto datagram = std::vector<char>(65507);
+    for (std::size_t i = 0; i < datagram.size(); ++i)
+      datagram[i] = static_cast<char>('a' + i % 26);
+
+    auto *ptr = reinterpret_cast<sockaddr *>(std::ranges::data(addr));
+    for (auto size : {std::size_t{1}, datagram.size(), UDP_BUFSIZE + 1})
+    {
+      ASSERT_EQ(::sendto(sock, datagram.data(), size, 0, ptr,
+                         sizeof(sockaddr_in)),
+                static_cast<ssize_t>(size));
+
+      auto buf = std::vector<char>(UDP_RECVSIZE);
+      ASSERT_EQ(::recv(sock, buf.data(), buf.size(), 0),
+                static_cast<ssize_t>(size));
+      EXPECT_TRUE(std::equal(buf.begin(), buf.begin() + size,
+                             datagram.begin()));
+    }
+    ::close(sock);
+  }
+
+  service.signal(service.terminate);
+  service.state.wait(async_context::STARTED);
+}
 // NOLINTEND
@@ -0,0 +1,61 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Cloudbus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cloudbus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with Cloudbus.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// NOLINTBEGIN
+#include "echo/detail/wakeup.hpp"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstddef>
+
+#include <sys/socket.h>
+using namespace echo::detail;
+
+TEST(WakeupTest, NotifyOnce)
+{
+  auto error = std::error_code();
+  auto waker = wakeup::create(error);
+  ASSERT_FALSE(error);
+  ASSERT_TRUE(waker);
+
+  auto buf = std::array<std::byte, 8>{};
+  EXPECT_LT(recv(waker.fd(), buf.data(), buf.size(), MSG_DONTWAIT), 0);
+
+  // Wakeups posted while one is pending are merged.
+  waker.notify();
+  waker.notify();
+  EXPECT_EQ(recv(waker.fd(), buf.data(), buf.size(), MSG_DONTWAIT), 1);
+  EXPECT_LT(recv(waker.fd(), buf.data(), buf.size(), MSG_DONTWAIT), 0);
+
+  waker.clear();
+  waker.notify();
+  EXPECT_EQ(recv(waker.fd(), buf.data(), buf.size(), MSG_DONTWAIT), 1);
+}
+
+TEST(WakeupTest, Closed)
+{
+  auto waker = wakeup();
+  EXPECT_FALSE(waker);
+  waker.notify();
+
+  auto error = std::error_code();
+  auto moved = wakeup::create(error);
+  waker = std::move(moved);
+  EXPECT_TRUE(waker);
+  EXPECT_FALSE(moved);
+}
+// NOLINTEND
@@ -0,0 +1,345 @@
+/* Copyright (C) 2025 Kevin Exton (kevin.exton@pm.me)
+ *
+ * Cloudbus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cloudbus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with Cloudbus.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// NOLINTBEGIN
+#include "echo/detail/bpf.hpp"
+#include "echo/detail/xdp.hpp"
+#include "echo/xdp_server.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <linux/if_ether.h>
+#include <netinet/ip.h>
+#include <netinet/ip6.h>
+#include <netinet/udp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+using namespace echo::detail;
+
+static constexpr auto SRC_MAC = std::array<std::uint8_t, 6>{2, 0, 0, 0, 0, 1};
+static constexpr auto DST_MAC = std::array<std::uint8_t, 6>{2, 0, 0, 0, 0, 2};
+
+// Builds an Ethernet frame around an IPv4 UDP datagram.
+static auto ipv4_frame(std::uint16_t sport, std::uint16_t dport,
+                       std::string_view payload,
+                       std::uint8_t proto = IPPROTO_UDP)
+    -> std::vector<std::byte>
+{
+  auto frame = std::vector<std::byte>(ETH_HLEN + sizeof(iphdr) +
+                                      sizeof(udphdr) + payload.size());
+  auto *eth = reinterpret_cast<ethhdr *>(frame.data());
+  std::ranges::copy(DST_MAC, eth->h_dest);
+  std::ranges::copy(SRC_MAC, eth->h_source);
+  eth->h_proto = htons(ETH_P_IP);
+
+  auto *ip = reinterpret_cast<iphdr *>(frame.data() + ETH_HLEN);
+  ip->version = 4;
+  ip->ihl = 5;
+  ip->ttl = 64;
+  ip->protocol = proto;
+  ip->tot_len = htons(frame.size() - ETH_HLEN);
+  ip->saddr = htonl(0x0a000001);
+  ip->daddr = htonl(0x0a000002);
+
+  auto *udp = reinterpret_cast<udphdr *>(ip + 1);
+  udp->source = htons(sport);
+  udp->dest = htons(dport);
+  udp->len = htons(sizeof(udphdr) + payload.size());
+  udp->check = htons(0x1234);
+  std::memcpy(udp + 1, payload.data(), payload.size());
+  return frame;
+}
+
+// Builds an Ethernet frame around an IPv6 UDP datagram.
+static auto ipv6_frame(std::uint16_t sport, std::uint16_t dport,
+                       std::string_view payload) -> std::vector<std::byte>
+{
+  auto frame = std::vector<std::byte>(ETH_HLEN + sizeof(ip6_hdr) +
+                                      sizeof(udphdr) + payload.size());
+  auto *eth = reinterpret_cast<ethhdr *>(frame.data());
+  std::ranges::copy(DST_MAC, eth->h_dest);
+  std::ranges::copy(SRC_MAC, eth->h_source);
+  eth->h_proto = htons(ETH_P_IPV6);
+
+  auto *ip = reinterpret_cast<ip6_hdr *>(frame.data() + ETH_HLEN);
+  ip->ip6_vfc = 6 << 4;
+  ip->ip6_plen = htons(sizeof(udphdr) + payload.size());
+  ip->ip6_nxt = IPPROTO_UDP;
+  ip->ip6_hlim = 64;
+  inet_pton(AF_INET6, "fd00::1", &ip->ip6_src);
+  inet_pton(AF_INET6, "fd00::2", &ip->ip6_dst);
+
+  auto *udp = reinterpret_cast<udphdr *>(ip + 1);
+  udp->source = htons(sport);
+  udp->dest = htons(dport);
+  udp->len = ip->ip6_plen;
+  std::memcpy(udp + 1, payload.data(), payload.size());
+  return frame;
+}
+
+TEST(ReflectTest, IPv4)
+{
+  auto frame = ipv4_frame(40000, 7, "hello");
+  ASSERT_TRUE(reflect(frame));
+
+  const auto *eth = reinterpret_cast<const ethhdr *>(frame.data());
+  EXPECT_TRUE(std::ranges::equal(eth->h_dest, SRC_MAC));
+  EXPECT_TRUE(std::ranges::equal(eth->h_source, DST_MAC));
+
+  const auto *ip = reinterpret_cast<const iphdr *>(frame.data() + ETH_HLEN);
+  EXPECT_EQ(ip->saddr, htonl(0x0a000002));
+  EXPECT_EQ(ip->daddr, htonl(0x0a000001));
+
+  const auto *udp = reinterpret_cast<const udphdr *>(ip + 1);
+  EXPECT_EQ(udp->source, htons(7));
+  EXPECT_EQ(udp->dest, htons(40000));
+  EXPECT_EQ(udp->check, htons(0x1234));
+  EXPECT_EQ(std::memcmp(udp + 1, "hello", 5), 0);
+
+  // Reflecting the echo gives back the original frame.
+  ASSERT_TRUE(reflect(frame));
+  EXPECT_EQ(frame, ipv4_frame(40000, 7, "hello"));
+}
+
+TEST(ReflectTest, IPv6)
+{
+  auto frame = ipv6_frame(40000, 7, "hello");
+  ASSERT_TRUE(reflect(frame));
+
+  const auto *ip = reinterpret_cast<const ip6_hdr *>(frame.data() + ETH_HLEN);
+  auto expected = in6_addr{};
+  inet_pton(AF_INET6, "fd00::2", &expected);
+  EXPECT_EQ(std::memcmp(&ip->ip6_src, &expected, sizeof(expected)), 0);
+
+  const auto *udp = reinterpret_cast<const udphdr *>(ip + 1);
+  EXPECT_EQ(udp->source, htons(7));
+  EXPECT_EQ(udp->dest, htons(40000));
+}
+
+TEST(ReflectTest, NotUDP)
+{
+  auto tcp = ipv4_frame(40000, 7, "hello", IPPROTO_TCP);
+  auto original = tcp;
+  EXPECT_FALSE(reflect(tcp));
+  EXPECT_EQ(tcp, original);
+
+  auto truncated = ipv4_frame(40000, 7, "");
+  truncated.resize(truncated.size() - 1);
+  EXPECT_FALSE(reflect(truncated));
+
+  auto arp = ipv4_frame(40000, 7, "hello");
+  reinterpret_cast<ethhdr *>(arp.data())->h_proto = htons(ETH_P_ARP);
+  EXPECT_FALSE(reflect(arp));
+}
+
+class RedirectProgramTest : public ::testing::Test {
+protected:
+  auto SetUp() -> void override
+  {
+    auto error = std::error_code();
+    xsks = bpf::create_map(BPF_MAP_TYPE_XSKMAP, sizeof(std::uint32_t),
+                           sizeof(int), 1, error);
+    if (error == std::errc::operation_not_permitted)
+      GTEST_SKIP() << "Loading XDP programs needs CAP_BPF.";
+    ASSERT_FALSE(error) << error.message();
+
+    auto log = std::vector<char>();
+    program = bpf::load_xdp(xsk_redirect_program(7, xsks, 1024), error, &log);
+    ASSERT_FALSE(error) << error.message() << "\n" << log.data();
+  }
+
+  auto TearDown() -> void override
+  {
+    if (program >= 0)
+      close(program);
+    if (xsks >= 0)
+      close(xsks);
+  }
+
+  auto run(std::vector<std::byte> frame) -> std::uint32_t
+  {
+    auto error = std::error_code();
+    auto action = bpf::test_run(program, frame, error);
+    EXPECT_FALSE(error) << error.message();
+    return action;
+  }
+
+  int xsks = -1;
+  int program = -1;
+};
+
+TEST_F(RedirectProgramTest, PassesOtherTraffic)
+{
+  // Without a socket on the queue, even echo traffic passes to the kernel.
+  EXPECT_EQ(run(ipv4_frame(40000, 7, "hello")), XDP_PASS);
+  EXPECT_EQ(run(ipv4_frame(40000, 9, "hello")), XDP_PASS);
+  EXPECT_EQ(run(ipv6_frame(40000, 7, "hello")), XDP_PASS);
+  EXPECT_EQ(run(ipv4_frame(40000, 7, "hello", IPPROTO_TCP)), XDP_PASS);
+}
+
+class ReflectProgramTest : public ::testing::Test {
+protected:
+  auto SetUp() -> void override
+  {
+    auto error = std::error_code();
+    counters = bpf::create_map(BPF_MAP_TYPE_PERCPU_ARRAY,
+                               sizeof(std::uint32_t), sizeof(xdp_counters), 1,
+                               error);
+    if (error == std::errc::operation_not_permitted)
+      GTEST_SKIP() << "Loading XDP programs needs CAP_BPF.";
+    ASSERT_FALSE(error) << error.message();
+
+    auto log = std::vector<char>();
+    program = bpf::load_xdp(xdp_reflect_program(7, counters), error, &log);
+    ASSERT_FALSE(error) << error.message() << "\n" << log.data();
+  }
+
+  auto TearDown() -> void override
+  {
+    if (program >= 0)
+      close(program);
+    if (counters >= 0)
+      close(counters);
+  }
+
+  auto run(std::vector<std::byte> &frame) -> std::uint32_t
+  {
+    auto error = std::error_code();
+    auto action = bpf::test_run(program, frame, error);
+    EXPECT_FALSE(error) << error.message();
+    return action;
+  }
+
+  int counters = -1;
+  int program = -1;
+};
+
+TEST_F(ReflectProgramTest, EchoesIPv4)
+{
+  auto frame = ipv4_frame(40000, 7, "hello");
+  auto expected = frame;
+  ASSERT_TRUE(reflect(expected));
+
+  EXPECT_EQ(run(frame), XDP_TX);
+  EXPECT_EQ(frame, expected);
+}
+
+TEST_F(ReflectProgramTest, EchoesIPv6)
+{
+  auto frame = ipv6_frame(40000, 7, "hello");
+  auto expected = frame;
+  ASSERT_TRUE(reflect(expected));
+
+  EXPECT_EQ(run(frame), XDP_TX);
+  EXPECT_EQ(frame, expected);
+}
+
+TEST_F(ReflectProgramTest, PassesOtherTraffic)
+{
+  for (auto frame : {ipv4_frame(40000, 9, "hello"),
+                     ipv4_frame(40000, 7, "hello", IPPROTO_TCP),
+                     ipv6_frame(40000, 9, "hello")})
+  {
+    auto original = frame;
+    EXPECT_EQ(run(frame), XDP_PASS);
+    EXPECT_EQ(frame, original);
+  }
+
+  // Multicast frames are left to the kernel.
+  auto frame = ipv4_frame(40000, 7, "hello");
+  frame[0] = std::byte{0x01};
+  EXPECT_EQ(run(frame), XDP_PASS);
+
+  // So are fragments.
+  frame = ipv4_frame(40000, 7, "hello");
+  reinterpret_cast<iphdr *>(frame.data() + ETH_HLEN)->frag_off = htons(IP_MF);
+  EXPECT_EQ(run(frame), XDP_PASS);
+}
+
+TEST_F(ReflectProgramTest, Counters)
+{
+  auto ipv4 = ipv4_frame(40000, 7, "hello");
+  auto ipv6 = ipv6_frame(40000, 7, "hello");
+  auto other = ipv4_frame(40000, 9, "hello");
+  auto ipv4_len = ipv4.size() - ETH_HLEN;
+  auto ipv6_len = ipv6.size() - ETH_HLEN;
+  run(ipv4);
+  run(ipv6);
+  run(other);
+
+  auto error = std::error_code();
+  auto totals = read_counters(counters, error);
+  ASSERT_FALSE(error) << error.message();
+  EXPECT_EQ(totals.packets, 2);
+  EXPECT_EQ(totals.bytes, ipv4_len + ipv6_len);
+}
+
+TEST(XdpServerTest, EchoOnLoopback)
+{
+  auto server = echo::xdp_server(8089, {.interface = "lo", .generic = true});
+  if (auto error = server.start())
+  {
+    if (error == std::errc::operation_not_permitted ||
+        error == std::errc::address_family_not_supported)
+    {
+      GTEST_SKIP() << "AF_XDP is not available: " << error.message();
+    }
+    FAIL() << error.message();
+  }
+  ASSERT_EQ(server.queues(), 1);
+
+  // Nothing listens on the port, so only the AF_XDP socket can reply. The
+  // kernel drops IPv4 loopback addresses that come in as frames, but not
+  // IPv6 ones.
+  auto sockfd = socket(AF_INET6, SOCK_DGRAM, 0);
+  ASSERT_GE(sockfd, 0);
+  auto timeout = timeval{.tv_sec = 2, .tv_usec = 0};
+  setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  // Loopback leaves UDP checksums to an offload that never runs, so the
+  // echo would come back with a partial checksum.
+  auto enable = 1;
+  setsockopt(sockfd, IPPROTO_UDP, UDP_NO_CHECK6_TX, &enable, sizeof(enable));
+  setsockopt(sockfd, IPPROTO_UDP, UDP_NO_CHECK6_RX, &enable, sizeof(enable));
+
+  auto addr = sockaddr_in6{};
+  addr.sin6_family = AF_INET6;
+  addr.sin6_port = htons(8089);
+  addr.sin6_addr = in6addr_loopback;
+  ASSERT_EQ(connect(sockfd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)),
+            0);
+
+  for (auto i = 0; i < 100; ++i)
+  {
+    auto msg = std::string("datagram ") + std::to_string(i);
+    ASSERT_EQ(send(sockfd, msg.data(), msg.size(), 0),
+              static_cast<ssize_t>(msg.size()));
+
+    auto buf = std::array<char, 64>{};
+    auto len = recv(sockfd, buf.data(), buf.size(), 0);
+    ASSERT_EQ(len, static_cast<ssize_t>(msg.size()));
+    EXPECT_EQ(std::string_view(buf.data(), len), msg);
+  }
+
+  close(sockfd);
+  server.stop();
+  EXPECT_EQ(server.queues(), 0);
+}
+// NOLINTEND